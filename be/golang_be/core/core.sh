@@ -1,4 +1,4 @@
-rm constants.go ipc_constants.go crc.go logger.go packet_helper.go server_config.go
+rm constants.go ipc_constants.go crc.go logger.go packet_helper.go server_config.go ipc_transport.go
 rm masterCore 
 
 ln -s ../packet/constants.go constants.go 
@@ -7,8 +7,16 @@ ln -s ../packet/logger.go logger.go
 ln -s ../packet/packet_helper.go packet_helper.go  
 ln -s ../packet/server_config.go server_config.go
 ln -s ../packet/crc.go crc.go 
+ln -s ../packet/ipc_transport.go ipc_transport.go
 
-CORE_GO="masterCore.go exls.go rscript.go site_constants.go crc.go client_helper.go fota.go command_mux.go test_fota.go test_routines.go constants.go server_config.go packet_helper.go logger.go ipc_constants.go db.go ipc_helper.go core_constants.go file_helper.go file_constants.go site_listner.go ack_stress_test.go site.go site_helper.go" 
+CORE_GO="masterCore.go core_main.go exls.go rscript.go site_constants.go crc.go client_helper.go fota.go fw_catalog.go device_stats.go punch_ingest.go employee_dir.go pay_period.go daily_hours.go timeinfo_partition.go xl_stream.go export.go report_cache.go db_stmt.go command_mux.go test_fota.go test_routines.go constants.go server_config.go packet_helper.go logger.go ipc_constants.go ipc_transport.go db.go ipc_helper.go core_constants.go file_helper.go file_constants.go site_listner.go site.go site_helper.go" 
+CORE_TEST="pay_period_test.go db_test.go"
+
+# ./core.sh -bench PayPeriod
+if [ "$1" == "-bench" ]; then
+  go test -vet=off -run '^$' -bench "$2" -benchmem $CORE_GO $CORE_TEST
+  exit
+fi
 
 go build -race $SITE_GO $CORE_GO
 
@@ -0,0 +1,13 @@
+package main
+
+import (
+	"math/rand"
+	"time"
+)
+
+// core on its own, single/ links the rest of it into one binary with the packet server
+func main() {
+	rand.Seed(time.Now().UnixNano())
+	logger_init("_server") //must be first
+	core_run()
+}
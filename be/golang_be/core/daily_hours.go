@@ -0,0 +1,148 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"time"
+
+	"github.com/lib/pq"
+)
+
+// daily_hours has one row per employee per day with a punch: the first login, the last
+// logout (all time_worked_judge looks at) and what they were judged to, worked and anomaly.
+// The punch path keeps it up to date (db_put_punches), a shift change re-judges the
+// employee's days. Reports read it instead of timeinfo
+
+type daily_hours_row struct {
+	id       uint32
+	datework time.Time
+	first_in sql.NullTime
+	last_out sql.NullTime
+}
+
+// weekends have no shift, judged like a day off. An error is the employee directory's,
+// the day is not judged
+func daily_hours_judge(r daily_hours_row) (time.Duration, int, error) {
+	var logins, logouts []time.Time
+	if r.first_in.Valid {
+		logins = []time.Time{r.first_in.Time}
+	}
+	if r.last_out.Valid {
+		logouts = []time.Time{r.last_out.Time}
+	}
+
+	var shift db_single_shift
+	if day := r.datework.Weekday(); day != time.Sunday && day != time.Saturday {
+		e, ok, err := employee_dir_get(r.id)
+		if err != nil {
+			return 0, 0, err
+		}
+		if ok {
+			shift, _ = shift_info_day(e.shift, day)
+		}
+	}
+
+	worked, anomaly, _, _, _ := time_worked_judge(logins, logouts, shift)
+	return worked, anomaly, nil
+}
+
+func daily_hours_scan(rows *sql.Rows) []daily_hours_row {
+	ret, err := daily_hours_read(rows)
+	if err != nil {
+		logger(PRINT_FATAL, "Failed fetching daily hours", err)
+	}
+	return ret
+}
+
+// daily_hours_scan for callers that can recover from a failed read
+func daily_hours_read(rows *sql.Rows) ([]daily_hours_row, error) {
+	var ret []daily_hours_row
+	for rows.Next() {
+		var r daily_hours_row
+		if err := rows.Scan(&r.id, &r.datework, &r.first_in, &r.last_out); err != nil {
+			return nil, err
+		}
+		ret = append(ret, r)
+	}
+	return ret, rows.Err()
+}
+
+// judges the rows, writes worked and anomaly. In tx, nil is outside of any
+func daily_hours_update(tx *sql.Tx, rows []daily_hours_row) error {
+	return daily_hours_update_ctx(context.Background(), tx, rows)
+}
+
+func daily_hours_update_ctx(ctx context.Context, tx *sql.Tx, rows []daily_hours_row) error {
+	if len(rows) == 0 {
+		return nil
+	}
+
+	ids := make([]int64, len(rows))
+	dates := make([]string, len(rows))
+	worked := make([]int64, len(rows))
+	anomaly := make([]int64, len(rows))
+	for i, r := range rows {
+		w, a, err := daily_hours_judge(r)
+		if err != nil {
+			return err
+		}
+		ids[i] = int64(r.id)
+		dates[i] = r.datework.Format(DATE_FORMAT)
+		worked[i] = int64(w / time.Second)
+		anomaly[i] = int64(a)
+	}
+
+	_, err := db_stmt_exec_ctx(ctx, tx, STMT_DAILY_HOURS_JUDGED, pq.Array(ids), pq.Array(dates), pq.Array(worked), pq.Array(anomaly))
+	return err
+}
+
+func daily_hours_judge_where(cond string, args ...interface{}) error {
+	rows, err := db.Query(`select id, datework, first_in, last_out from daily_hours where `+cond, args...)
+	if err != nil {
+		return err
+	}
+	judge, err := daily_hours_read(rows)
+	rows.Close()
+	if err != nil {
+		return err
+	}
+
+	if err := daily_hours_update(nil, judge); err != nil {
+		return err
+	}
+	if len(judge) > 0 {
+		logger(PRINT_NORMAL, "judged", len(judge), "employee days")
+	}
+	return nil
+}
+
+// after the new shift went into employeeinfo and the directory was invalidated. On an
+// error the days keep the old shift's judgement until the next shift change
+func daily_hours_rejudge(id uint32) {
+	if err := daily_hours_judge_where(`id = $1`, id); err != nil {
+		logger(PRINT_WARN, "Failed to re-judge daily hours for id", id, err)
+	}
+}
+
+// a daily_hours added to an existing install starts out empty, fill it from timeinfo once
+func daily_hours_init() {
+	var filled bool
+	err := db.QueryRow(`select exists (select 1 from daily_hours)`).Scan(&filled)
+	if err != nil {
+		logger(PRINT_FATAL, "Could not read daily_hours, was setup.sql run?", err)
+	}
+
+	if !filled {
+		res, err := db.Exec(`INSERT INTO daily_hours (datework, id, first_in, last_out)
+			SELECT punched_at::date, employee, min(punched_at::time) FILTER (WHERE type = 'login'), max(punched_at::time) FILTER (WHERE type = 'logout')
+			FROM timeinfo GROUP BY 1, 2`)
+		if err != nil {
+			logger(PRINT_FATAL, "Could not fill daily_hours from timeinfo", err)
+		}
+		n, _ := res.RowsAffected()
+		logger(PRINT_NORMAL, "daily_hours filled from timeinfo,", n, "employee days")
+	}
+	if err := daily_hours_judge_where(`anomaly is null`); err != nil {
+		logger(PRINT_FATAL, "Failed to judge daily hours", err)
+	}
+}
@@ -1,12 +1,12 @@
 package main
 
 import "time"
+import "context"
 import "fmt"
 import "log"
 import "database/sql"
-import _ "github.com/lib/pq"
+import "github.com/lib/pq"
 import "strings"
-import "os/exec"
 import "strconv"
 import "regexp"
 import "sort"
@@ -20,6 +20,14 @@ const (
 	databasename = "checkin_co"
 )
 
+// pool. database/sql keeps 2 idle connections by default, fewer than the punch path, the
+// exports and the directory use at once, a burst past that closed its extra connections
+// and the next one opened them again
+const DB_MAX_OPEN_CONNS = (16)
+const DB_MAX_IDLE_CONNS = (8)
+const DB_CONN_MAX_IDLE_S = (300)
+const DB_CONN_MAX_LIFETIME_S = (3600)
+
 const UPDATE = true
 const NEW_USER = false
 const TIME_FORMAT_SHIFT = "15:04"
@@ -42,10 +50,13 @@ func check_and_sanitize_email(email string) (bool, string) {
 	return false, ""
 }
 
+func db_con_string() string {
+	return fmt.Sprintf("host=%s port=%d user=%s  dbname=%s sslmode=disable", hostname, host_port, username, databasename) + db_time_zone_param()
+}
+
 func db_connect() {
-	pg_con_string := fmt.Sprintf("host=%s port=%d user=%s  dbname=%s sslmode=disable", hostname, host_port, username, databasename)
 	var err error
-	db, err = sql.Open("postgres", pg_con_string)
+	db, err = sql.Open("postgres", db_con_string())
 
 	if err != nil {
 		logger(PRINT_FATAL, "Could not connect to database!")
@@ -56,6 +67,12 @@ func db_connect() {
 	if err != nil {
 		logger(PRINT_FATAL, "Could not Ping database!")
 	}
+
+	db.SetMaxOpenConns(DB_MAX_OPEN_CONNS)
+	db.SetMaxIdleConns(DB_MAX_IDLE_CONNS)
+	db.SetConnMaxIdleTime(DB_CONN_MAX_IDLE_S * time.Second)
+	db.SetConnMaxLifetime(DB_CONN_MAX_LIFETIME_S * time.Second)
+	db_stmts_prepare()
 }
 
 func validateTime(start string, end string) bool {
@@ -118,7 +135,7 @@ func db_add_employee_salary_shift(cmd Cmd, update bool) Cmd_resp_json {
 		return ret
 	}
 
-	row := db.QueryRow(`select id from employeeinfo where email=$1;`, cleaned_email)
+	row := db.QueryRow(`select id from employeeinfo where email=$1 and deleted_at is null;`, cleaned_email)
 	if err != nil {
 		log.Fatal(err)
 	}
@@ -138,7 +155,7 @@ func db_add_employee_salary_shift(cmd Cmd, update bool) Cmd_resp_json {
 		logger(PRINT_FATAL, "Could not add user email!")
 	}
 
-	row = db.QueryRow(`select id from employeeinfo where employee=$1;`, cmd.Name)
+	row = db.QueryRow(`select id from employeeinfo where employee=$1 and deleted_at is null;`, cmd.Name)
 	if err != nil {
 		log.Fatal(err)
 	}
@@ -159,7 +176,7 @@ func db_add_employee_salary_shift(cmd Cmd, update bool) Cmd_resp_json {
 
 	if update {
 		/* updating user, make sure ID exists in databse */
-		row := db.QueryRow(`select id from employeeinfo where id=$1;`, cmd.Id)
+		row := db.QueryRow(`select id from employeeinfo where id=$1 and deleted_at is null;`, cmd.Id)
 		if err != nil {
 			log.Fatal(err)
 		}
@@ -296,81 +313,122 @@ func db_add_employee_salary_shift(cmd Cmd, update bool) Cmd_resp_json {
 		}
 
 		if cmd.Shift_m_s != "" && cmd.Shift_m_e != "" {
-			_, err = db.Exec(`UPDATE employeeinfo SET shift_m_s = $1, shift_m_e = $2 where email=$3`, cmd.Shift_m_s, cmd.Shift_m_e, cleaned_email)
+			_, err = db.Exec(`UPDATE employeeinfo SET shift_m_s = $1, shift_m_e = $2 where email=$3 and deleted_at is null`, cmd.Shift_m_s, cmd.Shift_m_e, cleaned_email)
 			if err != nil {
 				log.Fatal(err)
 			}
 		}
 
 		if cmd.Shift_t_s != "" && cmd.Shift_t_e != "" {
-			_, err = db.Exec(`UPDATE employeeinfo SET shift_t_s = $1, shift_t_e = $2 where email=$3`, cmd.Shift_t_s, cmd.Shift_t_e, cleaned_email)
+			_, err = db.Exec(`UPDATE employeeinfo SET shift_t_s = $1, shift_t_e = $2 where email=$3 and deleted_at is null`, cmd.Shift_t_s, cmd.Shift_t_e, cleaned_email)
 			if err != nil {
 				log.Fatal(err)
 			}
 		}
 
 		if cmd.Shift_w_s != "" && cmd.Shift_w_e != "" {
-			_, err = db.Exec(`UPDATE employeeinfo SET shift_w_s = $1, shift_w_e = $2 where email=$3`, cmd.Shift_w_s, cmd.Shift_w_e, cleaned_email)
+			_, err = db.Exec(`UPDATE employeeinfo SET shift_w_s = $1, shift_w_e = $2 where email=$3 and deleted_at is null`, cmd.Shift_w_s, cmd.Shift_w_e, cleaned_email)
 			if err != nil {
 				log.Fatal(err)
 			}
 		}
 
 		if cmd.Shift_th_s != "" && cmd.Shift_th_e != "" {
-			_, err = db.Exec(`UPDATE employeeinfo SET shift_th_s = $1, shift_th_e = $2 where email=$3`, cmd.Shift_th_s, cmd.Shift_th_e, cleaned_email)
+			_, err = db.Exec(`UPDATE employeeinfo SET shift_th_s = $1, shift_th_e = $2 where email=$3 and deleted_at is null`, cmd.Shift_th_s, cmd.Shift_th_e, cleaned_email)
 			if err != nil {
 				log.Fatal(err)
 			}
 		}
 
 		if cmd.Shift_f_s != "" && cmd.Shift_f_e != "" {
-			_, err = db.Exec(`UPDATE employeeinfo SET shift_f_s = $1, shift_f_e = $2 where email=$3`, cmd.Shift_f_s, cmd.Shift_f_e, cleaned_email)
+			_, err = db.Exec(`UPDATE employeeinfo SET shift_f_s = $1, shift_f_e = $2 where email=$3 and deleted_at is null`, cmd.Shift_f_s, cmd.Shift_f_e, cleaned_email)
 			if err != nil {
 				log.Fatal(err)
 			}
 		}
 	}
 
+	if update {
+		employee_dir_invalidate(uint32(cmd.Id))
+		daily_hours_rejudge(uint32(cmd.Id))
+	} else {
+		employee_dir_invalidate_all() // new id is the db's, and the shifts went in by email
+	}
 	return ret
 }
 
-func db_put(deviceId uint64, signInOrSignOut uint8, uid uint32, Time time.Time) bool {
-	var signInOrSignOut_string string
+// One statement per batch of punches. Names come from the employee directory, a punch
+// with no matching employee is not inserted. inserted[i] says if batch[i] made it in.
+// On an error (ctx running out included) nothing was committed, the batch is the caller's
+func db_put_punches(ctx context.Context, batch []punch) ([]bool, error) {
+	var ids []int64
+	var ats, dates, types, times []string
+	inserted := make([]bool, len(batch))
 
-	emp, err := db_get_name_from_id(uid)
-	if err {
-		logger_id(PRINT_WARN, deviceId, "uid", uid, "has no matching employee?") //TODO: send a warning to the device?
-		return false
+	for i, p := range batch {
+		_, ok, err := employee_dir_get(p.uid)
+		if err != nil {
+			return nil, err
+		}
+		if !ok {
+			logger_id(PRINT_WARN, p.device_id, "uid", p.uid, "has no matching employee?")
+			continue
+		}
+		inserted[i] = true
+
+		current_time_local := p.at.Local().Truncate(time.Second)
+		t := "logout"
+		if p.sign_in == PARALLAX_SIGN_IN {
+			t = "login"
+		}
+
+		ids = append(ids, int64(p.uid))
+		ats = append(ats, current_time_local.Format(time.RFC3339))
+		dates = append(dates, current_time_local.Format("2006-01-02"))
+		types = append(types, t)
+		times = append(times, current_time_local.Format("15:4:5"))
+		logger_id(PRINT_NORMAL, p.device_id, "uid = ", p.uid, "date=", dates[len(dates)-1], "signInOrSignOut=", t, "current_time=", times[len(times)-1])
 	}
 
-	if signInOrSignOut == PARALLAX_SIGN_IN {
-		logger_id(PRINT_NORMAL, deviceId, "uid", uid, "Just signed in")
-		signInOrSignOut_string = "login"
-	} else {
-		logger_id(PRINT_NORMAL, deviceId, "uid", uid, "Just signed out")
-		signInOrSignOut_string = "logout"
+	if len(ids) == 0 {
+		return inserted, nil
 	}
 
-	var current_time_local time.Time
-	var current_date, current_time string
+	/* the punches, and the days they touched in daily_hours, in one transaction */
+	tx, err := db.BeginTx(ctx, nil)
+	if err != nil {
+		return nil, err
+	}
+	defer tx.Rollback() // no-op once committed
 
-	/* if not given a time, use the current time */
-	if Time.IsZero() {
-		current_time_local = time.Now().Local()
-		current_date = current_time_local.Format("2006-01-02")
-		current_time = current_time_local.Format("15:4:5")
-	} else { /*Fake current time, used for testing */
-		current_time_local = Time
-		current_date = current_time_local.Format("2006-01-02")
-		current_time = current_time_local.Format("15:4:5")
+	_, err = db_stmt_exec_ctx(ctx, tx, STMT_PUNCH_INSERT, pq.Array(ids), pq.Array(ats), pq.Array(types))
+	if err != nil {
+		return nil, err
 	}
 
-	logger_id(PRINT_NORMAL, deviceId, "uid = ", uid, "date=", current_date, "signInOrSignOut=", signInOrSignOut_string, "current_time=", current_time)
-	_, err2 := db.Exec("INSERT INTO timeinfo VALUES ($1, $2, $3, $4, $5);", uid, emp, current_date, signInOrSignOut_string, current_time)
-	if err2 != nil {
-		log.Fatal(err)
+	rows, err := db_stmt_query_ctx(ctx, tx, STMT_DAILY_HOURS_UPSERT, pq.Array(ids), pq.Array(dates), pq.Array(types), pq.Array(times))
+	if err != nil {
+		return nil, err
 	}
-	return true
+	touched, err := daily_hours_read(rows)
+	rows.Close()
+	if err != nil {
+		return nil, err
+	}
+
+	if err = daily_hours_update_ctx(ctx, tx, touched); err != nil {
+		return nil, err
+	}
+	if err = tx.Commit(); err != nil {
+		return nil, err
+	}
+
+	days := make([]time.Time, len(touched))
+	for i, r := range touched {
+		days[i] = r.datework
+	}
+	report_cache_touch(days)
+	return inserted, nil
 }
 
 func db_get() []db_q_fill {
@@ -397,7 +455,7 @@ func db_get() []db_q_fill {
 }
 
 func db_delete_user(id uint32) bool {
-	row := db.QueryRow(`select id from employeeinfo where id=$1;`, id)
+	row := db.QueryRow(`select id from employeeinfo where id=$1 and deleted_at is null;`, id)
 
 	var id_valid int
 	switch err := row.Scan(&id_valid); err {
@@ -411,98 +469,52 @@ func db_delete_user(id uint32) bool {
 		logger(PRINT_FATAL, "Could not delete user from db!", id)
 	}
 
-	_, err := db.Exec(`DELETE FROM employeeinfo WHERE id=$1`, id)
+	/* their punches reference them, the row stays */
+	_, err := db.Exec(`UPDATE employeeinfo SET deleted_at = now() WHERE id=$1`, id)
 	if err != nil {
 		log.Fatal(err)
 	}
+	employee_dir_invalidate(id)
 	return true
 }
 
 func db_get_salary(id uint32) (int, bool) {
-	row := db.QueryRow(`select salary from employeeinfo where id=$1;`, id)
-
-	var Salary int
-
-	switch err := row.Scan(&Salary); err {
-	case sql.ErrNoRows:
-		logger(PRINT_WARN, "No matching ID for this username", id)
+	e, ok, err := employee_dir_get(id)
+	if err != nil {
 		return 0, false
-	case nil:
-		return Salary, true
-	default:
-		logger(PRINT_FATAL, "Could not get user salary from db!", id)
+	}
+	if !ok {
+		logger(PRINT_WARN, "No matching ID for this username", id)
 		return 0, false
 	}
+	return e.info.Salary, true
 }
 
 func db_get_name_from_id(id uint32) (string, bool) {
 	logger(PRINT_NORMAL, "trying to match id = ", id, ", to user!")
 
-	row := db.QueryRow(`select employee from employeeinfo where id=$1;`, id)
-
-	var employee string
-	switch err := row.Scan(&employee); err {
-	case sql.ErrNoRows:
+	e, ok, err := employee_dir_get(id)
+	if err != nil {
+		return "", true
+	}
+	if !ok {
 		logger(PRINT_WARN, "No matching ID for this username", id)
 		return "", true
-	case nil:
-		return employee, false
-	default:
-		logger(PRINT_FATAL, "Could not get user name from db (from ID)!", id)
-		return "", false
 	}
+	return e.info.Name, false
 }
 
+// nil if the directory could not be read, callers that write something lasting use
+// employee_dir_all and fail instead
 func db_get_employees() []db_get_employee_info {
-	var ret []db_get_employee_info
-	r := db_get_employee_info{}
-
-	rows, err := db.Query("select id, email, employee, Salary from employeeinfo")
-	if err != nil {
-		logger(PRINT_FATAL, "failed in initial quary #1, db_get_employees", err)
-	}
-	defer rows.Close()
-	for rows.Next() {
-		err := rows.Scan(&r.Id, &r.Email, &r.Name, &r.Salary)
-		if err != nil {
-			log.Fatal(err)
-		}
-		ret = append(ret, r)
-	}
-	err = rows.Err()
-	if err != nil {
-		logger(PRINT_FATAL, "failed in final quary #2, db_get_employees", err)
-	}
+	ret, _ := employee_dir_all()
 	return ret
 }
 
 func db_get_employee_shift_day(id uint32, day time.Weekday) (db_single_shift, bool) {
 	info, valid := db_get_employee_shift(id)
-	ret := db_single_shift{}
 	if valid {
-		if day == 1 {
-			ret.Shift_start = info.Shift_m_s
-			ret.Shift_end = info.Shift_m_e
-			return ret, true
-		}
-		if day == 2 {
-			ret.Shift_start = info.Shift_t_s
-			ret.Shift_end = info.Shift_t_e
-			return ret, true
-		}
-		if day == 3 {
-			ret.Shift_start = info.Shift_w_s
-			ret.Shift_end = info.Shift_w_e
-			return ret, true
-		}
-		if day == 4 {
-			ret.Shift_start = info.Shift_th_s
-			ret.Shift_end = info.Shift_th_e
-			return ret, true
-		}
-		if day == 5 {
-			ret.Shift_start = info.Shift_f_s
-			ret.Shift_end = info.Shift_f_e
+		if ret, ok := shift_info_day(info, day); ok {
 			return ret, true
 		}
 	}
@@ -510,229 +522,107 @@ func db_get_employee_shift_day(id uint32, day time.Weekday) (db_single_shift, bo
 	return db_single_shift{}, false
 }
 
-func db_get_employee_shift(id uint32) (Shift_info, bool) {
-	var ret Shift_info_sql
-	var retreal Shift_info
-
-	row := db.QueryRow(`select shift_m_s, shift_m_e,
- 											       shift_t_s, shift_t_e,
-														 shift_w_s, shift_w_e,
-														 shift_th_s, shift_th_e,
-														 shift_f_s, shift_f_e
-														 from employeeinfo where id = $1`, id)
-
-	switch err := row.Scan(&ret.Shift_m_s, &ret.Shift_m_e,
-		&ret.Shift_t_s, &ret.Shift_t_e,
-		&ret.Shift_w_s, &ret.Shift_w_e,
-		&ret.Shift_th_s, &ret.Shift_th_e,
-		&ret.Shift_f_s, &ret.Shift_f_e); err {
-	case sql.ErrNoRows:
-		logger(PRINT_WARN, "No such user exists with id = ", id)
-		return retreal, false
-		break
-	case nil:
-	default:
-		logger(PRINT_FATAL, "Could not get user shift infro from ID ", id)
-	}
-
-	if ret.Shift_m_s.Valid && ret.Shift_m_e.Valid {
-		retreal.Shift_m_s = ret.Shift_m_s.Time
-		retreal.Shift_m_e = ret.Shift_m_e.Time
-	}
-
-	if ret.Shift_t_s.Valid && ret.Shift_t_e.Valid {
-		retreal.Shift_t_s = ret.Shift_t_s.Time
-		retreal.Shift_t_e = ret.Shift_t_e.Time
-	}
-
-	if ret.Shift_w_s.Valid && ret.Shift_w_e.Valid {
-		retreal.Shift_w_s = ret.Shift_w_s.Time
-		retreal.Shift_w_e = ret.Shift_w_e.Time
-	}
+// the start and end of info on day, false on the weekend
+func shift_info_day(info Shift_info, day time.Weekday) (db_single_shift, bool) {
+	ret := db_single_shift{}
+	if day == 1 {
+		ret.Shift_start = info.Shift_m_s
+		ret.Shift_end = info.Shift_m_e
+		return ret, true
+	}
+	if day == 2 {
+		ret.Shift_start = info.Shift_t_s
+		ret.Shift_end = info.Shift_t_e
+		return ret, true
+	}
+	if day == 3 {
+		ret.Shift_start = info.Shift_w_s
+		ret.Shift_end = info.Shift_w_e
+		return ret, true
+	}
+	if day == 4 {
+		ret.Shift_start = info.Shift_th_s
+		ret.Shift_end = info.Shift_th_e
+		return ret, true
+	}
+	if day == 5 {
+		ret.Shift_start = info.Shift_f_s
+		ret.Shift_end = info.Shift_f_e
+		return ret, true
+	}
+	return ret, false
+}
 
-	if ret.Shift_th_s.Valid && ret.Shift_th_e.Valid {
-		retreal.Shift_th_s = ret.Shift_th_s.Time
-		retreal.Shift_th_e = ret.Shift_th_e.Time
+func db_get_employee_shift(id uint32) (Shift_info, bool) {
+	e, ok, err := employee_dir_get(id)
+	if err != nil {
+		return Shift_info{}, false
 	}
-
-	if ret.Shift_f_s.Valid && ret.Shift_f_e.Valid {
-		retreal.Shift_f_s = ret.Shift_f_s.Time
-		retreal.Shift_f_e = ret.Shift_f_e.Time
+	if !ok {
+		logger(PRINT_WARN, "No such user exists with id = ", id)
+		return Shift_info{}, false
 	}
-
-	return retreal, true
+	return e.shift, true
 }
 
 func db_get_emplyee_from_id(id uint32) (db_get_employee_info, bool) {
 	logger(PRINT_NORMAL, "Fetching emplyee with id =", id)
 
-	var ret db_get_employee_info
-
-	row := db.QueryRow(`select id, email, employee from employeeinfo where id = $1`, id)
-
-	switch err := row.Scan(&ret.Id, &ret.Email, &ret.Name); err {
-	case sql.ErrNoRows:
+	e, ok, err := employee_dir_get(id)
+	if err != nil {
+		return db_get_employee_info{}, false
+	}
+	if !ok {
 		logger(PRINT_WARN, "No such user exists with id = ", id)
-		return ret, false
-		break
-	case nil:
-	default:
-		logger(PRINT_FATAL, "Could not get user employee from ID ", id)
+		return db_get_employee_info{}, false
 	}
-	return ret, true
+	return e.info, true
 }
 
-// If an emplyee is supposed to work on a day, their work will be judged versus their expted shift */
-// if they
-// 	A) Are supposed to work and,
-//      1) login, logout in a sensible manner, work time is returned
-//      2) forget to do either login, or logout, logout/login time that is missing will be taken from shift dabatase and it will be flagged
-//			3) not login AND logout, 0 will be retuend
-//  b) are not supposed to work and,
-//			1)  login, logout in a sensible manner, work time is returned, but this is flagged
-//      2)  missing eitehr log in or logout time, flagged as error, 0 work time returned
-//  c) worked a negative amount of time, (logged in befoer they logged out), this is flagged as an error
-//  d) Did no work on a day they are not uspposed to wrok
-//     1 ) 0 time is returned, and it is "flagged"
-//  for multiple login/logout cases, the earliest login is considered and the latest logout
-//
-func db_get_time_worked_in_day(id uint32, Time time.Time) (time.Duration, int, db_single_shift, db_single_shift, int) {
-	if Time.Weekday() == 0 || Time.Weekday() == 6 {
-		logger(PRINT_WARN, "Tried to check work hours on weekend, not-supported")
-		return 0, 0, db_single_shift{}, db_single_shift{}, 0
-	}
-
-	_, exists := db_get_emplyee_from_id(id)
-	if !exists {
-		logger(PRINT_FATAL, "Tried to quary hours worked for emplyee that does not exist!", id)
-	}
-
-	date := Time.Format(DATE_FORMAT)
-
-	var time_info_login []time.Time
-	var time_info_logout []time.Time
-	var time_info time.Time
-
-	rows, err := db.Query(`select timestamp from timeinfo where id = $1 and datework = $2 and type = 'login'`, id, date)
-	if err != nil {
-		log.Fatal(err)
-	}
-	defer rows.Close()
-	for rows.Next() {
-		err := rows.Scan(&time_info)
-		if err != nil {
-			logger(PRINT_FATAL, "Failed fetching logins - loop")
-		}
-		time_info_login = append(time_info_login, time_info)
-	}
-	err = rows.Err()
-	if err != nil {
-		logger(PRINT_FATAL, "Failed fetching logins")
-	}
+// Every employee's first login and last logout of each day between from and to (DATE_FORMAT, inclusive)
+func db_get_daily_hours(from string, to string) punch_set {
+	ret := punch_set{}
 
-	rows, err = db.Query(`select timestamp from timeinfo where id = $1 and datework = $2 and type = 'logout'`, id, date)
+	rows, err := db_stmt_query(nil, STMT_DAILY_HOURS_RANGE, from, to)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer rows.Close()
-	for rows.Next() {
-		err := rows.Scan(&time_info)
-		if err != nil {
-			logger(PRINT_FATAL, "Failed fetching logout - loop")
-		}
-		time_info_logout = append(time_info_logout, time_info)
-	}
-	err = rows.Err()
-	if err != nil {
-		logger(PRINT_FATAL, "Failed fetching logouts")
-	}
-
-	shift, valid := db_get_employee_shift_day(id, Time.Weekday())
-	if !valid {
-		logger(PRINT_FATAL, "Invalid shift returned")
-	}
-
-	/* used to let other APIs know if a login/logout was taking from shift
-	infromation instead of real values */
-	var missing_login_logout int
 
-	/* no login AND logout times  */
-	if len(time_info_login) == 0 && len(time_info_logout) == 0 {
-		/* not supposed to work today */
-		if shift.Shift_start.IsZero() {
-			return 0, TIME_WORKED_VALID, db_single_shift{}, db_single_shift{}, 0
+	for _, r := range daily_hours_scan(rows) {
+		days, ok := ret[r.id]
+		if !ok {
+			days = make(map[string]*day_punches)
+			ret[r.id] = days
 		}
-		return 0, TIME_WORKED_MISSING, db_single_shift{}, db_single_shift{}, 0
-	}
-
-	var ret int
-
-	/* worked on wrong day, mark it as such */
-	if shift.Shift_start.IsZero() {
-		ret = TIME_WORKED_ON_WRONG_DAY
-	}
-
-	if len(time_info_login) == 0 {
-		if shift.Shift_start.IsZero() {
-			ret = TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY
-			goto calculate_time
-		}
-		missing_login_logout = TIME_MISSING_LOGIN
-		time_info_login = append(time_info_login, shift.Shift_start)
-		ret = TIME_WORKED_MISSING_ONE
-	}
 
-	if len(time_info_logout) == 0 {
-		if shift.Shift_end.IsZero() {
-			ret = TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY
-			goto calculate_time
+		day := &day_punches{}
+		if r.first_in.Valid {
+			day.logins = []time.Time{r.first_in.Time}
 		}
-		missing_login_logout = TIME_MISSING_LOGOUT
-		time_info_logout = append(time_info_logout, shift.Shift_end)
-		ret = TIME_WORKED_MISSING_ONE
-	}
-
-calculate_time:
-	var first_in, last_out time.Time
-
-	if len(time_info_login) > 0 {
-		first_in = time_info_login[0]
-		for _, login := range time_info_login {
-			if login.Before(first_in) {
-				first_in = login
-			}
+		if r.last_out.Valid {
+			day.logouts = []time.Time{r.last_out.Time}
 		}
+		days[r.datework.Format(DATE_FORMAT)] = day
 	}
+	return ret
+}
 
-	if len(time_info_logout) > 0 {
-		last_out = time_info_logout[0]
-		for _, logout := range time_info_logout {
-			if logout.After(last_out) {
-				last_out = logout
-			}
-		}
+// one day of one employee, judged by time_worked_judge. Reports use pay_period_load
+func db_get_time_worked_in_day(id uint32, Time time.Time) (time.Duration, int, db_single_shift, db_single_shift, int) {
+	if Time.Weekday() == 0 || Time.Weekday() == 6 {
+		logger(PRINT_WARN, "Tried to check work hours on weekend, not-supported")
+		return 0, 0, db_single_shift{}, db_single_shift{}, 0
 	}
 
-	total_work := last_out.Sub(first_in)
-
-	if ret != TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
-		if total_work < 0 {
-			return 0, TIME_WORKED_NEGATIVE, db_single_shift{}, db_single_shift{}, 0
-		}
+	_, exists := db_get_emplyee_from_id(id)
+	if !exists {
+		logger(PRINT_FATAL, "Tried to quary hours worked for emplyee that does not exist!", id)
 	}
 
-	/* actuall shift details */
-	var shift_actual, shift_expected db_single_shift
-	shift_actual.Shift_start = first_in
-	shift_actual.Shift_end = last_out
-
-	shift_expected.Shift_start = shift.Shift_start
-	shift_expected.Shift_end = shift.Shift_end
-
-	if ret == TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
-		total_work = 0
-	}
-	return total_work, ret, shift_expected, shift_actual, missing_login_logout
+	date := Time.Format(DATE_FORMAT)
+	pp := pay_period{punches: db_get_daily_hours(date, date)}
+	return pay_period_day(&pp, id, Time)
 }
 
 func db_get_shift_duration_weekday(id uint32, Time time.Time) time.Duration {
@@ -774,114 +664,27 @@ exit:
 	return int(randomdeviceId)
 }
 
+func db_put_device_stats(deviceId uint64, stats Device_stats, snapshot []byte) {
+	_, err := db_stmt_exec(nil, STMT_DEVICE_STATS_INSERT, deviceId, time.Now(), stats.Uptime_s, stats.Heap_free, stats.Heap_min_free, stats.Heap_largest_block, string(snapshot))
+	if err != nil {
+		logger_id(PRINT_WARN, deviceId, "Failed to insert device stats, err =", err)
+	}
+}
+
 func db_truncate_timeinfo() {
-	_, err := db.Exec(`TRUNCATE timeinfo`)
+	_, err := db.Exec(`TRUNCATE timeinfo, daily_hours`)
 	if err != nil {
 		logger(PRINT_FATAL, "Failed to truncate time info", err)
 	}
+	report_cache_touch_all()
 }
 
 func db_truncate_employeeifo() {
-	_, err := db.Exec(`TRUNCATE employeeinfo`)
+	_, err := db.Exec(`TRUNCATE employeeinfo, timeinfo, daily_hours`) // timeinfo references employeeinfo
 	if err != nil {
 		logger(PRINT_FATAL, "Failed to truncate employee info", err)
 	}
-}
-
-func db_get_pay_period_arr(id uint32, Time time.Time) []db_composite_per_day {
-	if Time.Day() != 1 && Time.Day() != 16 {
-		logger(PRINT_FATAL, "Can only accept on 16 and 1st day of month")
-	}
-	var lastDate int
-	var ret []db_composite_per_day
-	var day db_composite_per_day
-	var totalDaysInPeriod int
-
-	if Time.Day() == 1 {
-		totalDaysInPeriod = 15
-	} else { /*magic to calculate last day of the month */
-		firstDate := Time.AddDate(0, 0, -15)
-		lastDate = firstDate.AddDate(0, 1, -1).Day()
-		totalDaysInPeriod = lastDate - 15
-	}
-
-	for i := 0; i < totalDaysInPeriod; i++ {
-		if Time.AddDate(0, 0, i).Weekday() == 0 || Time.AddDate(0, 0, i).Weekday() == 6 {
-			continue
-		}
-		total_worked, valid, expected_shift, actual_shift, missing := db_get_time_worked_in_day(id, Time.AddDate(0, 0, i))
-		shift_duration_expected := db_get_shift_duration_weekday(id, Time.AddDate(0, 0, i))
-
-		day.date = Time.AddDate(0, 0, i)
-		day.actual_shift = actual_shift
-		day.expected_shift = expected_shift
-		day.actual_hours = total_worked
-		day.anomolies = valid
-		day.expected_hours = shift_duration_expected
-
-		if missing == TIME_MISSING_LOGIN {
-			day.actual_shift.Shift_start = time.Time{}
-		}
-
-		if missing == TIME_MISSING_LOGOUT {
-			day.actual_shift.Shift_end = time.Time{}
-		}
-
-		if missing == TIME_MISSING_LOGIN || missing == TIME_MISSING_LOGOUT {
-			logger(PRINT_NORMAL, day.actual_shift, "here!!")
-		}
-
-		day.delta = day.expected_hours - day.actual_hours
-		ret = append(ret, day)
-	}
-
-	return ret
-
-}
-
-func db_get_total_hours_in_period(id uint32, Time time.Time) db_hours_pay_period {
-	if Time.Day() != 1 && Time.Day() != 16 {
-		logger(PRINT_FATAL, "Can only accept on 16 and 1st day of month")
-	}
-	var lastDate int
-	var ret db_hours_pay_period
-
-	startDate := Time.Day()
-
-	if Time.Day() == 1 {
-		lastDate = 15
-	} else {
-		//magic to calculate last day of the month
-
-		//goto first date
-		Time = Time.AddDate(0, 0, -15)
-
-		//add 1 month, subtract 1 day
-		lastDate = Time.AddDate(0, 1, -1).Day()
-	}
-
-	for i := startDate; i <= lastDate; i++ {
-		if Time.AddDate(0, 0, i).Weekday() == 0 || Time.AddDate(0, 0, i).Weekday() == 6 {
-			continue
-		}
-		total_worked, valid, _, _, _ := db_get_time_worked_in_day(id, Time.AddDate(0, 0, i))
-		shift_duration := db_get_shift_duration_weekday(id, Time.AddDate(0, 0, i))
-
-		ret.actual_hours += total_worked
-		if valid != TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
-			ret.expected_hours += shift_duration
-		}
-
-		if valid != 0 {
-			ret.anomolies = true
-		}
-	}
-	hourly_wage, valid := db_get_employee_hourly_salary(id)
-	if valid {
-		ret.exptected_sal = ret.expected_hours.Hours() * hourly_wage
-		ret.actual_sal = ret.actual_hours.Hours() * hourly_wage
-	}
-	return ret
+	employee_dir_invalidate_all()
 }
 
 func db_get_anomoly_string(n int) string {
@@ -923,25 +726,42 @@ func db_get_employee_hourly_salary(id uint32) (float64, bool) {
 	return float64(salery) / (52 * dur.Hours()), true
 }
 
+// the device's whole roster is looked up in one query
 func db_sync_users(emp_list []employee) (bool, []byte) {
-	logger(PRINT_NORMAL, "here")
-
 	ret := make([]byte, MAX_USERS_DEVICE)
+	if len(emp_list) == 0 {
+		return true, ret
+	}
 
-	for _, employee := range emp_list {
-		row := db.QueryRow(`select id from employeeinfo where id=$1;`, employee.uid)
+	uids := make([]int64, len(emp_list))
+	for i, employee := range emp_list {
+		uids[i] = int64(employee.uid)
+	}
 
-		var id int
-		switch err := row.Scan(&id); err {
-		case sql.ErrNoRows:
-			logger(PRINT_NORMAL, "User don't exists= ", employee.id, employee.name)
-			ret[employee.id] = SYNC_DELETE_USER_BIT_FIELD
-			break
-		case nil:
+	rows, err := db_stmt_query(nil, STMT_SYNC_ROSTER, pq.Array(uids))
+	if err != nil {
+		logger(PRINT_FATAL, "Failed to sync DB's...!", err)
+	}
+	found := make(map[uint32]bool, len(emp_list))
+	for rows.Next() {
+		var id uint32
+		if err := rows.Scan(&id); err != nil {
+			logger(PRINT_FATAL, "Failed to sync DB's...!", err)
+		}
+		found[id] = true
+	}
+	if err := rows.Err(); err != nil {
+		logger(PRINT_FATAL, "Failed to sync DB's...!", err)
+	}
+	rows.Close()
+
+	for _, employee := range emp_list {
+		if found[employee.uid] {
 			logger(PRINT_NORMAL, "User still exists= ", employee.id, employee.name)
 			ret[employee.id] = SYNC_USER_EXISTS_BIT_FIELD
-		default:
-			logger(PRINT_FATAL, "Failed to sync DB's...!")
+		} else {
+			logger(PRINT_NORMAL, "User don't exists= ", employee.id, employee.name)
+			ret[employee.id] = SYNC_DELETE_USER_BIT_FIELD
 		}
 	}
 	return true, ret
@@ -1006,15 +826,3 @@ func db_site_password_verify(user_name, password string) bool {
 		return false
 	}
 }
-
-func db_export_csv() {
-	cmd := exec.Command(">output.csv")
-	cmd.Dir = "./static"
-	cmd.Run()
-
-	str := fmt.Sprintf("COPY timeinfo TO '/usr/local/timeScan/core/static/output.csv' WITH (FORMAT CSV, HEADER);")
-	_, err := db.Exec(str)
-	if err != nil {
-		log.Fatal(err)
-	}
-}
@@ -0,0 +1,171 @@
+package main
+
+import (
+	"context"
+	"database/sql"
+	"sync/atomic"
+	"time"
+)
+
+// The statements core runs over and over, prepared once at startup (db_connect) instead of
+// postgres parsing and planning the text on every call. A *sql.Stmt is prepared again by
+// database/sql on any pool connection it was not prepared on yet, and inside a transaction
+// (db_stmt_tx) on the transaction's connection, the first time only.
+// Admin writes (employee edits, truncates, device ids) are rare and stay plain db.Exec.
+//
+// Every call is timed, db_stats_timer logs per statement calls, errors, average and max
+// latency, with the pool's wait count and wait time, every DB_STATS_S. A query's latency is
+// up to its first row, reading the rest is the caller's
+
+const DB_STATS_S = (300)
+
+type db_stmt_id int
+
+const (
+	STMT_PUNCH_INSERT db_stmt_id = iota
+	STMT_DAILY_HOURS_UPSERT
+	STMT_DAILY_HOURS_JUDGED
+	STMT_DAILY_HOURS_RANGE
+	STMT_EMPLOYEE_ONE
+	STMT_SYNC_ROSTER
+	STMT_DEVICE_STATS_INSERT
+	STMT_COUNT
+)
+
+type db_stmt struct {
+	name  string
+	query string
+	stmt  *sql.Stmt
+
+	// since the last db_stats_log
+	calls  uint64
+	errs   uint64
+	ns     uint64
+	max_ns uint64
+}
+
+var db_stmts = [STMT_COUNT]db_stmt{
+	STMT_PUNCH_INSERT: {name: "punch_insert", query: `INSERT INTO timeinfo (employee, punched_at, type)
+		SELECT * FROM unnest($1::integer[], $2::timestamptz[], $3::varchar[])`},
+
+	STMT_DAILY_HOURS_UPSERT: {name: "daily_hours_upsert", query: `INSERT INTO daily_hours AS d (datework, id, first_in, last_out)
+		SELECT datework, id, min(timestamp) FILTER (WHERE type = 'login'), max(timestamp) FILTER (WHERE type = 'logout')
+		FROM unnest($1::bigint[], $2::date[], $3::varchar[], $4::time[]) AS p(id, datework, type, timestamp)
+		GROUP BY datework, id
+		ON CONFLICT (datework, id) DO UPDATE SET
+			first_in = LEAST(d.first_in, EXCLUDED.first_in),
+			last_out = GREATEST(d.last_out, EXCLUDED.last_out)
+		RETURNING id, datework, first_in, last_out`},
+
+	STMT_DAILY_HOURS_JUDGED: {name: "daily_hours_judged", query: `UPDATE daily_hours d SET worked = u.worked * interval '1 second', anomaly = u.anomaly
+		FROM unnest($1::bigint[], $2::date[], $3::bigint[], $4::integer[]) AS u(id, datework, worked, anomaly)
+		WHERE d.datework = u.datework AND d.id = u.id`},
+
+	STMT_DAILY_HOURS_RANGE: {name: "daily_hours_range", query: `select id, datework, first_in, last_out from daily_hours where datework between $1 and $2`},
+
+	STMT_EMPLOYEE_ONE: {name: "employee_one", query: `select ` + employee_dir_columns + ` from employeeinfo where id = $1 and deleted_at is null`},
+
+	STMT_SYNC_ROSTER: {name: "sync_roster", query: `select id from employeeinfo where id = ANY($1) and deleted_at is null`},
+
+	STMT_DEVICE_STATS_INSERT: {name: "device_stats_insert", query: `INSERT INTO devicestats(deviceid, taken, uptime_s, heap_free, heap_min_free, heap_largest_block, snapshot)
+		VALUES ($1, $2, $3, $4, $5, $6, $7)`},
+}
+
+func db_stmts_prepare() {
+	for i := range db_stmts {
+		s := &db_stmts[i]
+		stmt, err := db.Prepare(s.query)
+		if err != nil {
+			logger(PRINT_FATAL, "Could not prepare", s.name, err)
+		}
+		s.stmt = stmt
+	}
+}
+
+func db_stmt_observe(s *db_stmt, start time.Time, err error) {
+	ns := uint64(time.Since(start))
+	atomic.AddUint64(&s.calls, 1)
+	atomic.AddUint64(&s.ns, ns)
+	if err != nil {
+		atomic.AddUint64(&s.errs, 1)
+	}
+	for {
+		max := atomic.LoadUint64(&s.max_ns)
+		if ns <= max || atomic.CompareAndSwapUint64(&s.max_ns, max, ns) {
+			return
+		}
+	}
+}
+
+// the statement on tx's connection, nil tx is the pool
+func db_stmt_tx(tx *sql.Tx, s *db_stmt) *sql.Stmt {
+	if tx == nil {
+		return s.stmt
+	}
+	return tx.Stmt(s.stmt)
+}
+
+func db_stmt_exec(tx *sql.Tx, id db_stmt_id, args ...interface{}) (sql.Result, error) {
+	return db_stmt_exec_ctx(context.Background(), tx, id, args...)
+}
+
+// ctx going away cancels the statement on the server
+func db_stmt_exec_ctx(ctx context.Context, tx *sql.Tx, id db_stmt_id, args ...interface{}) (sql.Result, error) {
+	s := &db_stmts[id]
+	start := time.Now()
+	res, err := db_stmt_tx(tx, s).ExecContext(ctx, args...)
+	db_stmt_observe(s, start, err)
+	return res, err
+}
+
+func db_stmt_query(tx *sql.Tx, id db_stmt_id, args ...interface{}) (*sql.Rows, error) {
+	return db_stmt_query_ctx(context.Background(), tx, id, args...)
+}
+
+func db_stmt_query_ctx(ctx context.Context, tx *sql.Tx, id db_stmt_id, args ...interface{}) (*sql.Rows, error) {
+	s := &db_stmts[id]
+	start := time.Now()
+	rows, err := db_stmt_tx(tx, s).QueryContext(ctx, args...)
+	db_stmt_observe(s, start, err)
+	return rows, err
+}
+
+// sql.ErrNoRows is not an error here, it only shows up in Scan
+func db_stmt_query_row(tx *sql.Tx, id db_stmt_id, args ...interface{}) *sql.Row {
+	s := &db_stmts[id]
+	start := time.Now()
+	row := db_stmt_tx(tx, s).QueryRow(args...)
+	db_stmt_observe(s, start, row.Err())
+	return row
+}
+
+var db_stats_last sql.DBStats
+
+func db_stats_log() {
+	for i := range db_stmts {
+		s := &db_stmts[i]
+		calls := atomic.SwapUint64(&s.calls, 0)
+		errs := atomic.SwapUint64(&s.errs, 0)
+		ns := atomic.SwapUint64(&s.ns, 0)
+		max_ns := atomic.SwapUint64(&s.max_ns, 0)
+		if calls == 0 {
+			continue
+		}
+		logger_kv(PRINT_NORMAL, "db stmt", "name", s.name, "calls", calls, "errors", errs,
+			"avg", time.Duration(ns/calls), "max", time.Duration(max_ns))
+	}
+
+	st := db.Stats()
+	logger_kv(PRINT_NORMAL, "db pool", "open", st.OpenConnections, "in_use", st.InUse, "idle", st.Idle,
+		"waits", st.WaitCount-db_stats_last.WaitCount, "waited", st.WaitDuration-db_stats_last.WaitDuration,
+		"closed_idle", (st.MaxIdleClosed+st.MaxIdleTimeClosed)-(db_stats_last.MaxIdleClosed+db_stats_last.MaxIdleTimeClosed),
+		"closed_lifetime", st.MaxLifetimeClosed-db_stats_last.MaxLifetimeClosed)
+	db_stats_last = st
+}
+
+func db_stats_timer() {
+	for {
+		time.Sleep(DB_STATS_S * time.Second)
+		db_stats_log()
+	}
+}
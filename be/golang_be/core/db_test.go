@@ -0,0 +1,181 @@
+package main
+
+import (
+	"bytes"
+	"database/sql"
+	"database/sql/driver"
+	"io"
+	"math/rand"
+	"reflect"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+/**********************************************************
+*	db_sync_users for a fleet of SYNC_BENCH_DEVICES devices,
+*	MAX_USERS_DEVICE users each, what the monthly
+*	sync_devices costs. The db is a model, every statement
+*	costs a round trip, the statement, a probe per id looked
+*	up and a row per id that came back. "roster" is
+*	db_sync_users, "per_user" the one select per user it
+*	replaced, both have to come up with the same sync maps
+*
+*	./core.sh -bench SyncUsers
+*********************************************************/
+
+const SYNC_BENCH_DEVICES = (100)
+const SYNC_BENCH_EMPLOYEES = (2000)
+
+const SYNC_BENCH_RTT = 250 * time.Microsecond
+const SYNC_BENCH_STMT = 60 * time.Microsecond
+const SYNC_BENCH_PROBE = 3 * time.Microsecond
+const SYNC_BENCH_ROW = 4 * time.Microsecond
+
+var sync_bench_active map[int64]bool
+var sync_bench_queries int64
+var sync_bench_register sync.Once
+
+type sync_bench_driver struct{}
+type sync_bench_conn struct{}
+type sync_bench_stmt struct{ query string }
+type sync_bench_rows struct {
+	ids []int64
+	i   int
+}
+
+func (sync_bench_driver) Open(string) (driver.Conn, error) { return sync_bench_conn{}, nil }
+
+func (sync_bench_conn) Prepare(query string) (driver.Stmt, error) {
+	return sync_bench_stmt{query}, nil
+}
+func (sync_bench_conn) Close() error              { return nil }
+func (sync_bench_conn) Begin() (driver.Tx, error) { return nil, driver.ErrSkip }
+
+// pq.Array is a Valuer, anything else goes through as is
+func (sync_bench_conn) CheckNamedValue(v *driver.NamedValue) error {
+	if valuer, ok := v.Value.(driver.Valuer); ok {
+		val, err := valuer.Value()
+		v.Value = val
+		return err
+	}
+	return nil
+}
+
+func (s sync_bench_stmt) Close() error  { return nil }
+func (s sync_bench_stmt) NumInput() int { return -1 }
+func (s sync_bench_stmt) Exec([]driver.Value) (driver.Result, error) {
+	return driver.RowsAffected(0), nil
+}
+
+func (s sync_bench_stmt) Query(args []driver.Value) (driver.Rows, error) {
+	atomic.AddInt64(&sync_bench_queries, 1)
+
+	var ids []int64
+	switch v := args[0].(type) {
+	case []int64:
+		ids = v
+	case string: // "{1,2,3}" from pq.Array
+		for _, s := range strings.Split(strings.Trim(v, "{}"), ",") {
+			id, _ := strconv.ParseInt(s, 10, 64)
+			ids = append(ids, id)
+		}
+	default:
+		ids = []int64{reflect.ValueOf(v).Convert(reflect.TypeOf(int64(0))).Int()}
+	}
+
+	r := &sync_bench_rows{}
+	for _, id := range ids {
+		if sync_bench_active[id] {
+			r.ids = append(r.ids, id)
+		}
+	}
+	time.Sleep(SYNC_BENCH_RTT + SYNC_BENCH_STMT + time.Duration(len(ids))*SYNC_BENCH_PROBE + time.Duration(len(r.ids))*SYNC_BENCH_ROW)
+	return r, nil
+}
+
+func (r *sync_bench_rows) Columns() []string { return []string{"id"} }
+func (r *sync_bench_rows) Close() error      { return nil }
+func (r *sync_bench_rows) Next(dest []driver.Value) error {
+	if r.i == len(r.ids) {
+		return io.EOF
+	}
+	dest[0] = r.ids[r.i]
+	r.i++
+	return nil
+}
+
+// the baseline, one select per user
+func sync_bench_per_user(emp_list []employee) []byte {
+	ret := make([]byte, MAX_USERS_DEVICE)
+	for _, employee := range emp_list {
+		var id uint32
+		err := db.QueryRow(`select id from employeeinfo where id=$1`, employee.uid).Scan(&id)
+		if err == nil {
+			ret[employee.id] = SYNC_USER_EXISTS_BIT_FIELD
+		} else {
+			ret[employee.id] = SYNC_DELETE_USER_BIT_FIELD
+		}
+	}
+	return ret
+}
+
+// 5% of the employees were deleted since they were pushed, a few uids never existed
+func sync_bench_fleet() [][]employee {
+	rng := rand.New(rand.NewSource(1))
+	sync_bench_active = make(map[int64]bool)
+	for id := int64(1); id <= SYNC_BENCH_EMPLOYEES; id++ {
+		sync_bench_active[id] = rng.Intn(20) != 0
+	}
+
+	var fleet [][]employee
+	for d := 0; d < SYNC_BENCH_DEVICES; d++ {
+		var roster []employee
+		for slot := 0; slot < MAX_USERS_DEVICE; slot++ {
+			roster = append(roster, employee{id: uint16(slot), uid: uint32(1 + rng.Intn(SYNC_BENCH_EMPLOYEES*21/20)), valid: true})
+		}
+		fleet = append(fleet, roster)
+	}
+	return fleet
+}
+
+func BenchmarkSyncUsers(b *testing.B) {
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_WARN // every user is logged at NORMAL
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	sync_bench_register.Do(func() { sql.Register("sync_bench", sync_bench_driver{}) })
+	saved := db
+	db, _ = sql.Open("sync_bench", "")
+	db_stmts_prepare()
+	defer func() { db.Close(); db = saved }()
+
+	fleet := sync_bench_fleet()
+	want := make([][]byte, len(fleet))
+	for i, roster := range fleet {
+		want[i] = sync_bench_per_user(roster)
+	}
+
+	run := func(b *testing.B, sync func([]employee) []byte) {
+		atomic.StoreInt64(&sync_bench_queries, 0)
+		for i := 0; i < b.N; i++ {
+			for d, roster := range fleet {
+				if got := sync(roster); !bytes.Equal(got, want[d]) {
+					b.Fatalf("device %d: sync map differs from the per user one", d)
+				}
+			}
+		}
+		b.ReportMetric(float64(atomic.LoadInt64(&sync_bench_queries))/float64(b.N), "queries/fleet")
+	}
+
+	b.Run("per_user", func(b *testing.B) { run(b, sync_bench_per_user) })
+	b.Run("roster", func(b *testing.B) {
+		run(b, func(roster []employee) []byte {
+			_, ret := db_sync_users(roster)
+			return ret
+		})
+	})
+}
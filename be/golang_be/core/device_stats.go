@@ -0,0 +1,203 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"encoding/json"
+	"time"
+)
+
+// Runtime stats pulled off each device with GET_STATS_CMD, layout mirrors
+// stats_snapshot_t in fw/main/stats_core.h, the enums there are append only
+
+const DEVICE_STATS_VERSION = (2)
+const DEVICE_STATS_COUNTERS = (21)
+const DEVICE_STATS_QUEUES = (8)
+const DEVICE_STATS_TASKS = (11)
+const DEVICE_STATS_POLL_M = (15)
+
+const DEVICE_STATS_TASK_NOT_RUNNING = (0xFFFF)
+const DEVICE_STATS_QUEUE_NOT_INIT = (0xFF)
+
+type Device_stats struct {
+	Version            uint8
+	Uptime_s           uint32
+	Heap_free          uint32
+	Heap_min_free      uint32
+	Heap_largest_block uint32
+	Ll_len             [3]uint8 // RX, TX, CR
+	Queue_depth        [DEVICE_STATS_QUEUES]uint8
+	Task_stack_hwm     [DEVICE_STATS_TASKS]uint16
+	Counters           [DEVICE_STATS_COUNTERS]uint32
+}
+
+// same order as the FW enums, only used to make the jsonb readable
+var device_stats_counter_names = [DEVICE_STATS_COUNTERS]string{
+	"tcp_connects",
+	"tcp_socket_errors",
+	"tcp_rx_bytes",
+	"tcp_tx_bytes",
+	"pkt_rx",
+	"pkt_tx",
+	"pkt_rx_bad_type",
+	"pkt_retransmit",
+	"pkt_timed_out",
+	"ll_nodes_added",
+	"ll_full_waits",
+	"cmds_processed",
+	"cmds_rejected_busy",
+	"logins",
+	"logins_dropped",
+	"file_ops",
+	"file_errors",
+	"print_scans",
+	"print_no_match",
+	"fota_started",
+	"pkt_rx_bad_crc",
+}
+
+var device_stats_queue_names = [DEVICE_STATS_QUEUES]string{
+	"tcp_core_send",
+	"tcp_core_send_ack",
+	"tcp_core_processed",
+	"tcp_core_socket_write",
+	"parallax_login",
+	"lcd_print",
+	"master_to_fota",
+	"file_command",
+}
+
+var device_stats_task_names = [DEVICE_STATS_TASKS]string{
+	"master_core",
+	"registeration_core",
+	"tcp_core",
+	"reader_task",
+	"writer_task",
+	"tcp_core write manager",
+	"tx-manager",
+	"timer_generator",
+	"lcd_core",
+	"file_core",
+	"parallax_thread",
+}
+
+func device_stats_unpack(cmd_rsp Cmd_resp_payload) (Device_stats, bool) {
+	var stats Device_stats
+
+	if int(cmd_rsp.Payload_len) != binary.Size(stats) {
+		logger(PRINT_WARN, "stats payload len was", cmd_rsp.Payload_len, "expected", binary.Size(stats))
+		return stats, false
+	}
+
+	err := binary.Read(bytes.NewBuffer(cmd_rsp.Resp_payload), binary.LittleEndian, &stats)
+	if err != nil {
+		logger(PRINT_WARN, "Failed to unpack stats, err =", err)
+		return stats, false
+	}
+
+	if stats.Version != DEVICE_STATS_VERSION {
+		logger(PRINT_WARN, "Unknown stats version", stats.Version)
+		return stats, false
+	}
+	return stats, true
+}
+
+// queues that were never created and tasks that are not running are left out
+func device_stats_json(stats Device_stats) []byte {
+	queues := make(map[string]uint8)
+	for i, v := range stats.Queue_depth {
+		if v != DEVICE_STATS_QUEUE_NOT_INIT {
+			queues[device_stats_queue_names[i]] = v
+		}
+	}
+
+	tasks := make(map[string]uint16)
+	for i, v := range stats.Task_stack_hwm {
+		if v != DEVICE_STATS_TASK_NOT_RUNNING {
+			tasks[device_stats_task_names[i]] = v
+		}
+	}
+
+	counters := make(map[string]uint32)
+	for i, v := range stats.Counters {
+		counters[device_stats_counter_names[i]] = v
+	}
+
+	b, err := json.Marshal(map[string]interface{}{
+		"ll_rx":          stats.Ll_len[0],
+		"ll_tx":          stats.Ll_len[1],
+		"ll_cr":          stats.Ll_len[2],
+		"queue_depth":    queues,
+		"task_stack_hwm": tasks,
+		"counters":       counters,
+	})
+	if err != nil {
+		logger(PRINT_FATAL, "Failed to marshal device stats, err =", err)
+	}
+	return b
+}
+
+func create_ipc_cmd_get_stats(DeviceId uint64) Ipc_packet {
+	return create_ipc_cmd_packet(DeviceId, GET_STATS_CMD)
+}
+
+func get_device_stats(c client) (Device_stats, bool) {
+	var stats Device_stats
+	ok := false
+
+	response_chan := make(chan Ipc_packet)
+	site_mux_reg_cmd(c.deviceId, response_chan)
+
+	ipc := create_ipc_cmd_get_stats(c.deviceId)
+
+	go be_handle_command(ipc)
+
+	select {
+	case resp := <-response_chan:
+		cmd_rsp := packet_cmd_response_unpack(resp.P.Data)
+		if cmd_rsp.Cmd_status != CMD_STATUS_GOOD {
+			logger_id(PRINT_WARN, c.deviceId, "Could not get stats, cmd status =", cmd_rsp.Cmd_status)
+			break
+		}
+
+		stats, ok = device_stats_unpack(cmd_rsp)
+	case <-time.After(time.Second * COMMAND_TIMEOUT_TIME):
+		logger_id(PRINT_WARN, c.deviceId, "Timed out getting stats")
+	}
+
+	site_mux_unreg_cmd(c.deviceId)
+	return stats, ok
+}
+
+func poll_device_stats() {
+	deviceArr := get_all_devices()
+	for _, v := range deviceArr {
+		c := client{}
+		c.deviceId = v.DeviceId
+
+		// don't step on a command the site (or a sync) has in flight
+		if get_outstanding_command_or_fota_for_device(c.deviceId) {
+			continue
+		}
+
+		stats, ok := get_device_stats(c)
+		if !ok {
+			continue
+		}
+
+		logger_id(PRINT_DEBUG, c.deviceId, "uptime =", stats.Uptime_s, "heap free =", stats.Heap_free, "heap min =", stats.Heap_min_free)
+		db_put_device_stats(c.deviceId, stats, device_stats_json(stats))
+	}
+}
+
+func device_stats_timer() {
+	// the test harness owns the command mux
+	if TEST_MODE {
+		return
+	}
+
+	for {
+		time.Sleep(time.Minute * DEVICE_STATS_POLL_M)
+		poll_device_stats()
+	}
+}
@@ -0,0 +1,279 @@
+package main
+
+import (
+	"database/sql"
+	"sort"
+	"strconv"
+	"sync"
+	"time"
+
+	"github.com/lib/pq"
+)
+
+// employeeinfo kept in memory, punches and reports look up names, salaries and shifts here
+// instead of one query per lookup. The whole table is read on first use, after that a uid
+// that is not in the directory is not in employeeinfo. Entries are dropped by core's own
+// writes (db_add_employee_salary_shift, db_delete_user, ..) and by the employeeinfo_changed
+// NOTIFY (setup.sql, migrate -prepare on an older db) for writes from anywhere else, the next
+// lookup reads them again.
+//
+// The reads go out without employee_dir_mutex, lookups of other ids go on meanwhile. What a
+// read brings back only goes into the directory if nothing was invalidated while it was out
+// (employee_dir_version), otherwise the caller gets it and the next lookup reads again.
+//
+// A failed read is the caller's, nothing is installed and the next lookup tries again. The
+// punch path NAKs the batch (NAK_SERVER_DB), a reconnect of the listener invalidates
+// everything right when the db is flapping
+
+const EMPLOYEE_DIR_CHANNEL = "employeeinfo_changed"
+const EMPLOYEE_DIR_PING_S = (90)
+
+type employee_dir_entry struct {
+	info  db_get_employee_info
+	shift Shift_info
+}
+
+var employee_dir_mutex sync.Mutex
+var employee_dir = make(map[uint32]employee_dir_entry)
+var employee_dir_stale = make(map[uint32]bool)
+var employee_dir_loaded = false
+var employee_dir_version uint64 // bumped by every invalidate
+
+const employee_dir_columns = `id, employee, email, salary,
+	shift_m_s, shift_m_e, shift_t_s, shift_t_e, shift_w_s, shift_w_e,
+	shift_th_s, shift_th_e, shift_f_s, shift_f_e`
+
+type employee_dir_scanner interface {
+	Scan(dest ...interface{}) error
+}
+
+func employee_dir_scan(row employee_dir_scanner) (employee_dir_entry, error) {
+	var e employee_dir_entry
+	var email sql.NullString
+	var salary sql.NullInt64
+	var s Shift_info_sql
+
+	err := row.Scan(&e.info.Id, &e.info.Name, &email, &salary,
+		&s.Shift_m_s, &s.Shift_m_e,
+		&s.Shift_t_s, &s.Shift_t_e,
+		&s.Shift_w_s, &s.Shift_w_e,
+		&s.Shift_th_s, &s.Shift_th_e,
+		&s.Shift_f_s, &s.Shift_f_e)
+	if err != nil {
+		return e, err
+	}
+
+	e.info.Email = email.String
+	e.info.Salary = int(salary.Int64)
+
+	// a day only counts if both ends are set
+	if s.Shift_m_s.Valid && s.Shift_m_e.Valid {
+		e.shift.Shift_m_s = s.Shift_m_s.Time
+		e.shift.Shift_m_e = s.Shift_m_e.Time
+	}
+	if s.Shift_t_s.Valid && s.Shift_t_e.Valid {
+		e.shift.Shift_t_s = s.Shift_t_s.Time
+		e.shift.Shift_t_e = s.Shift_t_e.Time
+	}
+	if s.Shift_w_s.Valid && s.Shift_w_e.Valid {
+		e.shift.Shift_w_s = s.Shift_w_s.Time
+		e.shift.Shift_w_e = s.Shift_w_e.Time
+	}
+	if s.Shift_th_s.Valid && s.Shift_th_e.Valid {
+		e.shift.Shift_th_s = s.Shift_th_s.Time
+		e.shift.Shift_th_e = s.Shift_th_e.Time
+	}
+	if s.Shift_f_s.Valid && s.Shift_f_e.Valid {
+		e.shift.Shift_f_s = s.Shift_f_s.Time
+		e.shift.Shift_f_e = s.Shift_f_e.Time
+	}
+	return e, nil
+}
+
+// the whole table, employee_dir_mutex not held
+func employee_dir_read_all() (map[uint32]employee_dir_entry, error) {
+	rows, err := db.Query(`select ` + employee_dir_columns + ` from employeeinfo where deleted_at is null`)
+	if err != nil {
+		return nil, err
+	}
+	defer rows.Close()
+
+	ret := make(map[uint32]employee_dir_entry)
+	for rows.Next() {
+		e, err := employee_dir_scan(rows)
+		if err != nil {
+			return nil, err
+		}
+		ret[e.info.Id] = e
+	}
+	return ret, rows.Err()
+}
+
+// one employee, false if there is no such (active) employee. employee_dir_mutex not held
+func employee_dir_read_one(id uint32) (employee_dir_entry, bool, error) {
+	row := db_stmt_query_row(nil, STMT_EMPLOYEE_ONE, id)
+
+	e, err := employee_dir_scan(row)
+	switch err {
+	case sql.ErrNoRows:
+		return e, false, nil
+	case nil:
+		return e, true, nil
+	}
+	return e, false, err
+}
+
+// reads the whole table, installs it if nothing was invalidated meanwhile
+func employee_dir_load() (map[uint32]employee_dir_entry, error) {
+	employee_dir_mutex.Lock()
+	version := employee_dir_version
+	employee_dir_mutex.Unlock()
+
+	dir, err := employee_dir_read_all()
+	if err != nil {
+		logger(PRINT_WARN, "Could not load the employee directory", err)
+		return nil, err
+	}
+
+	employee_dir_mutex.Lock()
+	if version == employee_dir_version {
+		employee_dir = dir
+		employee_dir_stale = make(map[uint32]bool)
+		employee_dir_loaded = true
+	}
+	employee_dir_mutex.Unlock()
+
+	logger(PRINT_DEBUG, "employee directory loaded,", len(dir), "employees")
+	return dir, nil
+}
+
+// reads id again, installs it if nothing was invalidated meanwhile
+func employee_dir_refresh(id uint32) (employee_dir_entry, bool, error) {
+	employee_dir_mutex.Lock()
+	version := employee_dir_version
+	employee_dir_mutex.Unlock()
+
+	e, ok, err := employee_dir_read_one(id)
+	if err != nil {
+		logger(PRINT_WARN, "Could not refresh employee directory for id", id, err)
+		return e, false, err
+	}
+
+	employee_dir_mutex.Lock()
+	if version == employee_dir_version {
+		if ok {
+			employee_dir[id] = e
+		} else {
+			delete(employee_dir, id)
+		}
+		delete(employee_dir_stale, id)
+	}
+	employee_dir_mutex.Unlock()
+	return e, ok, nil
+}
+
+func employee_dir_get(id uint32) (employee_dir_entry, bool, error) {
+	employee_dir_mutex.Lock()
+	loaded, stale := employee_dir_loaded, employee_dir_stale[id]
+	e, ok := employee_dir[id]
+	employee_dir_mutex.Unlock()
+
+	if !loaded {
+		dir, err := employee_dir_load()
+		if err != nil {
+			return e, false, err
+		}
+		e, ok = dir[id]
+	} else if stale {
+		return employee_dir_refresh(id)
+	}
+	return e, ok, nil
+}
+
+// sorted by id
+func employee_dir_all() ([]db_get_employee_info, error) {
+	employee_dir_mutex.Lock()
+	loaded := employee_dir_loaded
+	var stale []uint32
+	for id := range employee_dir_stale {
+		stale = append(stale, id)
+	}
+	dir := employee_dir
+	employee_dir_mutex.Unlock()
+
+	if !loaded {
+		var err error
+		if dir, err = employee_dir_load(); err != nil {
+			return nil, err
+		}
+	} else if len(stale) != 0 {
+		for _, id := range stale {
+			if _, _, err := employee_dir_refresh(id); err != nil {
+				return nil, err
+			}
+		}
+		employee_dir_mutex.Lock()
+		dir = employee_dir
+		employee_dir_mutex.Unlock()
+	}
+
+	// dir may be the installed map, employee_dir_refresh writes into that one
+	employee_dir_mutex.Lock()
+	ret := make([]db_get_employee_info, 0, len(dir))
+	for _, e := range dir {
+		ret = append(ret, e.info)
+	}
+	employee_dir_mutex.Unlock()
+	sort.Slice(ret, func(i, j int) bool { return ret[i].Id < ret[j].Id })
+	return ret, nil
+}
+
+// an employee change shows up in every period's report
+func employee_dir_invalidate(id uint32) {
+	employee_dir_mutex.Lock()
+	employee_dir_version++
+	employee_dir_stale[id] = true
+	employee_dir_mutex.Unlock()
+	report_cache_touch_all()
+}
+
+func employee_dir_invalidate_all() {
+	employee_dir_mutex.Lock()
+	employee_dir_version++
+	employee_dir_loaded = false
+	employee_dir_mutex.Unlock()
+	report_cache_touch_all()
+}
+
+func employee_dir_listener_event(ev pq.ListenerEventType, err error) {
+	if err != nil {
+		logger(PRINT_WARN, "employee directory listener:", err)
+	}
+}
+
+// the payload is the id that changed, empty for a TRUNCATE. A nil notification means the
+// connection was lost and re-established, anything could have changed in between
+func employee_dir_listen() {
+	l := pq.NewListener(db_con_string(), 10*time.Second, time.Minute, employee_dir_listener_event)
+	if err := l.Listen(EMPLOYEE_DIR_CHANNEL); err != nil {
+		logger(PRINT_FATAL, "Could not LISTEN on", EMPLOYEE_DIR_CHANNEL, err)
+	}
+
+	for {
+		select {
+		case n := <-l.Notify:
+			if n == nil {
+				employee_dir_invalidate_all()
+				continue
+			}
+			id, err := strconv.ParseUint(n.Extra, 10, 32)
+			if err != nil {
+				employee_dir_invalidate_all()
+				continue
+			}
+			employee_dir_invalidate(uint32(id))
+		case <-time.After(EMPLOYEE_DIR_PING_S * time.Second):
+			go l.Ping()
+		}
+	}
+}
@@ -1,279 +1,157 @@
 package main
 
-import "github.com/tealeg/xlsx"
 import "fmt"
 import "time"
 import "sort"
 import "strconv"
+import "strings"
 
 const RED_STYLE = 1
 const BOLD_STYLE = 2
 
-var idToPayPeriodDeetz map[uint32]db_hours_pay_period
+const XL_WORKERS = (8)
+const XL_WINDOW = (4 * XL_WORKERS) // employees worked out but not written yet, bounds memory
 
-func getStyles(s int) *xlsx.Style {
-	if s == RED_STYLE {
-		style1 := xlsx.NewStyle()
-		style1.Fill = *xlsx.NewFill("solid", "FF0000", "00000000")
-		return style1
-	}
-
-	if s == BOLD_STYLE {
-		style2 := xlsx.NewStyle()
-		style2.Font.Bold = true
-		style2.Font.Size = 13
-	}
-
-	return xlsx.NewStyle()
+type xl_employee struct {
+	total db_hours_pay_period
+	arr   []db_composite_per_day
 }
 
 func truncate_float(f float64) string {
 	return fmt.Sprintf("%.2f", f)
 }
 
-func create_exel_main_row(sheet *xlsx.Sheet, pay_period db_hours_pay_period, name string) {
-	var style *xlsx.Style
+func create_exel_main_row(x *xl_stream, pay_period db_hours_pay_period, name string) {
+	var style int
 	if pay_period.actual_hours.Hours() < pay_period.expected_hours.Hours() {
-		style = getStyles(RED_STYLE)
+		style = RED_STYLE
 	}
 
-	row := sheet.AddRow()
-
-	row.AddCell()
-
-	cell := row.AddCell()
-	cell.SetString(name)
-	cell.SetStyle(style)
-
-	cell = row.AddCell()
-	cell.SetString(truncate_float(pay_period.actual_hours.Hours()))
-	cell.SetStyle(style)
-
-	cell = row.AddCell()
-	cell.SetString(truncate_float(pay_period.expected_hours.Hours()))
-	cell.SetStyle(style)
-
-	cell = row.AddCell()
+	var flagged string
 	if pay_period.anomolies {
-		cell.SetString(" YES ")
+		flagged = " YES "
 	}
-	cell.SetStyle(style)
-}
 
-func setup_header_first_page(sheet *xlsx.Sheet) {
-	sheet.SetColWidth(1, 4, 20)
-
-	sheet.AddRow()
-	sheet.AddRow()
-
-	row := sheet.AddRow()
-	cell := row.AddCell()
-
-	cell = row.AddCell()
-	cell.SetString("Name")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Total Worked")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Expected Worked")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Flagged")
-	cell.SetStyle(getStyles(BOLD_STYLE))
+	xl_stream_row(x, xl_cell{},
+		xl_cell{name, style},
+		xl_cell{truncate_float(pay_period.actual_hours.Hours()), style},
+		xl_cell{truncate_float(pay_period.expected_hours.Hours()), style},
+		xl_cell{flagged, style})
 }
 
-func setup_header_sub_page(sheet *xlsx.Sheet, name string, id uint32) {
-	sheet.SetColWidth(1, 9, 18)
-	sheet.SetColWidth(10, 10, 60)
-
-	row := sheet.AddRow()
-	cell := row.AddCell()
-
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell.SetString("Name: ")
-	cell = row.AddCell()
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell.SetString(name)
-
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetString("Expected Hours:")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell = row.AddCell()
-	cell.SetString(idToPayPeriodDeetz[id].expected_hours.String())
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetString("Actual Hours:")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell = row.AddCell()
-	cell.SetString(idToPayPeriodDeetz[id].actual_hours.String())
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	row = sheet.AddRow()
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetString("Expected Salary:")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell = row.AddCell()
-	cell.SetString(fmt.Sprintf("$%.2f", idToPayPeriodDeetz[id].exptected_sal))
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetString("Actual Salary:")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-	cell = row.AddCell()
-	cell.SetString(fmt.Sprintf("$%.2f", idToPayPeriodDeetz[id].actual_sal))
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	sheet.AddRow()
-	sheet.AddRow()
-
-	row = sheet.AddRow()
-	row.AddCell()
-	cell = row.AddCell()
-	cell.SetString("Date")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Weekday")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Expected In")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Expected Out")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Actual In")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Actual Out")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Expected Hours")
-	cell.SetStyle(getStyles(BOLD_STYLE))
-
-	cell = row.AddCell()
-	cell.SetString("Actual Hours")
-	cell.SetStyle(getStyles(BOLD_STYLE))
+func setup_header_first_page(x *xl_stream) {
+	xl_stream_row(x)
+	xl_stream_row(x)
+	xl_stream_row(x, xl_cell{},
+		xl_cell{"Name", BOLD_STYLE},
+		xl_cell{"Total Worked", BOLD_STYLE},
+		xl_cell{"Expected Worked", BOLD_STYLE},
+		xl_cell{"Flagged", BOLD_STYLE})
+}
 
-	cell = row.AddCell()
-	cell.SetString("Shift Difference")
-	cell.SetStyle(getStyles(BOLD_STYLE))
+func setup_header_sub_page(x *xl_stream, name string, deetz db_hours_pay_period) {
+	xl_stream_row(x, xl_cell{})
+	xl_stream_row(x, xl_cell{}, xl_cell{"Name: ", BOLD_STYLE}, xl_cell{name, BOLD_STYLE})
+	xl_stream_row(x, xl_cell{}, xl_cell{"Expected Hours:", BOLD_STYLE}, xl_cell{deetz.expected_hours.String(), BOLD_STYLE})
+	xl_stream_row(x, xl_cell{}, xl_cell{"Actual Hours:", BOLD_STYLE}, xl_cell{deetz.actual_hours.String(), BOLD_STYLE})
+	xl_stream_row(x)
+	xl_stream_row(x, xl_cell{}, xl_cell{"Expected Salary:", BOLD_STYLE}, xl_cell{fmt.Sprintf("$%.2f", deetz.exptected_sal), BOLD_STYLE})
+	xl_stream_row(x, xl_cell{}, xl_cell{"Actual Salary:", BOLD_STYLE}, xl_cell{fmt.Sprintf("$%.2f", deetz.actual_sal), BOLD_STYLE})
+	xl_stream_row(x)
+	xl_stream_row(x)
+	xl_stream_row(x, xl_cell{},
+		xl_cell{"Date", BOLD_STYLE},
+		xl_cell{"Weekday", BOLD_STYLE},
+		xl_cell{"Expected In", BOLD_STYLE},
+		xl_cell{"Expected Out", BOLD_STYLE},
+		xl_cell{"Actual In", BOLD_STYLE},
+		xl_cell{"Actual Out", BOLD_STYLE},
+		xl_cell{"Expected Hours", BOLD_STYLE},
+		xl_cell{"Actual Hours", BOLD_STYLE},
+		xl_cell{"Shift Difference", BOLD_STYLE},
+		xl_cell{"Flag", BOLD_STYLE})
+}
 
-	cell = row.AddCell()
-	cell.SetString("Flag")
-	cell.SetStyle(getStyles(BOLD_STYLE))
+func xl_time_or_na(t time.Time) xl_cell {
+	if t.IsZero() {
+		return xl_cell{"N/A", 0}
+	}
+	return xl_cell{t.Format(TIME_FORMAT), 0}
 }
 
-func create_row_sub_page(comp []db_composite_per_day, sheet *xlsx.Sheet, name string, id uint32) {
-	setup_header_sub_page(sheet, name, id)
+func create_row_sub_page(comp []db_composite_per_day, x *xl_stream, name string, deetz db_hours_pay_period) {
+	setup_header_sub_page(x, name, deetz)
 	for _, day := range comp {
-		row := sheet.AddRow()
-		cell := row.AddCell()
-		cell = row.AddCell()
-		cell.SetString(day.date.Format(DATE_FORMAT))
-
-		cell = row.AddCell()
-		cell.SetString(day.date.Weekday().String())
-
-		/* shift start, expted */
-		cell = row.AddCell()
-		if day.expected_shift.Shift_start.IsZero() {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.expected_shift.Shift_start.Format(TIME_FORMAT))
-		}
-
-		/* shift end, expted */
-		cell = row.AddCell()
-		if day.expected_shift.Shift_end.IsZero() {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.expected_shift.Shift_end.Format(TIME_FORMAT))
-		}
-
-		/* shift start, actuall */
-		cell = row.AddCell()
-		if day.actual_shift.Shift_start.IsZero() {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.actual_shift.Shift_start.Format(TIME_FORMAT))
-		}
-
-		/* shift end, actuall */
-		cell = row.AddCell()
-		if day.actual_shift.Shift_end.IsZero() {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.actual_shift.Shift_end.Format(TIME_FORMAT))
-		}
-
 		/* expted hours worked*/
-		cell = row.AddCell()
-		if day.expected_hours == 0 {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.expected_hours.String())
-		}
-
-		cell = row.AddCell()
-		if day.expected_hours == 0 {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.actual_hours.String())
+		expected := xl_cell{"N/A", 0}
+		actual := xl_cell{"N/A", 0}
+		if day.expected_hours != 0 {
+			expected.s = day.expected_hours.String()
+			actual.s = day.actual_hours.String()
 		}
 
 		/*delta*/
-		cell = row.AddCell()
-		if day.delta == 0 {
-			cell.SetString("N/A")
-		} else {
-			cell.SetString(day.delta.String())
+		delta := xl_cell{"N/A", 0}
+		if day.delta != 0 {
+			delta.s = day.delta.String()
 			if day.delta < 0 {
-				cell.SetStyle(getStyles(RED_STYLE))
+				delta.style = RED_STYLE
 			}
 		}
 
 		/* flag*/
-		cell = row.AddCell()
-		if day.anomolies == 0 {
-			cell.SetString("")
-		} else {
-			cell.SetString(db_get_anomoly_string(day.anomolies))
-			cell.SetStyle(getStyles(RED_STYLE))
+		flag := xl_cell{}
+		if day.anomolies != 0 {
+			flag = xl_cell{db_get_anomoly_string(day.anomolies), RED_STYLE}
 		}
 
+		xl_stream_row(x, xl_cell{},
+			xl_cell{day.date.Format(DATE_FORMAT), 0},
+			xl_cell{day.date.Weekday().String(), 0},
+			xl_time_or_na(day.expected_shift.Shift_start),
+			xl_time_or_na(day.expected_shift.Shift_end),
+			xl_time_or_na(day.actual_shift.Shift_start),
+			xl_time_or_na(day.actual_shift.Shift_end),
+			expected,
+			actual,
+			delta,
+			flag)
 	}
 }
 
-func create_sub_page(Time time.Time, file *xlsx.File) {
-	emp_arr := db_get_employees()
-	/* sort by name, alphabitaclly */
-	sort.Slice(emp_arr, func(i, j int) bool { return emp_arr[i].Name < emp_arr[j].Name })
+// Employees are worked out by XL_WORKERS goroutines, in emp_arr order, and written here
+// in the same order. At most XL_WINDOW of them are in between. Their totals go into totals
+func create_sub_page(pp *pay_period, emp_arr []db_get_employee_info, x *xl_stream, totals map[uint32]db_hours_pay_period) {
+	results := make([]chan xl_employee, len(emp_arr))
+	for i := range results {
+		results[i] = make(chan xl_employee, 1)
+	}
+	window := make(chan struct{}, XL_WINDOW)
+	jobs := make(chan int)
+
+	for w := 0; w < XL_WORKERS; w++ {
+		go func() {
+			for i := range jobs {
+				arr := pay_period_arr(pp, emp_arr[i].Id)
+				results[i] <- xl_employee{pay_period_sum(emp_arr[i].Id, arr), arr}
+			}
+		}()
+	}
 
-	logger(PRINT_NORMAL, emp_arr)
+	go func() {
+		for i := range emp_arr {
+			window <- struct{}{}
+			jobs <- i
+		}
+		close(jobs)
+	}()
 
-	for _, emp := range emp_arr {
+	for i, emp := range emp_arr {
+		r := <-results[i]
+		results[i] = nil
+		<-window
+
+		totals[emp.Id] = r.total
 
 		//max name for an excel page is 31
 		sheetName := emp.Name
@@ -281,91 +159,59 @@ func create_sub_page(Time time.Time, file *xlsx.File) {
 			sheetName = emp.Name[:31]
 		}
 
-		sheet, err := file.AddSheet(sheetName)
-		if err != nil {
-			panic(err)
-		}
-
-		arr := db_get_pay_period_arr(emp.Id, Time)
-		create_row_sub_page(arr, sheet, emp.Name, emp.Id)
+		xl_stream_sheet(x, i+1, sheetName, []xl_col{{1, 9, 18}, {10, 10, 60}})
+		create_row_sub_page(r.arr, x, emp.Name, r.total)
 	}
 }
 
-func create_first_page(Time time.Time, sheet *xlsx.Sheet) {
-	emp_arr := db_get_employees()
-	/* sort by name, alphabitaclly */
-	sort.Slice(emp_arr, func(i, j int) bool { return emp_arr[i].Name < emp_arr[j].Name })
+// after create_sub_page, the totals are the ones it worked out
+func create_first_page(emp_arr []db_get_employee_info, x *xl_stream, totals map[uint32]db_hours_pay_period) {
+	xl_stream_sheet(x, 0, "overview", []xl_col{{1, 4, 20}})
 
 	for i, emp := range emp_arr {
 		if i%45 == 0 {
 			/* don't know how to make these things float */
-			setup_header_first_page(sheet)
+			setup_header_first_page(x)
 		}
-		pay_period := db_get_total_hours_in_period(emp.Id, Time)
-		idToPayPeriodDeetz[emp.Id] = pay_period
-		create_exel_main_row(sheet, pay_period, emp.Name)
+		create_exel_main_row(x, totals[emp.Id], emp.Name)
 	}
 }
 
-func create_excel_document(Time time.Time, file_name string) {
-	if Time.Day() != 1 && Time.Day() != 16 {
-		logger(PRINT_FATAL, "Can only accept on 16 and 1st day of month")
-	}
-
-	if file_name == "" {
-		logger(PRINT_FATAL, "Name Null!")
-	}
-
-	var file *xlsx.File
-	var sheet *xlsx.Sheet
-	var err error
-	idToPayPeriodDeetz = make(map[uint32]db_hours_pay_period)
-
-	file = xlsx.NewFile()
-	sheet, err = file.AddSheet("overview")
-	create_first_page(Time, sheet)
-
-	create_sub_page(Time, file)
+// an overview sheet and a sheet per employee in emp_arr, for the days in pp
+func xl_report_write(x *xl_stream, pp *pay_period, emp_arr []db_get_employee_info) {
+	/* sort by name, alphabitaclly */
+	sort.Slice(emp_arr, func(i, j int) bool { return emp_arr[i].Name < emp_arr[j].Name })
 
-	err = file.Save("./static/" + file_name)
-	if err != nil {
-		logger(PRINT_NORMAL, err.Error())
-	}
+	/* the overview is the first sheet, but it is written last, from the sub pages' totals */
+	totals := make(map[uint32]db_hours_pay_period, len(emp_arr))
+	create_sub_page(pp, emp_arr, x, totals)
+	create_first_page(emp_arr, x, totals)
 }
 
 func xl_get_filename(year, month, period int) string {
 	return strconv.Itoa(year) + "_" + strconv.Itoa(month) + "_" + strconv.Itoa(period) + ".xlsx"
 }
 
-func xl_archive() {
-	for {
-		/* 13 hours is fucking, but you are gurenteed to run once a day*/
-		time.Sleep(time.Hour * 13)
-
-		date := time.Now()
-
-		year, month, day := date.Date()
-		if day == 16 || day == 1 {
-			archiveName := strconv.Itoa(year) + "_" + strconv.Itoa(int(month)) + "_" + strconv.Itoa(day) + ".xlsx"
-			create_excel_document(date, archiveName)
-		}
+// the period a name from xl_get_filename is for, false if it is not one or is in the future
+func xl_parse_filename(name string) (time.Time, bool) {
+	parts := strings.Split(strings.TrimSuffix(name, ".xlsx"), "_")
+	if len(parts) != 3 || !strings.HasSuffix(name, ".xlsx") {
+		return time.Time{}, false
+	}
+	year, err_y := strconv.Atoi(parts[0])
+	month, err_m := strconv.Atoi(parts[1])
+	day, err_d := strconv.Atoi(parts[2])
+	if err_y != nil || err_m != nil || err_d != nil || month < 1 || month > 12 || (day != 1 && day != 16) {
+		return time.Time{}, false
 	}
+	Time := time.Date(year, time.Month(month), day, 0, 0, 0, 0, time.UTC)
+	if Time.After(xl_this_period()) {
+		return time.Time{}, false
+	}
+	return Time, true
 }
 
-func xl_create_this_period() {
-	logger(PRINT_NORMAL, "Creating spreadsheet for this period!")
-
-	date := time.Now()
-	year, month, day := date.Date()
-
-	if day > 16 {
-		day = 16
-		/* period for 16 - end of motnh */
-		Time := time.Date(year, month, day, 0, 0, 0, 0, time.UTC)
-		create_excel_document(Time, xl_get_filename(year, int(month), day))
-	} else {
-		day = 1
-		Time := time.Date(year, month, day, 0, 0, 0, 0, time.UTC)
-		create_excel_document(Time, xl_get_filename(year, int(month), day))
-	}
+// the 1st or the 16th, the day the current pay period started
+func xl_this_period() time.Time {
+	return pay_period_start(time.Now())
 }
@@ -0,0 +1,213 @@
+package main
+
+import (
+	"database/sql"
+	"encoding/csv"
+	"errors"
+	"fmt"
+	"net/http"
+	"strconv"
+	"strings"
+	"time"
+
+	"github.com/lib/pq"
+)
+
+// Exports are written straight into the http response as they are worked out, chunked,
+// nothing goes to disk. Both take from and to (DATE_FORMAT, both days included) and id
+// (employee ids, id=1,2,3 or id=1&id=2), everything left out is not filtered on.
+//
+//	/export/csv   every punch, the columns the old COPY timeinfo had
+//	/export/xlsx  the pay period report for any run of days, this pay period by default
+//
+// A failure after the first byte went out aborts the response, the client sees a cut off
+// download rather than a file that looks whole
+
+const EXPORT_FLUSH_ROWS = (1000)
+const EXPORT_XLSX_MAX_DAYS = (366)
+const EXPORT_XLSX_TYPE = "application/vnd.openxmlformats-officedocument.spreadsheetml.sheet"
+
+type export_filter struct {
+	from time.Time // zero, no lower bound
+	to   time.Time // zero, no upper bound
+	ids  []int64   // empty, every employee
+}
+
+func export_parse_filter(req *http.Request) (export_filter, error) {
+	var f export_filter
+	var err error
+
+	if err = req.ParseForm(); err != nil {
+		return f, err
+	}
+	if s := req.Form.Get("from"); s != "" {
+		if f.from, err = time.ParseInLocation(DATE_FORMAT, s, time.Local); err != nil {
+			return f, errors.New("bad from, want " + DATE_FORMAT)
+		}
+	}
+	if s := req.Form.Get("to"); s != "" {
+		if f.to, err = time.ParseInLocation(DATE_FORMAT, s, time.Local); err != nil {
+			return f, errors.New("bad to, want " + DATE_FORMAT)
+		}
+	}
+	if !f.from.IsZero() && !f.to.IsZero() && f.to.Before(f.from) {
+		return f, errors.New("to is before from")
+	}
+
+	for _, v := range req.Form["id"] {
+		for _, s := range strings.Split(v, ",") {
+			if s = strings.TrimSpace(s); s == "" {
+				continue
+			}
+			id, err := strconv.ParseUint(s, 10, 32)
+			if err != nil {
+				return f, errors.New("bad id " + s)
+			}
+			f.ids = append(f.ids, int64(id))
+		}
+	}
+	return f, nil
+}
+
+func export_attachment(w http.ResponseWriter, content_type, name string) {
+	w.Header().Set("Content-Type", content_type)
+	w.Header().Set("Content-Disposition", "attachment; filename="+name)
+}
+
+// the response is already going out, all that can be done is to cut it off
+func export_abort(what string, err error) {
+	logger(PRINT_WARN, what, "export failed mid response,", err)
+	panic(http.ErrAbortHandler)
+}
+
+func export_csv(w http.ResponseWriter, req *http.Request) {
+	if !site_authorized(w, req) {
+		return
+	}
+	f, err := export_parse_filter(req)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	var conds []string
+	var args []interface{}
+	if !f.from.IsZero() {
+		args = append(args, f.from)
+		conds = append(conds, fmt.Sprintf("t.punched_at >= $%d", len(args)))
+	}
+	if !f.to.IsZero() {
+		args = append(args, f.to.AddDate(0, 0, 1))
+		conds = append(conds, fmt.Sprintf("t.punched_at < $%d", len(args)))
+	}
+	if len(f.ids) > 0 {
+		args = append(args, pq.Array(f.ids))
+		conds = append(conds, fmt.Sprintf("t.employee = ANY($%d)", len(args)))
+	}
+
+	// no ORDER BY, that would sort the whole range before the first row. Rows come
+	// out a month (partition) at a time, in the order they were punched in
+	q := `SELECT t.employee, e.employee, t.punched_at::date::text, t.type, t.punched_at::time::text
+		FROM timeinfo t JOIN employeeinfo e ON e.id = t.employee`
+	if len(conds) > 0 {
+		q += " WHERE " + strings.Join(conds, " AND ")
+	}
+
+	// a client that goes away cancels the query
+	rows, err := db.QueryContext(req.Context(), q, args...)
+	if err != nil {
+		logger(PRINT_WARN, "csv export query failed", err)
+		http.Error(w, "export failed", http.StatusInternalServerError)
+		return
+	}
+	defer rows.Close()
+
+	export_attachment(w, "text/csv", "timeinfo.csv")
+	flusher, _ := w.(http.Flusher)
+	cw := csv.NewWriter(w)
+	cw.Write([]string{"id", "employee", "datework", "type", "timestamp"})
+
+	n := 0
+	for rows.Next() {
+		var id int64
+		var name sql.NullString
+		var date, typ, at string
+		if err := rows.Scan(&id, &name, &date, &typ, &at); err != nil {
+			export_abort("csv", err)
+		}
+		cw.Write([]string{strconv.FormatInt(id, 10), name.String, date, typ, at})
+
+		if n++; n%EXPORT_FLUSH_ROWS == 0 && flusher != nil {
+			cw.Flush()
+			flusher.Flush()
+		}
+	}
+	if err := rows.Err(); err != nil {
+		export_abort("csv", err)
+	}
+	cw.Flush()
+	if err := cw.Error(); err != nil {
+		export_abort("csv", err)
+	}
+}
+
+// name is the attachment's file name
+func export_xlsx_write(w http.ResponseWriter, name string, pp *pay_period, emp_arr []db_get_employee_info) {
+	export_attachment(w, EXPORT_XLSX_TYPE, name)
+
+	x := xl_stream_new(w)
+	xl_report_write(x, pp, emp_arr)
+	if err := xl_stream_close(x); err != nil {
+		export_abort("xlsx", err)
+	}
+}
+
+func export_xlsx(w http.ResponseWriter, req *http.Request) {
+	if !site_authorized(w, req) {
+		return
+	}
+	f, err := export_parse_filter(req)
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusBadRequest)
+		return
+	}
+
+	if f.from.IsZero() {
+		period := xl_this_period()
+		f.from = time.Date(period.Year(), period.Month(), period.Day(), 0, 0, 0, 0, time.Local)
+	}
+	if f.to.IsZero() {
+		year, month, day := time.Now().Date()
+		f.to = time.Date(year, month, day, 0, 0, 0, 0, time.Local)
+	}
+	if f.to.Before(f.from) {
+		http.Error(w, "to is before from", http.StatusBadRequest)
+		return
+	}
+	if f.to.Sub(f.from) > EXPORT_XLSX_MAX_DAYS*24*time.Hour {
+		http.Error(w, fmt.Sprintf("at most %d days per report", EXPORT_XLSX_MAX_DAYS), http.StatusBadRequest)
+		return
+	}
+
+	emp_arr, err := employee_dir_all()
+	if err != nil {
+		http.Error(w, "could not read employees", http.StatusInternalServerError)
+		return
+	}
+	if len(f.ids) > 0 {
+		want := make(map[uint32]bool, len(f.ids))
+		for _, id := range f.ids {
+			want[uint32(id)] = true
+		}
+		filtered := emp_arr[:0]
+		for _, emp := range emp_arr {
+			if want[emp.Id] {
+				filtered = append(filtered, emp)
+			}
+		}
+		emp_arr = filtered
+	}
+
+	name := "report_" + f.from.Format(DATE_FORMAT) + "_" + f.to.Format(DATE_FORMAT) + ".xlsx"
+	export_xlsx_write(w, name, pay_period_load_days(pay_period_range(f.from, f.to)), emp_arr)
+}
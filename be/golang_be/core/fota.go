@@ -1,7 +1,7 @@
 package main
 
 import (
-	"os"
+	"io/ioutil"
 	"strconv"
 	"time"
 )
@@ -168,32 +168,34 @@ func check_status(expected_type uint8, expected_status uint8, status uint8, Type
 	return true
 }
 
-func create_ipc_fota_start_packet(DeviceId uint64, fw_version uint16) (Ipc_packet, bool) {
-	var f *os.File
-	var err error
+// returns the aligned image to send out, mini test images are per device and are read off disk,
+// real images come out of the fw catalog
+func fota_get_image(DeviceId uint64, fw_version uint16) ([]byte, uint32, bool) {
 	if fw_version >= FOTA_FW_VERSION_MINI_TEST {
 		deviceIdString := strconv.FormatUint(DeviceId, 10)
 		deviceIdString += "_minitest"
-		f, err = os.Open(deviceIdString)
+		buf, err := ioutil.ReadFile(deviceIdString)
 		if err != nil {
 			logger(PRINT_FATAL, "could not open file, err =", err)
 		}
-	} else {
-		fota_source := "./fw_versions/timeScan_" + strconv.Itoa(int(fw_version)) + "_aligned.bin"
-		f, err = os.Open(fota_source)
-		if err != nil {
-			logger(PRINT_FATAL, "Could not open FOTA file!")
-			return Ipc_packet{}, false
-		}
+		return buf, crc32(buf), true
+	}
+
+	img := fw_catalog_get(fw_version)
+	if img == nil {
+		logger(PRINT_WARN, "FW version", fw_version, "not in fw catalog!")
+		return nil, 0, false
 	}
+	return img.aligned, img.crc32, true
+}
 
-	// Get file size
-	fi, err := f.Stat()
-	if err != nil {
-		logger(PRINT_FATAL, "could not get file stat!, err =", err)
+func create_ipc_fota_start_packet(DeviceId uint64, fw_version uint16) (Ipc_packet, bool) {
+	buf, crc, ok := fota_get_image(DeviceId, fw_version)
+	if !ok {
+		return Ipc_packet{}, false
 	}
 
-	size := fi.Size()
+	size := len(buf)
 	logger(PRINT_NORMAL, "FOTA image size ==", size)
 	if 0 == size {
 		logger(PRINT_FATAL, "FOTA image size == 0")
@@ -203,16 +205,10 @@ func create_ipc_fota_start_packet(DeviceId uint64, fw_version uint16) (Ipc_packe
 		logger(PRINT_FATAL, "FOTA image size not one block size!")
 	}
 
-	buf := make([]byte, size)
-	_, err = f.ReadAt(buf, 0)
-	if err != nil {
-		logger(PRINT_FATAL, "Could not read file for FOTA!")
-	}
-
 	fp := Fota_packet{}
 	fp.FW_version = fw_version
 	fp.FW_blocks = uint16(size / (SEGMENTS_PER_META_FOTA_PACKET * LARGE_PAYLOAD_SIZE))
-	fp.FW_CRC32 = crc32(buf)
+	fp.FW_CRC32 = crc
 	fp.Type = FOTA_START_PACKET
 
 	ipc := Ipc_packet{}
@@ -249,22 +245,10 @@ func create_ipc_fota_final_packet(DeviceId uint64, clientId uint64, fw_version u
 }
 
 func create_fota_data_packet(DeviceId uint64, ClientId uint64, segment int, fw_version uint16) (Ipc_packet, bool) {
-	var f *os.File
-	var err error
-	if fw_version >= FOTA_FW_VERSION_MINI_TEST {
-		deviceIdString := strconv.FormatUint(DeviceId, 10)
-		deviceIdString += "_minitest"
-		f, err = os.Open(deviceIdString)
-		if err != nil {
-			logger(PRINT_FATAL, "could not open file, err =", err)
-		}
-	} else {
-		fota_source := "./fw_versions/timeScan_" + strconv.Itoa(int(fw_version)) + "_aligned.bin"
-		f, err = os.Open(fota_source)
-		if err != nil {
-			logger(PRINT_FATAL, "Could not open FOTA file = ", fota_source)
-			return Ipc_packet{}, false
-		}
+	img, _, ok := fota_get_image(DeviceId, fw_version)
+	if !ok {
+		logger(PRINT_FATAL, "Could not get FOTA image, version = ", fw_version)
+		return Ipc_packet{}, false
 	}
 
 	ipc := Ipc_packet{}
@@ -275,33 +259,21 @@ func create_fota_data_packet(DeviceId uint64, ClientId uint64, segment int, fw_v
 	ipc.P.Transaction_id = get_new_transaction_id()
 	ipc.P.Consumer_ack_req = CONSUMER_ACK_REQUIRED
 
-	buf := make([]byte, LARGE_PAYLOAD_SIZE)
-	n, err := f.ReadAt(buf, int64(segment*LARGE_PAYLOAD_SIZE))
-	if n != LARGE_PAYLOAD_SIZE {
-		logger(PRINT_FATAL, "did not read LARGE_PAYLOAD_SIZE!, read =", n)
+	off := segment * LARGE_PAYLOAD_SIZE
+	if off+LARGE_PAYLOAD_SIZE > len(img) {
+		logger(PRINT_FATAL, "did not read LARGE_PAYLOAD_SIZE!, read =", len(img)-off)
 	}
-	ipc.P.Data = buf
+	// image is read only, safe to hand out a slice of it
+	ipc.P.Data = img[off : off+LARGE_PAYLOAD_SIZE]
 
 	return ipc, true
 }
 
 func create_fota_meta_packet(DeviceId uint64, ClientId uint64, segment int, fw_version uint16) (Ipc_packet, bool) {
-	var f *os.File
-	var err error
-	if fw_version >= FOTA_FW_VERSION_MINI_TEST {
-		deviceIdString := strconv.FormatUint(DeviceId, 10)
-		deviceIdString += "_minitest"
-		f, err = os.Open(deviceIdString)
-		if err != nil {
-			logger(PRINT_FATAL, "could not open file, err =", err)
-		}
-	} else {
-		fota_source := "./fw_versions/timeScan_" + strconv.Itoa(int(fw_version)) + "_aligned.bin"
-		f, err = os.Open(fota_source)
-		if err != nil {
-			logger(PRINT_WARN, "Could not open FOTA fine!")
-			return Ipc_packet{}, false
-		}
+	img, _, ok := fota_get_image(DeviceId, fw_version)
+	if !ok {
+		logger(PRINT_WARN, "Could not get FOTA image!")
+		return Ipc_packet{}, false
 	}
 
 	ipc := Ipc_packet{}
@@ -309,14 +281,11 @@ func create_fota_meta_packet(DeviceId uint64, ClientId uint64, segment int, fw_v
 	ipc.ClientId = ClientId
 	ipc.P.Packet_type = FOTA_PACKET
 
-	buf := make([]byte, LARGE_PAYLOAD_SIZE*SEGMENTS_PER_META_FOTA_PACKET)
-	n, err := f.ReadAt(buf, int64(segment*LARGE_PAYLOAD_SIZE))
-	if n != LARGE_PAYLOAD_SIZE*SEGMENTS_PER_META_FOTA_PACKET {
-		logger(PRINT_FATAL, "did not read LARGE_PAYLOAD_SIZE!, read =", n)
-	}
-	if err != nil {
-		logger(PRINT_FATAL, "Failed to read a block from memory", err)
+	off := segment * LARGE_PAYLOAD_SIZE
+	if off+LARGE_PAYLOAD_SIZE*SEGMENTS_PER_META_FOTA_PACKET > len(img) {
+		logger(PRINT_FATAL, "did not read LARGE_PAYLOAD_SIZE!, read =", len(img)-off)
 	}
+	buf := img[off : off+LARGE_PAYLOAD_SIZE*SEGMENTS_PER_META_FOTA_PACKET]
 
 	fap := Fota_packet{}
 	fap.Type = FOTA_META_PACKET
@@ -343,40 +312,3 @@ func create_fota_ack_packet(DeviceId uint64, ClientId uint64, status uint8, Type
 
 	return ipc
 }
-
-func create_fota_image(fw_version uint16) bool {
-	fota_source := "./fw_versions/timeScan_" + strconv.Itoa(int(fw_version)) + ".bin"
-	logger(PRINT_NORMAL, "using fota_source = ", fota_source)
-	f, err := os.Open(fota_source)
-	if err != nil {
-		logger(PRINT_FATAL, "Could not open FOTA file!")
-		return false
-	}
-
-	fi, err := f.Stat()
-	if err != nil {
-		logger(PRINT_FATAL, "Could not open FOTA info!")
-		return false
-	}
-
-	buf := make([]byte, fi.Size())
-	f.Read(buf)
-
-	for {
-		/* loop goes BRRR*/
-		if len(buf)%4096 == 0 {
-			break
-		}
-		buf = append(buf, 0)
-	}
-
-	fota_source_aligned := "./fw_versions/timeScan_" + strconv.Itoa(int(fw_version)) + "_aligned.bin"
-	logger(PRINT_NORMAL, "Creating", fota_source_aligned)
-	fa, err := os.Create(fota_source_aligned)
-	if err != nil {
-		logger(PRINT_FATAL, "Failed to create!: err = ", err)
-	}
-	defer fa.Close()
-	fa.Write(buf)
-	return true
-}
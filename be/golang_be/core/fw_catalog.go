@@ -0,0 +1,244 @@
+package main
+
+import (
+	"io/ioutil"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"syscall"
+	"time"
+	"unsafe"
+)
+
+// In memory index of ./fw_versions, built once at boot and rebuilt when the directory changes
+// so a HELLO (or a whole fleet of them after a restart) never has to touch the disk
+
+const FW_CATALOG_DIR = "./fw_versions"
+const FW_CATALOG_PREFIX = "timeScan_"
+const FW_CATALOG_SUFFIX = ".bin"
+const FW_CATALOG_BLOCK_SIZE = (SEGMENTS_PER_META_FOTA_PACKET * LARGE_PAYLOAD_SIZE)
+const FW_CATALOG_POLL_S = (30) // only used if inotify is not available
+
+// inotify events we care about, a new image landing or an old one being pulled
+const FW_CATALOG_EVENTS = syscall.IN_CLOSE_WRITE | syscall.IN_MOVED_TO | syscall.IN_MOVED_FROM | syscall.IN_DELETE |
+	syscall.IN_DELETE_SELF | syscall.IN_MOVE_SELF
+
+// the directory itself went away (a deploy swapping it out), the watch has to be put on the new one
+const FW_CATALOG_EVENTS_SELF = syscall.IN_DELETE_SELF | syscall.IN_MOVE_SELF | syscall.IN_IGNORED
+
+type fw_image struct {
+	version uint16
+	path    string
+	size    int64 // size of the .bin on disk
+	mtime   time.Time
+	crc32   uint32 // over the aligned buffer, same as what the device checks
+	blocks  uint16 // number of FW_CATALOG_BLOCK_SIZE blocks
+	aligned []byte // padded to FW_CATALOG_BLOCK_SIZE, never written to after being published
+}
+
+var fw_catalog map[uint16]*fw_image
+var fw_catalog_latest uint16
+var fw_catalog_mutex sync.RWMutex
+
+// returns version, 0 if the file is not a (non aligned) fw image
+func fw_catalog_parse_name(name string) (uint16, bool) {
+	if !strings.HasPrefix(name, FW_CATALOG_PREFIX) || !strings.HasSuffix(name, FW_CATALOG_SUFFIX) {
+		return 0, false
+	}
+
+	v := strings.TrimSuffix(strings.TrimPrefix(name, FW_CATALOG_PREFIX), FW_CATALOG_SUFFIX)
+	i, err := strconv.Atoi(v)
+	if err != nil || i <= 0 || i >= FOTA_FW_VERSION_MINI_TEST {
+		return 0, false
+	}
+	return uint16(i), true
+}
+
+func fw_catalog_load_image(version uint16, path string, fi os.FileInfo) (*fw_image, bool) {
+	buf, err := ioutil.ReadFile(path)
+	if err != nil {
+		logger(PRINT_WARN, "fw catalog could not read", path, "err =", err)
+		return nil, false
+	}
+
+	size := int64(len(buf))
+	if size == 0 {
+		logger(PRINT_WARN, "fw catalog skipping empty image", path)
+		return nil, false
+	}
+
+	if pad := len(buf) % FW_CATALOG_BLOCK_SIZE; pad != 0 {
+		buf = append(buf, make([]byte, FW_CATALOG_BLOCK_SIZE-pad)...)
+	}
+
+	img := &fw_image{}
+	img.version = version
+	img.path = path
+	img.size = size
+	img.mtime = fi.ModTime()
+	img.aligned = buf
+	img.blocks = uint16(len(buf) / FW_CATALOG_BLOCK_SIZE)
+	img.crc32 = crc32(buf)
+
+	return img, true
+}
+
+// rebuilds the catalog, images that did not change (same size + mtime) are reused
+func fw_catalog_refresh() {
+	files, err := ioutil.ReadDir(FW_CATALOG_DIR)
+	if err != nil {
+		logger(PRINT_WARN, "fw catalog could not read", FW_CATALOG_DIR, "err =", err)
+		return
+	}
+
+	fw_catalog_mutex.RLock()
+	old := fw_catalog
+	fw_catalog_mutex.RUnlock()
+
+	new_catalog := make(map[uint16]*fw_image)
+	latest := uint16(0)
+
+	for _, fi := range files {
+		if fi.IsDir() {
+			continue
+		}
+
+		version, ok := fw_catalog_parse_name(fi.Name())
+		if !ok {
+			continue
+		}
+
+		path := FW_CATALOG_DIR + "/" + fi.Name()
+		if img, ok := old[version]; ok && img.size == fi.Size() && img.mtime.Equal(fi.ModTime()) {
+			new_catalog[version] = img
+		} else {
+			img, ok := fw_catalog_load_image(version, path, fi)
+			if !ok {
+				continue
+			}
+			logger_kv(PRINT_NORMAL, "fw catalog loaded", "path", path, "size", img.size, "blocks", img.blocks, "crc32", img.crc32)
+			new_catalog[version] = img
+		}
+
+		if version > latest {
+			latest = version
+		}
+	}
+
+	fw_catalog_mutex.Lock()
+	fw_catalog = new_catalog
+	fw_catalog_latest = latest
+	fw_catalog_mutex.Unlock()
+
+	logger(PRINT_NORMAL, "fw catalog has", len(new_catalog), "images, latest FW =", latest)
+}
+
+// returns nil if we don't have that version
+func fw_catalog_get(version uint16) *fw_image {
+	fw_catalog_mutex.RLock()
+	defer fw_catalog_mutex.RUnlock()
+	return fw_catalog[version]
+}
+
+// returns 0 if there is no FW to hand out
+func fw_catalog_latest_version() uint16 {
+	fw_catalog_mutex.RLock()
+	defer fw_catalog_mutex.RUnlock()
+	return fw_catalog_latest
+}
+
+func fw_catalog_poll() {
+	for {
+		time.Sleep(time.Second * FW_CATALOG_POLL_S)
+		fw_catalog_refresh()
+	}
+}
+
+func fw_catalog_watch_add(fd int) (int, error) {
+	return syscall.InotifyAddWatch(fd, FW_CATALOG_DIR, FW_CATALOG_EVENTS)
+}
+
+// returns -1 if inotify could not be set up
+func fw_catalog_watch_init() (int, int) {
+	fd, err := syscall.InotifyInit()
+	if err != nil {
+		logger(PRINT_WARN, "fw catalog could not init inotify, falling back to polling, err =", err)
+		return -1, -1
+	}
+
+	wd, err := fw_catalog_watch_add(fd)
+	if err != nil {
+		logger(PRINT_WARN, "fw catalog could not watch", FW_CATALOG_DIR, "falling back to polling, err =", err)
+		syscall.Close(fd)
+		return -1, -1
+	}
+	return fd, wd
+}
+
+// true if one of the events says the directory behind wd is gone. Events for an older watch
+// (the IN_IGNORED fw_catalog_watch_readd's rm causes) are not about the current directory
+func fw_catalog_watch_lost(buf []byte, wd int) bool {
+	for off := 0; off+syscall.SizeofInotifyEvent <= len(buf); {
+		event := (*syscall.InotifyEvent)(unsafe.Pointer(&buf[off]))
+		if int(event.Wd) == wd && event.Mask&FW_CATALOG_EVENTS_SELF != 0 {
+			return true
+		}
+		off += syscall.SizeofInotifyEvent + int(event.Len)
+	}
+	return false
+}
+
+// polls until FW_CATALOG_DIR is back and can be watched again
+func fw_catalog_watch_readd(fd int, wd int) int {
+	syscall.InotifyRmWatch(fd, uint32(wd)) // still on the moved directory after an IN_MOVE_SELF
+
+	for {
+		wd, err := fw_catalog_watch_add(fd)
+		// rescan after the watch is up, same as fw_catalog_init
+		fw_catalog_refresh()
+		if err == nil {
+			logger(PRINT_NORMAL, "fw catalog watching", FW_CATALOG_DIR, "again")
+			return wd
+		}
+		logger(PRINT_WARN, "fw catalog lost", FW_CATALOG_DIR, "polling until it is back, err =", err)
+		time.Sleep(time.Second * FW_CATALOG_POLL_S)
+	}
+}
+
+func fw_catalog_watch(fd int, wd int) {
+	defer syscall.Close(fd)
+
+	// we don't care what changed, just that something did, a rescan is cheap
+	buf := make([]byte, (syscall.SizeofInotifyEvent+syscall.NAME_MAX+1)*16)
+	for {
+		n, err := syscall.Read(fd, buf)
+		if err != nil {
+			if err == syscall.EINTR {
+				continue
+			}
+			logger(PRINT_WARN, "fw catalog inotify read failed, falling back to polling, err =", err)
+			fw_catalog_poll()
+			return
+		}
+		if fw_catalog_watch_lost(buf[:n], wd) {
+			wd = fw_catalog_watch_readd(fd, wd)
+			continue
+		}
+		fw_catalog_refresh()
+	}
+}
+
+func fw_catalog_init() {
+	fw_catalog = make(map[uint16]*fw_image)
+
+	// watch has to be up before the first scan, or we could miss an image landing in between
+	fd, wd := fw_catalog_watch_init()
+	fw_catalog_refresh()
+
+	if fd < 0 {
+		go fw_catalog_poll()
+	} else {
+		go fw_catalog_watch(fd, wd)
+	}
+}
@@ -0,0 +1 @@
+../packet/ipc_transport.go
\ No newline at end of file
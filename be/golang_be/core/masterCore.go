@@ -3,9 +3,7 @@ package main
 import (
 	"bitbucket.org/avd/go-ipc/mq"
 	"log"
-	"math/rand"
 	"os"
-	"strconv"
 	"sync"
 	"time"
 )
@@ -21,8 +19,7 @@ var cool_down_map map[uint32]time.Time // maps id to the time they signed up. It
 
 var device_busy_mutex, client_id_to_device_id_map, client_map_mutext, test_client_map_mutext, cmd_mux_mutex, cool_down_timer_mutex, sync_device_mutex sync.Mutex
 
-var dmq_from_site_to_core, dmq_from_core_to_site *mq.LinuxMessageQueue
-var dmq_from_packet_to_core, dmq_from_core_to_packet *mq.LinuxMessageQueue
+var dmq_from_site_to_core, dmq_from_core_to_site ipc_queue
 
 func init_lmq_core() {
 	mq.DestroyLinuxMessageQueue("smq_from_site_to_core")
@@ -37,9 +34,20 @@ func init_lmq_core() {
 		logger(PRINT_FATAL, "Could not create linux smq_client - (did yu increase the limit in /proc/sys/fs/mqueue/msg_max?  error: ", err)
 	}
 
-	dmq_from_core_to_site, err = mq.CreateLinuxMessageQueue("smq_from_core_to_site", os.O_RDWR, IPC_QUEUE_PERM, 10, MAX_IPC_LEN)
-	if err != nil {
-		logger(PRINT_FATAL, "Could not create linux smq_client - (did yu increase the limit in /proc/sys/fs/mqueue/msg_max?  error: ", err)
+	// both ends of this one live in core
+	dmq_from_core_to_site = create_ipc_chan()
+
+	if ipc_in_process {
+		return // single/, the packet server is in this process
+	}
+
+	if IPC_TRANSPORT == IPC_TRANSPORT_UNIX {
+		s := create_ipc_stream()
+		dmq_from_packet_to_core = s
+		dmq_from_core_to_packet = s
+		go ipc_stream_serve(s, IPC_UNIX_PATH)
+		logger(PRINT_DEBUG, "Created unix socket IPC")
+		return
 	}
 
 	dmq_from_packet_to_core, err = mq.CreateLinuxMessageQueue("smq_from_packet_to_core", os.O_RDWR, IPC_QUEUE_PERM, 10, MAX_IPC_LEN)
@@ -214,14 +222,14 @@ func handle_incomming_packet(ip Ipc_packet) {
 			go test_dispatcher(client)
 		} else {
 
-			_, latest_fw_int := latest_fw()
-			if latest_fw_int == 0 {
+			latest_fw := fw_catalog_latest_version()
+			if latest_fw == 0 {
 				break
 			}
 
 			// FW is outdated, FOTA time
-			if client.fw_version < uint16(latest_fw_int) {
-				fota(client, uint16(latest_fw_int))
+			if client.fw_version < latest_fw {
+				fota(client, latest_fw)
 			}
 			break
 		}
@@ -233,37 +241,6 @@ func handle_incomming_packet(ip Ipc_packet) {
 		cmd_response_mux(ip)
 		break
 
-	case LOGIN_PACKET:
-		logger(PRINT_NORMAL, "Login Packet RXed")
-		lp := packet_login_unpack(ip.P.Data)
-		deviceId, _ := get_device_id_from_client(ip.ClientId)
-
-		/* check to see if there is a cool down period on id, ie, we just added it */
-
-		logger(PRINT_SUPER_DEBUG, "Taking lock cool_down_timer_mutex in LOGIN_PACKET")
-		cool_down_timer_mutex.Lock()
-
-		if t, ok := cool_down_map[lp.uid]; ok {
-			if time.Now().Sub(t) < time.Second*120 {
-				logger(PRINT_NORMAL, "RXed a login within the cooldown period, silently discarding!")
-
-				cool_down_timer_mutex.Unlock()
-				return
-			}
-		}
-		cool_down_timer_mutex.Unlock()
-
-		ok := db_put(deviceId, lp.signInOrSignOut, lp.uid, time.Time{})
-		if !ok {
-			logger_id(PRINT_WARN, deviceId, "unknown user logged in, we will force sync the device!")
-			//send sync go device
-			c := client{}
-			c.ClientId = ip.ClientId
-			c.deviceId = deviceId
-			db_sync(c, SYNC_NORMAL_MODE)
-		}
-
-		break
 	case VOID_PACKET:
 		logger(PRINT_NORMAL, "RXed a void packet, silently disgarding...")
 		break
@@ -289,8 +266,9 @@ func handle_incomming_site(ip Ipc_packet) {
 }
 
 func mq_site_to_packet_writter() {
+	// ipc_packet_unpack copies the payload out, safe to reuse rx
+	rx := make([]byte, MAX_IPC_LEN)
 	for {
-		rx := make([]byte, PACKET_LEN_MAX)
 		n, err := dmq_from_site_to_core.Receive(rx)
 		if err != nil {
 			log.Fatal("failed to read q")
@@ -303,7 +281,7 @@ func mq_site_to_packet_writter() {
 
 func mq_from_packet_to_core() {
 	logger(PRINT_NORMAL, "starting packet core listner")
-	rx := make([]byte, PACKET_LEN_MAX)
+	rx := make([]byte, MAX_IPC_LEN)
 	var n int
 	var err error
 	for {
@@ -313,6 +291,11 @@ func mq_from_packet_to_core() {
 		}
 		ip := ipc_packet_unpack(rx[:n])
 
+		// punches are batched (punch_ingest.go), queue them in the order they came in
+		if ip.P.Packet_type == LOGIN_PACKET {
+			punch_submit(ip)
+			continue
+		}
 		go handle_incomming_packet(ip)
 	}
 }
@@ -326,25 +309,6 @@ func init_maps() {
 	cool_down_map = make(map[uint32]time.Time)
 }
 
-func latest_fw() (string, int) {
-
-	var file_name string
-	var latest_fw string
-	var latest_fw_int int
-
-	for i := 0; i < 100; i++ {
-		file_name = "./fw_versions/timeScan_" + strconv.Itoa(i) + ".bin"
-		if _, err := os.Stat(file_name); os.IsNotExist(err) {
-			continue
-		} else {
-			latest_fw = file_name
-			latest_fw_int = i
-		}
-	}
-	logger(PRINT_NORMAL, "Latest FW = ", latest_fw)
-	return latest_fw, latest_fw_int
-}
-
 func sync_devices() {
 	deviceArr := get_all_devices()
 	for _, v := range deviceArr {
@@ -371,17 +335,38 @@ func sync_devices_timer() {
 	}
 }
 
-func main() {
-	rand.Seed(time.Now().UnixNano())
-	logger_init("_server") //must be first
+// the partition a punch goes into has to exist before the month starts, main makes the first ones
+func timeinfo_partition_timer() {
+	for {
+		time.Sleep(time.Hour * 23)
+
+		err := timeinfo_partitions_ensure(db, time.Now())
+		if err != nil {
+			logger(PRINT_FATAL, "Could not create timeinfo partitions", err)
+		}
+	}
+}
 
+// everything but the logger, main (core_main.go) or single/ sets that up
+func core_run() {
 	init_lmq_core()
 	init_maps()
 	db_connect()
+	err := timeinfo_partitions_ensure(db, time.Now())
+	if err != nil {
+		logger(PRINT_FATAL, "Could not create timeinfo partitions", err)
+	}
+	daily_hours_init()
+	fw_catalog_init()
 
 	go sync_devices_timer()
+	go device_stats_timer()
+	go punch_ingest()
+	go timeinfo_partition_timer()
+	go employee_dir_listen()
 
-	go xl_archive()
+	go report_cache_timer()
+	go db_stats_timer()
 	go mq_from_packet_to_core()
 	go mq_site_to_packet_writter()
 	go mq_site_listner()
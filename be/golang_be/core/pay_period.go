@@ -0,0 +1,246 @@
+package main
+
+import (
+	"time"
+)
+
+// A pay period report is worked out from one daily_hours range scan: every employee's first
+// login and last logout of every day in the period are read up front (db_get_daily_hours)
+// and judged here.
+// Shifts and salaries come from the employee directory, nothing else goes to the db
+
+// daily_hours only keeps the first login and the last logout, that is all time_worked_judge
+// looks at
+type day_punches struct {
+	logins  []time.Time
+	logouts []time.Time
+}
+
+// id -> datework (DATE_FORMAT) -> punches
+type punch_set map[uint32]map[string]*day_punches
+
+type pay_period struct {
+	days    []time.Time // weekdays only, weekends are not judged
+	punches punch_set
+}
+
+// Time is the 1st (1st - 15th) or the 16th (16th - last day of the month)
+func pay_period_dates(Time time.Time) []time.Time {
+	if Time.Day() != 1 && Time.Day() != 16 {
+		logger(PRINT_FATAL, "Can only accept on 16 and 1st day of month")
+	}
+
+	var totalDaysInPeriod int
+	if Time.Day() == 1 {
+		totalDaysInPeriod = 15
+	} else { /*magic to calculate last day of the month */
+		firstDate := Time.AddDate(0, 0, -15)
+		totalDaysInPeriod = firstDate.AddDate(0, 1, -1).Day() - 15
+	}
+
+	return pay_period_range(Time, Time.AddDate(0, 0, totalDaysInPeriod-1))
+}
+
+// the 1st or the 16th of the pay period day is in, as pay_period_dates wants it
+func pay_period_start(day time.Time) time.Time {
+	start := 1
+	if day.Day() >= 16 {
+		start = 16
+	}
+	return time.Date(day.Year(), day.Month(), start, 0, 0, 0, 0, time.UTC)
+}
+
+// the weekdays from from to to, both included
+func pay_period_range(from, to time.Time) []time.Time {
+	var ret []time.Time
+	for day := from; !day.After(to); day = day.AddDate(0, 0, 1) {
+		if day.Weekday() == 0 || day.Weekday() == 6 {
+			continue
+		}
+		ret = append(ret, day)
+	}
+	return ret
+}
+
+func pay_period_load(Time time.Time) *pay_period {
+	return pay_period_load_days(pay_period_dates(Time))
+}
+
+// any run of days, the exports are not tied to the 1st and the 16th
+func pay_period_load_days(days []time.Time) *pay_period {
+	pp := pay_period{}
+	pp.days = days
+	if len(pp.days) == 0 {
+		pp.punches = punch_set{}
+		return &pp
+	}
+
+	from := pp.days[0].Format(DATE_FORMAT)
+	to := pp.days[len(pp.days)-1].Format(DATE_FORMAT)
+	pp.punches = db_get_daily_hours(from, to)
+	return &pp
+}
+
+// see db_get_time_worked_in_day
+func pay_period_day(pp *pay_period, id uint32, day time.Time) (time.Duration, int, db_single_shift, db_single_shift, int) {
+	shift, valid := db_get_employee_shift_day(id, day.Weekday())
+	if !valid {
+		logger(PRINT_FATAL, "Invalid shift returned")
+	}
+
+	var logins, logouts []time.Time
+	if p, ok := pp.punches[id][day.Format(DATE_FORMAT)]; ok {
+		logins = p.logins
+		logouts = p.logouts
+	}
+	return time_worked_judge(logins, logouts, shift)
+}
+
+func pay_period_arr(pp *pay_period, id uint32) []db_composite_per_day {
+	var ret []db_composite_per_day
+	var day db_composite_per_day
+
+	for _, date := range pp.days {
+		total_worked, valid, expected_shift, actual_shift, missing := pay_period_day(pp, id, date)
+		shift_duration_expected := db_get_shift_duration_weekday(id, date)
+
+		day.date = date
+		day.actual_shift = actual_shift
+		day.expected_shift = expected_shift
+		day.actual_hours = total_worked
+		day.anomolies = valid
+		day.expected_hours = shift_duration_expected
+
+		if missing == TIME_MISSING_LOGIN {
+			day.actual_shift.Shift_start = time.Time{}
+		}
+
+		if missing == TIME_MISSING_LOGOUT {
+			day.actual_shift.Shift_end = time.Time{}
+		}
+
+		day.delta = day.expected_hours - day.actual_hours
+		ret = append(ret, day)
+	}
+	return ret
+}
+
+// the overview's totals from the days pay_period_arr worked out
+func pay_period_sum(id uint32, arr []db_composite_per_day) db_hours_pay_period {
+	var ret db_hours_pay_period
+
+	for _, day := range arr {
+		ret.actual_hours += day.actual_hours
+		if day.anomolies != TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
+			ret.expected_hours += day.expected_hours
+		}
+
+		if day.anomolies != 0 {
+			ret.anomolies = true
+		}
+	}
+	hourly_wage, valid := db_get_employee_hourly_salary(id)
+	if valid {
+		ret.exptected_sal = ret.expected_hours.Hours() * hourly_wage
+		ret.actual_sal = ret.actual_hours.Hours() * hourly_wage
+	}
+	return ret
+}
+
+// If an emplyee is supposed to work on a day, their work will be judged versus their expted shift
+// if they
+//
+//	a) Are supposed to work and,
+//	    1) login, logout in a sensible manner, work time is returned
+//	    2) forget to do either login, or logout, logout/login time that is missing will be taken from shift dabatase and it will be flagged
+//	    3) not login AND logout, 0 will be retuend
+//	b) are not supposed to work and,
+//	    1) login, logout in a sensible manner, work time is returned, but this is flagged
+//	    2) missing eitehr log in or logout time, flagged as error, 0 work time returned
+//	c) worked a negative amount of time, (logged in befoer they logged out), this is flagged as an error
+//	d) Did no work on a day they are not uspposed to wrok
+//	    1) 0 time is returned, and it is "flagged"
+//	for multiple login/logout cases, the earliest login is considered and the latest logout
+func time_worked_judge(time_info_login, time_info_logout []time.Time, shift db_single_shift) (time.Duration, int, db_single_shift, db_single_shift, int) {
+	/* used to let other APIs know if a login/logout was taking from shift
+	infromation instead of real values */
+	var missing_login_logout int
+
+	/* no login AND logout times  */
+	if len(time_info_login) == 0 && len(time_info_logout) == 0 {
+		/* not supposed to work today */
+		if shift.Shift_start.IsZero() {
+			return 0, TIME_WORKED_VALID, db_single_shift{}, db_single_shift{}, 0
+		}
+		return 0, TIME_WORKED_MISSING, db_single_shift{}, db_single_shift{}, 0
+	}
+
+	var ret int
+
+	/* worked on wrong day, mark it as such */
+	if shift.Shift_start.IsZero() {
+		ret = TIME_WORKED_ON_WRONG_DAY
+	}
+
+	if len(time_info_login) == 0 {
+		if shift.Shift_start.IsZero() {
+			ret = TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY
+			goto calculate_time
+		}
+		missing_login_logout = TIME_MISSING_LOGIN
+		time_info_login = []time.Time{shift.Shift_start}
+		ret = TIME_WORKED_MISSING_ONE
+	}
+
+	if len(time_info_logout) == 0 {
+		if shift.Shift_end.IsZero() {
+			ret = TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY
+			goto calculate_time
+		}
+		missing_login_logout = TIME_MISSING_LOGOUT
+		time_info_logout = []time.Time{shift.Shift_end}
+		ret = TIME_WORKED_MISSING_ONE
+	}
+
+calculate_time:
+	var first_in, last_out time.Time
+
+	if len(time_info_login) > 0 {
+		first_in = time_info_login[0]
+		for _, login := range time_info_login {
+			if login.Before(first_in) {
+				first_in = login
+			}
+		}
+	}
+
+	if len(time_info_logout) > 0 {
+		last_out = time_info_logout[0]
+		for _, logout := range time_info_logout {
+			if logout.After(last_out) {
+				last_out = logout
+			}
+		}
+	}
+
+	total_work := last_out.Sub(first_in)
+
+	if ret != TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
+		if total_work < 0 {
+			return 0, TIME_WORKED_NEGATIVE, db_single_shift{}, db_single_shift{}, 0
+		}
+	}
+
+	/* actuall shift details */
+	var shift_actual, shift_expected db_single_shift
+	shift_actual.Shift_start = first_in
+	shift_actual.Shift_end = last_out
+
+	shift_expected.Shift_start = shift.Shift_start
+	shift_expected.Shift_end = shift.Shift_end
+
+	if ret == TIME_WORKED_MISSING_ONE_ON_NON_WORK_DAY {
+		total_work = 0
+	}
+	return total_work, ret, shift_expected, shift_actual, missing_login_logout
+}
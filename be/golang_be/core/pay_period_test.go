@@ -0,0 +1,111 @@
+package main
+
+import (
+	"bytes"
+	"fmt"
+	"math/rand"
+	"testing"
+	"time"
+)
+
+/**********************************************************
+*	Pay period report on synthetic data, what core does
+*	after the one daily_hours range scan (pay_period_load):
+*	judge every weekday of every employee and write the
+*	workbook. The employee directory is filled up front,
+*	nothing goes to the db
+*
+*	PAY_PERIOD_BENCH_EMPLOYEES employees, shifts on most
+*	weekdays, and days with no punches, a login or logout
+*	only, and negative days mixed in
+*
+*	./core.sh -bench PayPeriod
+*********************************************************/
+
+const PAY_PERIOD_BENCH_EMPLOYEES = (100)
+
+func pay_period_bench_clock(h, m int) time.Time {
+	return time.Date(0, 1, 1, h, m, 0, 0, time.UTC)
+}
+
+// the directory and the period's punches, as daily_hours would have them
+func pay_period_bench_setup(period time.Time) (*pay_period, []db_get_employee_info) {
+	rng := rand.New(rand.NewSource(1))
+	dir := make(map[uint32]employee_dir_entry)
+	var emp_arr []db_get_employee_info
+
+	pp := &pay_period{days: pay_period_dates(period), punches: punch_set{}}
+	for id := uint32(1); id <= PAY_PERIOD_BENCH_EMPLOYEES; id++ {
+		var e employee_dir_entry
+		e.info = db_get_employee_info{Id: id, Name: fmt.Sprintf("employee %03d", id), Salary: 30000 + rng.Intn(50000)}
+
+		s := &e.shift
+		for _, day := range [][2]*time.Time{{&s.Shift_m_s, &s.Shift_m_e}, {&s.Shift_t_s, &s.Shift_t_e},
+			{&s.Shift_w_s, &s.Shift_w_e}, {&s.Shift_th_s, &s.Shift_th_e}, {&s.Shift_f_s, &s.Shift_f_e}} {
+			if rng.Intn(6) != 0 {
+				*day[0], *day[1] = pay_period_bench_clock(8+rng.Intn(3), 0), pay_period_bench_clock(16+rng.Intn(3), 30)
+			}
+		}
+		dir[id] = e
+		emp_arr = append(emp_arr, e.info)
+
+		pp.punches[id] = make(map[string]*day_punches)
+		for _, day := range pp.days {
+			var p day_punches
+			switch n := rng.Intn(100); {
+			case n < 10: // nothing
+				continue
+			case n < 15:
+				p.logins = []time.Time{pay_period_bench_clock(8+rng.Intn(3), rng.Intn(60))}
+			case n < 20:
+				p.logouts = []time.Time{pay_period_bench_clock(16+rng.Intn(3), rng.Intn(60))}
+			case n < 22:
+				p.logins = []time.Time{pay_period_bench_clock(17, 0)}
+				p.logouts = []time.Time{pay_period_bench_clock(9, 0)}
+			default:
+				p.logins = []time.Time{pay_period_bench_clock(8+rng.Intn(3), rng.Intn(60))}
+				p.logouts = []time.Time{pay_period_bench_clock(16+rng.Intn(3), rng.Intn(60))}
+			}
+			pp.punches[id][day.Format(DATE_FORMAT)] = &p
+		}
+	}
+
+	employee_dir_mutex.Lock()
+	employee_dir = dir
+	employee_dir_stale = make(map[uint32]bool)
+	employee_dir_loaded = true
+	employee_dir_mutex.Unlock()
+	return pp, emp_arr
+}
+
+func BenchmarkPayPeriod(b *testing.B) {
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_WARN // every name lookup is logged at NORMAL
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	pp, emp_arr := pay_period_bench_setup(time.Date(2026, 9, 16, 0, 0, 0, 0, time.UTC))
+
+	// the overview's totals and every employee's days
+	b.Run("judge", func(b *testing.B) {
+		for i := 0; i < b.N; i++ {
+			for _, emp := range emp_arr {
+				pay_period_sum(emp.Id, pay_period_arr(pp, emp.Id))
+			}
+		}
+		b.ReportMetric(float64(b.Elapsed().Microseconds())/float64(b.N)/PAY_PERIOD_BENCH_EMPLOYEES, "us/employee")
+	})
+
+	// what report_cache_build does with it, the whole workbook
+	b.Run("report", func(b *testing.B) {
+		var buf bytes.Buffer
+		for i := 0; i < b.N; i++ {
+			buf.Reset()
+			x := xl_stream_new(&buf)
+			xl_report_write(x, pp, append([]db_get_employee_info(nil), emp_arr...))
+			if err := xl_stream_close(x); err != nil {
+				b.Fatal(err)
+			}
+		}
+		b.ReportMetric(float64(buf.Len()), "bytes/report")
+	})
+}
@@ -0,0 +1,129 @@
+package main
+
+import (
+	"context"
+	"time"
+)
+
+// LOGIN packets (punches) are written to timeinfo in batches by one goroutine, one statement per
+// batch instead of a goroutine and two round trips per punch. A batch goes out once it has
+// PUNCH_BATCH_MAX punches or its oldest punch is PUNCH_BATCH_DEADLINE_MS old, punches that come
+// in while a batch is on the wire make up the next one. With LOGIN_ACK_AFTER_COMMIT the device
+// gets its SERVER_ACK after the batch its punch was in is committed.
+//
+// The device gives up on a LOGIN after PACKET_FAILED_DURATION_MS (3500 ms, fw qcore.h) and an
+// ack that comes later is one it no longer knows. A batch has until its oldest punch is
+// PUNCH_ACK_BUDGET_MS old to commit, after that the transaction is cancelled and every punch
+// in it is NAKed, as is a batch that failed. The device shows the login failed and the worker
+// punches again, nothing of the batch is in the db
+
+const PUNCH_QUEUE_LEN = (4096)
+const PUNCH_BATCH_MAX = (512)
+const PUNCH_BATCH_DEADLINE_MS = (20) // well under the device's PACKET_FAILED_DURATION_MS
+const PUNCH_ACK_BUDGET_MS = (2500)   // PACKET_FAILED_DURATION_MS less the way back to the device
+
+type punch struct {
+	ip        Ipc_packet // the LOGIN, kept for the ack
+	device_id uint64
+	uid       uint32
+	sign_in   uint8
+	at        time.Time
+}
+
+var punch_queue = make(chan punch, PUNCH_QUEUE_LEN)
+
+// the device shows "Login failed" for anything but ACK_GOOD, or if this never comes
+func punch_ack(ip Ipc_packet, reason uint8) {
+	if !LOGIN_ACK_AFTER_COMMIT || ip.P.Consumer_ack_req != CONSUMER_ACK_REQUIRED {
+		return
+	}
+
+	ack := Ipc_packet{}
+	ack.ClientId = ip.ClientId
+	ack.P = create_ack_pack(ip.P, reason)
+	dmq_from_core_to_packet.Send(ipc_packet_pack(ack))
+}
+
+// runs on the ipc reader, in the order the packets came in. Only blocks if the
+// db falls PUNCH_QUEUE_LEN punches behind
+func punch_submit(ip Ipc_packet) {
+	logger(PRINT_NORMAL, "Login Packet RXed")
+	lp := packet_login_unpack(ip.P.Data)
+	deviceId, _ := get_device_id_from_client(ip.ClientId)
+
+	/* check to see if there is a cool down period on id, ie, we just added it */
+
+	logger(PRINT_SUPER_DEBUG, "Taking lock cool_down_timer_mutex in punch_submit")
+	cool_down_timer_mutex.Lock()
+
+	if t, ok := cool_down_map[lp.uid]; ok {
+		if time.Now().Sub(t) < time.Second*120 {
+			logger(PRINT_NORMAL, "RXed a login within the cooldown period, silently discarding!")
+
+			cool_down_timer_mutex.Unlock()
+			punch_ack(ip, ACK_GOOD)
+			return
+		}
+	}
+	cool_down_timer_mutex.Unlock()
+
+	punch_queue <- punch{ip: ip, device_id: deviceId, uid: lp.uid, sign_in: lp.signInOrSignOut, at: time.Now()}
+}
+
+func punch_flush(batch []punch) {
+	start := time.Now()
+	ctx, cancel := context.WithDeadline(context.Background(), batch[0].at.Add(time.Millisecond*PUNCH_ACK_BUDGET_MS))
+	inserted, err := db_put_punches(ctx, batch)
+	cancel()
+	if err != nil {
+		logger(PRINT_WARN, "punch batch of", len(batch), "not committed after", time.Since(start), "NAKing it,", err)
+		for _, p := range batch {
+			punch_ack(p.ip, NAK_SERVER_DB)
+		}
+		return
+	}
+	logger(PRINT_DEBUG, "flushed", len(batch), "punches in", time.Since(start))
+
+	// one sync per device, however many unknown uids it sent
+	synced := make(map[uint64]bool)
+	for i, p := range batch {
+		punch_ack(p.ip, ACK_GOOD)
+
+		if inserted[i] || synced[p.device_id] {
+			continue
+		}
+		logger_id(PRINT_WARN, p.device_id, "unknown user logged in, we will force sync the device!")
+		synced[p.device_id] = true
+
+		c := client{}
+		c.ClientId = p.ip.ClientId
+		c.deviceId = p.device_id
+		go db_sync(c, SYNC_NORMAL_MODE)
+	}
+}
+
+func punch_ingest() {
+	batch := make([]punch, 0, PUNCH_BATCH_MAX)
+	deadline := time.NewTimer(time.Hour)
+	deadline.Stop()
+
+	for {
+		batch = append(batch[:0], <-punch_queue)
+		deadline.Reset(time.Millisecond * PUNCH_BATCH_DEADLINE_MS)
+
+	fill:
+		for len(batch) < PUNCH_BATCH_MAX {
+			select {
+			case p := <-punch_queue:
+				batch = append(batch, p)
+			case <-deadline.C:
+				break fill
+			}
+		}
+
+		if !deadline.Stop() && len(batch) == PUNCH_BATCH_MAX {
+			<-deadline.C // fired while the last punch went in, don't let it end the next batch early
+		}
+		punch_flush(batch)
+	}
+}
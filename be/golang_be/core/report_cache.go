@@ -0,0 +1,282 @@
+package main
+
+import (
+	"bytes"
+	"crypto/sha256"
+	"database/sql"
+	"encoding/hex"
+	"io/ioutil"
+	"net/http"
+	"os"
+	"sort"
+	"sync"
+	"time"
+)
+
+// Pay period workbooks, built once per (period, data version) and kept in memory. A period's
+// version moves when a punch lands on one of its days (db_put_punches) or when anything in
+// employeeinfo changes (employee_dir_invalidate*, every period at once, names, shifts and
+// salaries are in every report). A download of a period that did not change since it was
+// built is served from here, a changed one is rebuilt by the first download, the ones
+// that come in meanwhile wait for that build. report_cache_timer rebuilds the stale ones in
+// the background so that mostly nobody waits.
+//
+// The ETag is the workbook's sha256, the zip has no timestamps in it, a rebuild that came
+// out the same is still a 304 for the browser
+//
+// A closed period is frozen: its workbook is written to REPORT_ARCHIVE_DIR under its
+// xl_get_filename name, the first time it is asked for or by the timer right after the
+// period closes, and served from there ever after. Employees deleted or edited later do not
+// change it. The workbooks the old xl_create_this_period / xl_archive left in ./static under
+// the same names were written mid period, they are never served, a closed period without an
+// archive is rebuilt from the db. Only periods from the first daily_hours row on can be
+// built (and so frozen), anything older is a 404 unless it was archived already
+
+const REPORT_CACHE_PERIODS = (6) // least recently downloaded ones go first
+const REPORT_CACHE_REFRESH_S = (120)
+const REPORT_ARCHIVE_DIR = "./static/archive/"
+
+type report_cache_entry struct {
+	version  uint64 // data version data was built at
+	data     []byte
+	etag     string
+	built    time.Time
+	used     time.Time
+	building chan struct{} // closed when the running build is done, nil if none is
+}
+
+var report_cache_mutex sync.Mutex
+var report_cache = make(map[string]*report_cache_entry) // period start, DATE_FORMAT
+var report_cache_clock uint64
+var report_cache_touched = make(map[string]uint64) // period start -> clock of its last change
+var report_cache_touched_all uint64
+
+// report_cache_mutex held
+func report_cache_version(period string) uint64 {
+	if v := report_cache_touched[period]; v > report_cache_touched_all {
+		return v
+	}
+	return report_cache_touched_all
+}
+
+// days is anything DATE_FORMAT'able, daily_hours rows' datework
+func report_cache_touch(days []time.Time) {
+	report_cache_mutex.Lock()
+	report_cache_clock++
+	for _, day := range days {
+		report_cache_touched[pay_period_start(day).Format(DATE_FORMAT)] = report_cache_clock
+	}
+	report_cache_mutex.Unlock()
+}
+
+func report_cache_touch_all() {
+	report_cache_mutex.Lock()
+	report_cache_clock++
+	report_cache_touched_all = report_cache_clock
+	report_cache_mutex.Unlock()
+}
+
+// report_cache_mutex held, drops the least recently used periods that are not building
+func report_cache_evict() {
+	if len(report_cache) <= REPORT_CACHE_PERIODS {
+		return
+	}
+	var periods []string
+	for p, e := range report_cache {
+		if e.building == nil {
+			periods = append(periods, p)
+		}
+	}
+	sort.Slice(periods, func(i, j int) bool { return report_cache[periods[i]].used.Before(report_cache[periods[j]].used) })
+	for _, p := range periods {
+		if len(report_cache) <= REPORT_CACHE_PERIODS {
+			return
+		}
+		delete(report_cache, p)
+	}
+}
+
+func report_cache_build(period time.Time) ([]byte, error) {
+	emp_arr, err := employee_dir_all()
+	if err != nil {
+		return nil, err
+	}
+	var buf bytes.Buffer
+	x := xl_stream_new(&buf)
+	xl_report_write(x, pay_period_load(period), emp_arr)
+	if err := xl_stream_close(x); err != nil {
+		return nil, err
+	}
+	return buf.Bytes(), nil
+}
+
+// the workbook for the pay period starting on period (the 1st or the 16th), built if the
+// cached one is stale. used says if this was a download, the timer's refreshes are not
+func report_cache_get(period time.Time, used bool) (*report_cache_entry, error) {
+	key := period.Format(DATE_FORMAT)
+
+	report_cache_mutex.Lock()
+	for {
+		e, ok := report_cache[key]
+		if !ok {
+			e = &report_cache_entry{}
+			report_cache[key] = e
+		}
+		if used {
+			e.used = time.Now()
+		}
+
+		version := report_cache_version(key)
+		if e.data != nil && e.version == version {
+			report_cache_mutex.Unlock()
+			return e, nil
+		}
+		if e.building != nil {
+			done := e.building
+			report_cache_mutex.Unlock()
+			<-done
+			report_cache_mutex.Lock()
+			continue
+		}
+
+		// anything touched from here on is a newer version than the one being built
+		done := make(chan struct{})
+		e.building = done
+		report_cache_mutex.Unlock()
+
+		start := time.Now()
+		data, err := report_cache_build(period)
+
+		report_cache_mutex.Lock()
+		e.building = nil
+		close(done)
+		if err != nil {
+			report_cache_mutex.Unlock()
+			return nil, err
+		}
+		sum := sha256.Sum256(data)
+		ret := &report_cache_entry{version: version, data: data, etag: `"` + hex.EncodeToString(sum[:]) + `"`,
+			built: time.Now(), used: e.used}
+		report_cache[key] = ret
+		report_cache_evict()
+		report_cache_mutex.Unlock()
+
+		logger_kv(PRINT_NORMAL, "report built", "key", key, "took", time.Since(start), "bytes", len(data))
+		return ret, nil
+	}
+}
+
+// the 1st or the 16th, before the current period started
+func report_period_closed(period time.Time) bool {
+	return period.Before(xl_this_period())
+}
+
+func report_archive_path(period time.Time) string {
+	return REPORT_ARCHIVE_DIR + xl_get_filename(period.Year(), int(period.Month()), period.Day())
+}
+
+// this period, or a closed one that is archived or has data. Keeps ./static/archive to
+// periods someone actually worked in
+func report_period_available(period time.Time) bool {
+	if !report_period_closed(period) || exists(report_archive_path(period)) {
+		return true
+	}
+
+	var first sql.NullTime
+	if err := db.QueryRow(`select min(datework) from daily_hours`).Scan(&first); err != nil {
+		logger(PRINT_WARN, "report for", period.Format(DATE_FORMAT), "could not read the data range", err)
+		return false
+	}
+	return first.Valid && !period.Before(pay_period_start(first.Time))
+}
+
+// writes a closed period's workbook to its archive, if it is not there yet. The rename
+// makes sure a download never sees half a file
+func report_archive_freeze(period time.Time) error {
+	path := report_archive_path(period)
+	if exists(path) {
+		return nil
+	}
+	if err := os.MkdirAll(REPORT_ARCHIVE_DIR, 0755); err != nil {
+		return err
+	}
+
+	e, err := report_cache_get(period, false)
+	if err != nil {
+		return err
+	}
+	tmp := path + ".tmp"
+	if err := ioutil.WriteFile(tmp, e.data, 0644); err != nil {
+		return err
+	}
+	if err := os.Rename(tmp, path); err != nil {
+		os.Remove(tmp)
+		return err
+	}
+	logger(PRINT_NORMAL, "report for", period.Format(DATE_FORMAT), "frozen to", path)
+	return nil
+}
+
+// name is the attachment's file name
+func report_cache_serve(w http.ResponseWriter, req *http.Request, name string, period time.Time) {
+	if report_period_closed(period) {
+		if err := report_archive_freeze(period); err != nil {
+			logger(PRINT_WARN, "report for", period.Format(DATE_FORMAT), "could not be frozen", err)
+		} else {
+			export_attachment(w, EXPORT_XLSX_TYPE, name)
+			http.ServeFile(w, req, report_archive_path(period))
+			return
+		}
+	}
+
+	e, err := report_cache_get(period, true)
+	if err != nil {
+		logger(PRINT_WARN, "report for", period.Format(DATE_FORMAT), "failed", err)
+		http.Error(w, "report failed", http.StatusInternalServerError)
+		return
+	}
+
+	export_attachment(w, EXPORT_XLSX_TYPE, name)
+	w.Header().Set("ETag", e.etag)
+	w.Header().Set("Cache-Control", "no-cache") // always revalidate, the etag makes that cheap
+	http.ServeContent(w, req, name, e.built, bytes.NewReader(e.data))
+}
+
+// keeps this period and any open period downloaded lately up to date, only stale ones are
+// built. The period before this one is frozen as soon as it closes
+func report_cache_timer() {
+	for {
+		this_period := xl_this_period()
+		report_cache_get(this_period, false)
+
+		last_period := pay_period_start(this_period.AddDate(0, 0, -1))
+		if !report_period_available(last_period) {
+			// nothing before this period yet, nothing to freeze
+		} else if err := report_archive_freeze(last_period); err != nil {
+			logger(PRINT_WARN, "report for", last_period.Format(DATE_FORMAT), "could not be frozen", err)
+		}
+
+		report_cache_mutex.Lock()
+		var stale []string
+		for p, e := range report_cache {
+			period, _ := time.ParseInLocation(DATE_FORMAT, p, time.UTC)
+			if report_period_closed(period) && e.building == nil {
+				delete(report_cache, p) // frozen, or will be on its next download
+				continue
+			}
+			if e.data != nil && e.building == nil && e.version != report_cache_version(p) {
+				stale = append(stale, p)
+			}
+		}
+		report_cache_mutex.Unlock()
+
+		for _, p := range stale {
+			period, _ := time.ParseInLocation(DATE_FORMAT, p, time.UTC)
+			if _, err := report_cache_get(period, false); err != nil {
+				logger(PRINT_WARN, "report refresh for", p, "failed", err)
+			}
+		}
+
+		time.Sleep(REPORT_CACHE_REFRESH_S * time.Second)
+	}
+}
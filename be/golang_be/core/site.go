@@ -207,11 +207,9 @@ func serve_client(c *websocket.Conn, mt int, cmd Cmd) {
 
 		json_packed := Cmd_resp_json{}
 
-		/* this is an ugly hack - we will generate the report for the current period EACH time, even if it's not being requested */
-		xl_create_this_period()
-
+		/* any period up to this one, /download serves it from the report cache */
 		fileName := xl_get_filename(cmd.Year, cmd.Month, cmd.Period)
-		if exists("./static/" + fileName) {
+		if period, ok := xl_parse_filename(fileName); ok && report_period_available(period) {
 			json_packed.Status_details = "File Exists... serving..."
 			json_packed.Cmd_status = 0
 		} else {
@@ -434,30 +432,46 @@ func home(w http.ResponseWriter, req *http.Request) {
 	t.Execute(w, "null")
 }
 
-func download(w http.ResponseWriter, req *http.Request) {
-	if req.Method == "GET" {
-		session, err := store.Get(req, "cookie-name")
+// false if the request was already answered, with a redirect to /login or an error
+func site_authorized(w http.ResponseWriter, req *http.Request) bool {
+	session, err := store.Get(req, "cookie-name")
+	if err != nil {
+		http.Error(w, err.Error(), http.StatusInternalServerError)
+		return false
+	}
+
+	user := getUser(session)
+	if auth := user.Authenticated; !auth {
+		session.AddFlash("You don't have access!")
+		err = session.Save(req, w)
 		if err != nil {
 			http.Error(w, err.Error(), http.StatusInternalServerError)
-			return
+			return false
 		}
+		http.Redirect(w, req, "/login", http.StatusFound)
+		return false
+	}
+	return true
+}
 
-		user := getUser(session)
-		if auth := user.Authenticated; !auth {
-			session.AddFlash("You don't have access!")
-			err = session.Save(req, w)
-			if err != nil {
-				http.Error(w, err.Error(), http.StatusInternalServerError)
-				return
-			}
-			http.Redirect(w, req, "/login", http.StatusFound)
+func download(w http.ResponseWriter, req *http.Request) {
+	if req.Method == "GET" {
+		if !site_authorized(w, req) {
 			return
 		}
 
 		req.ParseForm()
 		fileName := req.Form["file"][0]
 		logger(PRINT_NORMAL, "trying to serve:", fileName)
-		if exists("./static/" + fileName) {
+		if period, ok := xl_parse_filename(fileName); ok {
+			if !report_period_available(period) {
+				logger(PRINT_WARN, "no data for report:", fileName)
+				http.NotFound(w, req)
+				return
+			}
+			logger(PRINT_NORMAL, "Serving report:", fileName)
+			report_cache_serve(w, req, fileName, period)
+		} else if exists("./static/" + fileName) {
 			logger(PRINT_NORMAL, "File Exists... servering:", fileName)
 			w.Header().Set("Content-Disposition", "attachment; filename="+fileName)
 			w.Header().Set("Content-Type", req.Header.Get("Content-Type"))
@@ -544,6 +558,8 @@ func main_site() {
 	mux.HandleFunc("/", login)
 	mux.HandleFunc("/upgrade", upgrade)
 	mux.HandleFunc("/download", download)
+	mux.HandleFunc("/export/csv", export_csv)
+	mux.HandleFunc("/export/xlsx", export_xlsx)
 
 	fileServer := http.FileServer(http.Dir("./static"))
 	mux.Handle("/static/", http.StripPrefix("/static", neuter(fileServer)))
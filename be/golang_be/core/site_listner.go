@@ -53,7 +53,7 @@ func handle_incomming_ipc_site(ip Ipc_packet) {
 func mq_site_listner() {
 	logger(PRINT_NORMAL, "Starting Site Listner")
 
-	rx := make([]byte, PACKET_LEN_MAX)
+	rx := make([]byte, MAX_IPC_LEN)
 	var n int
 	var err error
 	for {
@@ -69,12 +69,11 @@ func fota(c client, fw_version uint16) {
 	ip.DeviceId = c.deviceId
 	ip.ClientId = c.ClientId
 
-	//create a fota image, unique each time!
-	create_fota_image(fw_version)
-
+	// image (already aligned) comes out of the fw catalog
 	ipc, ok := create_ipc_fota_start_packet(c.deviceId, fw_version)
 	if !ok {
-		logger(PRINT_FATAL, "Could not open file!")
+		logger(PRINT_WARN, "FW version", fw_version, "not in fw catalog, skipping FOTA")
+		return
 	}
 
 	be_handle_fota(ipc)
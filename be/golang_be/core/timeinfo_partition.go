@@ -0,0 +1,84 @@
+package main
+
+import (
+	"database/sql"
+	"fmt"
+	"os"
+	"path/filepath"
+	"strings"
+	"time"
+)
+
+// timeinfo is range partitioned on punched_at, a partition per month (local time), named
+// timeinfo_yYYYYmMM. There is no default partition, a punch for a month without one fails,
+// so core keeps this month's and next month's around. Shared with be/golang_be/migrate
+//
+// Go's time.Local (the partitions, db_put_punches) and the session TimeZone (punched_at::date
+// and ::time in daily_hours and the exports) have to be the same zone, both connect with
+// db_time_zone_param
+
+const TIMEINFO_PARTITIONS_AHEAD = (1)
+
+func timeinfo_partition_name(month time.Time) string {
+	return fmt.Sprintf("timeinfo_y%04dm%02d", month.Year(), int(month.Month()))
+}
+
+func timeinfo_partition_ensure(db *sql.DB, t time.Time) error {
+	from := time.Date(t.Year(), t.Month(), 1, 0, 0, 0, 0, time.Local)
+	to := from.AddDate(0, 1, 0)
+
+	_, err := db.Exec(fmt.Sprintf(`CREATE TABLE IF NOT EXISTS %s PARTITION OF timeinfo FOR VALUES FROM ('%s') TO ('%s')`,
+		timeinfo_partition_name(from), from.Format(time.RFC3339), to.Format(time.RFC3339)))
+	return err
+}
+
+// the IANA name of time.Local: $TZ, else the zoneinfo file /etc/localtime links to (or
+// /etc/timezone), UTC without any. false if it can not be told
+func db_time_zone() (string, bool) {
+	if tz, set := os.LookupEnv("TZ"); set {
+		tz = strings.TrimPrefix(tz, ":")
+		if tz == "" {
+			return "UTC", true
+		}
+		if i := strings.Index(tz, "zoneinfo/"); filepath.IsAbs(tz) && i >= 0 {
+			tz = tz[i+len("zoneinfo/"):]
+		}
+		_, err := time.LoadLocation(tz)
+		return tz, err == nil
+	}
+
+	if link, err := filepath.EvalSymlinks("/etc/localtime"); err == nil {
+		if i := strings.Index(link, "zoneinfo/"); i >= 0 {
+			return link[i+len("zoneinfo/"):], true
+		}
+	} else if os.IsNotExist(err) {
+		return "UTC", true
+	}
+	if b, err := os.ReadFile("/etc/timezone"); err == nil {
+		tz := strings.TrimSpace(string(b))
+		if _, err := time.LoadLocation(tz); err == nil && tz != "" {
+			return tz, true
+		}
+	}
+	return "", false
+}
+
+// appended to a dsn, the session TimeZone set to time.Local's
+func db_time_zone_param() string {
+	tz, ok := db_time_zone()
+	if !ok {
+		logger(PRINT_FATAL, "Could not tell the name of the local time zone, set TZ (e.g. TZ=Europe/Athens)")
+	}
+	return fmt.Sprintf(" TimeZone='%s'", tz)
+}
+
+// this month and TIMEINFO_PARTITIONS_AHEAD after it
+func timeinfo_partitions_ensure(db *sql.DB, now time.Time) error {
+	month := time.Date(now.Year(), now.Month(), 1, 0, 0, 0, 0, time.Local)
+	for i := 0; i <= TIMEINFO_PARTITIONS_AHEAD; i++ {
+		if err := timeinfo_partition_ensure(db, month.AddDate(0, i, 0)); err != nil {
+			return err
+		}
+	}
+	return nil
+}
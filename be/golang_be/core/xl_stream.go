@@ -0,0 +1,219 @@
+package main
+
+import (
+	"archive/zip"
+	"bufio"
+	"compress/flate"
+	"errors"
+	"fmt"
+	"io"
+	"sort"
+	"strings"
+	"sync"
+)
+
+// Just enough of an .xlsx writer for the reports: inline strings, column widths and the
+// styles in exls.go (RED_STYLE, BOLD_STYLE). Rows go straight into the zip, one sheet at a
+// time, nothing but the sheet names is kept around. Sheets can be written in any order,
+// xl_stream_sheet's order decides where they show up in the workbook
+
+type xl_cell struct {
+	s     string
+	style int
+}
+
+type xl_col struct {
+	first int // zero based, like xlsx.Sheet.SetColWidth
+	last  int
+	width float64
+}
+
+type xl_sheet_entry struct {
+	order int
+	name  string
+	part  int
+}
+
+type xl_stream struct {
+	zw     *zip.Writer
+	w      *bufio.Writer
+	sheets []xl_sheet_entry
+	names  map[string]bool
+	open   bool
+	err    error
+}
+
+// a zip entry per sheet, so a flate writer per employee. They are reused, and BestSpeed,
+// deflate was most of the time it took to write a report at the default level
+var xl_flate_pool sync.Pool
+
+type xl_flate_writer struct {
+	*flate.Writer
+}
+
+func (w xl_flate_writer) Close() error {
+	err := w.Writer.Close()
+	xl_flate_pool.Put(w.Writer)
+	return err
+}
+
+func xl_flate(out io.Writer) (io.WriteCloser, error) {
+	if fw, ok := xl_flate_pool.Get().(*flate.Writer); ok {
+		fw.Reset(out)
+		return xl_flate_writer{fw}, nil
+	}
+	fw, err := flate.NewWriter(out, flate.BestSpeed)
+	return xl_flate_writer{fw}, err
+}
+
+var xl_escaper = strings.NewReplacer("&", "&amp;", "<", "&lt;", ">", "&gt;", "\"", "&quot;")
+
+// straight into w (an http response or a buffer), xl_stream_close leaves w open
+func xl_stream_new(w io.Writer) *xl_stream {
+	x := &xl_stream{names: make(map[string]bool)}
+	x.zw = zip.NewWriter(w)
+	x.zw.RegisterCompressor(zip.Deflate, xl_flate)
+	return x
+}
+
+func xl_stream_part(x *xl_stream, name string) io.Writer {
+	if x.err != nil {
+		return nil
+	}
+	w, err := x.zw.Create(name)
+	if err != nil {
+		x.err = err
+	}
+	return w
+}
+
+func xl_stream_end_sheet(x *xl_stream) {
+	if !x.open {
+		return
+	}
+	x.open = false
+	if x.err != nil {
+		return
+	}
+	x.w.WriteString(`</sheetData></worksheet>`)
+	x.err = x.w.Flush()
+}
+
+// ends the sheet before it
+func xl_stream_sheet(x *xl_stream, order int, name string, cols []xl_col) {
+	xl_stream_end_sheet(x)
+	if x.err != nil {
+		return
+	}
+	if x.names[name] {
+		x.err = errors.New("duplicate sheet name " + name)
+		return
+	}
+	x.names[name] = true
+
+	part := len(x.sheets) + 1
+	x.sheets = append(x.sheets, xl_sheet_entry{order, name, part})
+
+	w := xl_stream_part(x, fmt.Sprintf("xl/worksheets/sheet%d.xml", part))
+	if w == nil {
+		return
+	}
+	if x.w == nil {
+		x.w = bufio.NewWriterSize(w, 32*1024)
+	} else {
+		x.w.Reset(w)
+	}
+	x.open = true
+
+	x.w.WriteString(`<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+		`<worksheet xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main">`)
+	if len(cols) > 0 {
+		x.w.WriteString(`<cols>`)
+		for _, c := range cols {
+			fmt.Fprintf(x.w, `<col min="%d" max="%d" width="%g" customWidth="1"/>`, c.first+1, c.last+1, c.width)
+		}
+		x.w.WriteString(`</cols>`)
+	}
+	x.w.WriteString(`<sheetData>`)
+}
+
+// an empty xl_cell{} leaves the cell blank, no cells is a blank row
+func xl_stream_row(x *xl_stream, cells ...xl_cell) {
+	if !x.open || x.err != nil {
+		return
+	}
+	x.w.WriteString(`<row>`)
+	for _, c := range cells {
+		if c.s == "" && c.style == 0 {
+			x.w.WriteString(`<c/>`)
+			continue
+		}
+		fmt.Fprintf(x.w, `<c s="%d" t="inlineStr"><is><t xml:space="preserve">`, c.style)
+		xl_escaper.WriteString(x.w, c.s)
+		x.w.WriteString(`</t></is></c>`)
+	}
+	x.w.WriteString(`</row>`)
+}
+
+// cellXfs are indexed by the exls.go style constants
+const xl_styles = `<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+	`<styleSheet xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main">` +
+	`<fonts count="2"><font><sz val="11"/><name val="Calibri"/></font><font><b/><sz val="13"/><name val="Calibri"/></font></fonts>` +
+	`<fills count="3"><fill><patternFill patternType="none"/></fill><fill><patternFill patternType="gray125"/></fill>` +
+	`<fill><patternFill patternType="solid"><fgColor rgb="FFFF0000"/><bgColor indexed="64"/></patternFill></fill></fills>` +
+	`<borders count="1"><border><left/><right/><top/><bottom/><diagonal/></border></borders>` +
+	`<cellStyleXfs count="1"><xf numFmtId="0" fontId="0" fillId="0" borderId="0"/></cellStyleXfs>` +
+	`<cellXfs count="3"><xf numFmtId="0" fontId="0" fillId="0" borderId="0" xfId="0"/>` +
+	`<xf numFmtId="0" fontId="0" fillId="2" borderId="0" xfId="0" applyFill="1"/>` +
+	`<xf numFmtId="0" fontId="1" fillId="0" borderId="0" xfId="0" applyFont="1"/></cellXfs>` +
+	`</styleSheet>`
+
+func xl_stream_close(x *xl_stream) error {
+	xl_stream_end_sheet(x)
+
+	sheets := append([]xl_sheet_entry(nil), x.sheets...)
+	sort.SliceStable(sheets, func(i, j int) bool { return sheets[i].order < sheets[j].order })
+
+	var types, workbook, rels strings.Builder
+	types.WriteString(`<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+		`<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types">` +
+		`<Default Extension="rels" ContentType="application/vnd.openxmlformats-package.relationships+xml"/>` +
+		`<Default Extension="xml" ContentType="application/xml"/>` +
+		`<Override PartName="/xl/workbook.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml"/>` +
+		`<Override PartName="/xl/styles.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.styles+xml"/>`)
+	workbook.WriteString(`<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+		`<workbook xmlns="http://schemas.openxmlformats.org/spreadsheetml/2006/main" xmlns:r="http://schemas.openxmlformats.org/officeDocument/2006/relationships"><sheets>`)
+	rels.WriteString(`<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+		`<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">` +
+		`<Relationship Id="rIdStyles" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles" Target="styles.xml"/>`)
+
+	for i, s := range sheets {
+		fmt.Fprintf(&types, `<Override PartName="/xl/worksheets/sheet%d.xml" ContentType="application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml"/>`, s.part)
+		fmt.Fprintf(&workbook, `<sheet name="%s" sheetId="%d" r:id="rId%d"/>`, xl_escaper.Replace(s.name), i+1, s.part)
+		fmt.Fprintf(&rels, `<Relationship Id="rId%d" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet" Target="worksheets/sheet%d.xml"/>`, s.part, s.part)
+	}
+	types.WriteString(`</Types>`)
+	workbook.WriteString(`</sheets></workbook>`)
+	rels.WriteString(`</Relationships>`)
+
+	parts := []struct{ name, body string }{
+		{"[Content_Types].xml", types.String()},
+		{"_rels/.rels", `<?xml version="1.0" encoding="UTF-8" standalone="yes"?>` +
+			`<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships">` +
+			`<Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument" Target="xl/workbook.xml"/>` +
+			`</Relationships>`},
+		{"xl/workbook.xml", workbook.String()},
+		{"xl/_rels/workbook.xml.rels", rels.String()},
+		{"xl/styles.xml", xl_styles},
+	}
+	for _, p := range parts {
+		if w := xl_stream_part(x, p.name); w != nil {
+			_, x.err = io.WriteString(w, p.body)
+		}
+	}
+
+	if err := x.zw.Close(); x.err == nil {
+		x.err = err
+	}
+	return x.err
+}
@@ -0,0 +1 @@
+../packet/constants.go
\ No newline at end of file
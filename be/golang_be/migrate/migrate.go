@@ -0,0 +1,224 @@
+package main
+
+import (
+	"database/sql"
+	"flag"
+	"fmt"
+	"os"
+	"time"
+
+	_ "github.com/lib/pq"
+)
+
+/**********************************************************
+*	Moves a timeinfo from before partitioning (id, employee
+*	name, datework, type, timestamp, no key, no index) into
+*	the partitioned one in setup.sql, core keeps running
+*	for everything but the first step:
+*
+*	1) stop core, ./migrate -prepare
+*	   creates the employeeinfo_changed NOTIFY triggers core's
+*	   employee directory listens on, if they are not there
+*	   (any db set up before them, whatever its timeinfo is),
+*	   then in one transaction: the old table becomes timeinfo_legacy,
+*	   the new timeinfo and employeeinfo.deleted_at are
+*	   created, daily_hours is filled from timeinfo_legacy if
+*	   it is empty. Deleted employees that still have punches
+*	   come back as deleted employees under their last name,
+*	   timeinfo.employee is a key now
+*	2) start the new core, it punches into the new timeinfo
+*	   and reports from daily_hours, ./migrate
+*	   moves a month per transaction, delete from
+*	   timeinfo_legacy and insert into timeinfo in the same
+*	   statement. A punch is always in exactly one of them,
+*	   stop it whenever, run it again to go on. Drops
+*	   timeinfo_legacy when it is empty
+*
+*	datework + timestamp is read in the session's TimeZone,
+*	set to the local zone like core's (db_time_zone_param),
+*	run it with the same TZ core has
+*
+*	./migrate -dsn "host=localhost user=postgres dbname=checkin_co sslmode=disable"
+*********************************************************/
+
+const MIGRATE_DSN = "host=localhost port=5432 user=postgres dbname=checkin_co sslmode=disable"
+const DATE_FORMAT = "2006-01-02" // as in core/db.go
+
+var migrate_steps = []string{
+	`ALTER TABLE timeinfo RENAME TO timeinfo_legacy`,
+	`CREATE INDEX timeinfo_legacy_datework ON timeinfo_legacy(datework)`,
+
+	`ALTER TABLE employeeinfo ADD COLUMN IF NOT EXISTS deleted_at timestamp with time zone`,
+	`ALTER TABLE employeeinfo DROP CONSTRAINT IF EXISTS employeeinfo_employee_key`,
+	`ALTER TABLE employeeinfo DROP CONSTRAINT IF EXISTS employeeinfo_email_key`,
+	`CREATE UNIQUE INDEX IF NOT EXISTS employeeinfo_employee_active ON employeeinfo(employee) WHERE deleted_at IS NULL`,
+	`CREATE UNIQUE INDEX IF NOT EXISTS employeeinfo_email_active ON employeeinfo(email) WHERE deleted_at IS NULL`,
+	`INSERT INTO employeeinfo (id, employee, deleted_at)
+		SELECT DISTINCT ON (id) id, employee, now() FROM timeinfo_legacy
+		WHERE id NOT IN (SELECT id FROM employeeinfo)
+		ORDER BY id, datework DESC NULLS LAST, timestamp DESC NULLS LAST`,
+
+	`CREATE TABLE timeinfo(employee integer NOT NULL REFERENCES employeeinfo(id),
+		punched_at timestamp with time zone NOT NULL,
+		type varchar(8) NOT NULL CHECK (type in ('login', 'logout'))
+		) PARTITION BY RANGE (punched_at)`,
+	`CREATE INDEX timeinfo_employee_punched_at ON timeinfo(employee, punched_at)`,
+
+	`CREATE TABLE IF NOT EXISTS daily_hours(datework date NOT NULL,
+		id bigint NOT NULL,
+		first_in time without time zone,
+		last_out time without time zone,
+		worked interval,
+		anomaly integer,
+		PRIMARY KEY (datework, id))`,
+	// core judges the NULL anomalies when it starts (daily_hours_init)
+	`INSERT INTO daily_hours (datework, id, first_in, last_out)
+		SELECT datework, id, min(timestamp) FILTER (WHERE type = 'login'), max(timestamp) FILTER (WHERE type = 'logout')
+		FROM timeinfo_legacy WHERE datework IS NOT NULL AND NOT EXISTS (SELECT 1 FROM daily_hours)
+		GROUP BY datework, id`,
+}
+
+// as in setup.sql, safe to run again
+var migrate_notify_steps = []string{
+	`CREATE OR REPLACE FUNCTION employeeinfo_notify() RETURNS trigger AS $$
+	BEGIN
+		IF TG_OP = 'TRUNCATE' THEN
+			PERFORM pg_notify('employeeinfo_changed', '');
+		ELSIF TG_OP = 'DELETE' THEN
+			PERFORM pg_notify('employeeinfo_changed', OLD.id::text);
+		ELSE
+			PERFORM pg_notify('employeeinfo_changed', NEW.id::text);
+		END IF;
+		RETURN NULL;
+	END;
+	$$ LANGUAGE plpgsql`,
+	`DROP TRIGGER IF EXISTS employeeinfo_changed ON employeeinfo`,
+	`CREATE TRIGGER employeeinfo_changed AFTER INSERT OR UPDATE OR DELETE ON employeeinfo
+		FOR EACH ROW EXECUTE PROCEDURE employeeinfo_notify()`,
+	`DROP TRIGGER IF EXISTS employeeinfo_truncated ON employeeinfo`,
+	`CREATE TRIGGER employeeinfo_truncated AFTER TRUNCATE ON employeeinfo
+		FOR EACH STATEMENT EXECUTE PROCEDURE employeeinfo_notify()`,
+}
+
+func migrate_run(db *sql.DB, what string, steps []string) {
+	tx, err := db.Begin()
+	if err != nil {
+		logger(PRINT_FATAL, "migrate: could not begin", err)
+	}
+	for _, step := range steps {
+		if _, err := tx.Exec(step); err != nil {
+			tx.Rollback()
+			logger(PRINT_FATAL, "migrate:", what, "failed, nothing was changed\n", step, "\n", err)
+		}
+	}
+	if err := tx.Commit(); err != nil {
+		logger(PRINT_FATAL, "migrate:", what, "failed, nothing was changed", err)
+	}
+}
+
+func migrate_has(db *sql.DB, query string) bool {
+	var ok bool
+	if err := db.QueryRow(query).Scan(&ok); err != nil {
+		logger(PRINT_FATAL, "migrate:", err)
+	}
+	return ok
+}
+
+func migrate_prepare(db *sql.DB) {
+	migrate_run(db, "notify triggers", migrate_notify_steps)
+	logger(PRINT_NORMAL, "employeeinfo notify triggers in place")
+
+	if migrate_has(db, `SELECT to_regclass('timeinfo_legacy') IS NOT NULL`) {
+		logger(PRINT_NORMAL, "timeinfo_legacy already there, prepare was run")
+		return
+	}
+	if !migrate_has(db, `SELECT EXISTS (SELECT 1 FROM information_schema.columns
+		WHERE table_schema = current_schema() AND table_name = 'timeinfo' AND column_name = 'datework')`) {
+		logger(PRINT_NORMAL, "timeinfo is not the old layout, nothing to prepare")
+		return
+	}
+
+	migrate_run(db, "prepare", migrate_steps)
+
+	if err := timeinfo_partitions_ensure(db, time.Now()); err != nil {
+		logger(PRINT_FATAL, "migrate: could not create this month's partitions", err)
+	}
+	logger(PRINT_NORMAL, "prepared, start core and run migrate again to move the punches")
+}
+
+// one month of timeinfo_legacy per transaction, oldest first
+func migrate_move(db *sql.DB) {
+	if !migrate_has(db, `SELECT to_regclass('timeinfo_legacy') IS NOT NULL`) {
+		logger(PRINT_NORMAL, "no timeinfo_legacy, nothing to move")
+		return
+	}
+
+	for {
+		var first sql.NullTime
+		if err := db.QueryRow(`SELECT min(datework) FROM timeinfo_legacy`).Scan(&first); err != nil {
+			logger(PRINT_FATAL, "migrate:", err)
+		}
+		if !first.Valid {
+			break
+		}
+
+		from := time.Date(first.Time.Year(), first.Time.Month(), 1, 0, 0, 0, 0, time.Local)
+		to := from.AddDate(0, 1, 0)
+		if err := timeinfo_partition_ensure(db, from); err != nil {
+			logger(PRINT_FATAL, "migrate: could not create partition", timeinfo_partition_name(from), err)
+		}
+
+		// a row without a time or with a type core never wrote can not go into the new
+		// table, it is dropped and counted
+		start := time.Now()
+		var moved, kept int64
+		err := db.QueryRow(`WITH moved AS (
+				DELETE FROM timeinfo_legacy WHERE datework >= $1 AND datework < $2
+				RETURNING id, datework, type, timestamp),
+			kept AS (
+				INSERT INTO timeinfo (employee, punched_at, type)
+				SELECT id, (datework + timestamp)::timestamptz, type FROM moved
+				WHERE timestamp IS NOT NULL AND type IN ('login', 'logout')
+				RETURNING 1)
+			SELECT (SELECT count(*) FROM moved), (SELECT count(*) FROM kept)`,
+			from.Format(DATE_FORMAT), to.Format(DATE_FORMAT)).Scan(&moved, &kept)
+		if err != nil {
+			logger(PRINT_FATAL, "migrate: moving", timeinfo_partition_name(from), "failed, run again", err)
+		}
+		logger(PRINT_NORMAL, timeinfo_partition_name(from), kept, "punches moved,", moved-kept, "dropped in", time.Since(start))
+	}
+
+	res, err := db.Exec(`DELETE FROM timeinfo_legacy`)
+	if err != nil {
+		logger(PRINT_FATAL, "migrate:", err)
+	}
+	if n, _ := res.RowsAffected(); n > 0 {
+		logger(PRINT_NORMAL, n, "punches without a datework dropped")
+	}
+	if _, err := db.Exec(`DROP TABLE timeinfo_legacy`); err != nil {
+		logger(PRINT_FATAL, "migrate: could not drop timeinfo_legacy", err)
+	}
+	if _, err := db.Exec(`ANALYZE timeinfo`); err != nil {
+		logger(PRINT_WARN, "migrate: ANALYZE timeinfo failed", err)
+	}
+	logger(PRINT_NORMAL, "done, timeinfo_legacy dropped")
+}
+
+func main() {
+	dsn := flag.String("dsn", MIGRATE_DSN, "postgres dsn")
+	prepare := flag.Bool("prepare", false, "swap in the new tables, core must be stopped")
+	flag.Parse()
+
+	db, err := sql.Open("postgres", *dsn+db_time_zone_param())
+	if err != nil {
+		fmt.Fprintln(os.Stderr, "could not open db:", err)
+		os.Exit(1)
+	}
+	defer db.Close()
+
+	if *prepare {
+		migrate_prepare(db)
+	} else {
+		migrate_move(db)
+	}
+}
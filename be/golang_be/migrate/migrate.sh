@@ -0,0 +1,22 @@
+rm constants.go logger.go server_config.go timeinfo_partition.go
+rm migrate
+
+ln -s ../packet/constants.go constants.go
+ln -s ../packet/logger.go logger.go
+ln -s ../packet/server_config.go server_config.go
+ln -s ../core/timeinfo_partition.go timeinfo_partition.go
+
+MIGRATE_GO="migrate.go constants.go logger.go server_config.go timeinfo_partition.go"
+
+go build -o migrate $MIGRATE_GO
+
+if [ $? != 0 ]; then
+  exit
+fi
+
+if [ ! -z "$1" ]; then
+  if [ "$1" == "-r" ]; then
+    shift
+    ./migrate "$@"
+  fi
+fi
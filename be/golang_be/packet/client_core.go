@@ -1,53 +1,47 @@
 package main
 
 import (
+	"encoding/binary"
 	"net"
 	"runtime"
 	"sync"
 	"time"
 )
 
+// Each connection runs on two goroutines. The tcp reader (tcp_socket_read)
+// chunks, accounts and forwards to core inline. Client_handler is the only
+// writer to the socket: downlink from the mailbox, acks and timeouts
 type Client_state struct {
-	init                   bool
-	err_chan_tcp           chan bool
-	tcp_write_shutdown     chan bool
-	tcp_socket_writer_chan chan Packet
-	tcp_socket_reader_chan chan Packet
+	conn      net.Conn
+	done      chan struct{} // closed by client_kill, tells the writer to shut down
+	kill_once sync.Once
+
+	// tcp reader -> writer, acks owed to the device
+	ack_chan    chan Packet
+	reader_done chan struct{}
 
 	//transaction accountant
-	m       map[uint16]map_packet
-	m_mutex *sync.Mutex
-
-	// Timer -> Client core
-	client_event_timer      chan bool
-	client_event_timer_kill chan bool
-
-	// Unix -> Client core
-	ipc_to_tcp_writer_chan chan Packet
-	tcp_to_icp_reader_chan chan Packet
-	ipc_read_shutdown      chan bool
-	ipc_write_shutdown     chan bool
-	ipc_shutdown           chan bool
-	client_id              uint64
-
-	wg_ipc    sync.WaitGroup
-	wg_tcp    sync.WaitGroup
-	wg_event  sync.WaitGroup
+	m              map[uint16]map_packet
+	m_mutex        *sync.Mutex
+	m_seq          uint64
+	timers_stopped bool
+
+	// Timer wheel -> Client core, only when a transaction actually timed out
+	client_event_timer chan bool
+
+	// core -> client
+	mb        *client_mailbox
+	client_id uint64
 	device_id string
 }
 
-func waitTimeout(wg *sync.WaitGroup, timeout time.Duration) bool {
-	c := make(chan struct{})
-	go func() {
-		defer close(c)
-		wg.Wait()
-	}()
-	select {
-	case <-c:
-		return false // completed normally
-	case <-time.After(timeout):
-		return true // timed out
-	}
+// safe from any goroutine, any number of times. Closing the socket
+// unblocks the reader as well as a writer stuck in conn.Write
+func client_kill(cs *Client_state) {
+	cs.kill_once.Do(func() {
+		close(cs.done)
+		cs.conn.Close()
+	})
 }
 
 // Handles incoming requests.
@@ -61,133 +55,83 @@ func Client_handler(conn net.Conn) {
 	// Initilize the packet_accountant
 	init_transaction_accountant(&cs)
 
-	// Must create the error channel we will share with the two TCP
-	// reader and writter tasks. If any errors occur during read/write/
-	// chunking the sub tasks will notify the client hanlder through
-	// this error channel
-
-	// the two TCP writer/reader slaves will
-	// write into this channel to let client_handler
-	// know something is wrong. The tcp_write_shutdown channel
-	// is used to let the tcp_socket_writter goroutine to know
-	// it is time to shutdown
-	cs.err_chan_tcp = make(chan bool, 10) //ther are max 3 writters into this, tcp_write, tcp_read, tranaction_accountant, add some buffer just incase
-	cs.tcp_write_shutdown = make(chan bool, 10)
-
-	// Handles communication with tcp writer/reader tasks
-	cs.tcp_socket_writer_chan = make(chan Packet, MAX_OUTSTANDING_TCP_CORE_SEND)
-	cs.tcp_socket_reader_chan = make(chan Packet, MAX_OUTSTANDING_TCP_CORE_SEND)
-
-	cs.client_event_timer = make(chan bool, 1)      // Internal to client handler
-	cs.client_event_timer_kill = make(chan bool, 2) // Internal to client handler
-
-	cs.ipc_to_tcp_writer_chan = make(chan Packet, MAX_OUTSTANDING_TCP_CORE_SEND) // IPC ---> TCP
-	cs.tcp_to_icp_reader_chan = make(chan Packet, MAX_OUTSTANDING_TCP_CORE_SEND) // IPC <--- TCP
-
-	cs.ipc_read_shutdown = make(chan bool, 10)  // IPC (internal)
-	cs.ipc_write_shutdown = make(chan bool, 10) // IPC (internal)
-	cs.ipc_shutdown = make(chan bool, 10)       // IPC (internal) can write to this to triger IPC shutdown and reset
-
+	cs.conn = conn
+	cs.done = make(chan struct{})
+	cs.reader_done = make(chan struct{})
+	cs.ack_chan = make(chan Packet, MAX_OUTSTANDING_TRANSACTIONS)
+	cs.client_event_timer = make(chan bool, 1) // Internal to client handler
 	cs.client_id = get_client_id()
 
-	// 1 for the writter task, 1 for the reader
-	cs.wg_tcp.Add(2)
-
-	//1 for the event generator
-	cs.wg_event.Add(1)
-
-	// 2 for the ipc writter reader task
-	cs.wg_ipc.Add(2)
+	// Register with the ipc_core, core sends any IPC packets for this
+	// client id into the mailbox
+	cs.mb = &client_mailbox{}
+	cs.mb.c = make(chan Ipc_packet, CLIENT_MAILBOX_LEN)
+	cs.mb.kick = func() { client_kill(&cs) }
+	register_client(cs.client_id, cs.mb)
 
-	go tcp_starter(conn, &cs)
-	go ipc_starter(&cs)
-
-	// Will trigger the event timer
-	go event_generator(&cs)
+	go tcp_socket_read(conn, &cs)
 
+	// this goroutine is the tcp writer, the buffer is only ever touched here
+	tx := make([]byte, PACKET_LEN_MAX)
+	var err error
 	for {
 		select {
-		case <-cs.err_chan_tcp:
-			logger(PRINT_WARN, "ClientID: ", cs.client_id, "A TCP error messge was recieved")
-			cs.tcp_write_shutdown <- true
-			cs.ipc_shutdown <- true
-			logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Sending suicide instruction to event goroutine")
-			cs.client_event_timer_kill <- true
-			break
-
-		case <-cs.ipc_shutdown:
-			logger(PRINT_WARN, "ClientID: ", cs.client_id, "shutting down IPC")
-			cs.ipc_read_shutdown <- true
-			cs.ipc_write_shutdown <- true
-			goto shutdown_client
-
-		case tcp_rx := <-cs.tcp_socket_reader_chan:
-			logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "sending to ipc output")
-			client_dequeue_transaction(tcp_rx, &cs) // Handle acks (will not go to IPC, only NAKs or no responses)
-			client_core_handle_packet_rx(tcp_rx, &cs)
-			break
+		case ipc_rx := <-cs.mb.c:
+			if log_enabled(PRINT_DEBUG) {
+				logger(PRINT_DEBUG, "ClientID: ", cs.client_id, " Sending to TCP")
+			}
+			// account before the write, the device can ack before conn.Write returns
+			client_enqueue_transaction(ipc_rx.P, &cs)
+			err = tcp_socket_write(conn, &cs, tx, ipc_rx.P)
+			client_mailbox_unspill(cs.mb)
 
-		case ipc_rx := <-cs.ipc_to_tcp_writer_chan:
-			logger(PRINT_DEBUG, "ClientID: ", cs.client_id, " Sending to TCP")
-			cs.tcp_socket_writer_chan <- ipc_rx
-			client_enqueue_transaction(ipc_rx, &cs)
-			break
+		case ack := <-cs.ack_chan:
+			err = tcp_socket_write(conn, &cs, tx, ack)
 
 		case <-cs.client_event_timer:
 			transaction_scan_timeout(&cs)
-			break
+
+		case <-cs.done:
+			goto shutdown_client
+		}
+
+		if err != nil {
+			logger(PRINT_WARN, "ClientID: ", cs.client_id, "A TCP error messge was recieved")
+			client_kill(&cs)
+			goto shutdown_client
 		}
 	}
 
 	// here we handle all todos related to shutting down a client
 shutdown_client:
-	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "waiting for event goroutine to die")
-
-	if waitTimeout(&(cs.wg_event), time.Second) {
-		logger(PRINT_FATAL, "ClientID: ", cs.client_id, "Timed out waiting for wait group (event)")
-	} else {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Finished waiting for event generator to close!")
-	}
+	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "stopping transaction timers")
+	transactions_stop_timers(&cs)
 	close(cs.client_event_timer)
+	client_deregister(cs.client_id)
 
-	if waitTimeout(&(cs.wg_tcp), time.Second*2) {
-		logger(PRINT_FATAL, "ClientID: ", cs.client_id, "Timed out waiting for wait group (tcp)")
-	} else {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Finished waiting for TCP writter/reader to close!")
-	}
-
-	// wait for the IPC to shut down
-	if waitTimeout(&(cs.wg_ipc), time.Second*2) {
-		logger(PRINT_FATAL, "ClientID: ", cs.client_id, "Timed out waiting for wait group (ipc)")
-	} else {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Wait group finished")
-	}
-
-	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "closing client_handler")
-	close(cs.err_chan_tcp)
-	close(cs.tcp_write_shutdown)
-
-	close(cs.tcp_socket_reader_chan)
-	close(cs.tcp_socket_writer_chan)
-
-	close(cs.ipc_to_tcp_writer_chan)
-	close(cs.tcp_to_icp_reader_chan)
-
-	close(cs.ipc_read_shutdown)
-	close(cs.ipc_write_shutdown)
-	close(cs.ipc_shutdown)
-
-	// Send a good bye packet to packet core
-	good_bye := create_goodbye_packet(cs.client_id)
-	err := mq_write(ipc_packet_pack(good_bye))
-	if err != nil {
-		logger(PRINT_FATAL, "ClientID: ", cs.client_id, "Will not handle failure to write to IPC messaeg queue - shut everything down and restart")
+	// the reader's mq_write gives up on cs.done, it should be out quickly. If it
+	// is not, the goodbye still has to go after its last packet, leave that to
+	// a goroutine rather than holding up (or taking down) the server
+	select {
+	case <-cs.reader_done:
+		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Finished waiting for TCP reader to close!")
+		client_goodbye(&cs)
+	case <-time.After(time.Millisecond * CLIENT_READER_WAIT_MS):
+		logger(PRINT_WARN, "ClientID: ", cs.client_id, "TCP reader still busy, goodbye goes to core once it is done")
+		go client_goodbye(&cs)
 	}
 
 	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Finished closing")
 	logger(PRINT_DEBUG, "# of goroutines: ", runtime.NumGoroutine())
-	time.Sleep(time.Second * 1)
+}
 
+// Send a good bye packet to packet core, after the reader sent its last packet
+func client_goodbye(cs *Client_state) {
+	<-cs.reader_done
+	good_bye := create_goodbye_packet(cs.client_id)
+	if err := mq_write(ipc_packet_pack(good_bye), nil); err != nil {
+		logger(PRINT_WARN, "ClientID: ", cs.client_id, "core never got the goodbye packet")
+	}
 }
 
 // If a packet requires an ACK, we will track it here
@@ -195,61 +139,94 @@ func client_enqueue_transaction(p Packet, cs *Client_state) {
 	if p.Consumer_ack_req != CONSUMER_ACK_REQUIRED {
 		return
 	}
-	logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Transaction_id ", p.Transaction_id, " needs a device ACK, adding it to the TX map")
+	if log_enabled(PRINT_DEBUG) {
+		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Transaction_id ", p.Transaction_id, " needs a device ACK, adding it to the TX map")
+	}
 	transactions_append(p.Transaction_id, cs)
 }
 
 // If device-ack, handle it here
 func client_dequeue_transaction(p Packet, cs *Client_state) {
-	if p.Packet_type == DEVICE_ACK_PACKET {
-		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Transaction_id ", p.Transaction_id, " Was popped, removing it from the TX map")
+	if p.Packet_type != DEVICE_ACK_PACKET {
+		return
+	}
+
+	reason := p.Data[PAYLOAD_OFFSET_ACK_NAK_REASON]
+	if reason == ACK_GOOD {
+		if log_enabled(PRINT_DEBUG) {
+			logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Transaction_id ", p.Transaction_id, " Was popped, removing it from the TX map")
+		}
 		transactions_pop(p.Transaction_id, cs)
+		return
 	}
+
+	// the device NAKs with the transaction_id it read, if that is what got
+	// corrupted it's not one of ours and the real one times out
+	if !transactions_try_pop(p.Transaction_id, cs) {
+		logger(PRINT_WARN, "ClientID: ", cs.client_id, "NAK with reason", reason, "for unknown transaction_id", p.Transaction_id)
+		return
+	}
+	logger(PRINT_WARN, "ClientID: ", cs.client_id, "Transaction_id", p.Transaction_id, "was NAKed with reason", reason)
+
+	// let core fail it now instead of waiting out the timeout
+	nak := Packet{}
+	nak.Consumer_ack_req = 0
+	nak.Packet_type = CMD_RESPONSE_PACKET
+	nak.Transaction_id = p.Transaction_id
+
+	payload := Cmd_resp_payload{}
+	payload.Total_packets = 1
+	payload.Cmd_status = CMD_STATUS_FAILED_CRC
+	payload.Resp_payload = make([]byte, CMD_RESPONSE_PAYLOAD_LEN)
+	nak.Data = cmd_payload_pack(payload)
+
+	client_to_core(nak, cs)
 }
 
-func event_generator(cs *Client_state) {
-	defer func() {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "ipc event wait group done")
-		cs.wg_event.Done()
-	}()
+// a frame that failed its CRC, only the header is used and even that is a
+// best guess. Never goes to core, the sender resends or times it out
+func client_core_handle_bad_crc(frame []byte, cs *Client_state) {
+	p := Packet{}
+	p.Packet_type = frame[0]
+	p.Transaction_id = binary.LittleEndian.Uint16(frame[1:3])
+	p.Consumer_ack_req = frame[3]
 
-	var counter int
-	for {
-		select {
-		case <-cs.client_event_timer_kill:
-			logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "event goroutine rxed suicide instruction, dying...")
-			return
-		default:
-		}
+	logger(PRINT_WARN, "ClientID: ", cs.client_id, "bad crc on a packet of type", p.Packet_type, "transaction_id", p.Transaction_id)
 
-		time.Sleep(time.Millisecond * 250)
-		select {
-		case cs.client_event_timer <- true:
-		default:
-			logger(PRINT_WARN, "ClientID: ", cs.client_id, "Was not able to write into cs.client_event_timer")
-			counter++
-			if counter == 10 {
-				logger(PRINT_FATAL, "ClientID: ", cs.client_id, "got stuck trying to shut down event generator")
-			}
-		}
+	// a corrupt device ack is dropped, the transaction accountant times it out
+	if p.Packet_type == DEVICE_ACK_PACKET || p.Consumer_ack_req != CONSUMER_ACK_REQUIRED {
+		return
+	}
+
+	select {
+	case cs.ack_chan <- create_ack_pack(p, NAK_BAD_CRC):
+	case <-cs.done:
 	}
 }
 
-// tcp core processed a packet, handle it
+// tcp core processed a packet, handle it, runs on the tcp reader
 // this could be an..
 // -> device ack
 // -> login packet (goes to BE)
 // -> query packet (goes to BE)
 func client_core_handle_packet_rx(p Packet, cs *Client_state) {
-	if p.Consumer_ack_req == CONSUMER_ACK_REQUIRED {
-		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Sending ACK to device for transaction_id", p.Transaction_id)
-		cs.tcp_socket_writer_chan <- create_ack_pack(p, ACK_GOOD)
+	client_dequeue_transaction(p, cs) // Handle acks (will not go to IPC, only NAKs or no responses)
+
+	if p.Consumer_ack_req == CONSUMER_ACK_REQUIRED && !(LOGIN_ACK_AFTER_COMMIT && p.Packet_type == LOGIN_PACKET) {
+		if log_enabled(PRINT_DEBUG) {
+			logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "Sending ACK to device for transaction_id", p.Transaction_id)
+		}
+		select {
+		case cs.ack_chan <- create_ack_pack(p, ACK_GOOD):
+		case <-cs.done:
+		}
 	}
 
 	if p.Packet_type == DEVICE_ACK_PACKET {
 		// device acks don't go to master-core
+		payload_buf_put(p.Data)
 		return
 	}
 
-	cs.tcp_to_icp_reader_chan <- p
+	client_to_core(p, cs)
 }
@@ -0,0 +1,154 @@
+package main
+
+import (
+	"bufio"
+	"flag"
+	"fmt"
+	"net"
+	"os"
+	"os/exec"
+	"runtime"
+	"runtime/debug"
+	"strings"
+	"testing"
+	"time"
+)
+
+/**********************************************************
+*	Idle connection memory, what one attached scanner costs
+*	the packet server. N devices connect and say nothing,
+*	each gets the real Client_handler (writer, reader,
+*	mailbox, accountant). The dialing end runs in a child
+*	process (this test binary again) so its sockets are not
+*	counted
+*
+*	reports VmRSS and go stack+heap per connection and the
+*	connections that fit in a GiB, re-check against the
+*	10k device target after touching Client_state, the
+*	mailbox or the reader/writer buffers
+*
+*	go test -vet=off -run IdleConnMemory -conns 5000 -v
+*
+*	the fd limit has to allow -conns plus a few
+*********************************************************/
+
+var conn_mem_conns = flag.Int("conns", 0, "idle connections for TestIdleConnMemory, 0 skips it")
+
+const CONN_MEM_DIAL_ENV = "CONN_MEM_DIAL"
+const CONN_MEM_SETTLE_MS = 2000
+
+func proc_rss_kb() int {
+	f, err := os.Open("/proc/self/status")
+	if err != nil {
+		return 0
+	}
+	defer f.Close()
+	s := bufio.NewScanner(f)
+	for s.Scan() {
+		if strings.HasPrefix(s.Text(), "VmRSS:") {
+			var kb int
+			fmt.Sscanf(strings.TrimPrefix(s.Text(), "VmRSS:"), "%d", &kb)
+			return kb
+		}
+	}
+	return 0
+}
+
+// the child, dials and holds the connections until it is killed
+func TestIdleConnMemoryDialer(t *testing.T) {
+	addr := os.Getenv(CONN_MEM_DIAL_ENV)
+	if addr == "" {
+		t.Skip("only runs as TestIdleConnMemory's child")
+	}
+	var conns []net.Conn
+	for i := 0; i < *conn_mem_conns; i++ {
+		c, err := net.Dial("tcp", addr)
+		if err != nil {
+			t.Fatalf("dial %d: %v", i, err)
+		}
+		conns = append(conns, c)
+	}
+	time.Sleep(time.Hour)
+}
+
+func TestIdleConnMemory(t *testing.T) {
+	conns := *conn_mem_conns
+	if conns == 0 || os.Getenv(CONN_MEM_DIAL_ENV) != "" {
+		t.Skip("pass -conns N to measure")
+	}
+
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL // every connect and disconnect is logged
+
+	init_map()
+	timer_wheel_test_start()
+	q := create_ipc_chan()
+	dmq_from_packet_to_core = q
+
+	// core's side, the goodbyes on teardown have to go somewhere
+	go func() {
+		for m := range q.q {
+			packet_buf_put(m)
+		}
+	}()
+
+	l, err := net.Listen("tcp", "127.0.0.1:0")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer l.Close()
+	accepted := make(chan bool, conns)
+	go func() {
+		for {
+			c, err := l.Accept()
+			if err != nil {
+				return
+			}
+			go Client_handler(c)
+			accepted <- true
+		}
+	}()
+
+	runtime.GC()
+	debug.FreeOSMemory()
+	base_rss, base_g := proc_rss_kb(), runtime.NumGoroutine()
+	var base runtime.MemStats
+	runtime.ReadMemStats(&base)
+
+	cmd := exec.Command(os.Args[0], "-test.run=^TestIdleConnMemoryDialer$", fmt.Sprintf("-conns=%d", conns))
+	cmd.Env = append(os.Environ(), CONN_MEM_DIAL_ENV+"="+l.Addr().String())
+	cmd.Stderr = os.Stderr
+	if err := cmd.Start(); err != nil {
+		t.Fatal(err)
+	}
+	defer cmd.Wait()
+	defer cmd.Process.Kill()
+
+	deadline := time.After(time.Duration(conns)*time.Millisecond + 30*time.Second)
+	for i := 0; i < conns; i++ {
+		select {
+		case <-accepted:
+		case <-deadline:
+			t.Fatalf("only %d of %d connections came in", i, conns)
+		}
+	}
+
+	// let every handler get to its select and the reader into Read
+	time.Sleep(CONN_MEM_SETTLE_MS * time.Millisecond)
+	runtime.GC()
+
+	var ms runtime.MemStats
+	runtime.ReadMemStats(&ms)
+	rss := float64(proc_rss_kb()-base_rss) * 1024 / float64(conns)
+	gomem := float64(ms.StackInuse+ms.HeapInuse-base.StackInuse-base.HeapInuse) / float64(conns)
+	t.Logf("%d idle conns, %d goroutines each", conns, (runtime.NumGoroutine()-base_g)/conns)
+	t.Logf("rss %.1f KiB/conn, %.0f conns/GiB", rss/1024, float64(1<<30)/rss)
+	t.Logf("go stack+heap %.1f KiB/conn, %.0f conns/GiB", gomem/1024, float64(1<<30)/gomem)
+
+	// the handlers log on the way out, they have to be gone before the level goes back
+	cmd.Process.Kill()
+	for wait := 0; runtime.NumGoroutine() > base_g+1 && wait < CLIENT_READER_WAIT_MS*5; wait++ {
+		time.Sleep(time.Millisecond)
+	}
+	CURRENT_LOG_LEVEL = level
+}
@@ -67,6 +67,12 @@ const DONT_WAIT_QUEUE = (0)
  *********************************************************/
 const ACK_GOOD = (0)
 const NAK_TCP_DOWN = (1)
+const NAK_BAD_CRC = (3)   // frame failed its CRC, (2) is internal to the FW
+const NAK_SERVER_DB = (4) // LOGIN, core could not commit the punch in time
+
+// crc field of the header (frame_crc), NONE is "not set"
+const PACKET_CRC_NONE = (0x0000)
+const PACKET_CRC_ZERO = (0xFFFF)
 
 // These are generated by the server
 const TOO_MANY_OUTSTANDING_COMMANDS = (100)
@@ -90,6 +96,7 @@ const GET_ALL_USERS_PER_DEVICE_FINAL = (11)
 const GENERATE_DEVICE_ID = (12)
 const HARD_RESET = (13)
 const DISPLAY_MSG_LCD = (14)
+const GET_STATS_CMD = (15) // response payload is a Device_stats
 
 /* The following two packets will ALWAYS be sent after each other
    The first gets the user list on a device, the next trims it based on
@@ -1,5 +1,10 @@
 package main
 
+import (
+	"encoding/binary"
+	hash_crc32 "hash/crc32"
+)
+
 var crc16tab = [256]uint16{
 	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
 	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
@@ -122,6 +127,41 @@ func crc32(buf []uint8) uint32 {
 	return crc
 }
 
+/**********************************************************
+*	Frame CRC, the crc field of every packet header
+*
+*	low 16 bits of the CRC-32C of the whole frame, with the
+*	crc field taken as zero. The firmware's crc32c() in ll.c,
+*	here the SSE4.2 instruction behind hash/crc32
+*********************************************************/
+var frame_crc_table = hash_crc32.MakeTable(hash_crc32.Castagnoli)
+var frame_crc_zero = [CRC_SIZE]byte{}
+
+func frame_crc(b []byte) uint16 {
+	crc := hash_crc32.Update(0, frame_crc_table, b[:PACKET_CRC_OFFSET])
+	crc = hash_crc32.Update(crc, frame_crc_table, frame_crc_zero[:])
+	crc = hash_crc32.Update(crc, frame_crc_table, b[PAYLOAD_OFFSET:])
+
+	if uint16(crc) == PACKET_CRC_NONE {
+		return PACKET_CRC_ZERO
+	}
+	return uint16(crc)
+}
+
+// b is one whole encoded frame
+func frame_crc_set(b []byte) {
+	binary.LittleEndian.PutUint16(b[PACKET_CRC_OFFSET:PAYLOAD_OFFSET], frame_crc(b))
+}
+
+// frames from senders that don't set a CRC pass unless PACKET_CRC_REQUIRED
+func frame_crc_check(b []byte) bool {
+	crc := binary.LittleEndian.Uint16(b[PACKET_CRC_OFFSET:PAYLOAD_OFFSET])
+	if crc == PACKET_CRC_NONE {
+		return !PACKET_CRC_REQUIRED
+	}
+	return crc == frame_crc(b)
+}
+
 /*
 func main() {
 	buf := make([]byte, 1<<20)
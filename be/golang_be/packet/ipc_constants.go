@@ -17,3 +17,22 @@ type Ipc_packet struct {
 	DeviceId uint64
 	token    uint32
 }
+
+/**********************************************************
+*       Transport between packet and core, see ipc_transport.go
+*********************************************************/
+const IPC_TRANSPORT_MQ = (0)   // linux message queues
+const IPC_TRANSPORT_UNIX = (1) // unix domain socket, batched
+
+// packet and core must be built with the same transport. UNIX moves ~4x the messages
+// but adds two goroutine hops, p99 is worse than MQ's at the rates a site sees
+// (BenchmarkIpcTransport), MQ stays the default until that is fixed. single/ runs
+// both in one process over channels whatever this says
+const IPC_TRANSPORT = IPC_TRANSPORT_MQ
+const IPC_UNIX_PATH = "/tmp/ts_packet_core.sock"
+
+const IPC_TRANSPORT_DEPTH = (256)  // messages buffered per direction before Send blocks
+const IPC_SEND_TIMEOUT_MS = (5000) // how long Send waits on a full queue
+const IPC_ABORT_POLL_MS = (100)    // linux mq only, how often a waiting SendAbort looks at abort
+const IPC_STREAM_BUF = (64 * 1024)
+const IPC_STREAM_BATCH_MAX = (64) // messages per write
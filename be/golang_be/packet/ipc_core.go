@@ -3,27 +3,107 @@ package main
 import (
 	"os"
 	"sync"
+	"time"
 
 	"bitbucket.org/avd/go-ipc/mq"
 )
 
 var client_id_source uint64
-var client_map map[uint64]chan Ipc_packet
-var dmq_from_packet_to_core, dmq_from_core_to_packet *mq.LinuxMessageQueue
-var client_id_mutex, mutex_map, mutex_mq sync.Mutex
+var client_id_mutex sync.Mutex
+
+// Downlink from core to each client. The registry is sharded by client id
+// and the shard lock is only held for the lookup, the send itself goes into
+// the client's own bounded mailbox and never blocks mq_listner
+type client_mailbox struct {
+	c      chan Ipc_packet
+	kick   func() // tears the client down
+	mutex  sync.Mutex
+	spill  []Ipc_packet // MAILBOX_SPILL only, keeps order behind c
+	closed bool
+	kicked bool
+}
 
-func mq_write(msg []byte) error {
-	mutex_mq.Lock()
-	err := dmq_from_packet_to_core.Send(msg)
-	if err != nil {
-		logger(PRINT_FATAL, "Wrote to a dead IPC channel - OR IPC channel full -  should be very rare - restart EVERYTHING", err)
+type client_shard struct {
+	mutex sync.RWMutex
+	m     map[uint64]*client_mailbox
+}
+
+var client_shards [CLIENT_SHARDS]client_shard
+
+func get_client_shard(id uint64) *client_shard {
+	return &client_shards[id%CLIENT_SHARDS]
+}
+
+// every transport is safe for concurrent senders, a full queue
+// blocks for a while (backpressure) and then comes back as an error.
+// Closing abort (nil never fires) gives up the wait right away, a
+// client being torn down must not sit behind a stuck core
+func mq_write(msg []byte, abort <-chan struct{}) error {
+	var err error
+	switch q := dmq_from_packet_to_core.(type) {
+	case *ipc_stream:
+		err = q.SendAbort(msg, abort)
+	case *ipc_chan:
+		err = q.SendAbort(msg, abort)
+	case *mq.LinuxMessageQueue:
+		err = mq_write_linux(q, msg, abort)
+	default:
+		err = q.Send(msg)
+	}
+	if err != nil && err != ipc_err_aborted {
+		logger(PRINT_WARN, "Could not write to core, error: ", err)
 	}
-	mutex_mq.Unlock()
 	return err
 }
 
+// a blocking mq_send can not be interrupted, wait in IPC_ABORT_POLL_MS
+// slices instead, up to IPC_SEND_TIMEOUT_MS like the other transports
+func mq_write_linux(q *mq.LinuxMessageQueue, msg []byte, abort <-chan struct{}) error {
+	deadline := time.Now().Add(time.Millisecond * IPC_SEND_TIMEOUT_MS)
+	for {
+		start := time.Now()
+		err := q.SendTimeout(msg, time.Millisecond*IPC_ABORT_POLL_MS)
+		if err == nil {
+			return nil
+		}
+		// failed without waiting out the slice, that is not a full queue
+		if time.Since(start) < time.Millisecond*IPC_ABORT_POLL_MS/2 {
+			return err
+		}
+		select {
+		case <-abort:
+			return ipc_err_aborted
+		default:
+		}
+		if time.Now().After(deadline) {
+			return ipc_err_full
+		}
+	}
+}
+
+// uplink, runs on the client's tcp reader. Takes ownership of p.Data
+func client_to_core(p Packet, cs *Client_state) {
+	// per packet, the args are boxed before logger() gets to drop them
+	if log_enabled(PRINT_DEBUG) {
+		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "sending to linuxQ")
+	}
+	b := packet_buf_get()
+	n := ipc_packet_encode(*b, Ipc_packet{P: p, ClientId: cs.client_id})
+	err := mq_write((*b)[:n], cs.done)
+	packet_buf_put(b)
+	payload_buf_put(p.Data) // from the chunker, dead once it is in the queue
+	if err == ipc_err_aborted {
+		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "closing, dropped a packet to core")
+	} else if err != nil {
+		// core is stuck or gone, shed the packet rather than the whole server
+		logger(PRINT_WARN, "ClientID: ", cs.client_id, "dropped a packet to core")
+	}
+}
+
 func mq_closer() {
-	dmq_from_packet_to_core.Destroy()
+	if q, ok := dmq_from_packet_to_core.(*mq.LinuxMessageQueue); ok {
+		q.Destroy()
+	}
 	logger(PRINT_WARN, "Closing MQ IPC")
 }
 
@@ -32,67 +112,147 @@ func mq_listner() {
 	init_lmq()
 	defer mq_closer()
 
+	// ipc_packet_unpack copies the payload out, safe to reuse rx
+	rx := make([]byte, MAX_IPC_LEN)
 	for {
-		rx := make([]byte, MAX_IPC_LEN) //PACKET_LEN_MAX)
 		n, err := dmq_from_core_to_packet.Receive(rx)
 		if err != nil {
 			logger(PRINT_FATAL, "failed to read q")
 		}
 
 		ip := ipc_packet_unpack(rx)
-		logger(PRINT_DEBUG, "ClientID: ", ip.ClientId, "Recieved packed_id, size : ", n)
+		if log_enabled(PRINT_DEBUG) {
+			logger(PRINT_DEBUG, "ClientID: ", ip.ClientId, "Recieved packed_id, size : ", n)
+		}
 
 		send_to_packet(ip)
 	}
 }
 
-func register_client(id uint64, c chan Ipc_packet) {
-	mutex_map.Lock()
-	if c == nil {
-		logger(PRINT_WARN, "ClientID: ", id, "failed, ipc_packet chan is nill")
+func register_client(id uint64, mb *client_mailbox) {
+	if mb == nil || mb.c == nil {
+		logger(PRINT_WARN, "ClientID: ", id, "failed, mailbox is nill")
 		panic(0)
 	}
 
-	if _, ok := client_map[id]; ok {
+	shard := get_client_shard(id)
+	shard.mutex.Lock()
+	if _, ok := shard.m[id]; ok {
 		logger(PRINT_WARN, "ClientID: ", id, "failed, device id already registered")
 	}
-	client_map[id] = c
-	mutex_map.Unlock()
+	shard.m[id] = mb
+	shard.mutex.Unlock()
 }
 
 func client_deregister(id uint64) {
-	mutex_map.Lock()
-	logger(PRINT_DEBUG, "CLIENT ID: ", id, "took mutex_map")
-	// Close the Channel
-	if _, ok := client_map[id]; ok {
-		close(client_map[id])
-		delete(client_map, id)
-	} else {
+	shard := get_client_shard(id)
+	shard.mutex.Lock()
+	mb, ok := shard.m[id]
+	delete(shard.m, id)
+	shard.mutex.Unlock()
+
+	if !ok {
 		logger(PRINT_WARN, "CLIENT ID: ", id, "Tried to deregister a non-registered client")
+		return
+	}
+
+	// Close the Channel, a racing send_to_packet sees closed and backs off
+	mb.mutex.Lock()
+	mb.closed = true
+	mb.spill = nil
+	close(mb.c)
+	mb.mutex.Unlock()
+}
+
+// mailbox is full, whatever CLIENT_MAILBOX_POLICY says. Called with mb.mutex held
+func client_mailbox_full(mb *client_mailbox, ip Ipc_packet) {
+	if CLIENT_MAILBOX_POLICY == MAILBOX_SPILL && len(mb.spill) < CLIENT_SPILL_MAX {
+		mb.spill = append(mb.spill, ip)
+		return
+	}
+
+	if CLIENT_MAILBOX_POLICY == MAILBOX_DROP {
+		logger(PRINT_WARN, "ClientID: ", ip.ClientId, "mailbox full, dropping packet type", ip.P.Packet_type)
+		return
+	}
+
+	// disconnect, or spill overflowed, the client is not keeping up
+	if !mb.kicked {
+		mb.kicked = true
+		logger(PRINT_WARN, "ClientID: ", ip.ClientId, "mailbox full, disconnecting client")
+		mb.kick()
+	}
+}
+
+// moves spilled packets into the mailbox as room frees up, run by the client's writer
+func client_mailbox_unspill(mb *client_mailbox) {
+	mb.mutex.Lock()
+	for len(mb.spill) != 0 && !mb.closed {
+		select {
+		case mb.c <- mb.spill[0]:
+			mb.spill[0] = Ipc_packet{}
+			mb.spill = mb.spill[1:]
+			continue
+		default:
+		}
+		break
 	}
-	mutex_map.Unlock()
-	logger(PRINT_DEBUG, "CLIENT ID: ", id, "gave mutex_map")
+	if len(mb.spill) == 0 {
+		mb.spill = nil
+	}
+	mb.mutex.Unlock()
 }
 
 func send_to_packet(ip Ipc_packet) {
-	mutex_map.Lock()
+	shard := get_client_shard(ip.ClientId)
+	shard.mutex.RLock()
+	mb, ok := shard.m[ip.ClientId]
+	shard.mutex.RUnlock()
 
-	if _, ok := client_map[ip.ClientId]; !ok {
+	if !ok {
 		logger(PRINT_WARN, "ClientID: ", ip.ClientId, "failed, client was not registered")
-		mutex_map.Unlock()
 		return
 	}
 
-	client_map[ip.ClientId] <- ip
+	mb.mutex.Lock()
+	if mb.closed {
+		mb.mutex.Unlock()
+		return
+	}
 
-	mutex_map.Unlock()
+	// anything already spilled goes first, keeps the order
+	if len(mb.spill) != 0 {
+		client_mailbox_full(mb, ip)
+	} else {
+		select {
+		case mb.c <- ip:
+		default:
+			client_mailbox_full(mb, ip)
+		}
+	}
+	mb.mutex.Unlock()
 }
 
 func init_map() {
-	client_map = make(map[uint64]chan Ipc_packet)
+	for i := range client_shards {
+		client_shards[i].m = make(map[uint64]*client_mailbox)
+	}
 }
 
 func init_lmq() {
+	if ipc_in_process {
+		return // single/, core is in this process
+	}
+
+	if IPC_TRANSPORT == IPC_TRANSPORT_UNIX {
+		s := create_ipc_stream()
+		dmq_from_packet_to_core = s
+		dmq_from_core_to_packet = s
+		go ipc_stream_dial(s, IPC_UNIX_PATH)
+		logger(PRINT_DEBUG, "Created unix socket IPC")
+		return
+	}
+
 	var err error
 
 	dmq_from_packet_to_core, err = mq.OpenLinuxMessageQueue("smq_from_packet_to_core", os.O_WRONLY)
@@ -118,68 +278,3 @@ func get_client_id() uint64 {
 
 	return ret
 }
-
-func ipc_starter(cs *Client_state) {
-	go ipc_reader(cs.client_id, cs)
-	go ipc_writer(cs.client_id, cs)
-}
-
-// Implementation of ipc_writter and reader is
-// naive, assumes a lot (chennels will never close....etc)
-// tood: fix these?
-
-func ipc_writer(id uint64, cs *Client_state) {
-	defer func() {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "ipc write wait group done")
-		cs.wg_ipc.Done()
-	}()
-
-	logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "starting IPC writer")
-	var ip Ipc_packet
-	ip.ClientId = id
-
-	for {
-		select {
-		case ip.P = <-cs.tcp_to_icp_reader_chan:
-			break
-		case <-cs.ipc_read_shutdown:
-			logger(PRINT_NORMAL, "ClientId: ", cs.client_id, "Shutting down read ipc goroutine")
-			return
-		}
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "ipc_writer sending to linuxQ")
-		err := mq_write(ipc_packet_pack(ip))
-		if err != nil {
-			logger(PRINT_FATAL, "ClientID: ", cs.client_id, "Will not handle failure to write to IPC messaeg queue - shut everything down and restart")
-		}
-	}
-}
-
-func ipc_reader(id uint64, cs *Client_state) {
-	defer func() {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "ipc read wait group done")
-		cs.wg_ipc.Done()
-	}()
-
-	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "starting IPC read server")
-	// Register this ipc_reader with the ipc_core, the core will sending
-	// any IPC packets to this particular client id into this chan
-	var ipc_packet Ipc_packet
-	ipc_read_chan := make(chan Ipc_packet, MAX_OUTSTANDING_TRANSACTIONS)
-	register_client(id, ipc_read_chan)
-
-	for {
-		select {
-		case ipc_packet = <-ipc_read_chan:
-			break
-		case <-cs.ipc_write_shutdown:
-			//only once call is required to derigster, will close ipc_read_chan
-			logger(PRINT_NORMAL, "ClientId: ", cs.client_id, "Shutting down write ipc goroutine")
-			client_deregister(id)
-			return
-		}
-
-		logger(PRINT_DEBUG, "ClientID: ", cs.client_id, "IPC_READER read a packet")
-
-		cs.ipc_to_tcp_writer_chan <- ipc_packet.P
-	}
-}
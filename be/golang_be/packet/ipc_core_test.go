@@ -0,0 +1,89 @@
+package main
+
+import (
+	"runtime"
+	"sync"
+	"sync/atomic"
+	"testing"
+	"time"
+)
+
+/**********************************************************
+*	Mailbox stress: one mq_listner stand in pushes to every
+*	client, client 0's writer is stuck and never drains its
+*	mailbox. The others have to get every packet, on time,
+*	and only client 0 gets kicked
+*********************************************************/
+
+const STRESS_CLIENTS = 64
+const STRESS_PER_CLIENT = CLIENT_MAILBOX_LEN + CLIENT_SPILL_MAX + 128 // enough to overflow the stalled one
+const STRESS_DEADLINE = 5 * time.Second
+
+func TestMailboxStalledClient(t *testing.T) {
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL // the kick is a PRINT_WARN
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	init_map()
+
+	var delivered int64
+	kicked := make([]int32, STRESS_CLIENTS)
+	mbs := make([]*client_mailbox, STRESS_CLIENTS)
+	var writers sync.WaitGroup
+
+	for id := uint64(0); id < STRESS_CLIENTS; id++ {
+		id := id
+		mb := &client_mailbox{c: make(chan Ipc_packet, CLIENT_MAILBOX_LEN)}
+		mb.kick = func() { atomic.AddInt32(&kicked[id], 1) }
+		mbs[id] = mb
+		register_client(id, mb)
+
+		if id == 0 {
+			continue // stalled, nobody reads mb.c
+		}
+
+		// what Client_handler's writer does with its mailbox
+		writers.Add(1)
+		go func() {
+			defer writers.Done()
+			for range mb.c {
+				atomic.AddInt64(&delivered, 1)
+				client_mailbox_unspill(mb)
+			}
+		}()
+	}
+
+	start := time.Now()
+	for i := 0; i < STRESS_PER_CLIENT; i++ {
+		for id := uint64(0); id < STRESS_CLIENTS; id++ {
+			send_to_packet(Ipc_packet{ClientId: id, P: Packet{Packet_type: CMD_PACKET}})
+		}
+		runtime.Gosched() // the real mq_listner blocks in Receive between packets
+	}
+	sent := time.Since(start)
+
+	want := int64((STRESS_CLIENTS - 1) * STRESS_PER_CLIENT)
+	for atomic.LoadInt64(&delivered) < want && time.Since(start) < STRESS_DEADLINE {
+		time.Sleep(time.Millisecond)
+	}
+	took := time.Since(start)
+
+	for id := uint64(0); id < STRESS_CLIENTS; id++ {
+		client_deregister(id)
+	}
+	writers.Wait()
+
+	if got := atomic.LoadInt64(&delivered); got != want {
+		t.Fatalf("healthy clients got %d of %d packets in %v", got, want, took)
+	}
+	if kicked[0] != 1 {
+		t.Errorf("stalled client kicked %d times, want 1", kicked[0])
+	}
+	for id := 1; id < STRESS_CLIENTS; id++ {
+		if kicked[id] != 0 {
+			t.Errorf("healthy client %d was kicked", id)
+		}
+	}
+	t.Logf("%d healthy clients got all %d packets in %v (sender done in %v), stalled client kicked once",
+		STRESS_CLIENTS-1, want, took, sent)
+}
@@ -0,0 +1,307 @@
+package main
+
+import (
+	"bufio"
+	"encoding/binary"
+	"errors"
+	"io"
+	"net"
+	"os"
+	"time"
+)
+
+/**********************************************************
+*	Pluggable IPC between packet and core
+*
+*	every queue is an ipc_queue, the linux message queues
+*	already fit the interface. The other transports:
+*
+*	ipc_stream - unix domain stream socket, one connection
+*	             carries both directions, messages are u16
+*	             length prefixed and written in batches
+*	ipc_chan   - in process, channels only. Core's own
+*	             core->site loopback, and packet<->core when
+*	             both run in one binary (single/, see
+*	             ipc_in_process_init)
+*
+*	Send blocks while the peer is behind (backpressure), up
+*	to IPC_SEND_TIMEOUT_MS, then gives up with ipc_err_full.
+*	SendAbort is the same but also gives up, with
+*	ipc_err_aborted, as soon as abort is closed
+*********************************************************/
+
+type ipc_queue interface {
+	Send(b []byte) error
+	Receive(b []byte) (int, error)
+}
+
+// shared by packet and core, in one binary (single/) they are the same queues
+var dmq_from_packet_to_core, dmq_from_core_to_packet ipc_queue
+
+// set by single/ before either side starts, init_lmq and init_lmq_core leave the
+// packet<->core queues alone
+var ipc_in_process bool
+
+var ipc_err_full = errors.New("ipc queue full")
+var ipc_err_aborted = errors.New("ipc send aborted")
+var ipc_err_too_big = errors.New("ipc message larger than receive buffer")
+
+type ipc_stream struct {
+	tx chan *[]byte
+	rx chan *[]byte
+
+	// what a failed flush did not get onto the socket, the next connection sends it
+	// first. Only the ipc_stream_run that owns the connection touches it
+	pending []*[]byte
+}
+
+type ipc_chan struct {
+	q chan *[]byte
+}
+
+// a nil abort never fires
+func ipc_send_pooled(q chan *[]byte, b []byte, abort <-chan struct{}) error {
+	if len(b) > MAX_IPC_LEN {
+		logger(PRINT_FATAL, "ipc message too large", len(b))
+	}
+
+	m := packet_buf_get()
+	*m = (*m)[:copy(*m, b)]
+
+	// fast path, no timer unless we actually have to wait
+	select {
+	case q <- m:
+		return nil
+	default:
+	}
+
+	timer := time.NewTimer(time.Millisecond * IPC_SEND_TIMEOUT_MS)
+	defer timer.Stop()
+	select {
+	case q <- m:
+		return nil
+	case <-timer.C:
+		packet_buf_put(m)
+		return ipc_err_full
+	case <-abort:
+		packet_buf_put(m)
+		return ipc_err_aborted
+	}
+}
+
+func ipc_receive_pooled(q chan *[]byte, b []byte) (int, error) {
+	m := <-q
+	defer packet_buf_put(m)
+
+	if len(*m) > len(b) {
+		return 0, ipc_err_too_big
+	}
+	return copy(b, *m), nil
+}
+
+/**********************************************************
+*                 In process transport
+*********************************************************/
+
+func create_ipc_chan() *ipc_chan {
+	return &ipc_chan{q: make(chan *[]byte, IPC_TRANSPORT_DEPTH)}
+}
+
+// packet and core in one process, a channel each way
+func ipc_in_process_init() {
+	ipc_in_process = true
+	dmq_from_packet_to_core = create_ipc_chan()
+	dmq_from_core_to_packet = create_ipc_chan()
+}
+
+func (c *ipc_chan) Send(b []byte) error {
+	return ipc_send_pooled(c.q, b, nil)
+}
+
+func (c *ipc_chan) SendAbort(b []byte, abort <-chan struct{}) error {
+	return ipc_send_pooled(c.q, b, abort)
+}
+
+func (c *ipc_chan) Receive(b []byte) (int, error) {
+	return ipc_receive_pooled(c.q, b)
+}
+
+/**********************************************************
+*                 Unix socket transport
+*********************************************************/
+
+func create_ipc_stream() *ipc_stream {
+	s := ipc_stream{}
+	s.tx = make(chan *[]byte, IPC_TRANSPORT_DEPTH)
+	s.rx = make(chan *[]byte, IPC_TRANSPORT_DEPTH)
+	return &s
+}
+
+func (s *ipc_stream) Send(b []byte) error {
+	return ipc_send_pooled(s.tx, b, nil)
+}
+
+func (s *ipc_stream) SendAbort(b []byte, abort <-chan struct{}) error {
+	return ipc_send_pooled(s.tx, b, abort)
+}
+
+func (s *ipc_stream) Receive(b []byte) (int, error) {
+	return ipc_receive_pooled(s.rx, b)
+}
+
+// reads frames off the socket until it fails, a slow Receive side stalls
+// this, which stalls the peer's writer through the socket buffer
+func ipc_stream_reader(s *ipc_stream, r *bufio.Reader) {
+	var hdr [2]byte
+
+	for {
+		if _, err := io.ReadFull(r, hdr[:]); err != nil {
+			logger(PRINT_WARN, "ipc stream read failed", err)
+			return
+		}
+
+		l := int(binary.LittleEndian.Uint16(hdr[:]))
+		if l > MAX_IPC_LEN {
+			logger(PRINT_WARN, "ipc stream frame too large", l)
+			return
+		}
+
+		m := packet_buf_get()
+		*m = (*m)[:l]
+		if _, err := io.ReadFull(r, *m); err != nil {
+			packet_buf_put(m)
+			logger(PRINT_WARN, "ipc stream read failed", err)
+			return
+		}
+		s.rx <- m
+	}
+}
+
+// the tail of batch that did not make it out, unwritten bytes were still buffered.
+// The rest went to the socket and back to the pool
+func ipc_stream_unsent(batch []*[]byte, unwritten int) []*[]byte {
+	written := -unwritten
+	for _, m := range batch {
+		written += 2 + len(*m)
+	}
+
+	for i, m := range batch {
+		written -= 2 + len(*m)
+		if written < 0 {
+			return append([]*[]byte(nil), batch[i:]...)
+		}
+		packet_buf_put(m)
+	}
+	return nil
+}
+
+// owns conn until either direction fails. Whatever is queued in s.tx is
+// written in one go, one syscall per batch instead of per message. A batch
+// is at most IPC_STREAM_BATCH_MAX * (MAX_IPC_LEN + 2), under IPC_STREAM_BUF,
+// so bufio never writes on its own and Flush is the only write that can fail
+func ipc_stream_run(s *ipc_stream, conn net.Conn) {
+	var hdr [2]byte
+
+	reader_done := make(chan bool)
+	go func() {
+		ipc_stream_reader(s, bufio.NewReaderSize(conn, IPC_STREAM_BUF))
+		conn.Close()
+		close(reader_done)
+	}()
+
+	w := bufio.NewWriterSize(conn, IPC_STREAM_BUF)
+	batch := s.pending
+	s.pending = nil
+	for {
+		if len(batch) == 0 {
+			select {
+			case m := <-s.tx:
+				batch = append(batch, m)
+			case <-reader_done:
+				return
+			}
+		}
+
+	fill:
+		for len(batch) < IPC_STREAM_BATCH_MAX {
+			select {
+			case m := <-s.tx:
+				batch = append(batch, m)
+			default:
+				break fill
+			}
+		}
+
+		for _, m := range batch {
+			binary.LittleEndian.PutUint16(hdr[:], uint16(len(*m)))
+			w.Write(hdr[:])
+			w.Write(*m)
+		}
+
+		if err := w.Flush(); err != nil {
+			s.pending = ipc_stream_unsent(batch, w.Buffered())
+			logger(PRINT_WARN, "ipc stream write failed,", len(s.pending), "messages requeued for the next connection", err)
+			conn.Close()
+			<-reader_done
+			return
+		}
+
+		for _, m := range batch {
+			packet_buf_put(m)
+		}
+		batch = batch[:0]
+	}
+}
+
+// core side, one packet server at a time, a new connection replaces the old one.
+// A restarted packet server can dial in before core notices the old socket is
+// dead (nothing to write, nothing to read), accepting keeps going while a peer
+// is served and closing the old conn is what gets ipc_stream_run to let go
+func ipc_stream_serve(s *ipc_stream, path string) {
+	os.Remove(path)
+	l, err := net.Listen("unix", path)
+	if err != nil {
+		logger(PRINT_FATAL, "could not listen on ipc socket", path, err)
+	}
+	os.Chmod(path, IPC_QUEUE_PERM)
+
+	conns := make(chan net.Conn, 1)
+	go func() {
+		var prev net.Conn
+		for {
+			conn, err := l.Accept()
+			if err != nil {
+				logger(PRINT_WARN, "ipc socket accept failed", err)
+				time.Sleep(time.Second)
+				continue
+			}
+			if prev != nil {
+				logger(PRINT_WARN, "new ipc peer, dropping the old one")
+				prev.Close()
+			}
+			prev = conn
+			conns <- conn
+		}
+	}()
+
+	for conn := range conns {
+		logger(PRINT_NORMAL, "ipc peer connected")
+		ipc_stream_run(s, conn)
+		logger(PRINT_WARN, "ipc peer went away")
+	}
+}
+
+// packet side, keeps redialing until core is up
+func ipc_stream_dial(s *ipc_stream, path string) {
+	for {
+		conn, err := net.Dial("unix", path)
+		if err != nil {
+			logger(PRINT_WARN, "could not reach core over", path, err)
+			time.Sleep(time.Second)
+			continue
+		}
+		logger(PRINT_NORMAL, "ipc connected to core")
+		ipc_stream_run(s, conn)
+		logger(PRINT_WARN, "ipc connection to core lost, redialing")
+	}
+}
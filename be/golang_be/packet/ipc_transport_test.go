@@ -0,0 +1,312 @@
+package main
+
+import (
+	"bytes"
+	"encoding/binary"
+	"fmt"
+	"io"
+	"net"
+	"os"
+	"os/exec"
+	"path/filepath"
+	"sort"
+	"sync"
+	"syscall"
+	"testing"
+	"time"
+	"unsafe"
+)
+
+/**********************************************************
+*	Transport benchmark, packet -> core messages/s and
+*	latency (p50, p99, send to Receive returning)
+*
+*	mq   - linux message queue, depth 10, senders behind one
+*	       mutex: mq_write before the ipc rework
+*	unix - ipc_stream, the senders in a child process
+*	chan - ipc_chan, one process (single/)
+*
+*	each at full speed and paced to 20k/s and 100k/s, in
+*	bursts once a ms. IPC_BENCH_SENDERS goroutines send
+*	CMD sized messages, like client readers do
+*
+*	go test -vet=off -bench IpcTransport -run XXX
+*********************************************************/
+
+var ipc_test_peer net.Conn
+
+// a second packet server dialing in takes over, the first one's conn is
+// closed and core's traffic goes to the new one
+func TestIpcStreamServeReplaces(t *testing.T) {
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL // connects and drops are PRINT_WARN
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	path := filepath.Join(t.TempDir(), "ipc.sock")
+	s := create_ipc_stream()
+	go ipc_stream_serve(s, path)
+
+	var old net.Conn
+	var err error
+	for i := 0; i < 100; i++ {
+		if old, err = net.Dial("unix", path); err == nil {
+			break
+		}
+		time.Sleep(10 * time.Millisecond)
+	}
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer old.Close()
+
+	// never closed (nor collected, the finalizer would close it), the serve loop
+	// outlives the test and would log it going away
+	peer, err := net.Dial("unix", path)
+	if err != nil {
+		t.Fatal(err)
+	}
+	ipc_test_peer = peer
+
+	old.SetReadDeadline(time.Now().Add(5 * time.Second))
+	if _, err := old.Read(make([]byte, 1)); err != io.EOF {
+		t.Fatalf("old peer read %v, want EOF", err)
+	}
+
+	msg := []byte("to the new packet server")
+	if err := s.Send(msg); err != nil {
+		t.Fatal(err)
+	}
+	var hdr [2]byte
+	peer.SetReadDeadline(time.Now().Add(5 * time.Second))
+	if _, err := io.ReadFull(peer, hdr[:]); err != nil {
+		t.Fatal(err)
+	}
+	got := make([]byte, binary.LittleEndian.Uint16(hdr[:]))
+	if _, err := io.ReadFull(peer, got); err != nil || !bytes.Equal(got, msg) {
+		t.Fatalf("new peer got %q, %v", got, err)
+	}
+}
+
+// a batch that failed part way is requeued from the first message that did not
+// get out whole, the ones before it go back to the pool
+func TestIpcStreamUnsent(t *testing.T) {
+	// 12 bytes a message on the wire, the third got 5 of its 12 out
+	for unwritten, first := range map[int]int{0: -1, 48: 0, 19: 2, 12: 3} {
+		// a fresh batch each time, the sent ones go back to the pool
+		var batch []*[]byte
+		for i := 0; i < 4; i++ {
+			m := packet_buf_get()
+			*m = (*m)[:10]
+			(*m)[0] = byte(i)
+			batch = append(batch, m)
+		}
+
+		got := ipc_stream_unsent(batch, unwritten)
+		if first == -1 {
+			if got != nil {
+				t.Errorf("%d unwritten: %d requeued, want none", unwritten, len(got))
+			}
+			continue
+		}
+		if len(got) != len(batch)-first || (*got[0])[0] != byte(first) {
+			t.Errorf("%d unwritten: %d requeued, want from message %d on", unwritten, len(got), first)
+		}
+		for _, m := range got {
+			packet_buf_put(m)
+		}
+	}
+}
+
+const IPC_BENCH_SENDERS = (4)
+const IPC_BENCH_MSG = (CMD_PACKET_SIZE + 16)
+const IPC_BENCH_ENV = "IPC_BENCH"
+const IPC_BENCH_MQ = "/ts_ipc_bench"
+
+// mq_open & co straight, the old mq_write was one mq_send per message
+type ipc_bench_mq struct {
+	fd int
+}
+
+func ipc_bench_mq_open(create bool) (*ipc_bench_mq, error) {
+	name, _ := syscall.BytePtrFromString(IPC_BENCH_MQ[1:])
+	attr := [4]int64{0, 10, MAX_IPC_LEN, 0} // flags, maxmsg, msgsize, curmsgs
+	flags := syscall.O_RDWR
+	if create {
+		syscall.Syscall(syscall.SYS_MQ_UNLINK, uintptr(unsafe.Pointer(name)), 0, 0)
+		flags |= syscall.O_CREAT
+	}
+	fd, _, e := syscall.Syscall6(syscall.SYS_MQ_OPEN, uintptr(unsafe.Pointer(name)), uintptr(flags), IPC_QUEUE_PERM,
+		uintptr(unsafe.Pointer(&attr)), 0, 0)
+	if e != 0 {
+		return nil, e
+	}
+	return &ipc_bench_mq{fd: int(fd)}, nil
+}
+
+func (q *ipc_bench_mq) Send(b []byte) error {
+	if _, _, e := syscall.Syscall6(syscall.SYS_MQ_TIMEDSEND, uintptr(q.fd), uintptr(unsafe.Pointer(&b[0])), uintptr(len(b)), 0, 0, 0); e != 0 {
+		return e
+	}
+	return nil
+}
+
+func (q *ipc_bench_mq) Receive(b []byte) (int, error) {
+	n, _, e := syscall.Syscall6(syscall.SYS_MQ_TIMEDRECEIVE, uintptr(q.fd), uintptr(unsafe.Pointer(&b[0])), uintptr(len(b)), 0, 0, 0)
+	if e != 0 {
+		return 0, e
+	}
+	return int(n), nil
+}
+
+// n messages over IPC_BENCH_SENDERS goroutines, pace msgs/s in all (0 is flat out).
+// lock is the old mutex_mq
+func ipc_bench_send(q ipc_queue, n, pace int, lock bool) error {
+	var mutex sync.Mutex
+	var wg sync.WaitGroup
+	errs := make(chan error, IPC_BENCH_SENDERS)
+
+	for s := 0; s < IPC_BENCH_SENDERS; s++ {
+		wg.Add(1)
+		go func() {
+			defer wg.Done()
+			b := make([]byte, IPC_BENCH_MSG)
+			per_ms := pace / IPC_BENCH_SENDERS / 1000
+			next := time.Now()
+			for i := 0; i < n/IPC_BENCH_SENDERS; i++ {
+				if per_ms != 0 && i%per_ms == 0 {
+					next = next.Add(time.Millisecond)
+					time.Sleep(time.Until(next))
+				}
+				binary.LittleEndian.PutUint64(b[8:], uint64(time.Now().UnixNano()))
+				if lock {
+					mutex.Lock()
+				}
+				err := q.Send(b)
+				if lock {
+					mutex.Unlock()
+				}
+				if err != nil {
+					errs <- err
+					return
+				}
+			}
+		}()
+	}
+	wg.Wait()
+	close(errs)
+	return <-errs
+}
+
+func ipc_bench_recv(b *testing.B, q ipc_queue, n int) {
+	rx := make([]byte, MAX_IPC_LEN)
+	lat := make([]int64, 0, n)
+	var start time.Time
+	for i := 0; i < n; i++ {
+		l, err := q.Receive(rx)
+		if err != nil || l != IPC_BENCH_MSG {
+			b.Fatalf("receive %d: %d bytes, %v", i, l, err)
+		}
+		if i == 0 {
+			start = time.Now()
+		}
+		lat = append(lat, time.Now().UnixNano()-int64(binary.LittleEndian.Uint64(rx[8:])))
+	}
+	took := time.Since(start)
+
+	sort.Slice(lat, func(i, j int) bool { return lat[i] < lat[j] })
+	if n > 1 {
+		b.ReportMetric(float64(n-1)/took.Seconds(), "msgs/s")
+	}
+	b.ReportMetric(float64(lat[n/2])/1e3, "p50_us")
+	b.ReportMetric(float64(lat[n*99/100])/1e3, "p99_us")
+}
+
+// the child, sends what the env says and waits to be killed
+func TestIpcBenchSender(t *testing.T) {
+	var mode, path string
+	var n, pace int
+	if _, err := fmt.Sscan(os.Getenv(IPC_BENCH_ENV), &mode, &path, &n, &pace); err != nil {
+		t.Skip("only runs as BenchmarkIpcTransport's child")
+	}
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL
+
+	var err error
+	if mode == "mq" {
+		var q *ipc_bench_mq
+		if q, err = ipc_bench_mq_open(false); err == nil {
+			err = ipc_bench_send(q, n, pace, true)
+		}
+	} else {
+		s := create_ipc_stream()
+		go ipc_stream_dial(s, path)
+		err = ipc_bench_send(s, n, pace, false)
+	}
+	if err != nil {
+		t.Fatal(err)
+	}
+	time.Sleep(time.Hour)
+}
+
+var ipc_bench_stream_once sync.Once
+var ipc_bench_stream *ipc_stream
+var ipc_bench_path string
+
+func BenchmarkIpcTransport(b *testing.B) {
+	// the serve loop outlives the benchmark and logs its peers going away
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL
+
+	ipc_bench_stream_once.Do(func() {
+		dir, err := os.MkdirTemp("", "ipc_bench")
+		if err != nil {
+			b.Fatal(err)
+		}
+		ipc_bench_path = filepath.Join(dir, "ipc.sock")
+		ipc_bench_stream = create_ipc_stream()
+		go ipc_stream_serve(ipc_bench_stream, ipc_bench_path)
+	})
+
+	for _, mode := range []string{"mq", "unix", "chan"} {
+		for _, pace := range []int{0, 20000, 100000} {
+			mode, pace := mode, pace
+			name := mode + "/full"
+			if pace != 0 {
+				name = fmt.Sprintf("%s/%dk", mode, pace/1000)
+			}
+			b.Run(name, func(b *testing.B) {
+				n := (b.N + IPC_BENCH_SENDERS - 1) / IPC_BENCH_SENDERS * IPC_BENCH_SENDERS
+				ipc_bench_run(b, mode, n, pace)
+			})
+		}
+	}
+}
+
+func ipc_bench_run(b *testing.B, mode string, n, pace int) {
+	var q ipc_queue
+	switch mode {
+	case "chan":
+		c := create_ipc_chan()
+		go ipc_bench_send(c, n, pace, false)
+		ipc_bench_recv(b, c, n)
+		return
+	case "mq":
+		mq, err := ipc_bench_mq_open(true)
+		if err != nil {
+			b.Skip("no linux message queues here:", err)
+		}
+		defer syscall.Close(mq.fd)
+		q = mq
+	default:
+		q = ipc_bench_stream
+	}
+
+	cmd := exec.Command(os.Args[0], "-test.run=^TestIpcBenchSender$")
+	cmd.Env = append(os.Environ(), fmt.Sprintf("%s=%s %s %d %d", IPC_BENCH_ENV, mode, ipc_bench_path, n, pace))
+	cmd.Stderr = os.Stderr
+	if err := cmd.Start(); err != nil {
+		b.Fatal(err)
+	}
+	defer cmd.Wait()
+	defer cmd.Process.Kill()
+
+	ipc_bench_recv(b, q, n)
+}
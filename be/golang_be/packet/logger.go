@@ -1,12 +1,67 @@
 package main
 
-import "fmt"
-import "time"
-import "strings"
-import "os"
-import "bytes"
+import (
+	"bufio"
+	"bytes"
+	"fmt"
+	"os"
+	"strconv"
+	"strings"
+	"sync"
+	"sync/atomic"
+	"time"
+)
+
+/**********************************************************
+*	Async logger, shared by packet and core
+*
+*	callers format into a pooled buffer (only if the level
+*	is enabled) and push it into a lock free ring, a single
+*	flusher goroutine owns the file + stdout and does the
+*	writes in batches. A full ring drops lines, it never
+*	blocks the packet path. FATAL drains the ring first
+*
+*	logger_kv writes key=value records for anything that
+*	gets parsed later (stats, timings), plain logger() is
+*	for prose
+*********************************************************/
+
+const LOG_RING_LEN = (4096) // must be a power of 2
+const LOG_FLUSH_MS = (100)
+const LOG_ROTATE_BYTES = (64 * 1024 * 1024)
+const LOG_ROTATE_PERIOD = (24 * time.Hour)
+const LOG_WRITER_BUF = (64 * 1024)
 
 var logHandle *os.File
+var log_dir = "./log/"
+
+var log_level_names = [...]string{"SDEBUG", "DEBUG ", "NORMAL", "WARN  ", "CRIT  ", "FATAL "}
+
+type log_slot struct {
+	seq  uint64
+	line *bytes.Buffer
+}
+
+// bounded MPSC ring, slot sequence numbers tell producers and the
+// flusher who owns a slot, no locks on either side
+type log_ring struct {
+	head  uint64 // next enqueue, shared by producers
+	tail  uint64 // next dequeue, flusher only
+	slots [LOG_RING_LEN]log_slot
+}
+
+var log_q log_ring
+var log_dropped uint64
+var log_running bool
+var log_wake = make(chan bool, 1)
+var log_sync = make(chan chan bool)
+var log_source string
+
+var log_line_pool = sync.Pool{
+	New: func() interface{} {
+		return new(bytes.Buffer)
+	},
+}
 
 func check(e error) {
 	if e != nil {
@@ -14,48 +69,233 @@ func check(e error) {
 	}
 }
 
-func logger_init(source string) {
+func log_ring_init(r *log_ring) {
+	for i := range r.slots {
+		r.slots[i].seq = uint64(i)
+	}
+}
+
+func log_ring_put(r *log_ring, line *bytes.Buffer) bool {
+	for {
+		pos := atomic.LoadUint64(&r.head)
+		slot := &r.slots[pos&(LOG_RING_LEN-1)]
+		seq := atomic.LoadUint64(&slot.seq)
+
+		if seq == pos {
+			if atomic.CompareAndSwapUint64(&r.head, pos, pos+1) {
+				slot.line = line
+				atomic.StoreUint64(&slot.seq, pos+1)
+				return true
+			}
+		} else if seq < pos {
+			return false // full
+		}
+	}
+}
+
+func log_ring_get(r *log_ring) *bytes.Buffer {
+	slot := &r.slots[r.tail&(LOG_RING_LEN-1)]
+	if atomic.LoadUint64(&slot.seq) != r.tail+1 {
+		return nil
+	}
+
+	line := slot.line
+	slot.line = nil
+	atomic.StoreUint64(&slot.seq, r.tail+LOG_RING_LEN)
+	r.tail++
+	return line
+}
+
+func log_file_name(source string) string {
 	timeString := time.Now().Format("02-Jan-2006 15:04:05")
 	timeString = strings.Replace(timeString, " ", "-", -1)
+	return log_dir + timeString + source
+}
 
+func logger_init(source string) {
 	var err error
-	logHandle, err = os.Create("./log/" + timeString + source)
+
+	log_source = source
+	logHandle, err = os.Create(log_file_name(source))
 	check(err)
+
+	log_ring_init(&log_q)
+	log_running = true
+	go log_flusher()
 }
 
-func ms_since_epoch() int64 {
-	return time.Now().UnixNano() / 1e6
+// only the flusher touches logHandle after logger_init
+func log_rotate(file_w *bufio.Writer) {
+	file_w.Flush()
+	logHandle.Close()
+
+	var err error
+	logHandle, err = os.Create(log_file_name(log_source))
+	check(err)
+	file_w.Reset(logHandle)
 }
 
-func logger(level int, a ...interface{}) {
-	var buf bytes.Buffer
+func log_flusher() {
+	file_w := bufio.NewWriterSize(logHandle, LOG_WRITER_BUF)
+	out_w := bufio.NewWriterSize(os.Stdout, LOG_WRITER_BUF)
+	ticker := time.NewTicker(time.Millisecond * LOG_FLUSH_MS)
+
+	file_bytes := 0
+	opened := time.Now()
+
+	var done chan bool
+	for {
+		select {
+		case <-log_wake:
+		case <-ticker.C:
+		case done = <-log_sync:
+		}
+
+		for line := log_ring_get(&log_q); line != nil; line = log_ring_get(&log_q) {
+			out_w.Write(line.Bytes())
+			file_w.Write(line.Bytes())
+			file_bytes += line.Len()
+			line.Reset()
+			log_line_pool.Put(line)
+		}
+
+		if dropped := atomic.SwapUint64(&log_dropped, 0); dropped != 0 {
+			msg := fmt.Sprintln("logger: ring full, dropped", dropped, "lines")
+			out_w.WriteString(msg)
+			file_w.WriteString(msg)
+		}
+
+		out_w.Flush()
+		file_w.Flush()
 
-	if level >= CURRENT_LOG_LEVEL {
-		fmt.Println(time.Now().Format("15:04:05.00000"), a)
+		if file_bytes >= LOG_ROTATE_BYTES || time.Since(opened) >= LOG_ROTATE_PERIOD {
+			log_rotate(file_w)
+			file_bytes = 0
+			opened = time.Now()
+		}
 
-		fmt.Fprint(&buf, a)
-		logHandle.Write(buf.Bytes())
-		logHandle.Write([]byte("\n"))
+		if done != nil {
+			close(done)
+			done = nil
+		}
+	}
+}
+
+// cheap check for call sites that would otherwise box arguments for nothing
+func log_enabled(level int) bool {
+	return level >= CURRENT_LOG_LEVEL || level == PRINT_FATAL
+}
+
+// blocks until the flusher has written out everything queued so far
+func log_flush_wait() {
+	done := make(chan bool)
+	select {
+	case log_sync <- done:
+		<-done
+	case <-time.After(time.Second):
+	}
+}
+
+func log_emit(level int, line *bytes.Buffer) {
+	if level == PRINT_FATAL && log_running {
+		// make room, then make sure it is on disk before going down
+		log_flush_wait()
+		log_ring_put(&log_q, line)
+		log_flush_wait()
+		panic(0) // time to die :(
+	}
+
+	if !log_running {
+		// before logger_init (tools, tests), just write it out
+		os.Stdout.Write(line.Bytes())
+	} else if log_ring_put(&log_q, line) {
+		select {
+		case log_wake <- true:
+		default:
+		}
+	} else {
+		atomic.AddUint64(&log_dropped, 1)
 	}
 
 	if level == PRINT_FATAL {
-		logHandle.Write([]byte("**** FATAL ****"))
 		panic(0) // time to die :(
 	}
 }
 
+func log_header(level int) *bytes.Buffer {
+	var ts [32]byte
+
+	line := log_line_pool.Get().(*bytes.Buffer)
+	line.Write(time.Now().AppendFormat(ts[:0], "15:04:05.00000"))
+	line.WriteByte(' ')
+	if level >= 0 && level < len(log_level_names) {
+		line.WriteString(log_level_names[level])
+	}
+	line.WriteByte(' ')
+	return line
+}
+
+func ms_since_epoch() int64 {
+	return time.Now().UnixNano() / 1e6
+}
+
+func logger(level int, a ...interface{}) {
+	if !log_enabled(level) {
+		return
+	}
+
+	line := log_header(level)
+	fmt.Fprintln(line, a...)
+	log_emit(level, line)
+}
+
 func logger_id(level int, id uint64, a ...interface{}) {
-	var buf bytes.Buffer
+	if !log_enabled(level) {
+		return
+	}
+
+	var id_buf [20]byte
+
+	line := log_header(level)
+	line.WriteString("DeviceID ")
+	line.Write(strconv.AppendUint(id_buf[:0], id, 10))
+	line.WriteString(" : ")
+	fmt.Fprintln(line, a...)
+	log_emit(level, line)
+}
 
-	if level >= CURRENT_LOG_LEVEL {
-		fmt.Println(time.Now().Format("15:04:05.00000"), "DeviceID", id, ":", a)
+// logger_kv(PRINT_NORMAL, "db stmt", "name", s.name, "calls", 12) comes out as
+// "db stmt name=punch_insert calls=12", values with spaces are quoted
+func logger_kv(level int, msg string, kv ...interface{}) {
+	if !log_enabled(level) {
+		return
+	}
 
-		fmt.Fprint(&buf, a)
-		logHandle.Write(buf.Bytes())
-		logHandle.Write([]byte("\n"))
+	line := log_header(level)
+	log_kv_format(line, msg, kv)
+	log_emit(level, line)
+}
+
+func log_kv_format(line *bytes.Buffer, msg string, kv []interface{}) {
+	line.WriteString(msg)
+	for i := 0; i < len(kv); i += 2 {
+		line.WriteByte(' ')
+		fmt.Fprint(line, kv[i])
+		line.WriteByte('=')
+		if i+1 < len(kv) {
+			log_kv_value(line, kv[i+1])
+		}
 	}
-	if level == PRINT_FATAL {
-		logHandle.Write([]byte("**** FATAL ****"))
-		panic(0) // time to die :(
+	line.WriteByte('\n')
+}
+
+func log_kv_value(line *bytes.Buffer, v interface{}) {
+	s, ok := v.(string)
+	if !ok {
+		s = fmt.Sprint(v)
+	}
+	if s == "" || strings.ContainsAny(s, " =\"") {
+		s = strconv.Quote(s)
 	}
+	line.WriteString(s)
 }
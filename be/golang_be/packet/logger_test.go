@@ -0,0 +1,98 @@
+package main
+
+import (
+	"bytes"
+	"os"
+	"path/filepath"
+	"strings"
+	"sync"
+	"testing"
+)
+
+/**********************************************************
+*	Logger throughput, messages/s into the ring at every
+*	level with CURRENT_LOG_LEVEL at PRINT_NORMAL. SDEBUG and
+*	DEBUG are the cost of a filtered call, the rest format
+*	and queue a line for the real flusher (to a temp dir and
+*	/dev/null). A full ring drops, so these are what the
+*	packet path pays, not what reaches the disk
+*
+*	go test -vet=off -bench Logger -run XXX -cpu 1,4
+*********************************************************/
+
+var logger_bench_once sync.Once
+
+func logger_bench_init(b *testing.B) {
+	logger_bench_once.Do(func() {
+		dir, err := os.MkdirTemp("", "logger_bench")
+		if err != nil {
+			b.Fatal(err)
+		}
+		null, err := os.OpenFile(os.DevNull, os.O_WRONLY, 0)
+		if err != nil {
+			b.Fatal(err)
+		}
+
+		// the flusher picks up stdout once it runs, answering a flush says it has
+		log_dir = dir + "/"
+		stdout := os.Stdout
+		os.Stdout = null
+		logger_init("_bench")
+		log_flush_wait()
+		os.Stdout = stdout
+	})
+}
+
+// the open file keeps going unlinked, rotation starts a new one in log_dir
+func logger_bench_clean(b *testing.B) {
+	log_flush_wait()
+	files, _ := filepath.Glob(log_dir + "*")
+	for _, f := range files {
+		os.Remove(f)
+	}
+}
+
+func BenchmarkLogger(b *testing.B) {
+	logger_bench_init(b)
+	defer logger_bench_clean(b)
+
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_NORMAL
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	for l := PRINT_SUPER_DEBUG; l < PRINT_FATAL; l++ {
+		l := l
+		name := strings.TrimSpace(log_level_names[l])
+		b.Run(name+"/logger_id", func(b *testing.B) {
+			b.ReportAllocs()
+			b.RunParallel(func(pb *testing.PB) {
+				i := 0
+				for pb.Next() {
+					logger_id(l, 0xDEADBEEF, "ClientID: ", 12, "Recieved packet, size : ", i)
+					i++
+				}
+			})
+			b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "msgs/s")
+		})
+		b.Run(name+"/logger_kv", func(b *testing.B) {
+			b.ReportAllocs()
+			b.RunParallel(func(pb *testing.PB) {
+				i := 0
+				for pb.Next() {
+					logger_kv(l, "rx", "client", 12, "device", 0xDEADBEEF, "size", i)
+					i++
+				}
+			})
+			b.ReportMetric(float64(b.N)/b.Elapsed().Seconds(), "msgs/s")
+		})
+	}
+}
+
+// a record is one line, keys in order, values that would split it quoted
+func TestLoggerKv(t *testing.T) {
+	var line bytes.Buffer
+	log_kv_format(&line, "db stmt", []interface{}{"name", "punch_insert", "calls", 12, "path", "a b", "empty", "", "odd"})
+	if got, want := line.String(), "db stmt name=punch_insert calls=12 path=\"a b\" empty=\"\" odd=\n"; got != want {
+		t.Errorf("got %q, want %q", got, want)
+	}
+}
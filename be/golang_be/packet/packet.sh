@@ -1,9 +1,10 @@
-go build -race server.go   client_core.go   \
+go build -race server.go   packet_main.go client_core.go   \
                            tcp_core.go constants.go     \
                            ipc_core.go packet_helper.go \
                            server_config.go logger.go   \
                            transaction_accountant.go    \
-                           ipc_constants.go crc.go 
+                           ipc_constants.go crc.go      \
+                           ipc_transport.go timer_wheel.go
 
 if [ $? != 0 ]; then
   exit 
@@ -6,8 +6,125 @@ import (
 	_ "fmt"
 	"log"
 	"strings"
+	"sync"
 )
 
+/**********************************************************
+*       					Packet codec
+*	hand rolled, works on caller owned buffers, no reflection
+*********************************************************/
+
+// scratch buffers for the pack side, large enough for any Ipc_packet
+var packet_buf_pool = sync.Pool{
+	New: func() interface{} {
+		b := make([]byte, MAX_IPC_LEN)
+		return &b
+	},
+}
+
+// always MAX_IPC_LEN long, the ipc transports hand theirs back cut to the message
+func packet_buf_get() *[]byte {
+	b := packet_buf_pool.Get().(*[]byte)
+	*b = (*b)[:cap(*b)]
+	return b
+}
+
+func packet_buf_put(b *[]byte) {
+	packet_buf_pool.Put(b)
+}
+
+// backing store for received payloads, the largest payload is a DATA packet
+type payload_buf [LARGE_PAYLOAD_SIZE]byte
+
+var payload_buf_pool = sync.Pool{
+	New: func() interface{} {
+		return new(payload_buf)
+	},
+}
+
+// len 0, cap LARGE_PAYLOAD_SIZE, give it back with payload_buf_put()
+func payload_buf_get() []byte {
+	return payload_buf_pool.Get().(*payload_buf)[:0]
+}
+
+// once the payload is dead (written to ipc, or a device ack), anything
+// that did not come from payload_buf_get() is left to the gc
+func payload_buf_put(b []byte) {
+	if cap(b) != LARGE_PAYLOAD_SIZE {
+		return
+	}
+	payload_buf_pool.Put((*payload_buf)(b[:LARGE_PAYLOAD_SIZE]))
+}
+
+// Writes the "c" packet into dst, returns the number of bytes written
+func packet_encode(dst []byte, packet Packet) int {
+	if len(packet.Data) < get_packet_payload_len(packet.Packet_type) {
+		logger(PRINT_FATAL, "packet smaller than expected", get_packet_payload_len(packet.Packet_type), "but got ", len(packet.Data))
+	}
+
+	n := PAYLOAD_OFFSET + len(packet.Data)
+	if len(dst) < n {
+		logger(PRINT_FATAL, "encode buffer too small, need", n, "but got", len(dst))
+	}
+
+	dst[0] = packet.Packet_type
+	binary.LittleEndian.PutUint16(dst[1:3], packet.Transaction_id)
+	dst[3] = packet.Consumer_ack_req
+	binary.LittleEndian.PutUint16(dst[4:6], packet.Crc)
+	copy(dst[PAYLOAD_OFFSET:n], packet.Data)
+
+	return n
+}
+
+// Fills p from the "c" packet in b, p.Data is reused if it has the capacity
+// so a caller that keeps p around decodes without allocating. b is not retained
+func packet_decode(p *Packet, b []byte) {
+	if len(b) < PAYLOAD_OFFSET {
+		logger(PRINT_FATAL, "len of b[] is smaller than a packet header", len(b))
+	}
+
+	p.Packet_type = b[0]
+	p.Transaction_id = binary.LittleEndian.Uint16(b[1:3])
+	p.Consumer_ack_req = b[3]
+	p.Crc = binary.LittleEndian.Uint16(b[4:6])
+
+	payload_len := get_packet_payload_len(p.Packet_type)
+	if len(b) < PAYLOAD_OFFSET+payload_len {
+		logger(PRINT_FATAL, "len of b[] is smaller than len of packet")
+	}
+
+	p.Data = append(p.Data[:0], b[PAYLOAD_OFFSET:PAYLOAD_OFFSET+payload_len]...)
+}
+
+func ipc_packet_encode(dst []byte, i Ipc_packet) int {
+	n := packet_encode(dst, i.P)
+	if len(dst) < n+16 {
+		logger(PRINT_FATAL, "encode buffer too small for ipc ids", len(dst))
+	}
+
+	binary.LittleEndian.PutUint64(dst[n:n+8], i.ClientId)
+	binary.LittleEndian.PutUint64(dst[n+8:n+16], i.DeviceId)
+	return n + 16
+}
+
+// the ids sit right after the packet, at get_packet_len() of the type
+func ipc_packet_decode(ip *Ipc_packet, b []byte) {
+	if b == nil {
+		logger(PRINT_FATAL, "nil packet given to ipc_packet_decode")
+	}
+
+	packet_decode(&ip.P, b)
+
+	l := get_packet_len(b[0])
+	if len(b) < l+16 {
+		logger(PRINT_FATAL, "len of b[] is smaller than len of ipc packet", len(b))
+	}
+
+	ip.ClientId = binary.LittleEndian.Uint64(b[l : l+8])
+	ip.DeviceId = binary.LittleEndian.Uint64(b[l+8 : l+16])
+	ip.token = 0
+}
+
 /**********************************************************
 *       					Helpers for Packets
 *********************************************************/
@@ -59,7 +176,8 @@ func get_packet_payload_len(packet_type uint8) int {
 	return ret
 }
 
-func get_packet_len(packet_type uint8) int {
+// 0 if the type is unknown, lets the chunker resync instead of dying
+func lookup_packet_len(packet_type uint8) int {
 	ret := 0
 	switch packet_type {
 	case DATA_PACKET:
@@ -98,7 +216,19 @@ func get_packet_len(packet_type uint8) int {
 	case VOID_PACKET:
 		ret = VOID_PACKET_SIZE
 		break
-	default:
+	}
+	return ret
+}
+
+func get_packet_len(packet_type uint8) int {
+	// never comes off the wire so it's not in the chunker's table, core sends
+	// them over ipc when LOGIN_ACK_AFTER_COMMIT
+	if packet_type == SERVER_ACK_PACKET {
+		return ACK_PACKET_SIZE
+	}
+
+	ret := lookup_packet_len(packet_type)
+	if ret == 0 {
 		log.Fatal("ERRO! Unknown packet type recieved: ", packet_type)
 	}
 	return ret
@@ -137,62 +267,15 @@ func create_goodbye_packet(client uint64) Ipc_packet {
 // Converts a golang Packet representation
 // into a "c" packet
 func packet_pack(packet Packet) []byte {
-	buf := new(bytes.Buffer)
-
-	err1 := binary.Write(buf, binary.LittleEndian, uint8(packet.Packet_type))
-	err2 := binary.Write(buf, binary.LittleEndian, packet.Transaction_id)
-	err3 := binary.Write(buf, binary.LittleEndian, packet.Consumer_ack_req)
-	err4 := binary.Write(buf, binary.LittleEndian, packet.Crc)
-
-	if len(packet.Data) < get_packet_payload_len(packet.Packet_type) {
-		logger(PRINT_FATAL, "packet smaller than expected", get_packet_payload_len(packet.Packet_type), "but got ", len(packet.Data))
-	}
-
-	var err5 error
-	if packet.Data != nil {
-		err5 = binary.Write(buf, binary.LittleEndian, packet.Data)
-	}
-	if err1 != nil || err2 != nil || err3 != nil || err4 != nil || err5 != nil {
-		log.Fatal("binary.Write failed - errors are as follows", err1, err2, err3, err4)
-	}
-
-	return buf.Bytes()
+	b := make([]byte, PAYLOAD_OFFSET+len(packet.Data))
+	packet_encode(b, packet)
+	return b
 }
 
 // Converts a C packet into a golang packet
 func packet_unpack(packed_packet []byte) Packet {
-	// first, extract a general_packet (ie, no payload)
-	// using binary.read, then later we will extract the data
-	var temp_packet Packet_general
-	buf := bytes.NewBuffer(packed_packet)
-
-	err := binary.Read(buf, binary.LittleEndian, &temp_packet)
-	if err != nil {
-		log.Fatal("Failed to unpack packet, error: ", err)
-	}
-
-	// Load the Data
-	// - first see how large the payload is
 	packet_out := Packet{}
-
-	packet_out.Packet_type = temp_packet.Packet_type
-	packet_out.Transaction_id = temp_packet.Transaction_id
-	packet_out.Consumer_ack_req = temp_packet.Consumer_ack_req
-	packet_out.Crc = temp_packet.Crc
-
-	payload_len := get_packet_payload_len(packet_out.Packet_type)
-	if payload_len == 0 {
-		// This packet does not have a payload
-		return packet_out
-	}
-
-	if len(packed_packet) < get_packet_payload_len(packet_out.Packet_type) {
-		logger(PRINT_FATAL, "len of b[] is smaller than len of packet")
-	}
-
-	packet_out.Data = make([]byte, 0, payload_len)
-	packet_out.Data = append(packet_out.Data, packed_packet[PAYLOAD_OFFSET:PAYLOAD_OFFSET+payload_len]...)
-
+	packet_decode(&packet_out, packed_packet)
 	return packet_out
 }
 
@@ -231,37 +314,16 @@ func create_ack_pack(p Packet, reason uint8) Packet {
 // Converts a golang Ipc_packet representation
 // into a "c" Ipc_packet
 func ipc_packet_pack(i Ipc_packet) []byte {
-	buf := new(bytes.Buffer)
-
-	_, err1 := buf.Write(packet_pack(i.P))
-	err2 := binary.Write(buf, binary.LittleEndian, i.ClientId)
-	err3 := binary.Write(buf, binary.LittleEndian, i.DeviceId)
-
-	if err1 != nil || err2 != nil || err3 != nil {
-		logger(PRINT_FATAL, "binary.Write failed - errors are as follows", err1, err2, err3, "client ID and device ID are ", i.ClientId, i.DeviceId)
-	}
-	return buf.Bytes()
+	b := make([]byte, PAYLOAD_OFFSET+len(i.P.Data)+16)
+	ipc_packet_encode(b, i)
+	return b
 }
 
 // Converts a "c" Ipc_packet representation
 // into a golang Ipc_packet
 func ipc_packet_unpack(b []byte) Ipc_packet {
-	if b == nil {
-		logger(PRINT_FATAL, "nil packet given to ipc-packet_unpack")
-	}
-
 	ip := Ipc_packet{}
-	ip.P = packet_unpack(b)
-
-	l := get_packet_len(b[0])
-
-	//ugly math... ip.Id starts at (TOTAL_LEN-LEN(INT64)*2)
-	id_offset := l                                                       // 16 is len(uint64)*2
-	ip.ClientId = binary.LittleEndian.Uint64(b[id_offset : id_offset+9]) // slice notition is [) not []
-
-	id_offset = l + 8
-	ip.DeviceId = binary.LittleEndian.Uint64(b[id_offset:])
-
+	ipc_packet_decode(&ip, b)
 	return ip
 }
 
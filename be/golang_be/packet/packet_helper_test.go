@@ -0,0 +1,340 @@
+package main
+
+import (
+	"bufio"
+	"bytes"
+	"encoding/binary"
+	"encoding/hex"
+	hash_crc32 "hash/crc32"
+	"os"
+	"strconv"
+	"strings"
+	"testing"
+)
+
+/**********************************************************
+*	Codec benchmarks, every type get_packet_len() knows
+*
+*	before - the binary.Write/binary.Read codec the hand
+*	         rolled one replaced, kept here as the baseline
+*	after  - packet_pack & co, a fresh slice per call
+*	pooled - packet_encode & co on pooled buffers, what
+*	         the tcp reader and mq_write actually run
+*
+*	go test -vet=off -bench . -run XXX
+*********************************************************/
+
+var codec_types = []struct {
+	name string
+	t    uint8
+}{
+	{"DATA", DATA_PACKET}, {"CMD", CMD_PACKET}, {"INTERNAL_ACK", INTERNAL_ACK_PACKET},
+	{"DEVICE_ACK", DEVICE_ACK_PACKET}, {"LOGIN", LOGIN_PACKET}, {"HELLO", HELLO_WORLD_PACKET},
+	{"GOODBYE", GOODBYE_WORLD_PACKET}, {"CMD_RESPONSE", CMD_RESPONSE_PACKET}, {"FOTA", FOTA_PACKET},
+	{"FOTA_ACK", FOTA_ACK_PACKET}, {"ECHO", ECHO_PACKET}, {"VOID", VOID_PACKET},
+}
+
+func codec_packet(t uint8) Packet {
+	p := Packet{Packet_type: t, Transaction_id: 0x1234, Consumer_ack_req: 1, Crc: 0xBEEF}
+	p.Data = make([]byte, get_packet_payload_len(t))
+	for i := range p.Data {
+		p.Data[i] = byte(i)
+	}
+	return p
+}
+
+func codec_ipc_packet(t uint8) Ipc_packet {
+	return Ipc_packet{P: codec_packet(t), ClientId: 7, DeviceId: 0xABCDEF}
+}
+
+// mq receives always land in a MAX_IPC_LEN buffer
+func codec_ipc_raw(t uint8) []byte {
+	raw := make([]byte, MAX_IPC_LEN)
+	copy(raw, ipc_packet_pack(codec_ipc_packet(t)))
+	return raw
+}
+
+/**********************************************************
+*	the codec before, reflection through encoding/binary
+*********************************************************/
+
+func packet_pack_before(packet Packet) []byte {
+	buf := new(bytes.Buffer)
+	binary.Write(buf, binary.LittleEndian, uint8(packet.Packet_type))
+	binary.Write(buf, binary.LittleEndian, packet.Transaction_id)
+	binary.Write(buf, binary.LittleEndian, packet.Consumer_ack_req)
+	binary.Write(buf, binary.LittleEndian, packet.Crc)
+	if packet.Data != nil {
+		binary.Write(buf, binary.LittleEndian, packet.Data)
+	}
+	return buf.Bytes()
+}
+
+func packet_unpack_before(packed_packet []byte) Packet {
+	var temp_packet Packet_general
+	binary.Read(bytes.NewBuffer(packed_packet), binary.LittleEndian, &temp_packet)
+
+	packet_out := Packet{}
+	packet_out.Packet_type = temp_packet.Packet_type
+	packet_out.Transaction_id = temp_packet.Transaction_id
+	packet_out.Consumer_ack_req = temp_packet.Consumer_ack_req
+	packet_out.Crc = temp_packet.Crc
+
+	payload_len := get_packet_payload_len(packet_out.Packet_type)
+	if payload_len == 0 {
+		return packet_out
+	}
+	packet_out.Data = make([]byte, 0, payload_len)
+	packet_out.Data = append(packet_out.Data, packed_packet[PAYLOAD_OFFSET:PAYLOAD_OFFSET+payload_len]...)
+	return packet_out
+}
+
+func ipc_packet_pack_before(i Ipc_packet) []byte {
+	buf := new(bytes.Buffer)
+	buf.Write(packet_pack_before(i.P))
+	binary.Write(buf, binary.LittleEndian, i.ClientId)
+	binary.Write(buf, binary.LittleEndian, i.DeviceId)
+	return buf.Bytes()
+}
+
+func ipc_packet_unpack_before(b []byte) Ipc_packet {
+	ip := Ipc_packet{}
+	ip.P = packet_unpack_before(b)
+
+	l := get_packet_len(b[0])
+	ip.ClientId = binary.LittleEndian.Uint64(b[l : l+8])
+	ip.DeviceId = binary.LittleEndian.Uint64(b[l+8:])
+	return ip
+}
+
+/**********************************************************
+*	the codecs agree byte for byte
+*********************************************************/
+
+func TestCodecMatchesBefore(t *testing.T) {
+	for _, ct := range codec_types {
+		ip := codec_ipc_packet(ct.t)
+
+		if !bytes.Equal(packet_pack(ip.P), packet_pack_before(ip.P)) {
+			t.Errorf("%s: packet_pack differs from before", ct.name)
+		}
+		if !bytes.Equal(ipc_packet_pack(ip), ipc_packet_pack_before(ip)) {
+			t.Errorf("%s: ipc_packet_pack differs from before", ct.name)
+		}
+
+		buf := make([]byte, MAX_IPC_LEN)
+		n := ipc_packet_encode(buf, ip)
+		if !bytes.Equal(buf[:n], ipc_packet_pack(ip)) {
+			t.Errorf("%s: ipc_packet_encode differs from ipc_packet_pack", ct.name)
+		}
+
+		// an INTERNAL_ACK's payload is shorter than its packet, it never goes over ipc
+		if ct.t == INTERNAL_ACK_PACKET {
+			continue
+		}
+		raw := codec_ipc_raw(ct.t)
+		var got Ipc_packet
+		ipc_packet_decode(&got, raw)
+		want := ipc_packet_unpack_before(raw)
+		if got.ClientId != want.ClientId || got.DeviceId != want.DeviceId || got.P.Crc != want.P.Crc ||
+			got.P.Transaction_id != want.P.Transaction_id || !bytes.Equal(got.P.Data, want.P.Data) {
+			t.Errorf("%s: ipc_packet_decode differs from before", ct.name)
+		}
+		if got.ClientId != 7 || got.DeviceId != 0xABCDEF || !bytes.Equal(got.P.Data, ip.P.Data) {
+			t.Errorf("%s: round trip lost something, got client %d device %x", ct.name, got.ClientId, got.DeviceId)
+		}
+	}
+}
+
+/**********************************************************
+*	benchmarks
+*********************************************************/
+
+var sink_b []byte
+var sink_p Packet
+var sink_i Ipc_packet
+
+func BenchmarkPacketPack(b *testing.B) {
+	for _, ct := range codec_types {
+		p := codec_packet(ct.t)
+		b.Run(ct.name+"/before", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_b = packet_pack_before(p)
+			}
+		})
+		b.Run(ct.name+"/after", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_b = packet_pack(p)
+			}
+		})
+		b.Run(ct.name+"/pooled", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				buf := packet_buf_get()
+				packet_encode(*buf, p)
+				packet_buf_put(buf)
+			}
+		})
+	}
+}
+
+func BenchmarkPacketUnpack(b *testing.B) {
+	for _, ct := range codec_types {
+		raw := packet_pack(codec_packet(ct.t))
+		b.Run(ct.name+"/before", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_p = packet_unpack_before(raw)
+			}
+		})
+		b.Run(ct.name+"/after", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_p = packet_unpack(raw)
+			}
+		})
+		b.Run(ct.name+"/pooled", func(b *testing.B) {
+			var p Packet
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				packet_decode(&p, raw)
+			}
+		})
+	}
+}
+
+func BenchmarkIpcPack(b *testing.B) {
+	for _, ct := range codec_types {
+		ip := codec_ipc_packet(ct.t)
+		b.Run(ct.name+"/before", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_b = ipc_packet_pack_before(ip)
+			}
+		})
+		b.Run(ct.name+"/after", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_b = ipc_packet_pack(ip)
+			}
+		})
+		b.Run(ct.name+"/pooled", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				buf := packet_buf_get()
+				ipc_packet_encode(*buf, ip)
+				packet_buf_put(buf)
+			}
+		})
+	}
+}
+
+func BenchmarkIpcUnpack(b *testing.B) {
+	for _, ct := range codec_types {
+		raw := codec_ipc_raw(ct.t)
+		b.Run(ct.name+"/before", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_i = ipc_packet_unpack_before(raw)
+			}
+		})
+		b.Run(ct.name+"/after", func(b *testing.B) {
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				sink_i = ipc_packet_unpack(raw)
+			}
+		})
+		b.Run(ct.name+"/pooled", func(b *testing.B) {
+			var ip Ipc_packet
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				ipc_packet_decode(&ip, raw)
+			}
+		})
+	}
+}
+
+/**********************************************************
+*	Frame CRC against testdata/frame_crc.txt, the same
+*	vectors fw/host/crc_test.c runs the firmware's crc32c
+*	over, so both ends agree on what goes in the header
+*********************************************************/
+
+type frame_crc_vector struct {
+	frame  []byte
+	crc32c uint32
+	crc    uint16
+}
+
+func frame_crc_vectors(t *testing.T) []frame_crc_vector {
+	f, err := os.Open("testdata/frame_crc.txt")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer f.Close()
+
+	var ret []frame_crc_vector
+	s := bufio.NewScanner(f)
+	s.Buffer(nil, 1<<16)
+	for s.Scan() {
+		fields := strings.Fields(s.Text())
+		if len(fields) == 0 || strings.HasPrefix(fields[0], "#") {
+			continue
+		}
+		frame, err_f := hex.DecodeString(fields[0])
+		crc32c, err_c := strconv.ParseUint(fields[1], 16, 32)
+		crc, err_r := strconv.ParseUint(fields[2], 16, 16)
+		if len(fields) != 3 || err_f != nil || err_c != nil || err_r != nil {
+			t.Fatalf("bad vector %q", s.Text())
+		}
+		ret = append(ret, frame_crc_vector{frame, uint32(crc32c), uint16(crc)})
+	}
+	if len(ret) == 0 {
+		t.Fatal("no vectors")
+	}
+	return ret
+}
+
+func TestFrameCrc(t *testing.T) {
+	for _, v := range frame_crc_vectors(t) {
+		if got := hash_crc32.Checksum(v.frame, frame_crc_table); got != v.crc32c {
+			t.Errorf("%x: crc32c %08x, want %08x", v.frame, got, v.crc32c)
+		}
+		if got := frame_crc(v.frame); got != v.crc {
+			t.Errorf("%x: frame_crc %04x, want %04x", v.frame, got, v.crc)
+		}
+
+		frame := append([]byte(nil), v.frame...)
+		frame_crc_set(frame)
+		if !frame_crc_check(frame) {
+			t.Errorf("%x: frame_crc_check failed on its own frame_crc_set", v.frame)
+		}
+		frame[len(frame)-1] ^= 0x01
+		if frame_crc_check(frame) {
+			t.Errorf("%x: frame_crc_check passed a flipped bit", v.frame)
+		}
+
+		binary.LittleEndian.PutUint16(frame[PACKET_CRC_OFFSET:PAYLOAD_OFFSET], PACKET_CRC_NONE)
+		if frame_crc_check(frame) != !PACKET_CRC_REQUIRED {
+			t.Errorf("%x: a frame without a crc passed=%v, PACKET_CRC_REQUIRED=%v", v.frame, !PACKET_CRC_REQUIRED, PACKET_CRC_REQUIRED)
+		}
+	}
+}
+
+// what the tcp reader runs on every frame it takes in
+func BenchmarkFrameCrcCheck(b *testing.B) {
+	for _, ct := range codec_types {
+		frame := packet_pack(codec_packet(ct.t))
+		frame_crc_set(frame)
+		b.Run(ct.name, func(b *testing.B) {
+			b.SetBytes(int64(len(frame)))
+			for i := 0; i < b.N; i++ {
+				if !frame_crc_check(frame) {
+					b.Fatal("crc mismatch")
+				}
+			}
+		})
+	}
+}
@@ -0,0 +1,7 @@
+package main
+
+// the packet server on its own, single/ links the rest of it into one binary with core
+func main() {
+	logger_init("_packet")
+	packet_run()
+}
@@ -27,8 +27,9 @@ func timeout(t time.Duration, timeout chan bool) {
 	timeout <- true
 }
 
-func main() {
-	logger_init("_packet")
+// everything but the logger, main (packet_main.go) or single/ sets that up
+func packet_run() {
+	timer_wheel_start()
 
 	// Start the IPC listner, TCP clients will hook into the IPC core
 	// to communicate to the backend
@@ -19,6 +19,27 @@ var CURRENT_LOG_LEVEL int = 1
 // used to set variables inside the ack/nak subsystem
 const MAX_OUTSTANDING_TRANSACTIONS = 16
 
+// per client downlink mailboxes (packet server, ipc_core.go)
+const CLIENT_SHARDS = 16
+const CLIENT_MAILBOX_LEN = MAX_OUTSTANDING_TRANSACTIONS
+const CLIENT_SPILL_MAX = 256       // FOTA pushes blocks back to back, give it room
+const CLIENT_READER_WAIT_MS = 2000 // how long a closing client waits on its tcp reader before moving on
+
+// what send_to_packet does when a client's mailbox is full
+const MAILBOX_DROP = 0       // drop the packet, core times the command out
+const MAILBOX_DISCONNECT = 1 // tear the client down, it will reconnect
+const MAILBOX_SPILL = 2      // queue up to CLIENT_SPILL_MAX in order, then disconnect
+
+const CLIENT_MAILBOX_POLICY = MAILBOX_SPILL
+
+// drop frames that come in without a CRC, leave false while
+// scanners on firmware that doesn't set one are still out there
+const PACKET_CRC_REQUIRED = false
+
+// LOGIN packets are acked by core once the punch is committed to the db
+// (punch_ingest.go), not by the packet server when the frame comes in
+const LOGIN_ACK_AFTER_COMMIT = true
+
 // Set timeouts
 
 const TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST = 5000
@@ -7,69 +7,89 @@ import (
 
 //import "time"
 
+// conn.Read lands straight in here, a few frames per syscall. Allocated per
+// connection, idle devices dominate so keep it small
+const CHUNKER_READ_BUF_LEN = (4 * PACKET_LEN_MAX)
+
 type chunker_state struct {
-	packet_parsed_so_far int
-	pckt_size            int
-	current_parse_type   int
-	packet_wip           []byte
+	buf          []byte // unparsed bytes are buf[start:end]
+	start        int
+	end          int
+	resync_bytes int // bytes dropped while looking for a known packet type
 }
 
 func chunker_reset(state *chunker_state) {
-	state.packet_parsed_so_far = 0
-	state.packet_wip = nil
-	state.pckt_size = 0
-	state.current_parse_type = -1
+	if state.buf == nil {
+		state.buf = make([]byte, CHUNKER_READ_BUF_LEN)
+	}
+	state.start = 0
+	state.end = 0
+	state.resync_bytes = 0
 }
 
-func chunker(state *chunker_state, rx []byte, lenght int, cs *Client_state) int {
-	if len(rx) == 0 || lenght == 0 {
-		return -1
+// where the next read should go, always has room for at least one full frame
+func chunker_rx_space(state *chunker_state) []byte {
+	if state.start == state.end {
+		state.start = 0
+		state.end = 0
+	} else if len(state.buf)-state.end < PACKET_LEN_MAX {
+		// the only copy, a frame that spans reads is moved to the front
+		state.end = copy(state.buf, state.buf[state.start:state.end])
+		state.start = 0
 	}
+	return state.buf[state.end:]
+}
 
-	var rx_processed = 0
-	for rx_processed != lenght {
-
-		// this function is "stateless", state is passed to it from tcp_socket_read(..)
-		if state.current_parse_type == -1 {
-			// the type is always the first byte in any packet
-			// - also, it must be offset to the boundary of the next
-			// incomming packet
-			state.current_parse_type = int(rx[rx_processed])
+// Frames the lenght bytes just read into chunker_rx_space(), every full frame is
+// decoded out of the read buffer into a pooled payload. Returns the number of frames
+func chunker(state *chunker_state, lenght int, cs *Client_state) int {
+	if lenght <= 0 {
+		return -1
+	}
+	state.end += lenght
+
+	frames := 0
+	dropped := state.resync_bytes
+	for state.start != state.end {
+		// the type is always the first byte in any packet, if we don't know
+		// it we lost framing, drop bytes until something that looks like a type
+		pckt_size := lookup_packet_len(state.buf[state.start])
+		if pckt_size == 0 {
+			state.start++
+			state.resync_bytes++
+			continue
+		}
 
-			state.pckt_size = get_packet_len(uint8(state.current_parse_type))
+		if state.end-state.start < pckt_size {
+			break
 		}
 
-		var rx_left = lenght - rx_processed
-		read_len := 0
+		frame := state.buf[state.start : state.start+pckt_size]
+		state.start += pckt_size
+		frames++
 
-		if rx_left <= (state.pckt_size - state.packet_parsed_so_far) {
-			read_len = rx_left
-		} else {
-			read_len = state.pckt_size - state.packet_parsed_so_far
+		if !frame_crc_check(frame) {
+			client_core_handle_bad_crc(frame, cs)
+			continue
 		}
 
-		state.packet_wip = append(state.packet_wip, rx[rx_processed:rx_processed+read_len]...)
-		state.packet_parsed_so_far += read_len
-		rx_processed += read_len
+		rx_packet := Packet{Data: payload_buf_get()}
+		packet_decode(&rx_packet, frame)
 
-		if state.packet_parsed_so_far == state.pckt_size {
+		client_core_handle_packet_rx(rx_packet, cs)
+	}
 
-			logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Recieved a packet")
-			rx_packet := packet_unpack(state.packet_wip[:state.pckt_size])
-			// Let the client handler know we got a packet
-			cs.tcp_socket_reader_chan <- rx_packet
-			//reset internal structures
-			chunker_reset(state)
-		}
+	if state.resync_bytes != dropped {
+		logger_kv(PRINT_WARN, "lost framing", "client", cs.client_id, "dropped", state.resync_bytes-dropped, "total", state.resync_bytes)
 	}
-	return 0
+	return frames
 }
 
-// Owns low level TCP reads
+// Owns low level TCP reads, every frame is handled inline (see client_core_handle_packet_rx)
 func tcp_socket_read(conn net.Conn, cs *Client_state) {
 	defer func() {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "read wait group done")
-		cs.wg_tcp.Done()
+		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "tcp reader done")
+		close(cs.reader_done)
 	}()
 
 	// Every connection needs a unique chunker
@@ -78,11 +98,9 @@ func tcp_socket_read(conn net.Conn, cs *Client_state) {
 	chunker_state := chunker_state{}
 	chunker_reset(&chunker_state)
 
-	chunk := make([]byte, PACKET_LEN_MAX)
-
 	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "starting TCP read server")
 	for {
-		n, err := conn.Read(chunk)
+		n, err := conn.Read(chunker_rx_space(&chunker_state))
 
 		if err != nil {
 			if err != io.EOF {
@@ -90,60 +108,29 @@ func tcp_socket_read(conn net.Conn, cs *Client_state) {
 			} else {
 				logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Connection closed by client")
 			}
-			cs.err_chan_tcp <- true
-			goto err
-			return
+			break
 		}
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "chunking", n, " bytes")
-		chunker(&chunker_state, chunk[0:n], n, cs)
+		chunker(&chunker_state, n, cs)
 	}
-err:
-	chunker_reset(&chunker_state)
+
 	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Closing TCP read socket!")
-	conn.Close()
-	cs.err_chan_tcp <- true
+	client_kill(cs)
 }
 
-// Owns low level TCP writes
-func tcp_socket_write(conn net.Conn, cs *Client_state) {
-	var packet Packet
-
-	defer func() {
-		logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "write wait group done")
-		cs.wg_tcp.Done()
-	}()
-
-	for {
-		select {
-		case packet = <-cs.tcp_socket_writer_chan:
-			break
-		case <-cs.tcp_write_shutdown:
-			goto err
-		}
-
-		packet_binary := packet_pack(packet)
+// Only called from the client's writer (Client_handler), buf is the writer's own
+func tcp_socket_write(conn net.Conn, cs *Client_state, buf []byte, packet Packet) error {
+	l := packet_encode(buf, packet)
+	frame_crc_set(buf[:l])
 
-		written := 0
-		l := len(packet_binary)
-		for written != l {
-			n, err := conn.Write(packet_binary[written:])
-			if err != nil {
-				logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "got the following error while writting: ", err)
-				goto err
-			}
-			written = written + n
-			logger(PRINT_NORMAL, "ClientID:", cs.client_id, "wrote ", n, " bytes")
+	written := 0
+	for written != l {
+		n, err := conn.Write(buf[written:l])
+		if err != nil {
+			logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "got the following error while writting: ", err)
+			return err
 		}
+		written = written + n
+		logger(PRINT_NORMAL, "ClientID:", cs.client_id, "wrote ", n, " bytes")
 	}
-
-err:
-	logger(PRINT_NORMAL, "ClientID: ", cs.client_id, "Closing TCP write socket!")
-	conn.Close()
-	cs.err_chan_tcp <- true
-}
-
-// Start the listener and writter goroutines
-func tcp_starter(conn net.Conn, cs *Client_state) {
-	go tcp_socket_read(conn, cs)
-	go tcp_socket_write(conn, cs)
+	return nil
 }
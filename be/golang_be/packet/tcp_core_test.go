@@ -0,0 +1,132 @@
+package main
+
+import (
+	"testing"
+)
+
+/**********************************************************
+*	Chunker benchmarks, a device stream fed the way
+*	conn.Read hands it over, every frame goes all the way
+*	to the ipc queue (client_to_core) like on the server
+*
+*	ByteByByte - one byte per read, worst case framing
+*	Read536    - one TCP segment's worth per read
+*	MultiFrame - the whole stream in one read
+*	Aligned    - exactly one frame per read
+*
+*	go test -vet=off -bench Chunker -run XXX
+*********************************************************/
+
+// uplink types only, no acks owed (Consumer_ack_req 0) and no device
+// acks, so nothing but the chunker and the ipc queue is measured
+func chunker_stream() ([]byte, int) {
+	types := []uint8{LOGIN_PACKET, CMD_RESPONSE_PACKET, HELLO_WORLD_PACKET, FOTA_ACK_PACKET, LOGIN_PACKET, GOODBYE_WORLD_PACKET}
+	var s []byte
+	for i, t := range types {
+		p := Packet{Packet_type: t, Transaction_id: uint16(i)}
+		p.Data = make([]byte, get_packet_payload_len(t))
+		p.Data[0] = byte(i)
+		s = append(s, packet_pack(p)...)
+	}
+	return s, len(types)
+}
+
+// the ipc queue the chunker's frames end up in
+func chunker_setup() (*ipc_chan, *Client_state) {
+	CURRENT_LOG_LEVEL = PRINT_WARN // the per frame PRINT_DEBUGs would be most of what is measured
+
+	q := create_ipc_chan()
+	dmq_from_packet_to_core = q
+
+	cs := &Client_state{client_id: 1}
+	cs.done = make(chan struct{})
+	return q, cs
+}
+
+// what core's ipc reader does, the buffers go back to the pool
+func chunker_drain(q *ipc_chan, n int) {
+	for i := 0; i < n; i++ {
+		packet_buf_put(<-q.q)
+	}
+}
+
+func chunker_feed(st *chunker_state, cs *Client_state, stream []byte, read_len int) int {
+	frames := 0
+	for off := 0; off < len(stream); {
+		space := chunker_rx_space(st)
+		n := read_len
+		if n > len(space) {
+			n = len(space)
+		}
+		n = copy(space[:n], stream[off:])
+		off += n
+		frames += chunker(st, n, cs)
+	}
+	return frames
+}
+
+func chunker_bench(b *testing.B, stream []byte, frames int, read_len int) {
+	q, cs := chunker_setup()
+	var st chunker_state
+	chunker_reset(&st)
+
+	b.SetBytes(int64(len(stream)))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		chunker_feed(&st, cs, stream, read_len)
+		chunker_drain(q, frames)
+	}
+}
+
+func BenchmarkChunkerByteByByte(b *testing.B) {
+	stream, frames := chunker_stream()
+	chunker_bench(b, stream, frames, 1)
+}
+
+func BenchmarkChunkerRead536(b *testing.B) {
+	stream, frames := chunker_stream()
+	chunker_bench(b, stream, frames, 536)
+}
+
+func BenchmarkChunkerMultiFrame(b *testing.B) {
+	stream, frames := chunker_stream()
+	chunker_bench(b, stream, frames, len(stream))
+}
+
+func BenchmarkChunkerAligned(b *testing.B) {
+	frame := packet_pack(Packet{Packet_type: CMD_RESPONSE_PACKET, Data: make([]byte, MEDIUM_PAYLOAD_SIZE)})
+	chunker_bench(b, frame, 1, len(frame))
+}
+
+// garbage up front then the stream three times, at read sizes that split
+// frames every which way. Every frame comes out whole and in order
+func TestChunkerFraming(t *testing.T) {
+	stream, frames := chunker_stream()
+	junk := []byte{0xFF, 0xEE, 200}
+	all := append(append([]byte{}, junk...), stream...)
+	all = append(all, stream...)
+	all = append(all, stream...)
+
+	for _, read_len := range []int{1, 7, 262, 536, len(all)} {
+		q, cs := chunker_setup()
+		var st chunker_state
+		chunker_reset(&st)
+
+		got := chunker_feed(&st, cs, all, read_len)
+		if got != 3*frames || st.resync_bytes != len(junk) {
+			t.Fatalf("read len %d: %d frames, %d resync bytes", read_len, got, st.resync_bytes)
+		}
+
+		for i := 0; i < got; i++ {
+			m := <-q.q
+			var ip Ipc_packet
+			ipc_packet_decode(&ip, *m)
+			packet_buf_put(m)
+
+			if int(ip.P.Transaction_id) != i%frames || ip.P.Data[0] != byte(i%frames) || ip.ClientId != cs.client_id {
+				t.Fatalf("read len %d: frame %d came out as transaction %d", read_len, i, ip.P.Transaction_id)
+			}
+		}
+	}
+}
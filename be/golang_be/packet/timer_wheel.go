@@ -0,0 +1,177 @@
+package main
+
+import (
+	"sync"
+	"time"
+)
+
+/**********************************************************
+*	One hierarchical timer wheel for the whole server
+*
+*	level 0 has a slot per tick, the upper levels hold far
+*	away timers and cascade them down as the wheel turns.
+*	Adding and cancelling are O(1), a tick only touches the
+*	slot that is due. Callbacks run on the wheel goroutine
+*	without the wheel lock, they must not block
+*********************************************************/
+
+const TIMER_WHEEL_TICK_MS = (50)
+const TIMER_WHEEL_LEVELS = (3)
+const TIMER_WHEEL_L0_BITS = (8) // 256 ticks, 12.8 s
+const TIMER_WHEEL_LN_BITS = (6) // 64 slots per upper level, ~13.6 min then ~14.5 h
+
+type wheel_timer struct {
+	expires uint64 // tick it fires on
+	fn      func()
+	prev    *wheel_timer
+	next    *wheel_timer
+	armed   bool
+}
+
+type timer_wheel struct {
+	mutex  sync.Mutex
+	now    uint64
+	levels [TIMER_WHEEL_LEVELS][]wheel_timer // each slot is a list head
+	fire   []func()
+}
+
+var timers timer_wheel
+
+func timer_wheel_level_bits(level int) uint {
+	return TIMER_WHEEL_L0_BITS + uint(level-1)*TIMER_WHEEL_LN_BITS
+}
+
+func timer_wheel_init(w *timer_wheel) {
+	for l := range w.levels {
+		slots := 1 << TIMER_WHEEL_LN_BITS
+		if l == 0 {
+			slots = 1 << TIMER_WHEEL_L0_BITS
+		}
+		w.levels[l] = make([]wheel_timer, slots)
+		for i := range w.levels[l] {
+			head := &w.levels[l][i]
+			head.next = head
+			head.prev = head
+		}
+	}
+}
+
+// called with w.mutex held
+func timer_wheel_place(w *timer_wheel, t *wheel_timer) {
+	// cascaded timers can be due this very tick, they land in the slot about to fire
+	if t.expires < w.now {
+		t.expires = w.now
+	}
+	delta := t.expires - w.now
+
+	var head *wheel_timer
+	if delta < 1<<TIMER_WHEEL_L0_BITS {
+		head = &w.levels[0][t.expires&(1<<TIMER_WHEEL_L0_BITS-1)]
+	} else {
+		for l := 1; l < TIMER_WHEEL_LEVELS; l++ {
+			bits := timer_wheel_level_bits(l)
+			if delta < 1<<(bits+TIMER_WHEEL_LN_BITS) || l == TIMER_WHEEL_LEVELS-1 {
+				// past the top level gets clamped to the furthest slot
+				if delta >= 1<<(bits+TIMER_WHEEL_LN_BITS) {
+					t.expires = w.now + 1<<(bits+TIMER_WHEEL_LN_BITS) - 1
+				}
+				head = &w.levels[l][(t.expires>>bits)&(1<<TIMER_WHEEL_LN_BITS-1)]
+				break
+			}
+		}
+	}
+
+	t.next = head
+	t.prev = head.prev
+	head.prev.next = t
+	head.prev = t
+	t.armed = true
+}
+
+func timer_wheel_unlink(t *wheel_timer) {
+	t.prev.next = t.next
+	t.next.prev = t.prev
+	t.prev = nil
+	t.next = nil
+	t.armed = false
+}
+
+// moves every timer in an upper level slot down to where it now belongs
+func timer_wheel_cascade(w *timer_wheel, level int) {
+	bits := timer_wheel_level_bits(level)
+	head := &w.levels[level][(w.now>>bits)&(1<<TIMER_WHEEL_LN_BITS-1)]
+	for head.next != head {
+		t := head.next
+		timer_wheel_unlink(t)
+		timer_wheel_place(w, t)
+	}
+}
+
+func timer_wheel_tick(w *timer_wheel) {
+	w.mutex.Lock()
+	w.now++
+
+	for l := TIMER_WHEEL_LEVELS - 1; l > 0; l-- {
+		if w.now&(1<<timer_wheel_level_bits(l)-1) == 0 {
+			timer_wheel_cascade(w, l)
+		}
+	}
+
+	w.fire = w.fire[:0]
+	head := &w.levels[0][w.now&(1<<TIMER_WHEEL_L0_BITS-1)]
+	for head.next != head {
+		t := head.next
+		timer_wheel_unlink(t)
+		w.fire = append(w.fire, t.fn)
+	}
+	w.mutex.Unlock()
+
+	for i, fn := range w.fire {
+		fn()
+		w.fire[i] = nil
+	}
+}
+
+func timer_wheel_run(w *timer_wheel) {
+	start := time.Now()
+	ticker := time.NewTicker(time.Millisecond * TIMER_WHEEL_TICK_MS)
+
+	// catch up if we were descheduled, the wheel never skips a slot
+	for range ticker.C {
+		target := uint64(time.Since(start) / (time.Millisecond * TIMER_WHEEL_TICK_MS))
+		for w.now < target {
+			timer_wheel_tick(w)
+		}
+	}
+}
+
+func timer_wheel_start() {
+	timer_wheel_init(&timers)
+	go timer_wheel_run(&timers)
+}
+
+// fn runs once, no earlier than ms from now, on the wheel goroutine
+func timer_add(ms int64, fn func()) *wheel_timer {
+	t := &wheel_timer{fn: fn}
+
+	timers.mutex.Lock()
+	t.expires = timers.now + uint64((ms+TIMER_WHEEL_TICK_MS-1)/TIMER_WHEEL_TICK_MS) + 1
+	timer_wheel_place(&timers, t)
+	timers.mutex.Unlock()
+	return t
+}
+
+// false if it already fired (or is about to)
+func timer_cancel(t *wheel_timer) bool {
+	if t == nil {
+		return false
+	}
+
+	timers.mutex.Lock()
+	armed := t.armed
+	if armed {
+		timer_wheel_unlink(t)
+	}
+	timers.mutex.Unlock()
+	return armed
+}
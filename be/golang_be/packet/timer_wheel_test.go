@@ -0,0 +1,194 @@
+package main
+
+import (
+	"net"
+	"sync"
+	"testing"
+	"time"
+)
+
+/**********************************************************
+*	Timer wheel tests
+*
+*	cascading runs on a private wheel ticked by hand, the
+*	others on the server's wheel in real time. The nack
+*	test waits out TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST
+*********************************************************/
+
+var timer_wheel_test_once sync.Once
+
+func timer_wheel_test_start() {
+	timer_wheel_test_once.Do(timer_wheel_start)
+}
+
+// timer_add, on w and in ticks
+func wheel_test_add(w *timer_wheel, ticks uint64, fn func()) *wheel_timer {
+	t := &wheel_timer{fn: fn, expires: w.now + ticks}
+	timer_wheel_place(w, t)
+	return t
+}
+
+// every timer fires on the very tick it is due, however far out it was added
+// and however many levels it cascaded through on the way down
+func TestWheelCascade(t *testing.T) {
+	var w timer_wheel
+	timer_wheel_init(&w)
+
+	l1 := uint64(1) << TIMER_WHEEL_L0_BITS
+	l2 := uint64(1) << timer_wheel_level_bits(2)
+	deltas := []uint64{1, 2, l1 - 1, l1, l1 + 1, 3*l1 + 17, l2 - 1, l2, l2 + 1, l2 + 5*l1 + 3}
+
+	// start off a slot boundary, cascades must not depend on where now is
+	for i := 0; i < 77; i++ {
+		timer_wheel_tick(&w)
+	}
+
+	fired := make(map[uint64]uint64)
+	for _, d := range deltas {
+		d := d
+		wheel_test_add(&w, d, func() {
+			if _, ok := fired[d]; ok {
+				t.Errorf("timer %d ticks out fired twice", d)
+			}
+			fired[d] = w.now
+		})
+	}
+
+	start := w.now
+	for w.now < start+deltas[len(deltas)-1]+1 {
+		timer_wheel_tick(&w)
+	}
+
+	for _, d := range deltas {
+		at, ok := fired[d]
+		if !ok {
+			t.Errorf("timer %d ticks out never fired", d)
+			continue
+		}
+		if at != start+d {
+			t.Errorf("timer %d ticks out fired %d ticks in", d, at-start)
+		}
+	}
+}
+
+// a cancelled timer never fires, and cancelling one that already fired says so
+func TestWheelCancelled(t *testing.T) {
+	timer_wheel_test_start()
+
+	fired := make(chan int, 2)
+	cancelled := timer_add(100, func() { fired <- 1 })
+	kept := timer_add(100, func() { fired <- 2 })
+
+	if !timer_cancel(cancelled) {
+		t.Fatal("cancel of an armed timer failed")
+	}
+	if got := <-fired; got != 2 {
+		t.Fatal("cancelled timer fired")
+	}
+	time.Sleep(3 * TIMER_WHEEL_TICK_MS * time.Millisecond)
+	select {
+	case <-fired:
+		t.Fatal("cancelled timer fired late")
+	default:
+	}
+	if timer_cancel(kept) {
+		t.Fatal("cancel of a timer that already fired succeeded")
+	}
+}
+
+// a device that never acks gets nacked to core about 5.05 s in, never before
+// 4.9 s. One that acked (transactions_pop) never does. The timer is armed for
+// TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST plus a tick and timer_add rounds up to
+// the next tick boundary, it lands 5.05 - 5.1 s in, the rest is scheduling
+func TestWheelNackTiming(t *testing.T) {
+	level := CURRENT_LOG_LEVEL
+	CURRENT_LOG_LEVEL = PRINT_CRITICAL // lost packets and disconnects are PRINT_WARN
+	defer func() { CURRENT_LOG_LEVEL = level }()
+
+	timer_wheel_test_start()
+	q := create_ipc_chan()
+	dmq_from_packet_to_core = q
+
+	const clients = 100
+	var css []*Client_state
+	var handlers sync.WaitGroup
+	start := time.Now()
+	for i := 0; i < clients; i++ {
+		conn, peer := net.Pipe()
+		defer peer.Close()
+
+		cs := &Client_state{client_id: uint64(i), conn: conn}
+		cs.done = make(chan struct{})
+		cs.client_event_timer = make(chan bool, 1)
+		init_transaction_accountant(cs)
+		css = append(css, cs)
+
+		// Client_handler's part, the timers only ever wake it
+		handlers.Add(1)
+		go func() {
+			defer handlers.Done()
+			for {
+				select {
+				case <-cs.client_event_timer:
+					transaction_scan_timeout(cs)
+				case <-cs.done:
+					return
+				}
+			}
+		}()
+
+		transactions_append(1, cs)
+		transactions_append(2, cs)
+		if i%2 == 0 {
+			transactions_pop(1, cs)
+			transactions_pop(2, cs)
+		}
+	}
+
+	nacks := make(map[uint64]int)
+	var first, last time.Duration
+	deadline := time.After(TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST*time.Millisecond + 2*time.Second)
+	for len(nacks) < clients/2 || nacks_short(nacks) {
+		select {
+		case m := <-q.q:
+			took := time.Since(start)
+			var ip Ipc_packet
+			ipc_packet_decode(&ip, *m)
+			packet_buf_put(m)
+
+			if took < 4900*time.Millisecond || took > 5200*time.Millisecond {
+				t.Errorf("client %d nacked after %v", ip.ClientId, took)
+			}
+			if ip.ClientId%2 == 0 {
+				t.Errorf("client %d acked its transactions but was nacked", ip.ClientId)
+			}
+			nacks[ip.ClientId]++
+			if first == 0 {
+				first = took
+			}
+			last = took
+		case <-deadline:
+			t.Fatalf("only %d of %d clients nacked", len(nacks), clients/2)
+		}
+	}
+
+	// anything that was going to come has, give a late one a chance anyway
+	time.Sleep(3 * TIMER_WHEEL_TICK_MS * time.Millisecond)
+	if len(q.q) != 0 {
+		t.Errorf("%d nacks after the last expected one", len(q.q))
+	}
+	for _, cs := range css {
+		client_kill(cs)
+	}
+	handlers.Wait()
+	t.Logf("%d clients nacked twice each, first after %v, last after %v", len(nacks), first, last)
+}
+
+func nacks_short(nacks map[uint64]int) bool {
+	for _, n := range nacks {
+		if n < 2 {
+			return true
+		}
+	}
+	return false
+}
@@ -8,52 +8,78 @@ import (
 type map_packet struct {
 	transaction_id uint16
 	timestamp      int64
+	timer          *wheel_timer
+	seq            uint64 // tells a reused transaction_id apart from the one the timer was armed for
 }
 
 func transactions_pop(transaction_id uint16, cs *Client_state) int {
 	cs.m_mutex.Lock()
 	// Check to see if a transaction_id is actually in the LL before
-	_, ok := cs.m[transaction_id]
+	mp, ok := cs.m[transaction_id]
 
 	if !ok {
 		logger(PRINT_FATAL, "Popped a transaction_id %d that was already popped", transaction_id)
 	}
+	timer_cancel(mp.timer)
 	delete(cs.m, transaction_id)
 
 	cs.m_mutex.Unlock()
 	return int(transaction_id)
 }
 
-func transaction_scan_timeout(cs *Client_state) {
+// like transactions_pop, but for ids that came from the device and may not be ours
+func transactions_try_pop(transaction_id uint16, cs *Client_state) bool {
 	cs.m_mutex.Lock()
-	for k := range cs.m {
-		if time_ms_since_timestamp(cs.m[k].timestamp) > TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST {
-			logger(PRINT_WARN, "Lost packet: ", cs.m[k].transaction_id)
-
-			// create nack
-			p := Packet{}
-			p.Consumer_ack_req = 0
-			p.Packet_type = CMD_RESPONSE_PACKET
-			p.Transaction_id = cs.m[k].transaction_id
+	defer cs.m_mutex.Unlock()
 
-			payload := Cmd_resp_payload{}
-			payload.Total_packets = 1
-			payload.Cmd_status = CMD_ACK_TIMED_OUT
-			payload.Resp_payload = make([]byte, CMD_RESPONSE_PAYLOAD_LEN)
-			p.Data = cmd_payload_pack(payload)
+	mp, ok := cs.m[transaction_id]
+	if !ok {
+		return false
+	}
+	timer_cancel(mp.timer)
+	delete(cs.m, transaction_id)
+	return true
+}
 
-			// send it to the client core
-			cs.tcp_to_icp_reader_chan <- p
+// runs on the client's writer. The nacks go out after the lock is dropped,
+// mq_write can block and the tcp reader needs the map to handle acks
+func transaction_scan_timeout(cs *Client_state) {
+	var lost []uint16
 
-			// close this connection
-			logger(PRINT_WARN, "Transaction Accountant triggering TCP disconnect")
-			cs.err_chan_tcp <- true
+	cs.m_mutex.Lock()
+	for k, mp := range cs.m {
+		if time_ms_since_timestamp(mp.timestamp) > TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST {
+			logger(PRINT_WARN, "Lost packet: ", mp.transaction_id)
+			lost = append(lost, mp.transaction_id)
 
 			// pop from map
-			delete(cs.m, cs.m[k].transaction_id)
+			delete(cs.m, k)
 		}
 	}
 	cs.m_mutex.Unlock()
+
+	for _, transaction_id := range lost {
+		// create nack
+		p := Packet{}
+		p.Consumer_ack_req = 0
+		p.Packet_type = CMD_RESPONSE_PACKET
+		p.Transaction_id = transaction_id
+
+		payload := Cmd_resp_payload{}
+		payload.Total_packets = 1
+		payload.Cmd_status = CMD_ACK_TIMED_OUT
+		payload.Resp_payload = make([]byte, CMD_RESPONSE_PAYLOAD_LEN)
+		p.Data = cmd_payload_pack(payload)
+
+		// send it to the client core
+		client_to_core(p, cs)
+	}
+
+	if len(lost) != 0 {
+		// close this connection
+		logger(PRINT_WARN, "Transaction Accountant triggering TCP disconnect")
+		client_kill(cs)
+	}
 }
 
 func transactions_append(transaction_id uint16, cs *Client_state) {
@@ -69,7 +95,37 @@ func transactions_append(transaction_id uint16, cs *Client_state) {
 		logger(PRINT_FATAL, "FATAL ERROR: Outstanding transactions full, unexpected when inserting:", transaction_id)
 	}
 
-	cs.m[transaction_id] = map_packet{transaction_id: transaction_id, timestamp: time_ms_since_epoch()}
+	cs.m_seq++
+	seq := cs.m_seq
+	mp := map_packet{transaction_id: transaction_id, timestamp: time_ms_since_epoch(), seq: seq}
+	mp.timer = timer_add(TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST+TIMER_WHEEL_TICK_MS, func() {
+		transaction_timer_expired(cs, transaction_id, seq)
+	})
+	cs.m[transaction_id] = mp
+	cs.m_mutex.Unlock()
+}
+
+// runs on the timer wheel, must not block. Only wakes the client handler,
+// which does the nack + disconnect in transaction_scan_timeout()
+func transaction_timer_expired(cs *Client_state, transaction_id uint16, seq uint64) {
+	cs.m_mutex.Lock()
+	mp, ok := cs.m[transaction_id]
+	if ok && mp.seq == seq && !cs.timers_stopped {
+		select {
+		case cs.client_event_timer <- true:
+		default:
+		}
+	}
+	cs.m_mutex.Unlock()
+}
+
+// client is going away, after this no timer touches cs
+func transactions_stop_timers(cs *Client_state) {
+	cs.m_mutex.Lock()
+	cs.timers_stopped = true
+	for _, mp := range cs.m {
+		timer_cancel(mp.timer)
+	}
 	cs.m_mutex.Unlock()
 }
 
@@ -0,0 +1 @@
+../packet/ipc_constants.go
\ No newline at end of file
@@ -0,0 +1 @@
+../packet/server_config.go
\ No newline at end of file
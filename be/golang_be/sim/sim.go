@@ -0,0 +1,261 @@
+package main
+
+import (
+	"database/sql"
+	"flag"
+	"fmt"
+	"os"
+	"os/signal"
+	"strconv"
+	"strings"
+	"sync"
+	"time"
+
+	_ "github.com/lib/pq"
+)
+
+/**********************************************************
+*	Device simulator / load generator for the packet server
+*
+*	speaks the scanner side of the binary protocol (HELLO,
+*	LOGIN punches, DEVICE_ACK, multi part CMD_RESP, FOTA
+*	acks) for N devices at once, reports throughput and
+*	p50/p99/p999 latencies:
+*
+*	hello  - HELLO to its SERVER_ACK (attach)
+*	punch  - LOGIN to its SERVER_ACK (packet server, core ipc and
+*	         the db commit, see LOGIN_ACK_AFTER_COMMIT)
+*	db     - LOGIN to the row showing up in timeinfo, only with
+*	         -dsn. Rows are matched to punches in send order, so
+*	         every uid in -uids must be a real employee
+*	cmd    - CMD in to the SERVER_ACK of the last response part
+*	fota   - FOTA packet in to the SERVER_ACK of our FOTA ack
+*
+*	commands and FOTA come from whoever drives core (site, or
+*	core in TEST_MODE), the simulator only answers them
+*
+*	./sim -n 5000 -punch_per_min 2 -link_ms 40 -duration 300
+*********************************************************/
+
+type sim_config struct {
+	addr          string
+	devices       int
+	device_base   uint64
+	fw_version    uint
+	punch_per_min float64
+	uids          []uint32
+	link_ms       int
+	jitter_ms     int
+	cmd_ms        int
+	cmd_parts     int
+	ramp_s        int
+	duration_s    int
+	report_s      int
+	reconnect     bool
+	dsn           string
+	db_poll_ms    int
+}
+
+var sim_cfg sim_config
+var sim_devices int
+var sim_devices_up int64
+
+var sim_hello_ack = sim_hist{name: "hello"}
+var sim_punch_ack = sim_hist{name: "punch"}
+var sim_punch_db = sim_hist{name: "db"}
+var sim_cmd_rtt = sim_hist{name: "cmd"}
+var sim_fota_step = sim_hist{name: "fota"}
+var sim_hists = []*sim_hist{&sim_hello_ack, &sim_punch_ack, &sim_punch_db, &sim_cmd_rtt, &sim_fota_step}
+
+var sim_connects = sim_counter{name: "connects"}
+var sim_connect_errors = sim_counter{name: "connect_err"}
+var sim_reconnects = sim_counter{name: "reconnects"}
+var sim_punches = sim_counter{name: "punches"}
+var sim_acks = sim_counter{name: "acks"}
+var sim_db_rows = sim_counter{name: "db_rows"}
+var sim_cmds = sim_counter{name: "cmds"}
+var sim_fota_acks = sim_counter{name: "fota_acks"}
+var sim_lost = sim_counter{name: "lost"}
+var sim_bad_rx = sim_counter{name: "bad_rx"}
+var sim_counters = []*sim_counter{&sim_connects, &sim_connect_errors, &sim_reconnects, &sim_punches, &sim_acks,
+	&sim_db_rows, &sim_cmds, &sim_fota_acks, &sim_lost, &sim_bad_rx}
+
+// punches waiting for their row, oldest first
+var sim_db_mutex sync.Mutex
+var sim_db_queue []time.Time
+
+// "1,2,10-20"
+func sim_parse_uids(s string) ([]uint32, error) {
+	var uids []uint32
+
+	for _, part := range strings.Split(s, ",") {
+		lo_hi := strings.SplitN(strings.TrimSpace(part), "-", 2)
+		lo, err := strconv.ParseUint(lo_hi[0], 10, 32)
+		if err != nil {
+			return nil, err
+		}
+		hi := lo
+		if len(lo_hi) == 2 {
+			if hi, err = strconv.ParseUint(lo_hi[1], 10, 32); err != nil {
+				return nil, err
+			}
+		}
+		for uid := lo; uid <= hi; uid++ {
+			uids = append(uids, uint32(uid))
+		}
+	}
+
+	if len(uids) == 0 {
+		return nil, fmt.Errorf("no uids in %q", s)
+	}
+	return uids, nil
+}
+
+func sim_db_track(sent time.Time) {
+	if sim_cfg.dsn == "" {
+		return
+	}
+
+	sim_db_mutex.Lock()
+	sim_db_queue = append(sim_db_queue, sent)
+	sim_db_mutex.Unlock()
+}
+
+// rows a punch can be matched to, anything punched from a minute before the sim started on,
+// the partition pruning keeps the count to the current month's partition
+const SIM_DB_WATCH_SLACK = time.Minute
+
+const SIM_DB_COUNT = `SELECT count(*) FROM timeinfo WHERE punched_at >= $1`
+
+// polls the row count, every new row closes the oldest outstanding punch
+func sim_db_watch(db *sql.DB, since time.Time, stop chan bool) {
+	since = since.Add(-SIM_DB_WATCH_SLACK)
+
+	var last int64
+	if err := db.QueryRow(SIM_DB_COUNT, since).Scan(&last); err != nil {
+		logger(PRINT_FATAL, "sim could not count timeinfo", err)
+	}
+
+	ticker := time.NewTicker(time.Duration(sim_cfg.db_poll_ms) * time.Millisecond)
+	defer ticker.Stop()
+
+	for {
+		select {
+		case <-ticker.C:
+		case <-stop:
+			return
+		}
+
+		var rows int64
+		if err := db.QueryRow(SIM_DB_COUNT, since).Scan(&rows); err != nil {
+			logger(PRINT_WARN, "sim could not count timeinfo", err)
+			continue
+		}
+
+		now := time.Now()
+		sim_db_mutex.Lock()
+		for ; last < rows && len(sim_db_queue) != 0; last++ {
+			sim_hist_add(&sim_punch_db, now.Sub(sim_db_queue[0]))
+			sim_db_queue = sim_db_queue[1:]
+			sim_count(&sim_db_rows)
+		}
+		last = rows // rows nobody here sent, don't hand them to later punches
+		sim_db_mutex.Unlock()
+	}
+}
+
+func sim_flags() {
+	var uids string
+
+	flag.StringVar(&sim_cfg.addr, "addr", "127.0.0.1:"+CONN_PORT, "packet server address")
+	flag.IntVar(&sim_cfg.devices, "n", 1000, "number of simulated scanners")
+	flag.Uint64Var(&sim_cfg.device_base, "device_base", 0x5100000000, "device id of the first scanner")
+	flag.UintVar(&sim_cfg.fw_version, "fw", 0xFFFF, "fw version in HELLO, lower than the catalog to get FOTA'd")
+	flag.Float64Var(&sim_cfg.punch_per_min, "punch_per_min", 1, "punches per device per minute (poisson)")
+	flag.StringVar(&uids, "uids", "1", "uids to punch with, e.g. 1,2,10-20")
+	flag.IntVar(&sim_cfg.link_ms, "link_ms", 0, "one way link latency")
+	flag.IntVar(&sim_cfg.jitter_ms, "jitter_ms", 0, "extra random one way latency, 0..jitter_ms")
+	flag.IntVar(&sim_cfg.cmd_ms, "cmd_ms", 20, "time the scanner spends on a command before answering")
+	flag.IntVar(&sim_cfg.cmd_parts, "cmd_parts", 1, "CMD_RESP packets per command")
+	flag.IntVar(&sim_cfg.ramp_s, "ramp", 10, "seconds to spread the initial connects over")
+	flag.IntVar(&sim_cfg.duration_s, "duration", 60, "seconds to run, 0 runs until ctrl-c")
+	flag.IntVar(&sim_cfg.report_s, "report", 5, "seconds between progress lines")
+	flag.BoolVar(&sim_cfg.reconnect, "reconnect", true, "redial when the server drops a scanner")
+	flag.StringVar(&sim_cfg.dsn, "dsn", "", "postgres dsn, enables the punch to db latency")
+	flag.IntVar(&sim_cfg.db_poll_ms, "db_poll_ms", 100, "timeinfo poll period for -dsn, the db latencies are this coarse")
+	flag.Parse()
+
+	var err error
+	sim_cfg.uids, err = sim_parse_uids(uids)
+	if err != nil {
+		fmt.Fprintln(os.Stderr, "bad -uids:", err)
+		os.Exit(2)
+	}
+	if sim_cfg.cmd_parts < 1 || sim_cfg.cmd_parts > 255 {
+		fmt.Fprintln(os.Stderr, "-cmd_parts must be 1..255")
+		os.Exit(2)
+	}
+	if sim_cfg.report_s < 1 {
+		fmt.Fprintln(os.Stderr, "-report must be at least 1")
+		os.Exit(2)
+	}
+	if sim_cfg.db_poll_ms < 1 {
+		fmt.Fprintln(os.Stderr, "-db_poll_ms must be at least 1")
+		os.Exit(2)
+	}
+	sim_devices = sim_cfg.devices
+}
+
+func main() {
+	CURRENT_LOG_LEVEL = PRINT_WARN
+	sim_flags()
+
+	stop := make(chan bool)
+	var wg sync.WaitGroup
+
+	start := time.Now()
+	if sim_cfg.dsn != "" {
+		db, err := sql.Open("postgres", sim_cfg.dsn)
+		if err != nil {
+			logger(PRINT_FATAL, "sim could not open db", err)
+		}
+		defer db.Close()
+		go sim_db_watch(db, start, stop)
+	}
+
+	for i := 0; i < sim_cfg.devices; i++ {
+		delay := time.Duration(int64(i) * int64(sim_cfg.ramp_s) * int64(time.Second) / int64(sim_cfg.devices))
+		wg.Add(1)
+		go func(id uint64) {
+			sim_device_run(id, delay, stop)
+			wg.Done()
+		}(sim_cfg.device_base + uint64(i))
+	}
+
+	interrupt := make(chan os.Signal, 1)
+	signal.Notify(interrupt, os.Interrupt)
+
+	var end <-chan time.Time
+	if sim_cfg.duration_s > 0 {
+		end = time.After(time.Duration(sim_cfg.duration_s) * time.Second)
+	}
+
+	report := time.NewTicker(time.Duration(sim_cfg.report_s) * time.Second)
+	last := start
+	for running := true; running; {
+		select {
+		case now := <-report.C:
+			sim_report_interval(now.Sub(start), now.Sub(last))
+			last = now
+		case <-end:
+			running = false
+		case <-interrupt:
+			running = false
+		}
+	}
+	report.Stop()
+
+	close(stop)
+	wg.Wait()
+	sim_report_final(time.Since(start))
+}
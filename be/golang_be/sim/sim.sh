@@ -0,0 +1,25 @@
+rm constants.go ipc_constants.go crc.go logger.go packet_helper.go server_config.go core_constants.go
+rm sim
+
+ln -s ../packet/constants.go constants.go
+ln -s ../packet/ipc_constants.go ipc_constants.go
+ln -s ../packet/logger.go logger.go
+ln -s ../packet/packet_helper.go packet_helper.go
+ln -s ../packet/server_config.go server_config.go
+ln -s ../packet/crc.go crc.go
+ln -s ../core/core_constants.go core_constants.go
+
+SIM_GO="sim.go sim_device.go sim_stats.go constants.go ipc_constants.go logger.go packet_helper.go server_config.go crc.go core_constants.go"
+
+go build -o sim $SIM_GO
+
+if [ $? != 0 ]; then
+  exit
+fi
+
+if [ ! -z "$1" ]; then
+  if [ "$1" == "-r" ]; then
+    shift
+    ./sim "$@"
+  fi
+fi
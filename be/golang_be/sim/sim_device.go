@@ -0,0 +1,383 @@
+package main
+
+import (
+	"bufio"
+	"encoding/binary"
+	"io"
+	"math/rand"
+	"net"
+	"strconv"
+	"sync/atomic"
+	"time"
+)
+
+/**********************************************************
+*	One simulated scanner
+*
+*	reader  - pulls frames off the socket, stamps them
+*	writer  - puts frames on the socket, paced by the link
+*	device  - everything else (acks, commands, FOTA, punches)
+*
+*	Uplink packets are sent with CONSUMER_ACK_REQUIRED like
+*	the firmware does, the SERVER_ACK closes the latency
+*	sample. Every downlink packet that asks for it gets a
+*	DEVICE_ACK
+*********************************************************/
+
+const SIM_RX_DEPTH = (64)
+const SIM_TX_DEPTH = (64)
+
+type sim_frame struct {
+	at time.Time // when it hit the wire (rx) or when it is due on the wire (tx)
+	b  []byte
+}
+
+// an uplink transaction waiting for its SERVER_ACK
+type sim_pending struct {
+	start time.Time
+	hist  *sim_hist // nil if nobody measures this one
+}
+
+type sim_device struct {
+	id        uint64
+	conn      net.Conn
+	rand      *rand.Rand
+	tid       uint16
+	pending   map[uint16]sim_pending
+	link_due  time.Time // uplink frames never overtake each other
+	fota_data int       // DATA packets since the last FOTA meta packet
+	punches   int
+
+	rx chan sim_frame
+	tx chan sim_frame
+}
+
+// server acks are never parsed by the server itself, so they are not in its table
+func sim_frame_len(t uint8) int {
+	if t == SERVER_ACK_PACKET {
+		return PAYLOAD_OFFSET + SMALL_PAYLOAD_SIZE
+	}
+	return lookup_packet_len(t)
+}
+
+func sim_link_delay(r *rand.Rand) time.Duration {
+	d := time.Duration(sim_cfg.link_ms) * time.Millisecond
+	if sim_cfg.jitter_ms > 0 {
+		d += time.Duration(r.Int63n(int64(sim_cfg.jitter_ms)*int64(time.Millisecond) + 1))
+	}
+	return d
+}
+
+func sim_reader(d *sim_device) {
+	defer close(d.rx)
+
+	r := bufio.NewReaderSize(d.conn, 4*PACKET_LEN_MAX)
+	for {
+		t, err := r.Peek(1)
+		if err != nil {
+			if err != io.EOF {
+				logger(PRINT_DEBUG, "sim device", d.id, "read failed", err)
+			}
+			return
+		}
+
+		l := sim_frame_len(t[0])
+		if l == 0 {
+			logger(PRINT_WARN, "sim device", d.id, "unknown packet type", t[0], "dropping the connection")
+			sim_count(&sim_bad_rx)
+			return
+		}
+
+		b := make([]byte, l)
+		if _, err := io.ReadFull(r, b); err != nil {
+			return
+		}
+		d.rx <- sim_frame{at: time.Now(), b: b}
+	}
+}
+
+func sim_writer(d *sim_device) {
+	for f := range d.tx {
+		if wait := time.Until(f.at); wait > 0 {
+			time.Sleep(wait)
+		}
+
+		if _, err := d.conn.Write(f.b); err != nil {
+			logger(PRINT_DEBUG, "sim device", d.id, "write failed", err)
+			d.conn.Close()
+			// keep draining, the device goroutine owns d.tx
+		}
+	}
+}
+
+func sim_send(d *sim_device, p Packet) {
+	b := make([]byte, PAYLOAD_OFFSET+len(p.Data))
+	packet_encode(b, p)
+	frame_crc_set(b)
+
+	due := time.Now().Add(sim_link_delay(d.rand))
+	if due.Before(d.link_due) {
+		due = d.link_due
+	}
+	d.link_due = due
+	d.tx <- sim_frame{at: due, b: b}
+}
+
+// uplink packet that wants a SERVER_ACK, hist gets the time until that ack
+func sim_send_tracked(d *sim_device, t uint8, data []byte, start time.Time, hist *sim_hist) uint16 {
+	d.tid++
+	tid := d.tid
+	if _, ok := d.pending[tid]; ok {
+		// wrapped around onto one the server never acked
+		sim_count(&sim_lost)
+	}
+	d.pending[tid] = sim_pending{start: start, hist: hist}
+
+	sim_send(d, Packet{Packet_type: t, Transaction_id: tid, Consumer_ack_req: CONSUMER_ACK_REQUIRED, Data: data})
+	return tid
+}
+
+func sim_hello_payload(d *sim_device) []byte {
+	b := make([]byte, MEDIUM_PAYLOAD_SIZE)
+	binary.LittleEndian.PutUint64(b[0:8], d.id)
+	binary.LittleEndian.PutUint16(b[8:10], uint16(sim_cfg.fw_version))
+	b[10] = NOT_BRICKED
+	copy(b[11:MEDIUM_PAYLOAD_SIZE-1], "sim-"+strconv.FormatUint(d.id, 16))
+	return b
+}
+
+func sim_punch(d *sim_device) {
+	b := make([]byte, MEDIUM_PAYLOAD_SIZE)
+	uid := sim_cfg.uids[d.rand.Intn(len(sim_cfg.uids))]
+
+	binary.LittleEndian.PutUint16(b[0:2], uint16(360+d.rand.Intn(15))) // temperature, 36.0 - 37.4
+	b[2] = PARALLAX_SIGN_IN
+	if d.punches%2 == 1 {
+		b[2] = PARALLAX_SIGN_OUT
+	}
+	binary.LittleEndian.PutUint32(b[3:7], uid)
+	copy(b[7:MEDIUM_PAYLOAD_SIZE-1], "sim user")
+	d.punches++
+
+	now := time.Now()
+	sim_send_tracked(d, LOGIN_PACKET, b, now, &sim_punch_ack)
+	sim_db_track(now)
+	sim_count(&sim_punches)
+}
+
+// acks every part, the last one closes the command round trip
+func sim_command(d *sim_device, rx time.Time) {
+	time.Sleep(time.Duration(sim_cfg.cmd_ms) * time.Millisecond) // the scanner doing the work
+
+	for i := 0; i < sim_cfg.cmd_parts; i++ {
+		resp := Cmd_resp_payload{}
+		resp.Cmd_status = CMD_STATUS_GOOD
+		resp.Transaction_id = d.tid + 1
+		resp.Total_packets = uint8(sim_cfg.cmd_parts)
+		resp.Packets_sequence_number = uint8(i)
+		resp.Resp_payload = make([]byte, CMD_RESPONSE_PAYLOAD_LEN)
+
+		var hist *sim_hist
+		if i == sim_cfg.cmd_parts-1 {
+			hist = &sim_cmd_rtt
+		}
+		sim_send_tracked(d, CMD_RESPONSE_PACKET, cmd_payload_pack(resp), rx, hist)
+	}
+	sim_count(&sim_cmds)
+}
+
+func sim_fota_ack(d *sim_device, rx time.Time, t uint8) {
+	b := make([]byte, MEDIUM_PAYLOAD_SIZE)
+	b[0] = t
+	b[1] = FOTA_STATUS_GOOD
+	sim_send_tracked(d, FOTA_ACK_PACKET, b, rx, &sim_fota_step)
+	sim_count(&sim_fota_acks)
+}
+
+func sim_fota(d *sim_device, p Packet, rx time.Time) {
+	fp := fota_packet_unpack(p.Data)
+
+	switch fp.Type {
+	case FOTA_START_PACKET:
+		d.fota_data = 0
+		sim_fota_ack(d, rx, FOTA_START_ACK)
+	case FOTA_META_PACKET:
+		// acked once its data packets are in, see sim_handle()
+		d.fota_data = 0
+	case FOTA_FINAL_PACKET:
+		sim_fota_ack(d, rx, FOTA_FINAL_ACK)
+	case FOTA_FINAL_TEST_ONLY:
+		sim_fota_ack(d, rx, FOTA_FINAL_TEST_ACK)
+	default:
+		logger(PRINT_WARN, "sim device", d.id, "unknown FOTA packet type", fp.Type)
+	}
+}
+
+func sim_handle(d *sim_device, f sim_frame) {
+	var p Packet
+	packet_decode(&p, f.b)
+
+	// same as the firmware's chunker, NAK it and drop it
+	crc_ok := frame_crc_check(f.b)
+	if !crc_ok {
+		logger(PRINT_WARN, "sim device", d.id, "bad crc on packet type", p.Packet_type)
+		sim_count(&sim_bad_rx)
+	}
+
+	if p.Packet_type != SERVER_ACK_PACKET && p.Consumer_ack_req == CONSUMER_ACK_REQUIRED {
+		ack := Packet{Packet_type: DEVICE_ACK_PACKET, Transaction_id: p.Transaction_id, Data: make([]byte, SMALL_PAYLOAD_SIZE)}
+		ack.Data[PAYLOAD_OFFSET_ACK_NAK_REASON] = ACK_GOOD
+		if !crc_ok {
+			ack.Data[PAYLOAD_OFFSET_ACK_NAK_REASON] = NAK_BAD_CRC
+		}
+		sim_send(d, ack)
+	}
+
+	if !crc_ok {
+		return
+	}
+
+	switch p.Packet_type {
+	case SERVER_ACK_PACKET:
+		pend, ok := d.pending[p.Transaction_id]
+		if !ok {
+			sim_count(&sim_bad_rx)
+			return
+		}
+		delete(d.pending, p.Transaction_id)
+		if p.Data[PAYLOAD_OFFSET_ACK_NAK_REASON] != ACK_GOOD {
+			// the server got it corrupted, as good as lost
+			sim_count(&sim_lost)
+			return
+		}
+		if pend.hist != nil {
+			sim_hist_add(pend.hist, time.Since(pend.start))
+		}
+		sim_count(&sim_acks)
+
+	case CMD_PACKET:
+		sim_command(d, f.at)
+
+	case FOTA_PACKET:
+		sim_fota(d, p, f.at)
+
+	case DATA_PACKET:
+		d.fota_data++
+		if d.fota_data == SEGMENTS_PER_META_FOTA_PACKET {
+			sim_fota_ack(d, f.at, FOTA_META_ACK)
+		}
+
+	default:
+		logger(PRINT_WARN, "sim device", d.id, "unexpected packet type", p.Packet_type)
+		sim_count(&sim_bad_rx)
+	}
+}
+
+// anything the server never acked within the packet server's own timeout
+func sim_sweep(d *sim_device) {
+	for tid, pend := range d.pending {
+		if time.Since(pend.start) > time.Millisecond*TCP_PACKET_MS_NO_ACK_CONSIDERED_LOST {
+			delete(d.pending, tid)
+			sim_count(&sim_lost)
+		}
+	}
+}
+
+func sim_punch_interval(d *sim_device) time.Duration {
+	if sim_cfg.punch_per_min <= 0 {
+		return time.Hour * 24 * 365
+	}
+	return time.Duration(d.rand.ExpFloat64() * float64(time.Minute) / sim_cfg.punch_per_min)
+}
+
+// one connection, returns once the server or the run is done with it
+func sim_session(d *sim_device, stop chan bool) {
+	d.pending = make(map[uint16]sim_pending)
+	d.link_due = time.Time{}
+	d.rx = make(chan sim_frame, SIM_RX_DEPTH)
+	d.tx = make(chan sim_frame, SIM_TX_DEPTH)
+
+	go sim_reader(d)
+	go sim_writer(d)
+	defer func() {
+		d.conn.Close()
+		close(d.tx)
+		for range d.rx {
+		}
+	}()
+
+	// no punches until the server knows who we are
+	sim_send_tracked(d, HELLO_WORLD_PACKET, sim_hello_payload(d), time.Now(), &sim_hello_ack)
+	hello_tid := d.tid
+	attached := false
+
+	punch := time.NewTimer(time.Hour)
+	punch.Stop()
+	sweep := time.NewTicker(time.Second)
+	defer punch.Stop()
+	defer sweep.Stop()
+
+	for {
+		select {
+		case f, ok := <-d.rx:
+			if !ok {
+				return
+			}
+			if wait := time.Until(f.at.Add(sim_link_delay(d.rand))); wait > 0 {
+				time.Sleep(wait)
+			}
+			sim_handle(d, f)
+
+			if _, waiting := d.pending[hello_tid]; !attached && !waiting {
+				attached = true
+				atomic.AddInt64(&sim_devices_up, 1)
+				defer atomic.AddInt64(&sim_devices_up, -1)
+				punch.Reset(sim_punch_interval(d))
+			}
+
+		case <-punch.C:
+			sim_punch(d)
+			punch.Reset(sim_punch_interval(d))
+
+		case <-sweep.C:
+			sim_sweep(d)
+
+		case <-stop:
+			return
+		}
+	}
+}
+
+func sim_device_run(id uint64, start_delay time.Duration, stop chan bool) {
+	d := sim_device{id: id, rand: rand.New(rand.NewSource(int64(id)))}
+
+	select {
+	case <-time.After(start_delay):
+	case <-stop:
+		return
+	}
+
+	for {
+		conn, err := net.Dial("tcp", sim_cfg.addr)
+		if err != nil {
+			logger(PRINT_WARN, "sim device", id, "could not connect", err)
+			sim_count(&sim_connect_errors)
+		} else {
+			sim_count(&sim_connects)
+			d.conn = conn
+			sim_session(&d, stop)
+		}
+
+		select {
+		case <-stop:
+			return
+		default:
+		}
+
+		if !sim_cfg.reconnect {
+			return
+		}
+		sim_count(&sim_reconnects)
+		time.Sleep(time.Second + time.Duration(d.rand.Int63n(int64(time.Second))))
+	}
+}
@@ -0,0 +1,140 @@
+package main
+
+import (
+	"fmt"
+	"math/bits"
+	"sync/atomic"
+	"time"
+)
+
+/**********************************************************
+*	Latency histograms for the simulator
+*
+*	log-linear buckets in microseconds, 16 per power of two
+*	(~6% resolution), lock free so every device goroutine
+*	records straight into the shared histogram
+*********************************************************/
+
+const SIM_HIST_SUB_BITS = (4)
+const SIM_HIST_SUB = (1 << SIM_HIST_SUB_BITS)
+const SIM_HIST_BUCKETS = (40 * SIM_HIST_SUB) // up to ~2^40 us, anything above lands in the last bucket
+
+type sim_hist struct {
+	name   string
+	counts [SIM_HIST_BUCKETS]uint64
+	total  uint64
+	max_us uint64
+}
+
+type sim_counter struct {
+	name string
+	n    uint64
+	last uint64 // value at the previous report, only the reporter touches it
+}
+
+func sim_hist_bucket(us uint64) int {
+	if us < SIM_HIST_SUB {
+		return int(us)
+	}
+
+	e := bits.Len64(us) - SIM_HIST_SUB_BITS - 1
+	b := (e+1)*SIM_HIST_SUB + int(us>>uint(e)) - SIM_HIST_SUB
+	if b >= SIM_HIST_BUCKETS {
+		b = SIM_HIST_BUCKETS - 1
+	}
+	return b
+}
+
+// largest value that lands in bucket b
+func sim_hist_bucket_max(b int) uint64 {
+	if b < SIM_HIST_SUB {
+		return uint64(b)
+	}
+
+	e := uint(b/SIM_HIST_SUB - 1)
+	m := uint64(b%SIM_HIST_SUB + SIM_HIST_SUB)
+	return (m+1)<<e - 1
+}
+
+func sim_hist_add(h *sim_hist, d time.Duration) {
+	us := uint64(0)
+	if d > 0 {
+		us = uint64(d / time.Microsecond)
+	}
+
+	atomic.AddUint64(&h.counts[sim_hist_bucket(us)], 1)
+	atomic.AddUint64(&h.total, 1)
+	for {
+		max := atomic.LoadUint64(&h.max_us)
+		if us <= max || atomic.CompareAndSwapUint64(&h.max_us, max, us) {
+			break
+		}
+	}
+}
+
+// q in (0, 1], 0 if nothing was recorded
+func sim_hist_quantile(h *sim_hist, q float64) time.Duration {
+	total := atomic.LoadUint64(&h.total)
+	if total == 0 {
+		return 0
+	}
+
+	rank := uint64(q*float64(total) + 0.5)
+	if rank == 0 {
+		rank = 1
+	}
+
+	seen := uint64(0)
+	for b := range h.counts {
+		seen += atomic.LoadUint64(&h.counts[b])
+		if seen >= rank {
+			us := sim_hist_bucket_max(b)
+			if max := atomic.LoadUint64(&h.max_us); us > max {
+				us = max
+			}
+			return time.Duration(us) * time.Microsecond
+		}
+	}
+	return time.Duration(atomic.LoadUint64(&h.max_us)) * time.Microsecond
+}
+
+func sim_count(c *sim_counter) {
+	atomic.AddUint64(&c.n, 1)
+}
+
+func sim_ms(d time.Duration) string {
+	return fmt.Sprintf("%.2f", float64(d)/float64(time.Millisecond))
+}
+
+func sim_hist_row(h *sim_hist) string {
+	return fmt.Sprintf("%-10s %9d %9s %9s %9s %9s", h.name, atomic.LoadUint64(&h.total),
+		sim_ms(sim_hist_quantile(h, 0.50)), sim_ms(sim_hist_quantile(h, 0.99)), sim_ms(sim_hist_quantile(h, 0.999)),
+		sim_ms(time.Duration(atomic.LoadUint64(&h.max_us))*time.Microsecond))
+}
+
+// one line per interval, rates are per second since the last report
+func sim_report_interval(elapsed time.Duration, interval time.Duration) {
+	line := fmt.Sprintf("t=%-6.0f up %d/%d", elapsed.Seconds(), atomic.LoadInt64(&sim_devices_up), sim_devices)
+	for _, c := range sim_counters {
+		n := atomic.LoadUint64(&c.n)
+		line += fmt.Sprintf(" %s %.1f/s", c.name, float64(n-c.last)/interval.Seconds())
+		c.last = n
+	}
+	line += fmt.Sprintf(" | punch_ack p99 %sms", sim_ms(sim_hist_quantile(&sim_punch_ack, 0.99)))
+	fmt.Println(line)
+}
+
+func sim_report_final(elapsed time.Duration) {
+	fmt.Println()
+	fmt.Printf("%d devices, %.0f s\n", sim_devices, elapsed.Seconds())
+	for _, c := range sim_counters {
+		n := atomic.LoadUint64(&c.n)
+		fmt.Printf("  %-14s %9d  (%.1f/s)\n", c.name, n, float64(n)/elapsed.Seconds())
+	}
+
+	fmt.Println()
+	fmt.Printf("%-10s %9s %9s %9s %9s %9s\n", "latency", "count", "p50 ms", "p99 ms", "p999 ms", "max ms")
+	for _, h := range sim_hists {
+		fmt.Println(sim_hist_row(h))
+	}
+}
@@ -0,0 +1 @@
+../packet/client_core.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/client_helper.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/command_mux.go
\ No newline at end of file
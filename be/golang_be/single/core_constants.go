@@ -0,0 +1 @@
+../core/core_constants.go
\ No newline at end of file
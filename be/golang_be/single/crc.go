@@ -0,0 +1 @@
+../packet/crc.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/daily_hours.go
\ No newline at end of file
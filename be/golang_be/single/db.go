@@ -0,0 +1 @@
+../core/db.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/db_stmt.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/device_stats.go
\ No newline at end of file
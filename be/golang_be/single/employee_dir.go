@@ -0,0 +1 @@
+../core/employee_dir.go
\ No newline at end of file
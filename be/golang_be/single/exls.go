@@ -0,0 +1 @@
+../core/exls.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/export.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/file_constants.go
\ No newline at end of file
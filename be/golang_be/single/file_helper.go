@@ -0,0 +1 @@
+../core/file_helper.go
\ No newline at end of file
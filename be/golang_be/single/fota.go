@@ -0,0 +1 @@
+../core/fota.go
\ No newline at end of file
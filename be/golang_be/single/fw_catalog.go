@@ -0,0 +1 @@
+../core/fw_catalog.go
\ No newline at end of file
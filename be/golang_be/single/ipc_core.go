@@ -0,0 +1 @@
+../packet/ipc_core.go
\ No newline at end of file
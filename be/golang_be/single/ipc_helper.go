@@ -0,0 +1 @@
+../core/ipc_helper.go
\ No newline at end of file
@@ -0,0 +1 @@
+../packet/logger.go
\ No newline at end of file
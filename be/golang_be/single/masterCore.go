@@ -0,0 +1 @@
+../core/masterCore.go
\ No newline at end of file
@@ -0,0 +1 @@
+../packet/packet_helper.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/pay_period.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/punch_ingest.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/report_cache.go
\ No newline at end of file
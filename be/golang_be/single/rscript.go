@@ -0,0 +1 @@
+../core/rscript.go
\ No newline at end of file
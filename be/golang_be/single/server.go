@@ -0,0 +1 @@
+../packet/server.go
\ No newline at end of file
@@ -0,0 +1,27 @@
+package main
+
+import (
+	"math/rand"
+	"time"
+)
+
+/**********************************************************
+*	Packet server and core in one binary
+*
+*	the packet/ and core/ sources (symlinked by single.sh)
+*	without their main()s. packet<->core is a channel each
+*	way (ipc_in_process_init), no kernel queue or socket in
+*	between, whatever IPC_TRANSPORT says. Site and core's
+*	own queues are as they are in core
+*
+*	./single.sh -r
+*********************************************************/
+
+func main() {
+	rand.Seed(time.Now().UnixNano())
+	logger_init("_single") //must be first
+	ipc_in_process_init()
+
+	go packet_run()
+	core_run()
+}
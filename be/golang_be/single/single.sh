@@ -0,0 +1,27 @@
+# packet server and core in one binary, see single.go. Run it from core/ (./static,
+# ./templates, ./log): cd ../core && ../single/single
+
+PACKET_GO="server.go client_core.go tcp_core.go ipc_core.go transaction_accountant.go timer_wheel.go constants.go packet_helper.go server_config.go logger.go ipc_constants.go crc.go ipc_transport.go"
+CORE_GO="masterCore.go exls.go rscript.go site_constants.go client_helper.go fota.go fw_catalog.go device_stats.go punch_ingest.go employee_dir.go pay_period.go daily_hours.go timeinfo_partition.go xl_stream.go export.go report_cache.go db_stmt.go command_mux.go test_fota.go test_routines.go db.go ipc_helper.go core_constants.go file_helper.go file_constants.go site_listner.go site.go site_helper.go"
+
+rm -f $PACKET_GO $CORE_GO
+rm -f single
+
+for f in $PACKET_GO; do
+  ln -s ../packet/$f $f
+done
+for f in $CORE_GO; do
+  ln -s ../core/$f $f
+done
+
+go build -race -o single single.go $PACKET_GO $CORE_GO
+
+if [ $? != 0 ]; then
+  exit
+fi
+
+if [ ! -z "$1" ]; then
+  if [ "$1" == "-r" ]; then
+    cd ../core && ../single/single
+  fi
+fi
@@ -0,0 +1 @@
+../core/site.go
\ No newline at end of file
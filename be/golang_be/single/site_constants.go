@@ -0,0 +1 @@
+../core/site_constants.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/site_helper.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/site_listner.go
\ No newline at end of file
@@ -0,0 +1 @@
+../packet/tcp_core.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/test_fota.go
\ No newline at end of file
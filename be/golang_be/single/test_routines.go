@@ -0,0 +1 @@
+../core/test_routines.go
\ No newline at end of file
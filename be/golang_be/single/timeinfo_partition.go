@@ -0,0 +1 @@
+../core/timeinfo_partition.go
\ No newline at end of file
@@ -0,0 +1 @@
+../packet/timer_wheel.go
\ No newline at end of file
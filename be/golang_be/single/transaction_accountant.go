@@ -0,0 +1 @@
+../packet/transaction_accountant.go
\ No newline at end of file
@@ -0,0 +1 @@
+../core/xl_stream.go
\ No newline at end of file
@@ -1,3 +1,4 @@
 #!/bin/bash
 
 clang-format -style=file main/*.[ch] -i
+clang-format -style=file host/*.[ch] host/include/*.h host/include/*/*.h -i
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdlib.h>
+
+/* FreeRTOS kernel config for the host build (POSIX port), see README.md.
+ * Kept as close to the ESP-IDF defaults the device runs with as the port
+ * allows, the differences are called out below */
+
+#define configUSE_PREEMPTION                    1
+#define configUSE_PORT_OPTIMISED_TASK_SELECTION 0
+#define configUSE_IDLE_HOOK                     1 // sleeps, else every instance burns a core
+#define configUSE_TICK_HOOK                     0
+#define configUSE_DAEMON_TASK_STARTUP_HOOK      0
+
+// the device runs at 100 Hz. The host socket shim polls once per tick, 1 ms keeps
+// that out of the latencies we measure. Everything in main/ is in ms, not raw ticks
+#define configTICK_RATE_HZ ((TickType_t)1000)
+
+#define configMAX_PRIORITIES     (25)
+#define configMINIMAL_STACK_SIZE ((unsigned short)(16 * 1024 / sizeof(StackType_t))) // PTHREAD_STACK_MIN
+#define configMAX_TASK_NAME_LEN  (16)
+#define configUSE_16_BIT_TICKS   0
+#define configIDLE_SHOULD_YIELD  1
+#define configSTACK_DEPTH_TYPE   uint32_t
+
+#define configUSE_MUTEXES               1
+#define configUSE_RECURSIVE_MUTEXES     1
+#define configUSE_COUNTING_SEMAPHORES   1
+#define configUSE_QUEUE_SETS            1
+#define configQUEUE_REGISTRY_SIZE       0
+#define configUSE_TASK_NOTIFICATIONS    1
+#define configUSE_TRACE_FACILITY        0
+#define configUSE_STATS_FORMATTING_FUNCTIONS 0
+#define configGENERATE_RUN_TIME_STATS   0
+#define configUSE_APPLICATION_TASK_TAG  0
+#define configENABLE_BACKWARD_COMPATIBILITY 1 // xQueueHandle, portTICK_RATE_MS
+
+// heap_3, malloc under vTaskSuspendAll
+#define configSUPPORT_DYNAMIC_ALLOCATION 1
+#define configSUPPORT_STATIC_ALLOCATION  0
+#define configTOTAL_HEAP_SIZE            ((size_t)(64 * 1024 * 1024))
+
+// the POSIX port runs tasks on their own pthread stacks, FreeRTOS can't check them
+#define configCHECK_FOR_STACK_OVERFLOW 0
+#define configUSE_MALLOC_FAILED_HOOK   0
+
+// event groups need the timer task for the FromISR calls
+#define configUSE_TIMERS             1
+#define configTIMER_TASK_PRIORITY    (configMAX_PRIORITIES - 1)
+#define configTIMER_QUEUE_LENGTH     (20)
+#define configTIMER_TASK_STACK_DEPTH (configMINIMAL_STACK_SIZE * 2)
+
+#define INCLUDE_vTaskPrioritySet            1
+#define INCLUDE_uxTaskPriorityGet           1
+#define INCLUDE_vTaskDelete                 1
+#define INCLUDE_vTaskSuspend                1 // portMAX_DELAY blocks forever, like on the device
+#define INCLUDE_vTaskDelayUntil             1
+#define INCLUDE_vTaskDelay                  1
+#define INCLUDE_xTaskGetSchedulerState      1
+#define INCLUDE_xTaskGetCurrentTaskHandle   1
+#define INCLUDE_uxTaskGetStackHighWaterMark 1
+#define INCLUDE_xTaskGetIdleTaskHandle      1
+#define INCLUDE_eTaskGetState               1
+#define INCLUDE_xTimerPendFunctionCall      1
+
+// a kernel assert is a firmware bug, same as ASSERT() in main/, let the launcher restart us
+#define configASSERT(x)     \
+    do {                    \
+        if (!(x)) {         \
+            abort();        \
+        }                   \
+    } while (0)
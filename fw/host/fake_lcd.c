@@ -0,0 +1,91 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "lcd.h"
+#include "stats_core.h"
+#include "system_defines.h"
+
+/* lcd.c without the glass. Same queue, same task, whatever would have been
+ * drawn goes to the log instead */
+
+/**********************************************************
+*               LCD CORE GLOBAL VARIABLES
+**********************************************************/
+QueueHandle_t lcdPrintQ;
+
+/**********************************************************
+*              LCD CORE STATIC VARIABLES
+**********************************************************/
+static const char        TAG[] = "LCD_CORE";
+static SemaphoreHandle_t lcd_state_mutex;
+static uint8_t           lcd_state;
+
+void print_lcd_api(uint8_t* string) {
+    if (!string) {
+        ESP_LOGE(TAG, "NULL MSG RXed!");
+        ASSERT(0);
+    }
+
+    lcd_cmd_t cmd;
+    cmd.len = strnlen((char*)string, LCD_MAX_CHAR);
+    memcpy(cmd.msg, string, cmd.len);
+    xQueueSendToBack(lcdPrintQ, &cmd, portMAX_DELAY);
+}
+
+void set_lcd_state(uint8_t state) {
+    ESP_LOGI(TAG, "Updating LCD to... %d", state);
+    if (pdTRUE != xSemaphoreTake(lcd_state_mutex, LCD_MUTEX_WAIT)) {
+        ESP_LOGE(TAG, "FAILED TO GET LCD_MUTEX!");
+        ASSERT(0);
+    }
+
+    lcd_state = state;
+
+    xSemaphoreGive(lcd_state_mutex);
+}
+
+// nothing to draw on
+void lcd_bench(int iterations, uint32_t* full_us, uint32_t* partial_us) {
+    (void)iterations;
+    *full_us    = 0;
+    *partial_us = 0;
+}
+
+static void lcd_core(void* v) {
+    lcd_cmd_t cmd;
+
+    ESP_LOGI(TAG, "Starting LCD core");
+    stats_register_task(STATS_TASK_LCD);
+
+    while (1) {
+        if (xQueueReceive(lcdPrintQ, &cmd, portMAX_DELAY) != pdPASS) {
+            continue;
+        }
+        ESP_LOGI(TAG, "LCD: %.*s", cmd.len, (char*)cmd.msg);
+    }
+}
+
+void lcd_core_spawner() {
+    BaseType_t rc;
+    rc = xTaskCreate(lcd_core,
+                     "lcd_core",
+                     4096,
+                     NULL,
+                     4,
+                     NULL);
+
+    if (rc != pdPASS) {
+        ASSERT(0);
+    }
+}
+
+void lcd_core_init_freertos_objects() {
+    lcd_state_mutex = xSemaphoreCreateMutex();
+    lcdPrintQ       = xQueueCreate(5, sizeof(lcd_cmd_t));
+
+    stats_register_queue(STATS_Q_LCD_PRINT, lcdPrintQ);
+}
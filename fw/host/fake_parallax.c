@@ -0,0 +1,250 @@
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "file_core.h"
+#include "lcd.h"
+#include "parallax.h"
+#include "stats_core.h"
+#include "system_defines.h"
+
+#include "host.h"
+
+/* parallax.c without the sensor. Same queues, same task, same messages to
+ * the LCD. A finger shows up every so often (poisson, --punch-per-min) and
+ * "matches" a random user file_core has, the way the real 1:N compare can
+ * only match someone enrolled. Each user alternates login and logout.
+ * Enrolling and deleting always succeed */
+
+// parallax.c's debounce after a scan
+#define FAKE_DEBOUNCE_MS (250)
+
+/**********************************************************
+*             PARALLAX CORE GLOBAL VARIABLES
+**********************************************************/
+QueueHandle_t parallaxLoginQ; // --> Outgoing (to master) someone logged in
+int           parallaxCoreReady;
+
+/**********************************************************
+*            PARALLAX CORE PRIVATE VARIABLES
+**********************************************************/
+static const char        TAG[] = "PARALLAX_CORE";
+static SemaphoreHandle_t parallaxCommandMutex;
+static SemaphoreHandle_t parallaxIrqStatus;
+static QueueHandle_t     parallaxCommandQ;
+static QueueHandle_t     parallaxCommandQ_res;
+static uint8_t           irqStatus;
+static bool              signed_in[MAX_EMPLOYEE];
+
+/**********************************************************
+*                 FAKE PARALLAX FUNCTIONS
+**********************************************************/
+
+// ticks until the next finger, portMAX_DELAY if nobody punches
+static TickType_t next_punch() {
+    double u;
+
+    if (host_config.punch_per_min <= 0) {
+        return portMAX_DELAY;
+    }
+    u = (esp_random() + 1.0) / 4294967296.0;
+    return pdMS_TO_TICKS((uint32_t)(-log(u) * 60000.0 / host_config.punch_per_min)) + 1;
+}
+
+// a random user file_core knows about, false if there are none
+static bool match_finger_print_to_id(uint16_t* login_id) {
+    uint16_t valid[MAX_EMPLOYEE];
+    int      n = 0;
+    int      i;
+
+    file_core_mutex_take();
+    for (i = 0; i < MAX_EMPLOYEE; i++) {
+        if (file_core_all_users_arr_valid[i]) {
+            valid[n++] = i;
+        }
+    }
+    file_core_mutex_give();
+
+    vTaskDelay(pdMS_TO_TICKS(host_config.scan_ms));
+    if (n == 0) {
+        return false;
+    }
+    *login_id = valid[esp_random() % n];
+    return true;
+}
+
+static void parallax_handle_login() {
+    parallax_login_t login;
+    uint16_t         login_id;
+
+    print_lcd_api((void*)"Place finger  on scanner!");
+
+    stats_inc(STATS_PRINT_SCANS);
+    if (!match_finger_print_to_id(&login_id)) {
+        stats_inc(STATS_PRINT_NO_MATCH);
+        print_lcd_api((void*)"Login failed! - try again");
+        goto end;
+    }
+
+    login.id            = login_id;
+    login.signIn        = !signed_in[login_id];
+    signed_in[login_id] = login.signIn;
+
+    ESP_LOGI(TAG, "User ID: %d logged in", login_id);
+    if (xQueueSend(parallaxLoginQ, &login, 0) != pdPASS) {
+        ASSERT(0);
+    }
+
+end:
+    vTaskDelay(pdMS_TO_TICKS(FAKE_DEBOUNCE_MS));
+}
+
+static void parallax_handle_command() {
+    int                 ret;
+    commandQ_parallax_t commandQ_cmd;
+    BaseType_t          xStatus = xQueueReceive(parallaxCommandQ, &commandQ_cmd, 0);
+    if (xStatus != pdPASS) {
+        ASSERT(0);
+    }
+
+    switch (commandQ_cmd.command) {
+    case PARALLAX_ADD_USER:
+        ESP_LOGI(TAG, "Starting to add user %u", commandQ_cmd.id);
+        print_lcd_api((void*)"Adding user");
+        vTaskDelay(pdMS_TO_TICKS(host_config.enroll_ms));
+        print_lcd_api((uint8_t*)"User added       to device!");
+        ret = ADDED_USER;
+        break;
+    case PARALLAX_DLT_ALL:
+        memset(signed_in, 0, sizeof(signed_in));
+        ret = ACK_SUCCESS;
+        break;
+    case PARALLAX_DLT_SPECIFIC:
+        ESP_LOGI(TAG, "Starting to remove user: %u", commandQ_cmd.id);
+        if (commandQ_cmd.id < MAX_EMPLOYEE) {
+            signed_in[commandQ_cmd.id] = false;
+        }
+        ret = ACK_SUCCESS;
+        break;
+    default:
+        ESP_LOGE(TAG, "Unknown command %u", commandQ_cmd.command);
+        ret = ACK_FAIL;
+        break;
+    }
+    xQueueSend(parallaxCommandQ_res, &ret, 0);
+}
+
+static void parallax_thread(void* ptr) {
+    bool*      console_mode = (bool*)ptr;
+    TickType_t wait;
+    TimeOut_t  timeout;
+
+    if (!*console_mode) {
+        set_irq_state(ENABLE_IRQS);
+    }
+
+    reset_device();
+
+    parallaxCoreReady = 1;
+    stats_register_task(STATS_TASK_PARALLAX);
+
+    wait = next_punch();
+    vTaskSetTimeOutState(&timeout);
+    for (;;) {
+        // commands come in between fingers, the next finger stays on schedule
+        if (xQueuePeek(parallaxCommandQ, &(commandQ_parallax_t){ 0 }, wait) == pdPASS) {
+            xTaskCheckForTimeOut(&timeout, &wait);
+            parallax_handle_command();
+            continue;
+        }
+
+        if (get_irq_state(GET_IRQ_STATE_FROM_TASK) == ENABLE_IRQS) {
+            parallax_handle_login();
+        }
+        wait = next_punch();
+        vTaskSetTimeOutState(&timeout);
+    }
+}
+
+int parallax_thread_gate(commandQ_parallax_t* cmd) {
+    int ret;
+    xSemaphoreTake(parallaxCommandMutex, portMAX_DELAY);
+    xQueueSend(parallaxCommandQ, cmd, 0);                     // Send the command
+    xQueueReceive(parallaxCommandQ_res, &ret, portMAX_DELAY); // Wait for the response
+    xSemaphoreGive(parallaxCommandMutex);
+    return ret;
+}
+
+uint16_t fetchNumberOfUsers() {
+    return 0;
+}
+
+// the module takes a second to come out of reset, parallax.c waits 2
+void reset_device() {
+    vTaskDelay(pdMS_TO_TICKS(2000));
+}
+
+// no buttons to hold down at boot, never console mode
+int check_program_mode() {
+    return 0;
+}
+
+void init_gpio() {
+}
+
+void set_irq_state(uint8_t state) {
+    ESP_LOGI(TAG, "Setting irqStatus to %hhu", state);
+    BaseType_t xStatus = xSemaphoreTake(parallaxIrqStatus, IRQ_TIMEOUT);
+    if (xStatus != pdPASS) {
+        ESP_LOGE(TAG, "Timed out getting mutex!");
+        ASSERT(0);
+    }
+    irqStatus = state;
+    xSemaphoreGive(parallaxIrqStatus);
+}
+
+uint8_t get_irq_state(bool calledFrom) {
+    uint8_t ret;
+
+    (void)calledFrom;
+    BaseType_t xStatus = xSemaphoreTake(parallaxIrqStatus, IRQ_TIMEOUT);
+    if (xStatus != pdPASS) {
+        ESP_LOGE(TAG, "Timed out getting mutex!");
+        ASSERT(0);
+    }
+    ret = irqStatus;
+    xSemaphoreGive(parallaxIrqStatus);
+    return ret;
+}
+
+void parallax_core_init_freertos_objects() {
+    parallaxLoginQ       = xQueueCreate(MAX_OUTSTANDING_LOGINS, sizeof(parallax_login_t));
+    parallaxCommandQ     = xQueueCreate(1, sizeof(commandQ_parallax_t));
+    parallaxCommandQ_res = xQueueCreate(1, sizeof(int32_t));
+    parallaxCommandMutex = xSemaphoreCreateMutex();
+    parallaxIrqStatus    = xSemaphoreCreateCounting(1, 1);
+
+    stats_register_queue(STATS_Q_PARALLAX_LOGIN, parallaxLoginQ);
+}
+
+void parallax_core_spawner(bool console_mode) {
+    BaseType_t rc;
+
+    static bool cm_local;
+    cm_local = console_mode;
+
+    rc = xTaskCreate(parallax_thread,
+                     "parallax_thread",
+                     4096,
+                     &cm_local,
+                     4,
+                     NULL);
+    if (rc != pdPASS) {
+        ASSERT(0);
+    }
+}
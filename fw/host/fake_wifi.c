@@ -0,0 +1,79 @@
+#include <string.h>
+
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "file_core.h"
+#include "state_core.h"
+#include "system_defines.h"
+#include "wifi_core.h"
+
+#include "host.h"
+
+/* wifi_core.c without the radio. The host is always on the network, so
+ * "connecting" is checking the credentials were provisioned, waiting
+ * --wifi-ms and raising the same got-ip event the real one does */
+
+static const char        TAG[] = "WIFI_CORE";
+static SemaphoreHandle_t wifi_state_mutex;
+static uint32_t          wifi_state;
+static char              ssid_name[MAX_SSID_LEN];
+static char              ssid_pw[MAX_PW_LEN];
+
+int wifi_connect() {
+    memset(ssid_name, 0, MAX_SSID_LEN);
+
+    memset(ssid_pw, 0, MAX_PW_LEN);
+
+    int err = file_core_get(NVS_SSID_NAME, ssid_name);
+    if (err != ITEM_GOOD) {
+        ESP_LOGW(TAG, "ssid name not set in nvs, can't connect");
+        return 1;
+    }
+
+    err = file_core_get(NVS_SSID_PW, ssid_pw);
+    if (err != ITEM_GOOD) {
+        ESP_LOGE(TAG, "ssid pw name not set in nvs, can't connect");
+        return 1;
+    }
+
+    ESP_LOGI(TAG, "Connecting to %s...", ssid_name);
+    vTaskDelay(pdMS_TO_TICKS(host_config.wifi_ms));
+    ESP_LOGI(TAG, "Got IP event!");
+
+    set_wifi_state(WIFI_UP);
+    lcd_state_machine_run(EVENT_GOT_IP);
+    return 0;
+}
+
+void wifi_core_init_freertos_objects() {
+    wifi_state_mutex = xSemaphoreCreateMutex();
+}
+
+void set_wifi_state(uint32_t state) {
+    if (pdTRUE != xSemaphoreTake(wifi_state_mutex, WIFI_MUTEX_WAIT)) {
+        ESP_LOGE(TAG, "FAILED TO GET WIFI_STATE_MUTEX!");
+        ASSERT(0);
+    }
+
+    if (state != WIFI_UP && state != WIFI_DOWN) {
+        ESP_LOGE(TAG, "Unknown state set - WIFI state");
+        ASSERT(0);
+    }
+
+    wifi_state = state;
+
+    xSemaphoreGive(wifi_state_mutex);
+}
+
+uint32_t get_wifi_state() {
+    if (pdTRUE != xSemaphoreTake(wifi_state_mutex, WIFI_MUTEX_WAIT)) {
+        ESP_LOGE(TAG, "FAILED TO GET WIFI_STATE_MUTEX!");
+        ASSERT(0);
+    }
+    int ret = wifi_state;
+    xSemaphoreGive(wifi_state_mutex);
+    return ret;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**********************************************************
+*                 HOST BUILD CONFIGURATION
+*        set from the command line, see host_main.c
+**********************************************************/
+typedef struct {
+    const char* dir; // this instance's "flash": nvs/, spiflash/, ota_N
+
+    // fake parallax
+    double   punch_per_min; // poisson, per device
+    uint32_t scan_ms;       // finger on the sensor until it matched
+    uint32_t enroll_ms;     // the three presses of an add user
+
+    // fake wifi
+    uint32_t wifi_ms; // association + dhcp
+
+    // esp_log blocks for as long as the device's console UART takes to send the line, 0 is free
+    uint32_t uart_baud;
+} host_config_t;
+
+extern host_config_t host_config;
+
+/**********************************************************
+*                   HOST BUILD HELPERS
+**********************************************************/
+
+// clock + esp_random() seed, first thing in main()
+void host_esp_init(uint64_t seed);
+
+// libc under vTaskSuspendAll, see host_libc.c. Returns what host_libc_unlock() needs
+bool host_libc_lock(void);
+void host_libc_unlock(bool locked);
+
+// <dir>/<name> into buf, false if it did not fit
+bool host_state_path(char* buf, size_t len, const char* name);
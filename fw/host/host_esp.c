@@ -0,0 +1,192 @@
+#include <errno.h>
+#include <malloc.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_err.h"
+#include "esp_event.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_netif.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+#include "host.h"
+
+/**********************************************************
+*              HOST ESP STATIC VARIABLES
+**********************************************************/
+static struct timespec boot;
+static uint64_t        random_state;
+static size_t          heap_min_free = SIZE_MAX;
+
+/**********************************************************
+*              HOST ESP GLOBAL VARIABLES
+**********************************************************/
+esp_log_level_t host_log_level = ESP_LOG_INFO;
+
+/**********************************************************
+*                 HOST ESP FUNCTIONS
+**********************************************************/
+
+// before anything else, esp_timer_get_time() counts from here
+void host_esp_init(uint64_t seed) {
+    clock_gettime(CLOCK_MONOTONIC, &boot);
+    random_state = seed ^ (uint64_t)boot.tv_nsec ^ ((uint64_t)getpid() << 32);
+    if (random_state == 0) {
+        random_state = 0x9E3779B97F4A7C15ull;
+    }
+}
+
+int64_t esp_timer_get_time(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)(now.tv_sec - boot.tv_sec) * 1000000 + (now.tv_nsec - boot.tv_nsec) / 1000;
+}
+
+uint32_t esp_log_timestamp(void) {
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// formatted on the stack and written with one syscall, no stdio lock to hold. With
+// --uart-baud the caller then waits out the line the way it would on the device's UART,
+// 10 bits a byte
+void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) {
+    char    line[512];
+    va_list ap;
+    int     len;
+
+    (void)level;
+    (void)tag;
+
+    va_start(ap, format);
+    len = vsnprintf(line, sizeof(line), format, ap);
+    va_end(ap);
+
+    if (len < 0) {
+        return;
+    }
+    if (len >= (int)sizeof(line)) {
+        len           = sizeof(line);
+        line[len - 1] = '\n';
+    }
+    while (write(STDOUT_FILENO, line, len) < 0 && errno == EINTR) {
+    }
+
+    if (host_config.uart_baud) {
+        usleep((uint64_t)len * 10 * 1000000 / host_config.uart_baud);
+    }
+}
+
+// xorshift64*, glibc's random() takes a lock
+uint32_t esp_random(void) {
+    uint32_t ret;
+
+    portENTER_CRITICAL(NULL);
+    random_state ^= random_state >> 12;
+    random_state ^= random_state << 25;
+    random_state ^= random_state >> 27;
+    ret = (uint32_t)((random_state * 0x2545F4914F6CDD1Dull) >> 32);
+    portEXIT_CRITICAL(NULL);
+
+    return ret;
+}
+
+void esp_chip_info(esp_chip_info_t* info) {
+    info->revision = 0;
+    info->cores    = 1;
+}
+
+const char* esp_get_idf_version(void) {
+    return "host";
+}
+
+void esp_restart(void) {
+    ESP_LOGW("HOST", "esp_restart(), exiting with %d", HOST_RESTART_EXIT_CODE);
+    host_libc_lock();
+    fflush(stdout);
+    _exit(HOST_RESTART_EXIT_CODE);
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    switch (code) {
+    case ESP_OK:
+        return "ESP_OK";
+    case ESP_FAIL:
+        return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:
+        return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:
+        return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:
+        return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:
+        return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:
+        return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:
+        return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:
+        return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_NVS_NOT_FOUND:
+        return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_TYPE_MISMATCH:
+        return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case ESP_ERR_NVS_INVALID_NAME:
+        return "ESP_ERR_NVS_INVALID_NAME";
+    case ESP_ERR_NVS_INVALID_LENGTH:
+        return "ESP_ERR_NVS_INVALID_LENGTH";
+    default:
+        return "UNKNOWN ERROR";
+    }
+}
+
+// IDF aborts (and reboots) on a failed ESP_ERROR_CHECK
+void host_error_check_failed(esp_err_t rc, const char* file, int line, const char* expression) {
+    ESP_LOGE("HOST", "ESP_ERROR_CHECK failed: esp_err_t 0x%x (%s) at %s:%d, expression: %s",
+             rc, esp_err_to_name(rc), file, line, expression);
+    esp_restart();
+}
+
+/**********************************************************
+*                        HEAP
+**********************************************************/
+size_t heap_caps_get_free_size(uint32_t caps) {
+    bool             locked = host_libc_lock();
+    struct mallinfo2 mi     = mallinfo2();
+    host_libc_unlock(locked);
+
+    (void)caps;
+    if (mi.fordblks < heap_min_free) {
+        heap_min_free = mi.fordblks;
+    }
+    return mi.fordblks;
+}
+
+size_t heap_caps_get_minimum_free_size(uint32_t caps) {
+    heap_caps_get_free_size(caps);
+    return heap_min_free;
+}
+
+size_t heap_caps_get_largest_free_block(uint32_t caps) {
+    return heap_caps_get_free_size(caps);
+}
+
+void heap_caps_print_heap_info(uint32_t caps) {
+    ESP_LOGI("HOST", "heap free %zu, min free %zu", heap_caps_get_free_size(caps), heap_min_free);
+}
+
+/**********************************************************
+*                  NETIF / EVENT LOOP
+**********************************************************/
+esp_err_t esp_netif_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void) {
+    return ESP_OK;
+}
@@ -0,0 +1,324 @@
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_vfs_fat.h"
+
+#include "host.h"
+
+/* FAT mount point, partitions and OTA on top of files in the state dir.
+ * Sizes and offsets are the ones in partitions.csv */
+
+#define HOST_MOUNT_MAX  (16)
+#define HOST_MMAP_SLOTS (2)
+
+/**********************************************************
+*             HOST FLASH STATIC VARIABLES
+**********************************************************/
+static const char TAG[] = "HOST_FLASH";
+
+static char mount_point[HOST_MOUNT_MAX]; // "" while unmounted
+
+static const esp_partition_t partitions[] = {
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_0, 0x110000, 0x100000, "ota_0" },
+    { ESP_PARTITION_TYPE_APP, ESP_PARTITION_SUBTYPE_APP_OTA_1, 0x210000, 0x100000, "ota_1" },
+    { ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, 0x310000, 0xe1000, "storage" },
+};
+
+static const esp_partition_t* boot_partition; // NULL is factory
+
+static struct {
+    const esp_partition_t* partition;
+    uint32_t               offset;
+} ota;
+
+static struct {
+    void*  addr;
+    size_t len;
+} maps[HOST_MMAP_SLOTS];
+
+/**********************************************************
+*                HOST FLASH FUNCTIONS
+**********************************************************/
+
+// "/spiflash/id_3" -> "<dir>/spiflash/id_3", NULL (errno set) if nothing is mounted there
+static const char* fat_path(const char* path, char* buf, size_t len) {
+    size_t n = strlen(mount_point);
+
+    if (strncmp(path, "/spiflash", sizeof("/spiflash") - 1) != 0) {
+        return path; // not the FAT partition, leave it alone
+    }
+    if (n == 0 || strncmp(path, mount_point, n) != 0 || (path[n] != '/' && path[n] != 0)) {
+        errno = ENOENT;
+        return NULL;
+    }
+    if (!host_state_path(buf, len, path + 1)) {
+        errno = ENAMETOOLONG;
+        return NULL;
+    }
+    return buf;
+}
+
+static bool partition_path(char* buf, size_t len, const esp_partition_t* partition) {
+    return host_state_path(buf, len, partition->label);
+}
+
+esp_err_t esp_vfs_fat_spiflash_mount(const char* base_path, const char* partition_label,
+                                     const esp_vfs_fat_mount_config_t* mount_config, wl_handle_t* wl_handle) {
+    char path[256];
+
+    (void)partition_label;
+    (void)mount_config;
+
+    if (mount_point[0] != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (strlen(base_path) >= sizeof(mount_point) || strcmp(base_path, "/spiflash") != 0) {
+        ESP_LOGE(TAG, "only /spiflash can be mounted, not %s", base_path);
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!host_state_path(path, sizeof(path), base_path + 1)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "could not create %s: errno %d", path, errno);
+        return ESP_FAIL;
+    }
+
+    strcpy(mount_point, base_path);
+    *wl_handle = 0;
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_fat_spiflash_unmount(const char* base_path, wl_handle_t wl_handle) {
+    (void)wl_handle;
+
+    if (strcmp(base_path, mount_point) != 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    mount_point[0] = 0;
+    return ESP_OK;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype, const char* label) {
+    size_t i;
+
+    for (i = 0; i < sizeof(partitions) / sizeof(partitions[0]); i++) {
+        const esp_partition_t* p = &partitions[i];
+        if (p->type == type && (subtype == ESP_PARTITION_SUBTYPE_ANY || p->subtype == subtype) &&
+            (!label || strcmp(p->label, label) == 0)) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+// erasing the FAT partition is how file_core formats it
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+    char           path[256];
+    char           file[512];
+    DIR*           dir;
+    struct dirent* e;
+
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (partition->subtype != ESP_PARTITION_SUBTYPE_DATA_FAT) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (!host_state_path(path, sizeof(path), "spiflash")) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    dir = opendir(path);
+    if (!dir) {
+        return errno == ENOENT ? ESP_OK : ESP_FAIL;
+    }
+    while ((e = readdir(dir))) {
+        if (e->d_name[0] == '.') {
+            continue;
+        }
+        snprintf(file, sizeof(file), "%s/%s", path, e->d_name);
+        unlink(file);
+    }
+    closedir(dir);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+    char    path[256];
+    ssize_t n;
+    int     fd;
+
+    if (dst_offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!partition_path(path, sizeof(path), partition)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    fd = open(path, O_WRONLY | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    n = pwrite(fd, src, size, dst_offset);
+    close(fd);
+    return n == (ssize_t)size ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t esp_partition_mmap(const esp_partition_t* partition, size_t offset, size_t size,
+                             spi_flash_mmap_memory_t memory, const void** out_ptr, spi_flash_mmap_handle_t* out_handle) {
+    char     path[256];
+    void*    addr;
+    uint32_t i;
+    int      fd;
+
+    (void)memory;
+    if (offset + size > partition->size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (i = 0; i < HOST_MMAP_SLOTS && maps[i].addr; i++) {
+    }
+    if (i == HOST_MMAP_SLOTS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!partition_path(path, sizeof(path), partition)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+    // reading past the end of the file would SIGBUS, flash is always all there
+    if (ftruncate(fd, partition->size) != 0) {
+        close(fd);
+        return ESP_FAIL;
+    }
+    addr = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, offset);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return ESP_FAIL;
+    }
+
+    maps[i].addr = addr;
+    maps[i].len  = size;
+    *out_ptr     = addr;
+    *out_handle  = i;
+    return ESP_OK;
+}
+
+void spi_flash_munmap(spi_flash_mmap_handle_t handle) {
+    if (handle >= HOST_MMAP_SLOTS || !maps[handle].addr) {
+        return;
+    }
+    munmap(maps[handle].addr, maps[handle].len);
+    maps[handle].addr = NULL;
+}
+
+/**********************************************************
+*                         OTA
+**********************************************************/
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from) {
+    (void)start_from;
+    return boot_partition == &partitions[0] ? &partitions[1] : &partitions[0];
+}
+
+// erases the slot, the image is appended by esp_ota_write()
+esp_err_t esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle) {
+    char path[256];
+
+    (void)image_size;
+    if (!partition_path(path, sizeof(path), partition)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (truncate(path, 0) != 0 && errno != ENOENT) {
+        return ESP_FAIL;
+    }
+
+    ota.partition = partition;
+    ota.offset    = 0;
+    *out_handle   = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size) {
+    esp_err_t err;
+
+    if (handle != 1 || !ota.partition) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    err = esp_partition_write(ota.partition, ota.offset, data, size);
+    if (err == ESP_OK) {
+        ota.offset += size;
+    }
+    return err;
+}
+
+esp_err_t esp_ota_end(esp_ota_handle_t handle) {
+    if (handle != 1 || !ota.partition) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ota.partition = NULL;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_set_boot_partition(const esp_partition_t* partition) {
+    ESP_LOGI(TAG, "boot partition is now %s (not booted on the host)", partition->label);
+    boot_partition = partition;
+    return ESP_OK;
+}
+
+esp_err_t esp_ota_mark_app_valid_cancel_rollback(void) {
+    return ESP_OK;
+}
+
+/**********************************************************
+*            LIBC FILE CALLS, FAT MOUNT POINT
+*   wrapped the same way as host_libc.c, see CMakeLists.txt
+**********************************************************/
+FILE* __real_fopen(const char* path, const char* mode);
+int   __real_remove(const char* path);
+int   __real_access(const char* path, int mode);
+
+FILE* __wrap_fopen(const char* path, const char* mode) {
+    char        buf[256];
+    const char* host = fat_path(path, buf, sizeof(buf));
+    FILE*       ret;
+    bool        locked;
+
+    if (!host) {
+        return NULL;
+    }
+
+    locked = host_libc_lock();
+    ret    = __real_fopen(host, mode);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+int __wrap_remove(const char* path) {
+    char        buf[256];
+    const char* host = fat_path(path, buf, sizeof(buf));
+    if (!host) {
+        return -1;
+    }
+    return __real_remove(host);
+}
+
+int __wrap_access(const char* path, int mode) {
+    char        buf[256];
+    const char* host = fat_path(path, buf, sizeof(buf));
+    if (!host) {
+        return -1;
+    }
+    return __real_access(host, mode);
+}
@@ -0,0 +1,128 @@
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+
+#include "host.h"
+
+/* The POSIX port switches tasks from a signal handler. A task switched out
+ * inside malloc or stdio keeps glibc's lock, the next task to call in blocks
+ * on it in the kernel and, if it has the higher priority, never lets the
+ * owner run again. heap_3 avoids this with vTaskSuspendAll, main/ calls libc
+ * directly, so those calls are wrapped here (-Wl,--wrap, see CMakeLists.txt).
+ * The list in CMakeLists.txt and the __wrap_ functions below go together */
+
+bool host_libc_lock(void) {
+    if (xTaskGetSchedulerState() != taskSCHEDULER_RUNNING) {
+        return false;
+    }
+    vTaskSuspendAll();
+    return true;
+}
+
+void host_libc_unlock(bool locked) {
+    if (locked) {
+        xTaskResumeAll();
+    }
+}
+
+/**********************************************************
+*                        HEAP
+**********************************************************/
+void* __real_malloc(size_t size);
+void* __real_calloc(size_t nmemb, size_t size);
+void* __real_realloc(void* ptr, size_t size);
+void  __real_free(void* ptr);
+
+void* __wrap_malloc(size_t size) {
+    bool  locked = host_libc_lock();
+    void* ret    = __real_malloc(size);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+void* __wrap_calloc(size_t nmemb, size_t size) {
+    bool  locked = host_libc_lock();
+    void* ret    = __real_calloc(nmemb, size);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+void* __wrap_realloc(void* ptr, size_t size) {
+    bool  locked = host_libc_lock();
+    void* ret    = __real_realloc(ptr, size);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+void __wrap_free(void* ptr) {
+    bool locked = host_libc_lock();
+    __real_free(ptr);
+    host_libc_unlock(locked);
+}
+
+/**********************************************************
+*                        STDIO
+*   fopen/remove/access live in host_flash.c, they also
+*   map the FAT mount point
+**********************************************************/
+int    __real_puts(const char* s);
+int    __real_putchar(int c);
+int    __real_fclose(FILE* stream);
+size_t __real_fread(void* ptr, size_t size, size_t nmemb, FILE* stream);
+size_t __real_fwrite(const void* ptr, size_t size, size_t nmemb, FILE* stream);
+char*  __real_fgets(char* s, int size, FILE* stream);
+
+int __wrap_printf(const char* format, ...) {
+    va_list ap;
+    bool    locked = host_libc_lock();
+
+    va_start(ap, format);
+    int ret = vprintf(format, ap); // not wrapped, nothing in main/ calls it
+    va_end(ap);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+int __wrap_puts(const char* s) {
+    bool locked = host_libc_lock();
+    int  ret    = __real_puts(s);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+int __wrap_putchar(int c) {
+    bool locked = host_libc_lock();
+    int  ret    = __real_putchar(c);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+int __wrap_fclose(FILE* stream) {
+    bool locked = host_libc_lock();
+    int  ret    = __real_fclose(stream);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+size_t __wrap_fread(void* ptr, size_t size, size_t nmemb, FILE* stream) {
+    bool   locked = host_libc_lock();
+    size_t ret    = __real_fread(ptr, size, nmemb, stream);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+size_t __wrap_fwrite(const void* ptr, size_t size, size_t nmemb, FILE* stream) {
+    bool   locked = host_libc_lock();
+    size_t ret    = __real_fwrite(ptr, size, nmemb, stream);
+    host_libc_unlock(locked);
+    return ret;
+}
+
+char* __wrap_fgets(char* s, int size, FILE* stream) {
+    bool  locked = host_libc_lock();
+    char* ret    = __real_fgets(s, size, stream);
+    host_libc_unlock(locked);
+    return ret;
+}
@@ -0,0 +1,94 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+
+// the real calls, the header maps the BSD names onto the functions below
+#undef socket
+#undef connect
+#undef recv
+#undef send
+
+// lwIP gives up on a SYN after its retries, about this long
+#define HOST_CONNECT_TIMEOUT_MS (18000)
+
+/**********************************************************
+*                 HOST LWIP FUNCTIONS
+**********************************************************/
+
+// wait one tick, lets every other task run once before we look again
+static void lwip_wait(void) {
+    vTaskDelay(1);
+}
+
+int lwip_socket(int domain, int type, int protocol) {
+    return socket(domain, type | SOCK_NONBLOCK | SOCK_CLOEXEC, protocol);
+}
+
+int lwip_connect(int s, const struct sockaddr* name, socklen_t namelen) {
+    struct pollfd pfd   = { .fd = s, .events = POLLOUT };
+    int64_t       start = esp_timer_get_time();
+    socklen_t     len   = sizeof(int);
+    int           err;
+
+    if (connect(s, name, namelen) == 0) {
+        return 0;
+    }
+    if (errno != EINPROGRESS) {
+        return -1;
+    }
+
+    while (poll(&pfd, 1, 0) < 1) {
+        if (esp_timer_get_time() - start > HOST_CONNECT_TIMEOUT_MS * 1000ll) {
+            errno = ETIMEDOUT;
+            return -1;
+        }
+        lwip_wait();
+    }
+
+    if (getsockopt(s, SOL_SOCKET, SO_ERROR, &err, &len) != 0) {
+        return -1;
+    }
+    if (err != 0) {
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+ssize_t lwip_recv(int s, void* mem, size_t len, int flags) {
+    for (;;) {
+        ssize_t n = recv(s, mem, len, flags | MSG_DONTWAIT);
+        if (n > 0) {
+            return n;
+        }
+        if (n == 0) {
+            // peer closed. The reader loops on 0 byte reads until the writer
+            // notices, on the device every one of those is a trip through the
+            // tcpip thread. Don't let it spin any faster here
+            lwip_wait();
+            return 0;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return -1;
+        }
+        lwip_wait();
+    }
+}
+
+// returns once something went out, the caller loops on short sends
+ssize_t lwip_send(int s, const void* dataptr, size_t size, int flags) {
+    for (;;) {
+        ssize_t n = send(s, dataptr, size, flags | MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (n >= 0) {
+            return n;
+        }
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            return -1;
+        }
+        lwip_wait();
+    }
+}
@@ -0,0 +1,243 @@
+#include <errno.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "bench_core.h"
+#include "console_core.h"
+#include "file_core.h"
+#include "ll.h"
+#include "tcp_core.h"
+
+#include "host.h"
+
+/* ts_fw_host --dir /tmp/fleet/42 --id 42 --ip 127.0.0.1 --port 3333
+ *
+ * One scanner as a linux process. Anything given on the command line is
+ * written to nvs before app_main() runs, the same items a device gets over
+ * the console when it is provisioned. Everything else (users, journal,
+ * FOTA cookie) lives in --dir between restarts */
+
+#define HOST_MAIN_STACK (8192)
+
+void app_main(void);
+
+/**********************************************************
+*                HOST GLOBAL VARIABLES
+**********************************************************/
+host_config_t host_config = {
+    .dir           = ".",
+    .punch_per_min = 1,
+    .scan_ms       = 3000, // parallax.c waits 3s for the 1:N compare
+    .enroll_ms     = 6000,
+    .wifi_ms       = 2000,
+};
+static const char* bench_suite; // --bench, instead of app_main()
+
+/**********************************************************
+*                HOST STATIC VARIABLES
+**********************************************************/
+static const char TAG[] = "HOST_MAIN";
+
+static struct {
+    bool        have_id;
+    uint64_t    id;
+    const char* name;
+    const char* ip;
+    bool        have_port;
+    uint16_t    port;
+    const char* ssid;
+    const char* pw;
+} provision;
+
+static const struct option options[] = {
+    { "dir", required_argument, NULL, 'd' },
+    { "id", required_argument, NULL, 'i' },
+    { "name", required_argument, NULL, 'n' },
+    { "ip", required_argument, NULL, 'a' },
+    { "port", required_argument, NULL, 'p' },
+    { "ssid", required_argument, NULL, 's' },
+    { "pw", required_argument, NULL, 'w' },
+    { "punch-per-min", required_argument, NULL, 'P' },
+    { "scan-ms", required_argument, NULL, 'S' },
+    { "enroll-ms", required_argument, NULL, 'E' },
+    { "wifi-ms", required_argument, NULL, 'W' },
+    { "log", required_argument, NULL, 'l' },
+    { "uart-baud", required_argument, NULL, 'u' },
+    { "bench", required_argument, NULL, 'b' },
+    { "help", no_argument, NULL, 'h' },
+    { 0 },
+};
+
+/**********************************************************
+*                  HOST MAIN FUNCTIONS
+**********************************************************/
+bool host_state_path(char* buf, size_t len, const char* name) {
+    int n = snprintf(buf, len, "%s/%s", host_config.dir, name);
+    return n > 0 && (size_t)n < len;
+}
+
+// main.c calls this when the program mode buttons are held, never on the host
+void console_init() {
+    ESP_LOGW(TAG, "no console on the host build");
+}
+
+void vApplicationIdleHook(void) {
+    // every task is blocked, give the core back to the other instances
+    usleep(15000);
+}
+
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s --dir DIR [--id N] [--name S] [--ip A] [--port N] [--ssid S] [--pw S]\n"
+            "          [--punch-per-min F] [--scan-ms N] [--enroll-ms N] [--wifi-ms N] [--log 0-5]\n"
+            "          [--uart-baud N] [--bench SUITE]\n",
+            prog);
+    exit(2);
+}
+
+static void provision_nvs() {
+    nvs_handle_t handle;
+    uint8_t      bricked;
+
+    ESP_ERROR_CHECK(nvs_flash_init());
+    ESP_ERROR_CHECK(nvs_open("nvs", NVS_READWRITE, &handle));
+
+    if (provision.have_id) {
+        ESP_ERROR_CHECK(nvs_set_u64(handle, "device_id", provision.id));
+    }
+    if (provision.name) {
+        ESP_ERROR_CHECK(nvs_set_str(handle, "device_name", provision.name));
+    }
+    if (provision.ip) {
+        ESP_ERROR_CHECK(nvs_set_str(handle, "ip", provision.ip));
+    }
+    if (provision.have_port) {
+        ESP_ERROR_CHECK(nvs_set_u16(handle, "port", provision.port));
+    }
+    if (provision.ssid) {
+        ESP_ERROR_CHECK(nvs_set_str(handle, "ssid_name", provision.ssid));
+    }
+    if (provision.pw) {
+        ESP_ERROR_CHECK(nvs_set_str(handle, "ssid_pw", provision.pw));
+    }
+
+    // file_core_is_bricked() reads garbage if the key was never written
+    if (nvs_get_u8(handle, "bricked", &bricked) == ESP_ERR_NVS_NOT_FOUND) {
+        ESP_ERROR_CHECK(nvs_set_u8(handle, "bricked", 0));
+    }
+
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+static void main_task(void* arg) {
+    app_main();
+    vTaskDelete(NULL);
+}
+
+// bench_core.c's suites, with only what they need set up, then exit. Compare builds with
+// different TS_HOST_HOT_LOG, --uart-baud 115200 makes LOG_HOT_UART cost what it does on the device
+static void bench_task(void* arg) {
+    int ret;
+
+    ll_init();
+    tcp_core_init_freertos_objects();
+    file_core_init_freertos_objects();
+    file_core_spawner(); // mounts the "FAT", runs ahead of us at its higher priority
+    ret = bench_run(bench_suite);
+
+    host_libc_lock();
+    fflush(stdout);
+    _exit(ret ? 2 : 0);
+}
+
+int main(int argc, char** argv) {
+    char name[32];
+    int  opt;
+
+    while ((opt = getopt_long(argc, argv, "h", options, NULL)) != -1) {
+        switch (opt) {
+        case 'd':
+            host_config.dir = optarg;
+            break;
+        case 'i':
+            provision.have_id = true;
+            provision.id      = strtoull(optarg, NULL, 0);
+            break;
+        case 'n':
+            provision.name = optarg;
+            break;
+        case 'a':
+            provision.ip = optarg;
+            break;
+        case 'p':
+            provision.have_port = true;
+            provision.port      = (uint16_t)strtoul(optarg, NULL, 0);
+            break;
+        case 's':
+            provision.ssid = optarg;
+            break;
+        case 'w':
+            provision.pw = optarg;
+            break;
+        case 'P':
+            host_config.punch_per_min = strtod(optarg, NULL);
+            break;
+        case 'S':
+            host_config.scan_ms = strtoul(optarg, NULL, 0);
+            break;
+        case 'E':
+            host_config.enroll_ms = strtoul(optarg, NULL, 0);
+            break;
+        case 'W':
+            host_config.wifi_ms = strtoul(optarg, NULL, 0);
+            break;
+        case 'l':
+            host_log_level = (esp_log_level_t)atoi(optarg);
+            break;
+        case 'u':
+            host_config.uart_baud = strtoul(optarg, NULL, 0);
+            break;
+        case 'b':
+            bench_suite = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+    }
+
+    if (mkdir(host_config.dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "could not create %s: %s\n", host_config.dir, strerror(errno));
+        return 1;
+    }
+    if (provision.have_id && !provision.name) {
+        snprintf(name, sizeof(name), "host-%llx", (unsigned long long)provision.id);
+        provision.name = name;
+    }
+
+    host_esp_init(provision.id);
+    setvbuf(stdout, NULL, _IOLBF, 0);
+    provision_nvs();
+
+    if (xTaskCreate(bench_suite ? bench_task : main_task, "main", HOST_MAIN_STACK, NULL, 1, NULL) != pdPASS) {
+        fprintf(stderr, "could not create the main task\n");
+        return 1;
+    }
+    vTaskStartScheduler();
+
+    // only if the scheduler could not start
+    return 1;
+}
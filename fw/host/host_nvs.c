@@ -0,0 +1,243 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include "host.h"
+
+/* <dir>/nvs/<namespace>/<key>, one byte of type then the value. Typed like
+ * the real thing, reading a u8 key as a u16 is a ESP_ERR_NVS_TYPE_MISMATCH.
+ * Sets land on disk right away (write + rename), nvs_commit() has nothing to do */
+
+#define NVS_MAX_NAMESPACES (8)
+#define NVS_KEY_NAME_MAX   (15) // NVS_KEY_NAME_MAX_SIZE - 1
+#define NVS_STR_MAX        (4000)
+
+typedef enum {
+    NVS_TYPE_U8  = 0x01,
+    NVS_TYPE_U16 = 0x02,
+    NVS_TYPE_U32 = 0x04,
+    NVS_TYPE_U64 = 0x08,
+    NVS_TYPE_STR = 0x21,
+} nvs_type_e;
+
+/**********************************************************
+*              HOST NVS STATIC VARIABLES
+**********************************************************/
+static const char TAG[] = "HOST_NVS";
+static char       namespaces[NVS_MAX_NAMESPACES][NVS_KEY_NAME_MAX + 1];
+
+/**********************************************************
+*                 HOST NVS FUNCTIONS
+**********************************************************/
+static esp_err_t key_path(char* buf, size_t len, nvs_handle_t handle, const char* key) {
+    char name[sizeof("nvs/") + 2 * (NVS_KEY_NAME_MAX + 1)];
+
+    if (handle == 0 || handle > NVS_MAX_NAMESPACES || namespaces[handle - 1][0] == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!key || strlen(key) == 0 || strlen(key) > NVS_KEY_NAME_MAX || strchr(key, '/')) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+
+    snprintf(name, sizeof(name), "nvs/%s/%s", namespaces[handle - 1], key);
+    return host_state_path(buf, len, name) ? ESP_OK : ESP_ERR_INVALID_SIZE;
+}
+
+static esp_err_t nvs_write(nvs_handle_t handle, const char* key, nvs_type_e type, const void* value, size_t len) {
+    char      path[256];
+    char      tmp[sizeof(path) + 4];
+    uint8_t   t = type;
+    esp_err_t err;
+    int       fd;
+
+    err = key_path(path, sizeof(path), handle, key);
+    if (err != ESP_OK) {
+        return err;
+    }
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        ESP_LOGE(TAG, "could not open %s: errno %d", tmp, errno);
+        return ESP_FAIL;
+    }
+    if (write(fd, &t, 1) != 1 || write(fd, value, len) != (ssize_t)len) {
+        ESP_LOGE(TAG, "could not write %s: errno %d", tmp, errno);
+        close(fd);
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+    close(fd);
+
+    if (rename(tmp, path) != 0) {
+        ESP_LOGE(TAG, "could not rename %s: errno %d", tmp, errno);
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+// *len is the room in value on the way in, the stored length on the way out
+static esp_err_t nvs_read(nvs_handle_t handle, const char* key, nvs_type_e type, void* value, size_t* len) {
+    char      path[256];
+    uint8_t   buf[1 + NVS_STR_MAX];
+    esp_err_t err;
+    ssize_t   n;
+    int       fd;
+
+    err = key_path(path, sizeof(path), handle, key);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return errno == ENOENT ? ESP_ERR_NVS_NOT_FOUND : ESP_FAIL;
+    }
+    n = read(fd, buf, sizeof(buf));
+    close(fd);
+
+    if (n < 1) {
+        return ESP_FAIL;
+    }
+    if (buf[0] != type) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+
+    n--;
+    if (value) {
+        if ((size_t)n > *len) {
+            return ESP_ERR_NVS_INVALID_LENGTH;
+        }
+        memcpy(value, buf + 1, n);
+    }
+    *len = n;
+    return ESP_OK;
+}
+
+static esp_err_t nvs_read_int(nvs_handle_t handle, const char* key, nvs_type_e type, void* value, size_t size) {
+    size_t    len = size;
+    esp_err_t err = nvs_read(handle, key, type, value, &len);
+    if (err == ESP_OK && len != size) {
+        return ESP_ERR_NVS_TYPE_MISMATCH;
+    }
+    return err;
+}
+
+esp_err_t nvs_flash_init(void) {
+    char path[256];
+
+    if (!host_state_path(path, sizeof(path), "nvs")) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "could not create %s: errno %d", path, errno);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char* name, nvs_open_mode_t open_mode, nvs_handle_t* out_handle) {
+    char     path[256];
+    char     dir[sizeof("nvs/") + NVS_KEY_NAME_MAX + 1];
+    uint32_t i;
+
+    (void)open_mode;
+    if (!name || strlen(name) == 0 || strlen(name) > NVS_KEY_NAME_MAX || strchr(name, '/')) {
+        return ESP_ERR_NVS_INVALID_NAME;
+    }
+
+    snprintf(dir, sizeof(dir), "nvs/%s", name);
+    if (!host_state_path(path, sizeof(path), dir)) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (mkdir(path, 0755) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "could not create %s: errno %d", path, errno);
+        return ESP_FAIL;
+    }
+
+    // handles are per namespace, they stay valid after nvs_close()
+    for (i = 0; i < NVS_MAX_NAMESPACES; i++) {
+        if (namespaces[i][0] == 0) {
+            strcpy(namespaces[i], name);
+        }
+        if (strcmp(namespaces[i], name) == 0) {
+            *out_handle = i + 1;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle) {
+    (void)handle;
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle) {
+    (void)handle;
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char* key) {
+    char      path[256];
+    esp_err_t err = key_path(path, sizeof(path), handle, key);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (unlink(path) != 0) {
+        return errno == ENOENT ? ESP_ERR_NVS_NOT_FOUND : ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t handle, const char* key, uint8_t value) {
+    return nvs_write(handle, key, NVS_TYPE_U8, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u16(nvs_handle_t handle, const char* key, uint16_t value) {
+    return nvs_write(handle, key, NVS_TYPE_U16, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char* key, uint32_t value) {
+    return nvs_write(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u64(nvs_handle_t handle, const char* key, uint64_t value) {
+    return nvs_write(handle, key, NVS_TYPE_U64, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char* key, const char* value) {
+    size_t len = strlen(value) + 1;
+    if (len > NVS_STR_MAX) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    return nvs_write(handle, key, NVS_TYPE_STR, value, len);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t handle, const char* key, uint8_t* out_value) {
+    return nvs_read_int(handle, key, NVS_TYPE_U8, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u16(nvs_handle_t handle, const char* key, uint16_t* out_value) {
+    return nvs_read_int(handle, key, NVS_TYPE_U16, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char* key, uint32_t* out_value) {
+    return nvs_read_int(handle, key, NVS_TYPE_U32, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t handle, const char* key, uint64_t* out_value) {
+    return nvs_read_int(handle, key, NVS_TYPE_U64, out_value, sizeof(*out_value));
+}
+
+// out_value == NULL asks for the length, NUL included
+esp_err_t nvs_get_str(nvs_handle_t handle, const char* key, char* out_value, size_t* length) {
+    return nvs_read(handle, key, NVS_TYPE_STR, out_value, length);
+}
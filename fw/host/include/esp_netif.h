@@ -0,0 +1,8 @@
+#pragma once
+
+#include "esp_err.h"
+
+// the host's own stack does the networking, nothing to bring up
+typedef struct esp_netif_obj esp_netif_t;
+
+esp_err_t esp_netif_init(void);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_partition.h"
+
+#define OTA_SIZE_UNKNOWN (0xffffffff)
+
+typedef uint32_t esp_ota_handle_t;
+
+/* The image lands in <state dir>/ota_N. Nothing boots it, after the FOTA reboot
+ * the instance comes back up on the same binary (and reports the same
+ * FW_VERSION), so a FOTA_FINAL_TEST_ONLY run is the one to measure with */
+const esp_partition_t* esp_ota_get_next_update_partition(const esp_partition_t* start_from);
+esp_err_t              esp_ota_begin(const esp_partition_t* partition, size_t image_size, esp_ota_handle_t* out_handle);
+esp_err_t              esp_ota_write(esp_ota_handle_t handle, const void* data, size_t size);
+esp_err_t              esp_ota_end(esp_ota_handle_t handle);
+esp_err_t              esp_ota_set_boot_partition(const esp_partition_t* partition);
+esp_err_t              esp_ota_mark_app_valid_cancel_rollback(void);
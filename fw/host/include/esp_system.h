@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "esp_timer.h" // older IDFs had esp_timer_get_time here, main/ still counts on it
+
+// the process exits with HOST_RESTART_EXIT_CODE, run_fleet.sh boots it again
+#define HOST_RESTART_EXIT_CODE (3)
+
+void     esp_restart(void) __attribute__((noreturn));
+uint32_t esp_random(void);
+
+// what bench_core.c prints in BENCH_INFO
+typedef struct {
+    int     revision;
+    uint8_t cores;
+} esp_chip_info_t;
+
+void        esp_chip_info(esp_chip_info_t* info);
+const char* esp_get_idf_version(void);
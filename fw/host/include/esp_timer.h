@@ -0,0 +1,6 @@
+#pragma once
+
+#include <stdint.h>
+
+// us since the process started, like boot on the device
+int64_t esp_timer_get_time(void);
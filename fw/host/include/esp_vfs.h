@@ -0,0 +1,7 @@
+#pragma once
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "esp_err.h"
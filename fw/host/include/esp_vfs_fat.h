@@ -0,0 +1,25 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "esp_err.h"
+#include "esp_log.h" // IDF's pulls it in, file_core.c counts on that
+#include "esp_partition.h"
+#include "sdkconfig.h"
+
+/* The FAT partition is a directory, <state dir>/spiflash. main/ opens files by
+ * their device path ("/spiflash/id_3"), host_flash.c rewrites the prefix */
+typedef int wl_handle_t;
+
+#define WL_INVALID_HANDLE (-1)
+
+typedef struct {
+    bool   format_if_mount_failed;
+    int    max_files;
+    size_t allocation_unit_size;
+} esp_vfs_fat_mount_config_t;
+
+esp_err_t esp_vfs_fat_spiflash_mount(const char* base_path, const char* partition_label,
+                                     const esp_vfs_fat_mount_config_t* mount_config, wl_handle_t* wl_handle);
+esp_err_t esp_vfs_fat_spiflash_unmount(const char* base_path, wl_handle_t wl_handle);
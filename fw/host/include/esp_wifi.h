@@ -0,0 +1,5 @@
+#pragma once
+
+// wifi is faked in fake_wifi.c, see wifi_core.h for what main/ uses
+#include "esp_err.h"
+#include "esp_netif.h"
@@ -0,0 +1,38 @@
+#pragma once
+
+/* ESP-IDF's FreeRTOS is a fork of the kernel, main/ is written against its
+ * headers. This maps them onto the stock kernel running on the POSIX port.
+ * IDF's headers pull each other in, so main/ uses semaphores and queues after
+ * only including task.h. Do the same here, assert() included */
+#include <assert.h>
+
+#include <FreeRTOS.h>
+
+#include <event_groups.h>
+#include <queue.h>
+#include <semphr.h>
+#include <task.h>
+
+/**********************************************************
+*                 IDF ONLY KERNEL API
+**********************************************************/
+
+// IDF is SMP, its critical sections take a spinlock. One core here, the kernel's
+// critical section (signals masked) is all there is
+typedef int portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED (0)
+
+#undef portENTER_CRITICAL
+#undef portEXIT_CRITICAL
+#define portENTER_CRITICAL(mux) vPortEnterCritical()
+#define portEXIT_CRITICAL(mux)  vPortExitCritical()
+
+// IDF takes the stack depth in bytes, the kernel in StackType_t words (8 bytes here).
+// Passing the byte count straight through gives every task 8x its device stack,
+// which glibc's printf needs anyway
+#define HOST_STACK_DEPTH(depth) ((depth) < configMINIMAL_STACK_SIZE ? configMINIMAL_STACK_SIZE : (depth))
+#define xTaskCreate(fn, name, depth, arg, prio, handle) \
+    xTaskCreate(fn, name, HOST_STACK_DEPTH(depth), arg, prio, handle)
+
+#define IRAM_ATTR
+#define DRAM_ATTR
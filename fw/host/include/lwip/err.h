@@ -0,0 +1,3 @@
+#pragma once
+
+typedef signed char err_t;
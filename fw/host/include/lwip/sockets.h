@@ -0,0 +1,28 @@
+#pragma once
+
+/* lwIP's socket API on top of the host's. Like lwIP's own header, the BSD
+ * names are macros onto lwip_*(), so main/ compiles unchanged.
+ *
+ * The POSIX port runs one task at a time, a task blocked in a syscall holds
+ * up every other task until the next tick. The lwip_*() calls never block in
+ * the kernel: they try the non blocking socket and vTaskDelay(1) while it
+ * would block, roughly what the device does waiting on the tcpip thread */
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+int     lwip_socket(int domain, int type, int protocol);
+int     lwip_connect(int s, const struct sockaddr* name, socklen_t namelen);
+ssize_t lwip_recv(int s, void* mem, size_t len, int flags);
+ssize_t lwip_send(int s, const void* dataptr, size_t size, int flags);
+
+#define socket(domain, type, protocol)  lwip_socket(domain, type, protocol)
+#define connect(s, name, namelen)       lwip_connect(s, name, namelen)
+#define recv(s, mem, len, flags)        lwip_recv(s, mem, len, flags)
+#define send(s, dataptr, size, flags)   lwip_send(s, dataptr, size, flags)
+
+#define inet_ntoa_r(addr, buf, buflen) inet_ntop(AF_INET, &(addr), buf, buflen)
@@ -0,0 +1,4 @@
+#pragma once
+
+/* the handful of sdkconfig values main/ reads, as menuconfig has them for the device */
+#define CONFIG_WL_SECTOR_SIZE (4096)
@@ -0,0 +1,213 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "lcd_fb.h"
+
+/* lcd_fb.c against a recording fake of the i2c bus. Every callback is one bus
+ * transaction (see lcd_bus_write in lcd.c), the fake keeps them in order and
+ * plays them onto a 2x16 "glass" the way the controller's DDRAM would, so a
+ * test can check both what went over the bus and what ended up on the screen */
+
+#define BUS_MAX (64)
+
+typedef struct {
+    int     instruction; // set-DDRAM or data
+    uint8_t addr;        // where the transaction started writing
+    uint8_t bytes[LCD_FB_COLS];
+    size_t  len;
+} bus_txn_t;
+
+static bus_txn_t bus[BUS_MAX];
+static int       bus_len;
+static uint8_t   ddram_addr;
+static char      glass[LCD_FB_LINES][LCD_FB_COLS];
+static int       failures;
+
+#define CHECK(cond, ...)                                         \
+    do {                                                         \
+        if (!(cond)) {                                           \
+            printf("%s:%d: %s: ", __FILE__, __LINE__, __func__); \
+            printf(__VA_ARGS__);                                 \
+            printf("\n");                                        \
+            failures++;                                          \
+        }                                                        \
+    } while (0)
+
+/**********************************************************
+*                  FAKE I2C BUS
+**********************************************************/
+
+static void fake_instruction(uint8_t instruction) {
+    bus_txn_t* t = &bus[bus_len++];
+
+    t->instruction = 1;
+    t->addr        = instruction & ~LCD_FB_SET_DDRAM;
+    t->len         = 0;
+    ddram_addr     = t->addr;
+}
+
+static void fake_data(const uint8_t* data, size_t len) {
+    bus_txn_t* t = &bus[bus_len++];
+    size_t     i;
+
+    t->instruction = 0;
+    t->addr        = ddram_addr;
+    t->len         = len;
+    memcpy(t->bytes, data, len);
+
+    // the controller auto-increments, a run never crosses into the other line
+    for (i = 0; i < len; i++) {
+        glass[ddram_addr >= LCD_FB_LINE_ADDR(1)][ddram_addr & 0x3F] = data[i];
+        ddram_addr++;
+    }
+}
+
+static void bus_reset(void) {
+    bus_len = 0;
+}
+
+static void setup(lcd_fb_t* fb) {
+    memset(glass, LCD_FB_BLANK, sizeof(glass));
+    lcd_fb_init(fb, fake_instruction, fake_data);
+    bus_reset();
+}
+
+static int draw(lcd_fb_t* fb, const char* msg) {
+    bus_reset();
+    return lcd_fb_draw(fb, (const uint8_t*)msg, strlen(msg) + 1);
+}
+
+// msg as it should look on the glass, blank padded
+static int glass_shows(const char* msg) {
+    char   want[LCD_FB_LINES][LCD_FB_COLS];
+    size_t len = strlen(msg);
+
+    memset(want, LCD_FB_BLANK, sizeof(want));
+    memcpy(want, msg, len < sizeof(want) ? len : sizeof(want));
+    return memcmp(glass, want, sizeof(want)) == 0;
+}
+
+// transaction n is a set-DDRAM to addr followed by a data write of len bytes
+static int bus_run(int n, uint8_t addr, size_t len) {
+    return bus_len > n + 1 && bus[n].instruction && bus[n].addr == addr && !bus[n + 1].instruction &&
+           bus[n + 1].addr == addr && bus[n + 1].len == len;
+}
+
+/**********************************************************
+*                     TESTS
+**********************************************************/
+
+static void test_first_draw(void) {
+    lcd_fb_t fb;
+    int      n;
+
+    setup(&fb);
+    n = draw(&fb, "Booting...");
+    CHECK(n == 2 && bus_len == 2, "%d transactions (%d on the bus), want 2", n, bus_len);
+    CHECK(bus_run(0, 0x00, 10), "not one run of 10 at 0x00");
+    CHECK(glass_shows("Booting..."), "glass: %.32s", (char*)glass);
+}
+
+static void test_redraw_same(void) {
+    lcd_fb_t fb;
+    int      n;
+
+    setup(&fb);
+    draw(&fb, "  ...ready!...  <-out      in->");
+    n = draw(&fb, "  ...ready!...  <-out      in->");
+    CHECK(n == 0 && bus_len == 0, "unchanged redraw took %d transactions", n);
+}
+
+// dirty cells LCD_FB_MERGE_GAP apart go out as one run, one more and they split
+static void test_merge_gap(void) {
+    lcd_fb_t fb;
+    char     msg[LCD_FB_COLS + 1];
+    int      n;
+
+    setup(&fb);
+    memset(msg, LCD_FB_BLANK, LCD_FB_COLS);
+    msg[LCD_FB_COLS]          = '\0';
+    msg[0]                    = 'a';
+    msg[LCD_FB_MERGE_GAP + 1] = 'b';
+    n                         = draw(&fb, msg);
+    CHECK(n == 2, "gap of %d: %d transactions, want 2", LCD_FB_MERGE_GAP, n);
+    CHECK(bus_run(0, 0x00, LCD_FB_MERGE_GAP + 2), "gap of %d: not one merged run", LCD_FB_MERGE_GAP);
+    CHECK(glass_shows(msg), "glass: %.32s", (char*)glass);
+
+    setup(&fb);
+    memset(msg, LCD_FB_BLANK, LCD_FB_COLS);
+    msg[0]                    = 'a';
+    msg[LCD_FB_MERGE_GAP + 2] = 'b';
+    n                         = draw(&fb, msg);
+    CHECK(n == 4, "gap of %d: %d transactions, want 4", LCD_FB_MERGE_GAP + 1, n);
+    CHECK(bus_run(0, 0x00, 1) && bus_run(2, LCD_FB_MERGE_GAP + 2, 1), "gap of %d: runs not split",
+          LCD_FB_MERGE_GAP + 1);
+    CHECK(glass_shows(msg), "glass: %.32s", (char*)glass);
+}
+
+// only the second line changes, the run is addressed there
+static void test_second_line(void) {
+    lcd_fb_t fb;
+    int      n;
+
+    setup(&fb);
+    draw(&fb, "Welcome:        Bob");
+    n = draw(&fb, "Welcome:        Rob");
+    CHECK(n == 2, "%d transactions, want 2", n);
+    CHECK(bus_run(0, LCD_FB_LINE_ADDR(1), 1), "not one run of 1 at 0x40");
+    CHECK(glass_shows("Welcome:        Rob"), "glass: %.32s", (char*)glass);
+}
+
+// a shorter message blanks what the longer one left behind
+static void test_shorter_blanks(void) {
+    lcd_fb_t fb;
+    int      n;
+
+    setup(&fb);
+    draw(&fb, "Try Again In 2  Minutes. Thanks!");
+    n = draw(&fb, "Try Again");
+    CHECK(n == 4, "%d transactions, want 4", n);
+    // "In 2" is 10..13, the blanks around it were blank already
+    CHECK(bus_run(0, 10, 4) && bus_run(2, LCD_FB_LINE_ADDR(1), LCD_FB_COLS), "wrong runs");
+    CHECK(glass_shows("Try Again"), "glass: %.32s", (char*)glass);
+}
+
+// after invalidate every cell is rewritten, one run per line
+static void test_invalidate(void) {
+    lcd_fb_t fb;
+    int      n;
+
+    setup(&fb);
+    draw(&fb, "Goodbye:");
+    lcd_fb_invalidate(&fb);
+    n = draw(&fb, "Goodbye:");
+    CHECK(n == 4, "%d transactions, want 4", n);
+    CHECK(bus_run(0, 0x00, LCD_FB_COLS) && bus_run(2, LCD_FB_LINE_ADDR(1), LCD_FB_COLS), "wrong runs");
+    CHECK(glass_shows("Goodbye:"), "glass: %.32s", (char*)glass);
+}
+
+// anything past the glass is dropped, not wrapped
+static void test_too_long(void) {
+    lcd_fb_t fb;
+
+    setup(&fb);
+    draw(&fb, "0123456789abcdefghijklmnopqrstuvEXTRA");
+    CHECK(glass_shows("0123456789abcdefghijklmnopqrstuv"), "glass: %.32s", (char*)glass);
+}
+
+int main(void) {
+    test_first_draw();
+    test_redraw_same();
+    test_merge_gap();
+    test_second_line();
+    test_shorter_blanks();
+    test_invalidate();
+    test_too_long();
+
+    if (failures) {
+        printf("lcd_fb: %d checks failed\n", failures);
+        return 1;
+    }
+    printf("lcd_fb: ok\n");
+    return 0;
+}
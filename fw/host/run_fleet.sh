@@ -0,0 +1,44 @@
+#!/bin/bash
+
+# ./run_fleet.sh N [ts_fw_host args...]
+#
+# N scanners against a packet server, ids FLEET_BASE_ID.., state under
+# FLEET_DIR/<id>, logs in FLEET_DIR/<id>.log. An instance that asserts or
+# takes a FOTA comes back up like the device would. ctrl-c stops them all
+
+N=${1:?usage: $0 N [ts_fw_host args...]}
+shift
+
+FLEET_BIN=${FLEET_BIN:-./build/ts_fw_host}
+FLEET_DIR=${FLEET_DIR:-/tmp/ts_fleet}
+FLEET_BASE_ID=${FLEET_BASE_ID:-0x4800000000}
+FLEET_IP=${FLEET_IP:-127.0.0.1}
+FLEET_PORT=${FLEET_PORT:-3334}
+
+RESTART_EXIT_CODE=3 # HOST_RESTART_EXIT_CODE, esp_system.h
+
+mkdir -p $FLEET_DIR
+
+run_one() {
+  local id=$1
+  shift
+  while true; do
+    $FLEET_BIN --dir $FLEET_DIR/$id --id $id --ip $FLEET_IP --port $FLEET_PORT \
+               --ssid host --pw host "$@" >> $FLEET_DIR/$id.log 2>&1
+    rc=$?
+    if [ $rc != $RESTART_EXIT_CODE ]; then
+      echo "$id exited with $rc, restarting" >> $FLEET_DIR/$id.log
+    fi
+    sleep 1
+  done
+}
+
+# the whole process group, the restart loops and the instances under them
+trap 'trap - INT TERM; kill 0' INT TERM
+
+for ((i = 0; i < N; i++)); do
+  run_one $(printf "%d" $((FLEET_BASE_ID + i))) "$@" &
+done
+
+echo "$N scanners running, logs in $FLEET_DIR"
+wait
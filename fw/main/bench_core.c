@@ -0,0 +1,214 @@
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "string.h"
+#include <stdio.h>
+
+#include "bench_core.h"
+#include "file_core.h"
+#include "fota_task.h"
+#include "lcd.h"
+#include "ll.h"
+#include "packet.h"
+#include "qcore.h"
+#include "system_defines.h"
+#include "tcp_core.h"
+
+/**********************************************************
+*              BENCH CORE STATIC VARIABLES
+**********************************************************/
+static const char TAG[] = "BENCH_CORE";
+
+static const size_t crc_sizes[]     = { 16, 256, 4096 };
+static const size_t frame_sizes[]   = { ACK_PACKET_SIZE, CMD_PACKET_SIZE, DATA_PACKET_SIZE };
+static const size_t fat_sizes[]     = { 512, 4096 };
+static const int    chunker_reads[] = { 64, 536, 1460 }; // tiny, default TCP MSS, ethernet MSS
+
+static uint8_t crc_buf[4096];
+
+/**********************************************************
+*                  BENCH CORE FUCTIONS
+**********************************************************/
+
+static void bench_row(const char* suite, const char* name, uint32_t param, uint32_t iters, uint32_t total_us, uint32_t bytes_per_op) {
+    uint32_t ns_per_op = iters ? ((uint64_t)total_us * 1000) / iters : 0;
+    uint32_t kb_per_s  = total_us ? ((uint64_t)bytes_per_op * iters * 1000000 / 1024) / total_us : 0;
+
+    printf("BENCH,%s,%s,%u,%u,%u,%u,%u\n", suite, name, param, iters, total_us, ns_per_op, kb_per_s);
+}
+
+static void bench_err(const char* suite, const char* name, uint32_t param) {
+    printf("BENCH_ERR,%s,%s,%u\n", suite, name, param);
+}
+
+static void bench_crc() {
+    int      s, i, iters;
+    int64_t  start;
+    uint32_t us;
+
+    for (i = 0; i < sizeof(crc_buf); i++) {
+        crc_buf[i] = i * 31;
+    }
+
+    for (s = 0; s < sizeof(crc_sizes) / sizeof(crc_sizes[0]); s++) {
+        iters = BENCH_CRC_BYTES / crc_sizes[s];
+
+        start = esp_timer_get_time();
+        for (i = 0; i < iters; i++) {
+            crc16(crc_buf, crc_sizes[s]);
+        }
+        us = esp_timer_get_time() - start;
+        bench_row("crc", "crc16", crc_sizes[s], iters, us, crc_sizes[s]);
+
+        start = esp_timer_get_time();
+        for (i = 0; i < iters; i++) {
+            crc32(crc_buf, crc_sizes[s]);
+        }
+        us = esp_timer_get_time() - start;
+        bench_row("crc", "crc32", crc_sizes[s], iters, us, crc_sizes[s]);
+
+        start = esp_timer_get_time();
+        for (i = 0; i < iters; i++) {
+            crc32c(0, crc_buf, crc_sizes[s]);
+        }
+        us = esp_timer_get_time() - start;
+        bench_row("crc", "crc32c", crc_sizes[s], iters, us, crc_sizes[s]);
+    }
+
+    // what the chunker pays per packet received
+    for (s = 0; s < sizeof(frame_sizes) / sizeof(frame_sizes[0]); s++) {
+        iters = BENCH_CRC_BYTES / frame_sizes[s];
+        packet_crc_set(crc_buf, frame_sizes[s]);
+
+        start = esp_timer_get_time();
+        for (i = 0; i < iters; i++) {
+            packet_crc_check(crc_buf, frame_sizes[s]);
+        }
+        us = esp_timer_get_time() - start;
+        bench_row("crc", "frame_check", frame_sizes[s], iters, us, frame_sizes[s]);
+    }
+}
+
+// uses the RX_LL, which nobody touches unless tcp core is up
+static void bench_ll() {
+    static uint8_t node[PACKET_LEN_MAX];
+    int            r, i;
+    int64_t        start;
+    uint32_t       add_us = 0, pop_us = 0;
+
+    if (get_tcp_core_status() == TCP_CORE_UP || ll_get_counter(RX_LL) != 0) {
+        bench_err("ll", "rx_ll_busy", CMD_PACKET_SIZE);
+        return;
+    }
+
+    memset(node, 0, sizeof(node));
+    for (r = 0; r < BENCH_LL_ROUNDS; r++) {
+        start = esp_timer_get_time();
+        for (i = 0; i < MAX_RX_LEN; i++) {
+            ll_add_node(RX_LL, node, CMD_PACKET_SIZE, TRANSACTION_ID_DONT_CARE, STORE_DATA);
+        }
+        add_us += esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        for (i = 0; i < MAX_RX_LEN; i++) {
+            ll_pop(RX_LL, node);
+        }
+        pop_us += esp_timer_get_time() - start;
+    }
+
+    bench_row("ll", "ll_add_node", CMD_PACKET_SIZE, BENCH_LL_ROUNDS * MAX_RX_LEN, add_us, CMD_PACKET_SIZE);
+    bench_row("ll", "ll_pop", CMD_PACKET_SIZE, BENCH_LL_ROUNDS * MAX_RX_LEN, pop_us, CMD_PACKET_SIZE);
+}
+
+static void bench_fat() {
+    int      s;
+    uint32_t write_us, read_us;
+
+    for (s = 0; s < sizeof(fat_sizes) / sizeof(fat_sizes[0]); s++) {
+        if (file_core_bench_fat(fat_sizes[s], BENCH_FILE_ITERS, &write_us, &read_us) != FILE_RET_OK) {
+            bench_err("fat", "fat_rw", fat_sizes[s]);
+            continue;
+        }
+        bench_row("fat", "fat_write", fat_sizes[s], BENCH_FILE_ITERS, write_us, fat_sizes[s]);
+        bench_row("fat", "fat_read", fat_sizes[s], BENCH_FILE_ITERS, read_us, fat_sizes[s]);
+    }
+}
+
+static void bench_nvs() {
+    uint32_t write_us, read_us;
+
+    if (file_core_bench_nvs(BENCH_FILE_ITERS, &write_us, &read_us) != ITEM_GOOD) {
+        bench_err("nvs", "nvs_rw", sizeof(uint32_t));
+        return;
+    }
+    bench_row("nvs", "nvs_write_commit", sizeof(uint32_t), BENCH_FILE_ITERS, write_us, sizeof(uint32_t));
+    bench_row("nvs", "nvs_read", sizeof(uint32_t), BENCH_FILE_ITERS, read_us, sizeof(uint32_t));
+}
+
+static void bench_lcd() {
+    uint32_t full_us, partial_us;
+
+    lcd_bench(BENCH_LCD_ITERS, &full_us, &partial_us);
+    if (full_us == 0) {
+        bench_err("lcd", "lcd_not_ready", LCD_MAX_CHAR);
+        return;
+    }
+    bench_row("lcd", "lcd_redraw_full", LCD_MAX_CHAR, BENCH_LCD_ITERS, full_us, LCD_MAX_CHAR);
+    bench_row("lcd", "lcd_redraw_one_cell", LCD_MAX_CHAR, BENCH_LCD_ITERS, partial_us, 1);
+}
+
+static void bench_chunker() {
+    int      r, packets;
+    uint32_t us, bytes;
+
+    for (r = 0; r < sizeof(chunker_reads) / sizeof(chunker_reads[0]); r++) {
+        packets = tcp_core_bench_chunker(chunker_reads[r], BENCH_CHUNKER_PASSES, &us, &bytes);
+        if (packets != BENCH_CHUNKER_PASSES * TCP_CORE_BENCH_PACKETS) {
+            bench_err("chunker", "chunker_loopback", chunker_reads[r]);
+            continue;
+        }
+        bench_row("chunker", "chunker_loopback", chunker_reads[r], packets, us, bytes / packets);
+    }
+}
+
+static const struct {
+    const char* name;
+    void (*run)();
+} suites[] = {
+    { "crc", bench_crc },
+    { "ll", bench_ll },
+    { "fat", bench_fat },
+    { "nvs", bench_nvs },
+    { "lcd", bench_lcd },
+    { "chunker", bench_chunker },
+};
+
+int bench_run(const char* suite) {
+    esp_chip_info_t chip;
+    bool            all   = !suite || !strcmp(suite, "all");
+    bool            known = all;
+    int             i;
+
+    for (i = 0; i < sizeof(suites) / sizeof(suites[0]) && !known; i++) {
+        known = !strcmp(suite, suites[i].name);
+    }
+    if (!known) {
+        ESP_LOGE(TAG, "unknown suite %s", suite);
+        return -1;
+    }
+
+    esp_chip_info(&chip);
+    printf("BENCH_INFO,fw,%hu,chip_rev,%d,cores,%d,idf,%s\n", fota_get_fw_version(), chip.revision, chip.cores, esp_get_idf_version());
+    printf("BENCH,suite,case,param,iters,total_us,ns_per_op,kb_per_s\n");
+
+    for (i = 0; i < sizeof(suites) / sizeof(suites[0]); i++) {
+        if (all || !strcmp(suite, suites[i].name)) {
+            suites[i].run();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+/* On device micro benchmarks, run from the console ("bench --suite=...").
+ * Results are printed as CSV so runs on different builds / boards can be diffed:
+ *
+ *   BENCH_INFO,fw,<fw version>,chip_rev,<rev>,cores,<n>,idf,<idf version>
+ *   BENCH,suite,case,param,iters,total_us,ns_per_op,kb_per_s
+ *   BENCH_ERR,suite,case,param
+ *
+ * param is the buffer / packet / read size the case ran with */
+
+#define BENCH_CRC_BYTES      (256 * 1024) // per size, iterations = BENCH_CRC_BYTES / size
+#define BENCH_LL_ROUNDS      (64)         // each round fills then drains the RX_LL
+#define BENCH_FILE_ITERS     (16)         // FAT + NVS, kept low, this is real flash wear
+#define BENCH_LCD_ITERS      (20)
+#define BENCH_CHUNKER_PASSES (64)
+
+// returns 0, -1 if the suite is unknown
+int bench_run(const char* suite);
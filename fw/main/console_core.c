@@ -8,8 +8,11 @@
 #include "freertos/queue.h"
 #include "freertos/task.h"
 
+#include "bench_core.h"
 #include "file_core.h"
 #include "parallax.h"
+#include "stats_core.h"
+#include "trace_core.h"
 
 #include "console_core.h"
 
@@ -42,6 +45,19 @@ static struct {
     struct arg_end* end;
 } arg_reboot;
 
+static struct {
+    struct arg_end* end;
+} arg_stats;
+
+static struct {
+    struct arg_end* end;
+} arg_trace;
+
+static struct {
+    struct arg_str* suite;
+    struct arg_end* end;
+} arg_bench;
+
 bool isValidIpAddress(char* ipAddress) {
     struct sockaddr_in sa;
     int                result = inet_pton(AF_INET, ipAddress, &(sa.sin_addr));
@@ -53,6 +69,31 @@ static int system_reboot(int argc, char** argv) {
     esp_restart();
 }
 
+static int system_stats(int argc, char** argv) {
+    stats_print();
+    return 0;
+}
+
+static int system_trace(int argc, char** argv) {
+    trace_dump();
+    return 0;
+}
+
+static int system_bench(int argc, char** argv) {
+    int nerrors = arg_parse(argc, argv, (void**)&arg_bench);
+    if (nerrors != 0) {
+        arg_print_errors(stderr, arg_bench.end, argv[0]);
+        return 1;
+    }
+
+    const char* suite = arg_bench.suite->count ? arg_bench.suite->sval[0] : "all";
+    if (bench_run(suite) != 0) {
+        printf("unknown suite, use one of all, crc, ll, fat, nvs, lcd, chunker\n");
+        return 1;
+    }
+    return 0;
+}
+
 static int system_reset(int argc, char** argv) {
     char accept_string[MAX_ACCEPT_LEN];
 
@@ -310,12 +351,55 @@ void register_reboot() {
     ESP_ERROR_CHECK(esp_console_cmd_register(&i2cconfig_cmd));
 }
 
+void register_stats() {
+    arg_stats.end = arg_end(2);
+
+    const esp_console_cmd_t i2cconfig_cmd = {
+        .command  = "stats",
+        .help     = "print heap, queue, task and packet stats",
+        .hint     = NULL,
+        .func     = &system_stats,
+        .argtable = &arg_stats
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&i2cconfig_cmd));
+}
+
+void register_trace() {
+    arg_trace.end = arg_end(2);
+
+    const esp_console_cmd_t i2cconfig_cmd = {
+        .command  = "trace",
+        .help     = "dump the binary hot path log ring",
+        .hint     = NULL,
+        .func     = &system_trace,
+        .argtable = &arg_trace
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&i2cconfig_cmd));
+}
+
+void register_bench() {
+    arg_bench.suite = arg_str0(NULL, "suite", "<all|crc|ll|fat|nvs|lcd|chunker>", "which benchmarks to run, defaults to all");
+    arg_bench.end   = arg_end(2);
+
+    const esp_console_cmd_t i2cconfig_cmd = {
+        .command  = "bench",
+        .help     = "run on device micro benchmarks, prints CSV",
+        .hint     = NULL,
+        .func     = &system_bench,
+        .argtable = &arg_bench
+    };
+    ESP_ERROR_CHECK(esp_console_cmd_register(&i2cconfig_cmd));
+}
+
 void register_console(void) {
     register_deviceidset();
     register_ipset();
     register_wifi();
     register_reboot();
     register_reset();
+    register_stats();
+    register_trace();
+    register_bench();
 }
 
 void console_init() {
@@ -342,6 +426,15 @@ void console_init() {
     printf("* Erase All Users:                                                                     *\n");
     printf("*   reset --agree=yes                                                                  *\n");
     printf("*                                                                                      *\n");
+    printf("* Runtime stats (heap, queues, task stacks, counters):                                 *\n");
+    printf("*   stats                                                                              *\n");
+    printf("*                                                                                      *\n");
+    printf("* Hot path log ring (newest last):                                                     *\n");
+    printf("*   trace                                                                              *\n");
+    printf("*                                                                                      *\n");
+    printf("* Benchmarks (CSV, grep for BENCH):                                                    *\n");
+    printf("*   bench --suite=all                                                                  *\n");
+    printf("*                                                                                      *\n");
     printf("****************************************************************************************\n");
 
     ESP_ERROR_CHECK(esp_console_repl_start());
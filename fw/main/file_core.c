@@ -1,4 +1,5 @@
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_vfs.h"
 #include "esp_vfs_fat.h"
 #include <stdio.h>
@@ -12,6 +13,7 @@
 #include "file_core.h"
 #include "fota_task.h" //fw-version
 #include "lcd.h"
+#include "stats_core.h"
 #include "system_defines.h"
 
 #include "nvs.h"
@@ -443,9 +445,10 @@ void file_thread(void* ptr) {
 
     //let the rest of the system know we file-core is ready
     fileCoreReady = 1;
+    stats_register_task(STATS_TASK_FILE);
 
     for (;;) {
-        int ret;
+        int ret = FILE_RET_OK;
 
         // Wait for command
         BaseType_t xStatus = xQueueReceive(fileCommandQ, &commandQ_cmd, portMAX_DELAY);
@@ -500,6 +503,11 @@ void file_thread(void* ptr) {
             xQueueSend(fileCommandQ_res, &ret, 0);
             break;
         }
+
+        stats_inc(STATS_FILE_OPS);
+        if (ret != FILE_RET_OK) {
+            stats_inc(STATS_FILE_ERRORS);
+        }
     }
 }
 
@@ -523,6 +531,8 @@ void file_core_init_freertos_objects() {
     fileCommandMutex = xSemaphoreCreateMutex();
     fileUserArrMutex = xSemaphoreCreateMutex();
     nvs_sem          = xSemaphoreCreateMutex();
+
+    stats_register_queue(STATS_Q_FILE_COMMAND, fileCommandQ);
 }
 
 int file_core_set(int item, void* data) {
@@ -921,3 +931,120 @@ bool file_core_get_journal(uint16_t* uid) {
     file_core_get(NVS_JOURNAL, uid);
     return true;
 }
+
+/**********************************************************
+*                  FILE CORE BENCHMARKS
+**********************************************************/
+
+// writes then reads back a size byte file iterations times, the users never get touched
+// returns FILE_RET_OK / FILE_RET_FAIL
+int file_core_bench_fat(size_t size, int iterations, uint32_t* write_us, uint32_t* read_us) {
+    char     fileName[30];
+    uint8_t* buf;
+    FILE*    f;
+    int      i;
+    int      ret = FILE_RET_OK;
+    int64_t  start;
+
+    if (!write_us || !read_us || iterations <= 0) {
+        ASSERT(0);
+    }
+
+    buf = malloc(size);
+    if (!buf) {
+        return FILE_RET_FAIL;
+    }
+    memset(buf, 0xA5, size);
+    snprintf(fileName, sizeof(fileName), "%s/bench.bin", base_path);
+
+    *write_us = 0;
+    *read_us  = 0;
+
+    // keeps file core (and anyone going through it) off the FS while we run
+    file_core_mutex_take();
+    for (i = 0; i < iterations; i++) {
+        start = esp_timer_get_time();
+        f     = fopen(fileName, "wb");
+        if (!f || fwrite(buf, 1, size, f) != size) {
+            ret = FILE_RET_FAIL;
+        }
+        if (f) {
+            fclose(f);
+        }
+        *write_us += esp_timer_get_time() - start;
+
+        start = esp_timer_get_time();
+        f     = fopen(fileName, "rb");
+        if (!f || fread(buf, 1, size, f) != size) {
+            ret = FILE_RET_FAIL;
+        }
+        if (f) {
+            fclose(f);
+        }
+        *read_us += esp_timer_get_time() - start;
+
+        if (ret != FILE_RET_OK) {
+            break;
+        }
+    }
+    remove(fileName);
+    file_core_mutex_give();
+
+    free(buf);
+    return ret;
+}
+
+// set + commit then get of a u32 in its own namespace, erased when done
+int file_core_bench_nvs(int iterations, uint32_t* write_us, uint32_t* read_us) {
+    nvs_handle_t my_handle;
+    esp_err_t    err;
+    uint32_t     val;
+    int          i;
+    int          ret = ITEM_GOOD;
+    int64_t      start;
+
+    if (!write_us || !read_us || iterations <= 0) {
+        ASSERT(0);
+    }
+
+    if (pdTRUE != xSemaphoreTake(nvs_sem, FILE_ARR_MAX_MUTEX_WAIT)) {
+        ESP_LOGE(TAG, "FAILED TO TAKE NVS_MUTEX!");
+        ASSERT(0);
+    }
+
+    err = nvs_open("bench", NVS_READWRITE, &my_handle);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Error (%s) opening NVS handle!", esp_err_to_name(err));
+        xSemaphoreGive(nvs_sem);
+        return ITEM_CANT_SET;
+    }
+
+    *write_us = 0;
+    *read_us  = 0;
+    for (i = 0; i < iterations; i++) {
+        start = esp_timer_get_time();
+        err   = nvs_set_u32(my_handle, "bench", i);
+        if (err == ESP_OK) {
+            err = nvs_commit(my_handle);
+        }
+        *write_us += esp_timer_get_time() - start;
+        if (err != ESP_OK) {
+            ret = ITEM_CANT_SET;
+            break;
+        }
+
+        start = esp_timer_get_time();
+        err   = nvs_get_u32(my_handle, "bench", &val);
+        *read_us += esp_timer_get_time() - start;
+        if (err != ESP_OK || val != i) {
+            ret = ITEM_CANT_GET;
+            break;
+        }
+    }
+
+    nvs_erase_key(my_handle, "bench");
+    nvs_commit(my_handle);
+    nvs_close(my_handle);
+    xSemaphoreGive(nvs_sem);
+    return ret;
+}
@@ -103,6 +103,10 @@ void file_core_clear_journal();
 void file_core_set_journal(uint16_t uid);
 bool file_core_get_journal(uint16_t* uid);
 
+// benchmarks, see bench_core.c
+int file_core_bench_fat(size_t size, int iterations, uint32_t* write_us, uint32_t* read_us);
+int file_core_bench_nvs(int iterations, uint32_t* write_us, uint32_t* read_us);
+
 int  verify_nvs_required_items();
 void file_core_print_details();
 void lcd_boot_message();
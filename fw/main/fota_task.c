@@ -6,6 +6,7 @@
 #include "esp_ota_ops.h"
 #include "esp_partition.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "nvs_flash.h"
 
@@ -22,6 +23,9 @@
 #include "packet.h"
 #include "qcore.h"
 #include "system_defines.h"
+#include "trace_core.h"
+
+#define HOT_LOG_MODE FOTA_HOT_LOG
 
 /**********************************************************
 *              FOTA CORE STATIC VARIABLES
@@ -41,7 +45,7 @@ uint16_t fota_get_fw_version() {
 
 static void create_fota_ack(uint8_t type, uint8_t status) {
     uint16_t ti = create_transaction_id();
-    ESP_LOGI(TAG, "writting ACK w/ ID %hu, type %hhu status %hhu", ti, type, status);
+    HOT_LOG2(TRACE_FOTA_ACK, "writting ACK w/ ID %hu, type/status %x", ti, (type << 8) | status);
 
     packet_fota_rsp_create(generic_pkt, // Backing array
                            ti,          // Transaction ID
@@ -70,6 +74,8 @@ void fota_task(void* parameters) {
     uint16_t           cur_block = 0;
     esp_err_t          err;
     fota_pkt_payload_t fota_initial, fota_meta, fota_final;
+    int64_t            download_start;
+    uint32_t           download_ms;
 
     xStatus = xQueueReceive(master_to_fota_q, generic_pkt, FOTA_TIME_BETWEEN_FOTA_PACKETS);
     if (xStatus != pdPASS) {
@@ -101,8 +107,10 @@ void fota_task(void* parameters) {
     esp_ota_handle_t ota_handle;
     esp_ota_begin(dst_partition, OTA_SIZE_UNKNOWN, &ota_handle);
 
+    download_start = esp_timer_get_time();
+
     for (; cur_block < fota_initial.fw_blocks; cur_block++) {
-        ESP_LOGI(TAG, "Currently fetching block == %hu", cur_block);
+        HOT_LOG1(TRACE_FOTA_FETCH_BLOCK, "Currently fetching block == %hu", cur_block);
 
         xStatus = xQueueReceive(master_to_fota_q, generic_pkt, FOTA_TIME_BETWEEN_FOTA_PACKETS);
         if (xStatus != pdPASS) {
@@ -119,8 +127,7 @@ void fota_task(void* parameters) {
             create_fota_ack(FOTA_META_ACK, FOTA_STATUS_FAILED_REASON_UNKNOWN);
             ASSERT(0);
         }
-        ESP_LOGI(TAG, "RXed a meta packet!");
-        ESP_LOGI(TAG, "CRC16 for next 8 segment == %hu", fota_meta.fw_crc16);
+        HOT_LOG1(TRACE_FOTA_META, "RXed a meta packet!, CRC16 for next 8 segment == %hu", fota_meta.fw_crc16);
 
         for (i = 0; i < SEGMETNS_PER_BLOCK; i++) {
             xStatus = xQueueReceive(master_to_fota_q, generic_pkt, FOTA_TIME_BETWEEN_FOTA_PACKETS);
@@ -132,7 +139,7 @@ void fota_task(void* parameters) {
                 return;
             }
 
-            ESP_LOGI(TAG, "RXed a data packet!");
+            HOT_LOG1(TRACE_FOTA_DATA, "RXed data packet %d!", i);
             type = packet_get_type(generic_pkt);
             if (type != DATA_PACKET) {
                 ESP_LOGE(TAG, "Unexpected packed RXed, %hhu", type);
@@ -143,7 +150,7 @@ void fota_task(void* parameters) {
             memcpy(fota_malloc_packet + i * LARGE_PLAYLOAD_SIZE, packet_data_get_payload_data(generic_pkt), LARGE_PLAYLOAD_SIZE);
         }
         crc16_local = crc16(fota_malloc_packet, LARGE_PLAYLOAD_SIZE * SEGMETNS_PER_BLOCK);
-        ESP_LOGI(TAG, "CRC16(local) == %hu, CRC16(expected) == %hu", crc16_local, fota_meta.fw_crc16);
+        HOT_LOG2(TRACE_FOTA_CRC16, "CRC16(local) == %hu, CRC16(expected) == %hu", crc16_local, fota_meta.fw_crc16);
         if (crc16_local != fota_meta.fw_crc16) {
             ESP_LOGE(TAG, "CRC16 MISS-MATCH!! - BAILING OUT! - setting fota underway == false!");
             create_fota_ack(FOTA_META_ACK, FOTA_STATUS_FAILED_CRC16);
@@ -158,9 +165,16 @@ void fota_task(void* parameters) {
         } else {
             ESP_ERROR_CHECK(esp_ota_write(ota_handle, fota_malloc_packet, SEGMETNS_PER_BLOCK * LARGE_PLAYLOAD_SIZE));
         }
-        ESP_LOGI(TAG, "Commited block %hu to memory!", cur_block);
+        HOT_LOG1(TRACE_FOTA_BLOCK_COMMITTED, "Commited block %hu to memory!", cur_block);
     }
 
+    // end to end, includes flash writes and the server round trips, compare with FOTA_HOT_LOG on/off
+    download_ms = (esp_timer_get_time() - download_start) / 1000;
+    ESP_LOGI(TAG, "Downloaded %u bytes in %u ms (%u bytes/s)",
+             fota_initial.fw_blocks * SEGMETNS_PER_BLOCK * LARGE_PLAYLOAD_SIZE,
+             download_ms,
+             download_ms ? (uint32_t)((uint64_t)fota_initial.fw_blocks * SEGMETNS_PER_BLOCK * LARGE_PLAYLOAD_SIZE * 1000 / download_ms) : 0);
+
     ESP_LOGI(TAG, "waiting for final packet ! - going to check CRC32!");
     xStatus = xQueueReceive(master_to_fota_q, generic_pkt, FOTA_TIME_BETWEEN_FOTA_PACKETS);
     if (xStatus != pdPASS) {
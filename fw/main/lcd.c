@@ -2,11 +2,14 @@
 #include "driver/i2c.h"
 #include "esp_console.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "math.h"
 #include "string.h"
 #include <stdio.h>
 
 #include "lcd.h"
+#include "lcd_fb.h"
+#include "stats_core.h"
 #include "system_defines.h"
 
 #define I2C_MASTER_TX_BUF_DISABLE 0                /*!< I2C master doesn't need buffer */
@@ -21,6 +24,15 @@
 #define RESET_PIN_LCD     (21)
 #define RESET_PIN_LCD_SEL (1ULL << RESET_PIN_LCD)
 
+#define LCD_I2C_ADDR          (0x7C)
+#define LCD_CONTROL_INSTR     (0x00)
+#define LCD_CONTROL_DATA      (0x40)
+#define LCD_I2C_TIMEOUT       (50 / portTICK_RATE_MS)
+#define LCD_INSTRUCTION_DELAY (10 / portTICK_PERIOD_MS)
+
+_Static_assert(LCD_FB_COLS == LCD_MAX_CHAR_PER_LINE, "lcd framebuffer width does not match lcd.h");
+_Static_assert(LCD_FB_LINES * LCD_FB_COLS == LCD_MAX_CHAR, "lcd framebuffer size does not match lcd.h");
+
 /**********************************************************
 *               LCD CORE GLOBAL VARIABLES
 **********************************************************/
@@ -36,6 +48,8 @@ static i2c_port_t        i2c_port      = I2C_NUM_0;
 static const char        TAG[]         = "LCD_CORE";
 static SemaphoreHandle_t lcd_state_mutex;
 static uint8_t           lcd_state;
+static lcd_fb_t          lcd_fb;       // lcd_core + lcd_bench, under lcd_fb_mutex
+static SemaphoreHandle_t lcd_fb_mutex; // only contended while a benchmark runs
 
 static uint8_t booting[]          = "Booting...";
 static uint8_t missing_nvs[]      = "Error: not      configured";
@@ -85,27 +99,31 @@ static struct {
     struct arg_end* end;
 } i2cconfig_args;
 
-void instruction_write(uint8_t data) {
+// one i2c transaction, control byte followed by len bytes (controller auto-increments DDRAM)
+static void lcd_bus_write(uint8_t control, const uint8_t* data, size_t len) {
     i2c_cmd_handle_t cmd = i2c_cmd_link_create();
     i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (0x7C), ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, (0x00), ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data, ACK_CHECK_EN);
+    i2c_master_write_byte(cmd, LCD_I2C_ADDR, ACK_CHECK_EN);
+    i2c_master_write_byte(cmd, control, ACK_CHECK_EN);
+    i2c_master_write(cmd, (uint8_t*)data, len, ACK_CHECK_EN);
     i2c_master_stop(cmd);
-    i2c_master_cmd_begin(i2c_port, cmd, 50 / portTICK_RATE_MS);
+    i2c_master_cmd_begin(i2c_port, cmd, LCD_I2C_TIMEOUT);
     i2c_cmd_link_delete(cmd);
-    vTaskDelay(10 / portTICK_PERIOD_MS);
 }
 
-void data_write(uint8_t data) {
-    i2c_cmd_handle_t cmd = i2c_cmd_link_create();
-    i2c_master_start(cmd);
-    i2c_master_write_byte(cmd, (0x7C), ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, (0x40), ACK_CHECK_EN);
-    i2c_master_write_byte(cmd, data, ACK_CHECK_EN);
-    i2c_master_stop(cmd);
-    i2c_master_cmd_begin(i2c_port, cmd, 50 / portTICK_RATE_MS);
-    i2c_cmd_link_delete(cmd);
+// slow, only used during init where some instructions (clear, home) need ms to settle
+void instruction_write(uint8_t data) {
+    lcd_bus_write(LCD_CONTROL_INSTR, &data, 1);
+    vTaskDelay(LCD_INSTRUCTION_DELAY);
+}
+
+// set DDRAM address takes ~30us, the i2c transaction itself takes longer, no need to sleep
+static void address_write(uint8_t data) {
+    lcd_bus_write(LCD_CONTROL_INSTR, &data, 1);
+}
+
+static void data_write(const uint8_t* data, size_t len) {
+    lcd_bus_write(LCD_CONTROL_DATA, data, len);
 }
 
 static void init_lcd() {
@@ -129,16 +147,10 @@ static void init_lcd() {
     instruction_write(0x01);
     instruction_write(0x06);
     instruction_write(0x02);
-    ESP_LOGI(TAG, "Done init LCD");
-}
-
-void clear_screen() {
-    instruction_write(0x02); //return home
-    instruction_write(0x01); //clear display
-}
 
-void next_line() {
-    instruction_write(0x80 | 0x40); // set dram address to 0x40
+    // screen was just cleared, framebuffer starts out blank
+    lcd_fb_init(&lcd_fb, address_write, data_write);
+    ESP_LOGI(TAG, "Done init LCD");
 }
 
 void print_lcd_api(uint8_t* string) {
@@ -153,21 +165,57 @@ void print_lcd_api(uint8_t* string) {
     xQueueSendToBack(lcdPrintQ, &cmd, portMAX_DELAY);
 }
 
+// only sends the cells that changed since the last draw, no clear so no flicker
 void print_screen(uint8_t* data, size_t len) {
-    clear_screen();
     if (len > LCD_MAX_CHAR) {
         ESP_LOGE(TAG, "Exceeded screen size!!: %d", len);
         ASSERT(0);
     }
 
-    int curser = 0;
-    while (curser != len) {
-        if (curser == LCD_MAX_CHAR_PER_LINE) {
-            next_line();
-        }
-        data_write(*data++);
-        curser++;
+    xSemaphoreTake(lcd_fb_mutex, portMAX_DELAY);
+    int transactions = lcd_fb_draw(&lcd_fb, data, len);
+    xSemaphoreGive(lcd_fb_mutex);
+    ESP_LOGD(TAG, "Redrew screen with %d i2c transactions", transactions);
+}
+
+// times iterations redraws where every cell changes (full) and where one cell changes (partial)
+// the glass is left with garbage on it, lcd_core will fix it on its next redraw
+void lcd_bench(int iterations, uint32_t* full_us, uint32_t* partial_us) {
+    uint8_t frame[2][LCD_MAX_CHAR];
+    int     i;
+    int64_t start;
+
+    if (!full_us || !partial_us || iterations <= 0) {
+        ASSERT(0);
     }
+
+    memset(frame[0], '#', LCD_MAX_CHAR);
+    memset(frame[1], '*', LCD_MAX_CHAR);
+
+    xSemaphoreTake(lcd_fb_mutex, portMAX_DELAY);
+    if (!lcd_fb.data) {
+        // lcd_core has not finished init_lcd yet
+        *full_us    = 0;
+        *partial_us = 0;
+        xSemaphoreGive(lcd_fb_mutex);
+        return;
+    }
+
+    start = esp_timer_get_time();
+    for (i = 0; i < iterations; i++) {
+        lcd_fb_draw(&lcd_fb, frame[i & 1], LCD_MAX_CHAR);
+    }
+    *full_us = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (i = 0; i < iterations; i++) {
+        frame[0][0] = '0' + (i % 10);
+        lcd_fb_draw(&lcd_fb, frame[0], LCD_MAX_CHAR);
+    }
+    *partial_us = esp_timer_get_time() - start;
+
+    lcd_fb_invalidate(&lcd_fb);
+    xSemaphoreGive(lcd_fb_mutex);
 }
 
 void set_lcd_state(uint8_t state) {
@@ -228,6 +276,7 @@ void print_default() {
 
 void lcd_core(void* v) {
     ESP_LOGI(TAG, "Starting LCD core");
+    stats_register_task(STATS_TASK_LCD);
     init_gpio_lcd();
     init_lcd();
 
@@ -271,5 +320,8 @@ void lcd_core_spawner() {
 
 void lcd_core_init_freertos_objects() {
     lcd_state_mutex = xSemaphoreCreateMutex();
+    lcd_fb_mutex    = xSemaphoreCreateMutex();
     lcdPrintQ       = xQueueCreate(5, sizeof(lcd_cmd_t));
+
+    stats_register_queue(STATS_Q_LCD_PRINT, lcdPrintQ);
 }
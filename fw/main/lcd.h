@@ -20,6 +20,7 @@ void lcd_core_spawner(void);
 void print_lcd_api(uint8_t* string);
 void lcd_core_init_freertos_objects();
 void set_lcd_state(uint8_t state);
+void lcd_bench(int iterations, uint32_t* full_us, uint32_t* partial_us);
 
 typedef struct {
     uint8_t len;
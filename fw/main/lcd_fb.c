@@ -0,0 +1,69 @@
+#include "string.h"
+
+#include "lcd_fb.h"
+
+// assumes the display was just cleared (IE, all blanks)
+void lcd_fb_init(lcd_fb_t* fb, lcd_fb_instruction_fn instruction, lcd_fb_data_fn data) {
+    fb->instruction = instruction;
+    fb->data        = data;
+    memset(fb->cells, LCD_FB_BLANK, sizeof(fb->cells));
+}
+
+// we no longer know what is on the glass (reset, glitch..) next draw will rewrite every cell
+void lcd_fb_invalidate(lcd_fb_t* fb) {
+    memset(fb->cells, 0, sizeof(fb->cells));
+}
+
+// line wraps after LCD_FB_COLS characters, anything past len (or a NULL) is drawn as a blank
+// returns how many bus transactions it took
+int lcd_fb_draw(lcd_fb_t* fb, const uint8_t* msg, size_t len) {
+    uint8_t next[LCD_FB_LINES][LCD_FB_COLS];
+    int     transactions = 0;
+    int     line, col, start, end, gap;
+    size_t  i;
+
+    if (len > LCD_FB_LINES * LCD_FB_COLS) {
+        len = LCD_FB_LINES * LCD_FB_COLS;
+    }
+
+    memset(next, LCD_FB_BLANK, sizeof(next));
+    for (i = 0; i < len; i++) {
+        if (msg[i] == '\0') {
+            break;
+        }
+        next[i / LCD_FB_COLS][i % LCD_FB_COLS] = msg[i];
+    }
+
+    for (line = 0; line < LCD_FB_LINES; line++) {
+        col = 0;
+        while (col < LCD_FB_COLS) {
+            // find the start of the next dirty run
+            if (next[line][col] == fb->cells[line][col]) {
+                col++;
+                continue;
+            }
+
+            // extend the run, swallowing short clean gaps
+            start = col;
+            end   = col;
+            gap   = 0;
+            for (col = start + 1; col < LCD_FB_COLS && gap <= LCD_FB_MERGE_GAP; col++) {
+                if (next[line][col] != fb->cells[line][col]) {
+                    end = col;
+                    gap = 0;
+                } else {
+                    gap++;
+                }
+            }
+
+            fb->instruction(LCD_FB_SET_DDRAM | (LCD_FB_LINE_ADDR(line) + start));
+            fb->data(&next[line][start], end - start + 1);
+            transactions += 2;
+
+            memcpy(&fb->cells[line][start], &next[line][start], end - start + 1);
+            col = end + 1;
+        }
+    }
+
+    return transactions;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "stddef.h"
+#include "stdint.h"
+
+/* Shadow framebuffer for the 2x16 LCD, keeps a copy of what is on the glass so a redraw
+ * only touches the cells that changed. No ESP/FreeRTOS dependencies, the bus is passed in
+ * as two callbacks so this can be built on the host against a fake i2c bus */
+
+#define LCD_FB_LINES (2)
+#define LCD_FB_COLS  (16)
+
+#define LCD_FB_LINE_ADDR(line) ((line) ? 0x40 : 0x00)
+#define LCD_FB_SET_DDRAM       (0x80)
+#define LCD_FB_BLANK           (' ')
+
+/* rewriting a few unchanged cells in an open data transaction is cheaper than closing it,
+ * sending a set-DDRAM instruction and opening a new one */
+#define LCD_FB_MERGE_GAP (4)
+
+typedef void (*lcd_fb_instruction_fn)(uint8_t instruction);
+typedef void (*lcd_fb_data_fn)(const uint8_t* data, size_t len);
+
+typedef struct {
+    lcd_fb_instruction_fn instruction;
+    lcd_fb_data_fn        data;
+    uint8_t               cells[LCD_FB_LINES][LCD_FB_COLS];
+} lcd_fb_t;
+
+void lcd_fb_init(lcd_fb_t* fb, lcd_fb_instruction_fn instruction, lcd_fb_data_fn data);
+void lcd_fb_invalidate(lcd_fb_t* fb);
+int  lcd_fb_draw(lcd_fb_t* fb, const uint8_t* msg, size_t len);
@@ -12,8 +12,12 @@
 #include <sys/param.h>
 
 #include "ll.h"
+#include "stats_core.h"
 #include "system_defines.h"
 #include "timer_helper.h"
+#include "trace_core.h"
+
+#define HOT_LOG_MODE LL_HOT_LOG
 
 /**********************************************************
 *                LL - CORE PRIVATE VARIABLES
@@ -102,6 +106,52 @@ uint32_t crc32(const void* buf, size_t size) {
     return crc;
 }
 
+/* CRC-32C (Castagnoli), same polynomial as crc32() but the standard init/xorout,
+ * matches Go's crc32.Castagnoli so the server checks it with SSE4.2.
+ * Slice-by-4: four table lookups per 32 bit word instead of one per byte,
+ * crc32Table is slice 0, the other three are built by crc32c_init() */
+static uint32_t crc32cSlices[3][256];
+
+static void crc32c_init() {
+    uint32_t crc;
+    int      i, s;
+
+    for (i = 0; i < 256; i++) {
+        crc = crc32Table[i];
+        for (s = 0; s < 3; s++) {
+            crc                = crc32Table[crc & 0xff] ^ (crc >> 8);
+            crc32cSlices[s][i] = crc;
+        }
+    }
+}
+
+// chains like zlib, crc32c(crc32c(0, a, n), b, m) == crc32c(0, ab, n + m)
+uint32_t crc32c(uint32_t crc, const void* buf, size_t size) {
+    const uint8_t* p = buf;
+
+    crc = ~crc;
+
+    // words have to be aligned on the xtensa
+    while (size && ((uintptr_t)p & 3)) {
+        crc = crc32Table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+        size--;
+    }
+
+    while (size >= 4) {
+        crc ^= *(const uint32_t*)p;
+        crc = crc32cSlices[2][crc & 0xff] ^ crc32cSlices[1][(crc >> 8) & 0xff] ^
+              crc32cSlices[0][(crc >> 16) & 0xff] ^ crc32Table[crc >> 24];
+        p += 4;
+        size -= 4;
+    }
+
+    while (size--) {
+        crc = crc32Table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
 static const unsigned short crc16tab[256] = {
     0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
     0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef,
@@ -501,7 +551,7 @@ int ll_peek(uint16_t transaction_id, bool take_sem, uint8_t* data) {
     if (take_sem) {
         xSemaphoreGive(cr_sem);
     }
-    return transaction_id;
+    return ret;
 }
 
 // Spins until there is room in the LL we are
@@ -513,13 +563,14 @@ static void spin_till_free(ll_type_e type) {
 
     if (type == RX_LL) {
         while (1) {
-            ESP_LOGI(TAG, "Adding a packet to the RX_LL, currently has %d", ll_get_counter(RX_LL));
             rc = xSemaphoreTake(rx_sem, delay);
             if (rc != pdTRUE) {
                 ASSERT(0);
             }
+            HOT_LOG2(TRACE_LL_ADD, "Adding a packet to the LL %d, currently has %d", type, len_rx_ll);
             if (len_rx_ll == MAX_RX_LEN) {
                 xSemaphoreGive(rx_sem);
+                stats_inc(STATS_LL_FULL_WAITS);
                 taskYIELD();
                 continue;
             }
@@ -528,13 +579,14 @@ static void spin_till_free(ll_type_e type) {
         }
     } else if (type == TX_LL) {
         while (1) {
-            ESP_LOGI(TAG, "Adding packet to the TX_LL, currently has %d", ll_get_counter(TX_LL));
             rc = xSemaphoreTake(tx_sem, delay);
             if (rc != pdTRUE) {
                 ASSERT(0);
             }
+            HOT_LOG2(TRACE_LL_ADD, "Adding a packet to the LL %d, currently has %d", type, len_tx_ll);
             if (len_tx_ll == MAX_TX_LEN) {
                 xSemaphoreGive(tx_sem);
+                stats_inc(STATS_LL_FULL_WAITS);
                 taskYIELD();
                 continue;
             }
@@ -543,13 +595,14 @@ static void spin_till_free(ll_type_e type) {
         }
     } else {
         while (1) {
-            ESP_LOGI(TAG, "Adding a packet to the CR_LL, currently has %d", ll_get_counter(CR_LL));
             rc = xSemaphoreTake(cr_sem, delay);
             if (rc != pdTRUE) {
                 ASSERT(0);
             }
+            HOT_LOG2(TRACE_LL_ADD, "Adding a packet to the LL %d, currently has %d", type, len_cr_ll);
             if (len_cr_ll == MAX_CR_LEN) {
                 xSemaphoreGive(cr_sem);
+                stats_inc(STATS_LL_FULL_WAITS);
                 taskYIELD();
                 continue;
             }
@@ -566,6 +619,7 @@ int ll_add_node(ll_type_e type, void* data, size_t size, uint16_t transaction_id
     // Spin till we have room in the RX/TX/CR buffer
     // (assumes sigle producer of data)
     spin_till_free(type);
+    stats_inc(STATS_LL_NODES_ADDED);
 
     if (type == RX_LL) {
         xSemaphoreTake(rx_sem, portMAX_DELAY);
@@ -597,6 +651,8 @@ void ll_init() {
     ASSERT(rx_sem);
     ASSERT(tx_sem);
     ASSERT(cr_sem);
+
+    crc32c_init();
 }
 
 /**********************************************************
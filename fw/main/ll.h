@@ -36,6 +36,7 @@ typedef enum {
 //crc
 uint16_t crc16(uint8_t* buf, size_t len);
 uint32_t crc32(const void* buf, size_t size);
+uint32_t crc32c(uint32_t crc, const void* buf, size_t size);
 
 //test only
 void ll_test();
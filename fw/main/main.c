@@ -23,7 +23,9 @@
 #include "tcp_core.h"
 #include "wifi_core.h"
 
+#ifndef QUICK_BOOT
 #define QUICK_BOOT (0)
+#endif
 
 void app_main(void) {
 
@@ -19,6 +19,7 @@
 #include "packet.h"
 #include "parallax.h"
 #include "qcore.h"
+#include "stats_core.h"
 #include "sync_task.h"
 #include "system_defines.h"
 #include "tcp_core.h"
@@ -213,6 +214,7 @@ static void fota_handler() {
         goto send_packet;
     }
 
+    stats_inc(STATS_FOTA_STARTED);
     xStatus = xTaskCreate(fota_task,            // function
                           "FOTA task",          // name
                           8192,                 // stack size
@@ -509,17 +511,20 @@ static void master_core_handle_login() {
 
     if (TCP_CORE_DOWN == get_tcp_core_status()) {
         print_lcd_api((void*)"Failed - no connection");
+        stats_inc(STATS_LOGINS_DROPPED);
         return;
     }
 
     // Test if TCP core is up, if not, put the login info into flash till the core is up
     if (MASTER_CORE_NOT_REGISTERED == get_master_core_status()) {
         print_lcd_api((void*)"Failed - no connection");
+        stats_inc(STATS_LOGINS_DROPPED);
         return;
     }
 
     if(bricked){
         print_lcd_api((void*)"Device Bricked... Login failed");
+        stats_inc(STATS_LOGINS_DROPPED);
         return;
     }
 
@@ -562,6 +567,7 @@ static void master_core_handle_login() {
     if (xStatus != pdTRUE) {
         ASSERT(0);
     }
+    stats_inc(STATS_LOGINS);
 }
 
 //packet to be processed is in the static global variable general_pkt
@@ -910,6 +916,38 @@ static void display_message(){
   }
 }
 
+static void send_stats() {
+    // packet_cmd_resp_create always copies a full CMD_RESPONSE_PAYLOAD_LEN
+    static uint8_t   rsp[CMD_RESPONSE_PAYLOAD_LEN];
+    stats_snapshot_t snap;
+    uint16_t         ti = create_transaction_id();
+
+    stats_snapshot(&snap);
+    memset(rsp, 0, CMD_RESPONSE_PAYLOAD_LEN);
+    memcpy(rsp, &snap, sizeof(stats_snapshot_t));
+
+    packet_cmd_resp_create(generic_pkt,                            // reuse this buffer
+                           ti,                                     // new transaction ID
+                           packet_get_transaction_id(generic_pkt), // transaction_id of orig cmd
+                           1,                                      // total_packets
+                           0,                                      // no packets remaning
+                           CMD_STATUS_GOOD,                        // cmd_status
+                           sizeof(stats_snapshot_t),               // sizeof payload
+                           rsp                                     // response payload
+    );
+
+    ll_add_node(CR_LL,
+                &generic_pkt,
+                CMD_RESP_PACKET_SIZE,
+                ti,
+                STORE_DATA);
+
+    BaseType_t xStatus = xQueueSendToBack(tcp_core_send, generic_pkt, MASTER_TIMEOUT);
+    if (xStatus != pdTRUE) {
+        ASSERT(0);
+    }
+}
+
 bool sync_cmd_process() {
     sync_pkt_payload_t sync_payload;
     packet_sync_unpack(packet_cmd_get_payload(generic_pkt), &sync_payload);
@@ -971,6 +1009,7 @@ static void process_cmd_pkt() {
                                NULL                                    // response payload
         );
         ESP_LOGW(TAG, "Failed to process new command as master core is busy");
+        stats_inc(STATS_CMDS_REJECTED_BUSY);
         xStatus = xQueueSendToBack(tcp_core_send, generic_pkt, MASTER_TIMEOUT);
         if (xStatus != pdTRUE) {
             ASSERT(0);
@@ -987,6 +1026,7 @@ static void process_cmd_pkt() {
         }
     }
 
+    stats_inc(STATS_CMDS_PROCESSED);
     switch (cmd_type) {
     case ADD_USER_CMD:
         if (!packet_cmd_get_payload_data(generic_pkt)) {
@@ -1128,6 +1168,12 @@ static void process_cmd_pkt() {
         ESP_LOGI(TAG, "Got a request to deisplay a message on the LCD");
         display_message();
         
+        give_master_core_outstanding_commands();
+        break;
+    case GET_STATS_CMD:
+        ESP_LOGI(TAG, "Got a request for runtime stats");
+        send_stats();
+
         give_master_core_outstanding_commands();
         break;
     case DISCONNECT_CMD:
@@ -1430,6 +1476,7 @@ static void master_core_handle_server_packet() {
 static void registeration_core(void* v) {
     char device_name[MAX_DEVICE_NAME];
     uint8_t bricked;
+    stats_register_task(STATS_TASK_REGISTRATION);
     file_core_get(NVS_BRICKED, &bricked);
 
     for (;;) {
@@ -1490,8 +1537,10 @@ static void master_core_process_acks() {
     }
 
     if (ll_peek(pkt.transaction_id, TRUE, ack_pkt) < 0) {
-        // Master core should always store LL's
-        ASSERT(0);
+        // an ack that came in after the transaction was already failed
+        // (PACKET_FAILED_DURATION_MS) and deleted, nothing left to do
+        ESP_LOGW(TAG, "Late ACK for transaction ID %d, dropping it", pkt.transaction_id);
+        return;
     }
 
     if (packet_get_type(ack_pkt) == HELLO_PACKET) {
@@ -1555,6 +1604,8 @@ static void master_core_process_acks() {
 }
 
 static void master_core(void* v) {
+    stats_register_task(STATS_TASK_MASTER_CORE);
+
     // wait for the rest of the subsytems to be live
     while (parallaxCoreReady == 0 || fileCoreReady == 0) {
         vTaskDelay(1000 / portTICK_PERIOD_MS);
@@ -1604,6 +1655,8 @@ static void master_core_init_freertos_objects() {
     //Pushes data packets from master core to FOTA task
     master_to_fota_q    = xQueueCreate(MASTER_TO_FOTA_DEPTH, DATA_PACKET_SIZE); // Internal  ->  FOTA_PACKET
     master_to_suicide_q = xQueueCreate(1, sizeof(int));                         // Master core -> sync task
+
+    stats_register_queue(STATS_Q_MASTER_TO_FOTA, master_to_fota_q);
 }
 
 void master_core_spawner() {
@@ -61,6 +61,7 @@ extern bool          disable_next_ack;
 #define SYNC_COMMAND               (9)
 /* USED BY BACKEND (10-13) */
 #define DISPLAY_MSG_LCD            (14)
+#define GET_STATS_CMD              (15) /* response payload is a stats_snapshot_t */
 
 // test only
 #define ECHO_CMD                       (100)
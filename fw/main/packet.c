@@ -4,6 +4,7 @@
 #include "stdlib.h"
 #include "system_defines.h"
 
+#include "ll.h"
 #include "packet.h"
 const char TAG[] = "PACKET";
 
@@ -117,6 +118,42 @@ uint8_t packet_ack_get_reason(void* pkt) {
     return temp->payload[PAYLOAD_OFFSET_ACK_NAK_REASON];
 }
 
+static uint16_t packet_crc_compute(void* pkt, uint16_t len) {
+    static const uint8_t zero[CRC_SIZE] = { 0 };
+    uint8_t*             b              = (uint8_t*)pkt;
+    uint32_t             crc;
+
+    crc = crc32c(0, b, PACKET_CRC_OFFSET);
+    crc = crc32c(crc, zero, CRC_SIZE);
+    crc = crc32c(crc, b + PAYLOAD_OFFSET, len - PAYLOAD_OFFSET);
+
+    return (crc & 0xFFFF) == PACKET_CRC_NONE ? PACKET_CRC_ZERO : (crc & 0xFFFF);
+}
+
+// len is the whole frame, header included
+int packet_crc_set(void* pkt, uint16_t len) {
+    if (pkt == NULL || len < PAYLOAD_OFFSET) {
+        return -1;
+    }
+
+    general_pkt_t* temp = (general_pkt_t*)pkt;
+    temp->crc           = packet_crc_compute(pkt, len);
+    return 0;
+}
+
+// true if the frame is intact, or came from a sender that does not set a CRC
+bool packet_crc_check(void* pkt, uint16_t len) {
+    if (pkt == NULL || len < PAYLOAD_OFFSET) {
+        return false;
+    }
+
+    general_pkt_t* temp = (general_pkt_t*)pkt;
+    if (temp->crc == PACKET_CRC_NONE) {
+        return true;
+    }
+    return temp->crc == packet_crc_compute(pkt, len);
+}
+
 int packet_hello_create(void* pkt, uint16_t transaction_id, uint64_t device_id, const char* device_name, uint16_t fw_version, uint8_t bricked_code) {
     if (pkt == NULL || device_name == NULL) {
         ASSERT(0);
@@ -27,6 +27,8 @@ uint16_t            packet_get_transaction_id(void* pkt);
 uint16_t            packet_ack_create(void* pkt, uint16_t id, uint8_t reason, uint8_t type);
 uint8_t             packet_ack_get_reason(void* pkt);
 int                 packet_ack_nak_set_reason(void* pkt, uint8_t reason);
+int                 packet_crc_set(void* pkt, uint16_t len);
+bool                packet_crc_check(void* pkt, uint16_t len);
 int                 packet_hello_create(void* pkt, uint16_t transaction_id, uint64_t device_id, const char* device_name, uint16_t fw_version, uint8_t bricked);
 uint32_t            packet_hello_get_id(void* pkt);
 int                 packet_login_create(login_pkt_t* pkt, const char* name, const uint16_t temperature, const uint16_t transaction_id, const bool signIn, const uint32_t uid);
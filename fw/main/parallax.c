@@ -9,6 +9,7 @@
 
 #include "lcd.h"
 #include "parallax.h"
+#include "stats_core.h"
 #include "system_defines.h"
 
 static const char TAG[] = "PARALLAX_CORE";
@@ -503,8 +504,10 @@ void parallax_handle_login() {
 
     print_lcd_api((void*)"Place finger  on scanner!");
 
+    stats_inc(STATS_PRINT_SCANS);
     match_finger_print_to_id(&login_id, &login_valid);
     if (!login_valid) {
+        stats_inc(STATS_PRINT_NO_MATCH);
         if (button == GPIO_INPUT_IO_LOGIN) {
             print_lcd_api((void*)"Login failed! - try again");
         } else {
@@ -617,6 +620,7 @@ void parallax_thread(void* ptr) {
 
     //let the rest of the system know we parallax-core is ready
     parallaxCoreReady = 1;
+    stats_register_task(STATS_TASK_PARALLAX);
 
     for (;;) {
         // Wait for...
@@ -653,6 +657,8 @@ void parallax_core_init_freertos_objects() {
     parallax_core_queue_set = xQueueCreateSet(MAX_OUTSTANDING_LOGINS + 3);
     xQueueAddToSet(parallaxCommandQ, parallax_core_queue_set);
     xQueueAddToSet(gpio_evt_proximity, parallax_core_queue_set);
+
+    stats_register_queue(STATS_Q_PARALLAX_LOGIN, parallaxLoginQ);
 }
 
 void parallax_core_spawner(bool console_mode) {
@@ -3,6 +3,7 @@
 #include "esp_log.h"
 #include "esp_netif.h"
 #include "esp_system.h"
+#include "esp_timer.h"
 #include "esp_wifi.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/event_groups.h"
@@ -21,11 +22,15 @@
 #include "packet.h"
 #include "qcore.h"
 #include "state_core.h"
+#include "stats_core.h"
 #include "system_defines.h"
 #include "tcp_core.h"
 #include "timer_helper.h"
+#include "trace_core.h"
 #include "wifi_core.h"
 
+#define HOT_LOG_MODE QCORE_HOT_LOG
+
 //no longer used
 #define HOST_IP_ADDR "192.168.0.189"
 #define PORT         3334
@@ -70,6 +75,10 @@ static int        threads_destroyed = 0;
 static int curr_buff;
 static int current_parse_type = -1;
 
+// chunker loopback benchmark, complete packets are counted and dropped
+static bool chunker_bench;
+static int  chunker_bench_packets;
+
 /**********************************************************
 *                  TCP CORE GLOBAL FUNCTIONS
 **********************************************************/
@@ -150,7 +159,7 @@ static void chunker_handle_host_ack(void* rx_pkt) {
                       packet_ack_get_reason(rx_pkt),
                       SERVER_ACK_PACKET);
 
-    ESP_LOGI(TAG, "Chunker got transaction ID: %d, was acked/naked with reason %d", packet_get_transaction_id(rx_pkt), packet_ack_get_reason(rx_pkt));
+    HOT_LOG2(TRACE_CHUNKER_HOST_ACK, "Chunker got transaction ID: %d, was acked/naked with reason %d", packet_get_transaction_id(rx_pkt), packet_ack_get_reason(rx_pkt));
 
     BaseType_t xStatus = xQueueSendToBack(tcp_core_host_ack, (void* const) & ack_nack_packet, QCORE_TIMEOUT);
     if (xStatus != pdTRUE) {
@@ -184,7 +193,7 @@ static void chunker_device_ack_create(void* rx_pkt, uint8_t reason) {
                       reason,
                       DEVICE_ACK_PACKET);
 
-    ESP_LOGI(TAG, "Sending ACK back to the server for transaction_id = %d", packet_get_transaction_id(rx_pkt));
+    HOT_LOG1(TRACE_DEVICE_ACK_TX, "Sending ACK back to the server for transaction_id = %d", packet_get_transaction_id(rx_pkt));
 
     BaseType_t xStatus = xQueueSendToBack(tcp_core_rx_tx_short_circuit_device_ack, &ack_nack_packet, QCORE_TIMEOUT); //@TODO deal with negative case
     if (xStatus != pdTRUE) {
@@ -200,7 +209,7 @@ void static reset_chunker() {
 // Splits up a TPC stream into packets
 // the rest of the system can understand
 static int chunker(const char* rx, const int len) {
-    ESP_LOGI(TAG, "Chunker called!");
+    HOT_LOG1(TRACE_CHUNKER_CALLED, "Chunker called with %d bytes", len);
     // some statics to ease MALLOC ussage
     static char chunk_buff[PACKET_LEN_MAX];
 
@@ -243,12 +252,13 @@ static int chunker(const char* rx, const int len) {
 #endif
             default:
                 ESP_LOGE(TAG, "unknown command parse type recieved: %hhu", current_parse_type);
+                stats_inc(STATS_PKT_RX_BAD_TYPE);
                 current_parse_type = -1;
                 return -1;
             }
         }
 
-        ESP_LOGI(TAG, "tcp-core starting to parse new msg of type =  %hhu", current_parse_type);
+        HOT_LOG1(TRACE_CHUNKER_NEW_MSG, "tcp-core starting to parse new msg of type =  %hhu", current_parse_type);
         // Only read within the next message boundary based on the current
         // Packet size being processed.
         int rx_left  = len - rx_proccessed;
@@ -264,8 +274,26 @@ static int chunker(const char* rx, const int len) {
         }
 
         if (curr_buff == pckt_size) {
-            //@TODO CHECK CRC!
-            // check_packet_crc(...);
+            if (chunker_bench) {
+                chunker_bench_packets++;
+                reset_chunker();
+                continue;
+            }
+
+            stats_inc(STATS_PKT_RX);
+
+            // A corrupt packet never makes it to the RX_LL, if the server
+            // wanted an ack it gets a NAK and resends. A corrupt server ack
+            // is dropped, the TX_LL times the packet out and resends it
+            if (!packet_crc_check(chunk_buff, pckt_size)) {
+                ESP_LOGE(TAG, "bad crc on a packet of type %hhu, transaction_id = %d", current_parse_type, packet_get_transaction_id(chunk_buff));
+                stats_inc(STATS_PKT_RX_BAD_CRC);
+                if (current_parse_type != SERVER_ACK_PACKET) {
+                    chunker_device_ack_create(chunk_buff, NAK_BAD_CRC);
+                }
+                reset_chunker();
+                continue;
+            }
 
             // Check to see if we got a host ack packet,
             // if so, use it to pop the outstanding TX_LL
@@ -273,7 +301,7 @@ static int chunker(const char* rx, const int len) {
                 chunker_handle_host_ack(chunk_buff);
                 reset_chunker();
             } else {
-                ESP_LOGI(TAG, "Adding a packet of type %hhu to the RX_LL, currently has %d", current_parse_type, ll_get_counter(RX_LL));
+                HOT_LOG2(TRACE_CHUNKER_RX_LL_ADD, "Adding a packet of type %hhu to the RX_LL, currently has %d", current_parse_type, ll_get_counter(RX_LL));
                 int type = current_parse_type;
                 reset_chunker();
 
@@ -285,13 +313,55 @@ static int chunker(const char* rx, const int len) {
                    ASSERT(0);
                 }
                 // Send a device ACK
-                chunker_device_ack_create(chunk_buff, ACK_GOOD); //TODO- don't hardcode ACK_GOOD, depends on CRC!
+                chunker_device_ack_create(chunk_buff, ACK_GOOD);
             }
         }
     }
     return 0;
 }
 
+// Feeds the chunker a stream of CMD packets, rx_len bytes per "recv", passes times over.
+// Must not run while the socket reader is up (IE, console mode only)
+// returns packets parsed, -1 on error
+int tcp_core_bench_chunker(int rx_len, int passes, uint32_t* us, uint32_t* bytes) {
+    static char stream[TCP_CORE_BENCH_PACKETS * CMD_PACKET_SIZE];
+    const int   stream_len = sizeof(stream);
+    int         i, off, len;
+    int64_t     start;
+
+    if (!us || !bytes || rx_len <= 0 || passes <= 0) {
+        ASSERT(0);
+    }
+
+    if (get_tcp_core_status() == TCP_CORE_UP) {
+        ESP_LOGE(TAG, "can't benchmark the chunker while tcp core is up");
+        return -1;
+    }
+
+    memset(stream, 0, stream_len);
+    for (i = 0; i < TCP_CORE_BENCH_PACKETS; i++) {
+        stream[i * CMD_PACKET_SIZE] = CMD_PACKET;
+    }
+
+    reset_chunker();
+    chunker_bench         = true;
+    chunker_bench_packets = 0;
+
+    start = esp_timer_get_time();
+    for (i = 0; i < passes; i++) {
+        for (off = 0; off < stream_len; off += len) {
+            len = (stream_len - off < rx_len) ? stream_len - off : rx_len;
+            chunker(stream + off, len);
+        }
+    }
+    *us    = esp_timer_get_time() - start;
+    *bytes = passes * stream_len;
+
+    chunker_bench = false;
+    reset_chunker();
+    return chunker_bench_packets;
+}
+
 static int sock_connect(int sock) {
     char               addr_str[128];
     struct sockaddr_in dest_addr;
@@ -327,6 +397,7 @@ static int sock_create() {
 static void tcp_socket_reader_task(void* pvParameters) {
     ESP_LOGI(TAG, "Starting tcp socket reader task");
     int sock = *((int*)pvParameters);
+    stats_register_task(STATS_TASK_TCP_READER);
 
     for (;;) {
         char rx_buff[PACKET_LEN_MAX];
@@ -334,10 +405,12 @@ static void tcp_socket_reader_task(void* pvParameters) {
         // Error occurred during receiving
         if (len < 0) {
             ESP_LOGE(TAG, "recv failed: errno %d", errno);
+            stats_inc(STATS_TCP_SOCKET_ERRORS);
 
             BaseType_t xStatus = xQueueSendToBack(tcp_core_socket_error, (const void*)&errno, QCORE_TIMEOUT);
             if (xStatus == pdPASS) {
                 tcp_core_tx_rx_destroyed();
+                stats_unregister_task(STATS_TASK_TCP_READER);
                 vTaskDelete(NULL);
             } else {
                 ESP_LOGI(TAG, "Something went wrong sending a message to master TCP thread, restarting");
@@ -346,8 +419,9 @@ static void tcp_socket_reader_task(void* pvParameters) {
         }
         // Data received
         else {
-            ESP_LOGI(TAG, "Received %d bytes:", len);
+            HOT_LOG1(TRACE_SOCK_RX, "Received %d bytes:", len);
             if (len > 0) { // (zero bytes are read on error)
+                stats_add(STATS_TCP_RX_BYTES, len);
                 chunker(rx_buff, len);
             }
         }
@@ -388,6 +462,7 @@ static void tcp_socket_writer_task(void* pvParameters) {
 
     int         sock = *((int*)pvParameters);
     static char tx_buff[PACKET_LEN_MAX];
+    stats_register_task(STATS_TASK_TCP_WRITER);
 
     for (;;) {
         memset(tx_buff, 0, PACKET_LEN_MAX);
@@ -396,6 +471,7 @@ static void tcp_socket_writer_task(void* pvParameters) {
         if (xActivatedMember == tcp_core_rx_stop) {
             xQueueReceive(tcp_core_rx_stop, tx_buff, 0);
             tcp_core_tx_rx_destroyed(); // Let the tcp core thread know we are destroyed
+            stats_unregister_task(STATS_TASK_TCP_WRITER);
             vTaskDelete(NULL);
         }
 
@@ -404,11 +480,12 @@ static void tcp_socket_writer_task(void* pvParameters) {
             ESP_LOGI(TAG, "Could not read from queue inside tcp_socket_writer_task?");
             ASSERT(0);
         }
-        ESP_LOGI(TAG, "Sending transaction_id = %d", packet_get_transaction_id(tx_buff));
+        HOT_LOG1(TRACE_SOCK_TX, "Sending transaction_id = %d", packet_get_transaction_id(tx_buff));
 
         // tx_buff sized for largest possible packet, must send the
         // actuall lenght of the packet
         size_t packet_len = packet_get_size(tx_buff);
+        packet_crc_set(tx_buff, packet_len);
 
         char* tx_ptr = tx_buff;
         for (;;) {
@@ -416,6 +493,7 @@ static void tcp_socket_writer_task(void* pvParameters) {
             int len  = send(sock, tx_ptr, packet_len, 0);
             if (len < 0) {
                 ESP_LOGE(TAG, "send failed: errno %d", errno);
+                stats_inc(STATS_TCP_SOCKET_ERRORS);
 
                 // Let the write adaptor know we had an issue sending to the host
                 tcp_socket_writer_task_helper_create_ack_nack_and_enqueue(tx_buff, TCP_CORE_DOWN);
@@ -424,6 +502,7 @@ static void tcp_socket_writer_task(void* pvParameters) {
                 BaseType_t xStatus = xQueueSendToBack(tcp_core_socket_error, (const void*)&errno, QCORE_TIMEOUT);
                 if (xStatus == pdPASS) {
                     tcp_core_tx_rx_destroyed(); // Let the tcp core thread know we are destroyed
+                    stats_unregister_task(STATS_TASK_TCP_WRITER);
                     vTaskDelete(NULL);
                 } else {
                     ESP_LOGI(TAG, "Something went wrong sending a message to master TCP thread, restarting :(");
@@ -433,7 +512,9 @@ static void tcp_socket_writer_task(void* pvParameters) {
 
             tx_ptr = tx_ptr + len;
             sent   = sent + len;
+            stats_add(STATS_TCP_TX_BYTES, len);
             if (sent == packet_len) {
+                stats_inc(STATS_PKT_TX);
                 tcp_socket_writer_task_helper_create_ack_nack_and_enqueue(tx_buff, ACK_GOOD);
                 break;
             }
@@ -447,6 +528,7 @@ static void tcp_core_thread(void* pvParameters) {
     TaskHandle_t reader, writer;
     reader = NULL;
     writer = NULL;
+    stats_register_task(STATS_TASK_TCP_CORE);
 
     for (;;) {
 
@@ -508,6 +590,7 @@ static void tcp_core_thread(void* pvParameters) {
             // No error in setting up TCP, expected pathway, let the rest
             // of the system know TCP is up
             ESP_LOGI(TAG, "TCP_CORE IS UP!");
+            stats_inc(STATS_TCP_CONNECTS);
             set_tcp_core_status(TCP_CORE_UP);
 
             //Set the LCD state to display that we are connected to the server
@@ -611,6 +694,7 @@ static void tcp_core_rx_tx_short_circuit_send_ack() {
 static void tcp_core_write_adaptor(void* pvParameters) {
     // Queueset must be sized to hold as many events as the queues it waits on
     QueueSetHandle_t tcp_read_adaptor_queue_set;
+    stats_register_task(STATS_TASK_TCP_WRITE_ADAPTOR);
     tcp_read_adaptor_queue_set = xQueueCreateSet(MAX_OUTSTANDING_TCP_CORE_SEND_X2 * 2);
 
     xQueueAddToSet(tcp_core_send, tcp_read_adaptor_queue_set);
@@ -665,6 +749,7 @@ static void tcp_core_write_adaptor_manage_timer_event() {
                                   INTERNAL_ACK_PACKET);
                 xQueueSendToBack(tcp_core_send_ack, &ack_nack, portMAX_DELAY);
                 ESP_LOGW(TAG, "Did not get host ACK within timeout for transaction_id = %d, giving up", cur_node->transaction_id);
+                stats_inc(STATS_PKT_TIMED_OUT);
                 // Don't grab a semaphor, we already have one
                 ll_delete(TX_LL, cur_node->transaction_id, DONT_TAKE_SEM);
                 return;
@@ -682,6 +767,7 @@ static void tcp_core_write_adaptor_manage_timer_event() {
             // Otherwise, mark the node as "unacked" and send this node
             // back onto the TX path so we can send it out again
             ESP_LOGW(TAG, "Transaction ID %d has yet to be acked, resending", cur_node->transaction_id);
+            stats_inc(STATS_PKT_RETRANSMIT);
             cur_node->internal_ack = 0;
             memcpy(send_buff, cur_node->data, cur_node->size); // tcp_core_send is sized for max message len,
                 // not doing this would read past smaller packets
@@ -731,7 +817,7 @@ static void tcp_core_write_adaptor_manage_ack_nak_helper() {
     // te TCP core acked us, lets pop it off the TX_LL and
     // send an ack to the host
     if (packet_get_consumer_ack_req(&ack_nack_packet) != CONSUMER_ACK_REQUIRED) {
-        ESP_LOGI(TAG, "Consumer ACK not requierd for transaction_id %d, popping LL", transaction_id);
+        HOT_LOG1(TRACE_TX_LL_NO_CONSUMER, "Consumer ACK not requierd for transaction_id %d, popping LL", transaction_id);
 
         // POP TX_LL
         ll_delete(TX_LL, transaction_id, TAKE_SEM);
@@ -749,7 +835,7 @@ static void tcp_core_write_adaptor_manage_ack_nak_helper() {
         return;
     }
 
-    ESP_LOGI(TAG, "Waiting for consumer ACK on transaction_id %d", transaction_id);
+    HOT_LOG1(TRACE_TX_LL_WAIT_CONSUMER, "Waiting for consumer ACK on transaction_id %d", transaction_id);
     // If we get here, we need to wait for the host to ACK the packet that was sent out
     // we will mark the packet as internally acked and wait for the server ack to arive.
     ll_modify(transaction_id, INTERNAL_ACK, TX_LL);
@@ -766,7 +852,14 @@ static void tcp_core_handle_host_ack() {
 
     uint16_t transaction_id = ack_nack_packet.transaction_id;
 
-    ESP_LOGI(TAG, "Transaction_id %d, was ACK'd popping LL", transaction_id);
+    // The server got it corrupted, leave it in the TX_LL and treat it like a
+    // lost packet: resent with PACKET_RETRY_MECHANISM, timed out without
+    if (packet_ack_get_reason(&ack_nack_packet) == NAK_BAD_CRC) {
+        ESP_LOGW(TAG, "Transaction_id %d was NAKed with a bad crc, will resend", transaction_id);
+        return;
+    }
+
+    HOT_LOG1(TRACE_TX_LL_ACKED, "Transaction_id %d, was ACK'd popping LL", transaction_id);
 
     // POP TX_LL
     ll_delete(TX_LL, transaction_id, TAKE_SEM);
@@ -787,6 +880,7 @@ static void tcp_core_handle_host_ack() {
 // B) Internal TCP write ack (packet sent out)
 // C) Event timer, time to walk the LL and see if anything is expired.
 static void tcp_core_write_tx_ll_manager(void* pvParameters) {
+    stats_register_task(STATS_TASK_TX_MANAGER);
     for (;;) {
         QueueHandle_t xActivatedMember = xQueueSelectFromSet(tcp_core_tx_manager_queue_set, portMAX_DELAY);
 
@@ -807,6 +901,7 @@ static void tcp_core_write_tx_ll_manager(void* pvParameters) {
 }
 
 static void global_event_core(void* pvParameters) {
+    stats_register_task(STATS_TASK_TIMER);
     for (;;) {
         int foo = 0;
         xQueueSendToBack(tcp_core_write_event, (const void*)&foo, 0);
@@ -877,6 +972,11 @@ void tcp_core_init_freertos_objects() {
     ASSERT(tcp_core_host_ack);
     ASSERT(tcp_core_tx_manager_queue_set);
     ASSERT(tcp_status);
+
+    stats_register_queue(STATS_Q_TCP_CORE_SEND, tcp_core_send);
+    stats_register_queue(STATS_Q_TCP_CORE_SEND_ACK, tcp_core_send_ack);
+    stats_register_queue(STATS_Q_TCP_CORE_PROCESSED, tcp_core_processed_packet);
+    stats_register_queue(STATS_Q_TCP_CORE_SOCKET_WRITE, tcp_core_socket_write);
 }
 
 void tcp_core_spawn_main(void) {
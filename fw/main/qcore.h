@@ -111,6 +111,16 @@ typedef struct
 #define ACK_GOOD             (0)
 #define NAK_TCP_DOWN         (1)
 #define SERVER_ACK_TIMED_OUT (2)
+#define NAK_BAD_CRC          (3)
+#define NAK_SERVER_DB        (4) // LOGIN, the server could not commit the punch in time
+/**********************************************************
+ *                      FRAME CRC
+ *********************************************************/
+// low 16 bits of the CRC-32C of the frame, taken with the crc field zeroed.
+// 0 means the sender did not set one (old firmware/server), a frame that
+// really sums to 0 goes out as PACKET_CRC_ZERO
+#define PACKET_CRC_NONE (0x0000)
+#define PACKET_CRC_ZERO (0xFFFF)
 /**********************************************************
  *               CONSUMER ACK REQUIREMENTS
  *********************************************************/
@@ -0,0 +1,175 @@
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "string.h"
+#include <stdio.h>
+
+#include "ll.h"
+#include "qcore.h"
+#include "stats_core.h"
+#include "system_defines.h"
+
+/**********************************************************
+*              STATS CORE STATIC VARIABLES
+**********************************************************/
+static const char    TAG[] = "STATS_CORE";
+static uint32_t      counters[STATS_MAX];
+static TaskHandle_t  tasks[STATS_TASK_MAX];
+static portMUX_TYPE  tasks_mux = portMUX_INITIALIZER_UNLOCKED;
+static QueueHandle_t queues[STATS_Q_MAX];
+
+// snapshot is sent back inside a single cmd response
+_Static_assert(sizeof(stats_snapshot_t) <= CMD_RESPONSE_PAYLOAD_LEN, "stats snapshot does not fit in a cmd response");
+
+static const char* counter_names[STATS_MAX] = {
+    "tcp_connects",
+    "tcp_socket_errors",
+    "tcp_rx_bytes",
+    "tcp_tx_bytes",
+    "pkt_rx",
+    "pkt_tx",
+    "pkt_rx_bad_type",
+    "pkt_retransmit",
+    "pkt_timed_out",
+    "ll_nodes_added",
+    "ll_full_waits",
+    "cmds_processed",
+    "cmds_rejected_busy",
+    "logins",
+    "logins_dropped",
+    "file_ops",
+    "file_errors",
+    "print_scans",
+    "print_no_match",
+    "fota_started",
+    "pkt_rx_bad_crc",
+};
+
+static const char* queue_names[STATS_Q_MAX] = {
+    "tcp_core_send",
+    "tcp_core_send_ack",
+    "tcp_core_processed",
+    "tcp_core_socket_write",
+    "parallax_login",
+    "lcd_print",
+    "master_to_fota",
+    "file_command",
+};
+
+static const char* task_names[STATS_TASK_MAX] = {
+    "master_core",
+    "registeration_core",
+    "tcp_core",
+    "reader_task",
+    "writer_task",
+    "tcp_core write manager",
+    "tx-manager",
+    "timer_generator",
+    "lcd_core",
+    "file_core",
+    "parallax_thread",
+};
+
+/**********************************************************
+*                  STATS CORE FUCTIONS
+**********************************************************/
+
+void stats_inc(stats_counter_e id) {
+    __atomic_fetch_add(&counters[id], 1, __ATOMIC_RELAXED);
+}
+
+void stats_add(stats_counter_e id, uint32_t n) {
+    __atomic_fetch_add(&counters[id], n, __ATOMIC_RELAXED);
+}
+
+void stats_register_task(stats_task_e id) {
+    portENTER_CRITICAL(&tasks_mux);
+    tasks[id] = xTaskGetCurrentTaskHandle();
+    portEXIT_CRITICAL(&tasks_mux);
+}
+
+// MUST be called before a registered task deletes itself. Once this returns no
+// snapshot is looking at the task, vTaskDelete can free it
+void stats_unregister_task(stats_task_e id) {
+    portENTER_CRITICAL(&tasks_mux);
+    tasks[id] = NULL;
+    portEXIT_CRITICAL(&tasks_mux);
+}
+
+void stats_register_queue(stats_queue_e id, QueueHandle_t q) {
+    queues[id] = q;
+}
+
+void stats_snapshot(stats_snapshot_t* snap) {
+    int i;
+
+    if (!snap) {
+        ASSERT(0);
+    }
+
+    memset(snap, 0, sizeof(stats_snapshot_t));
+    snap->version            = STATS_SNAPSHOT_VERSION;
+    snap->uptime_s           = esp_timer_get_time() / 1000000;
+    snap->heap_free          = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    snap->heap_min_free      = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+    snap->heap_largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+
+    snap->ll_len[RX_LL] = ll_get_counter(RX_LL);
+    snap->ll_len[TX_LL] = ll_get_counter(TX_LL);
+    snap->ll_len[CR_LL] = ll_get_counter(CR_LL);
+
+    for (i = 0; i < STATS_Q_MAX; i++) {
+        snap->queue_depth[i] = queues[i] ? uxQueueMessagesWaiting(queues[i]) : STATS_QUEUE_NOT_INIT;
+    }
+
+    // a task unregisters then deletes itself, holding the lock over the stack walk
+    // keeps its handle alive until we are done with it. Spinlock, so both cores
+    for (i = 0; i < STATS_TASK_MAX; i++) {
+        portENTER_CRITICAL(&tasks_mux);
+        TaskHandle_t t          = tasks[i];
+        snap->task_stack_hwm[i] = t ? uxTaskGetStackHighWaterMark(t) : STATS_TASK_NOT_RUNNING;
+        portEXIT_CRITICAL(&tasks_mux);
+    }
+
+    for (i = 0; i < STATS_MAX; i++) {
+        snap->counters[i] = __atomic_load_n(&counters[i], __ATOMIC_RELAXED);
+    }
+}
+
+void stats_print() {
+    stats_snapshot_t snap;
+    int              i;
+
+    stats_snapshot(&snap);
+
+    printf("uptime: %u s\n", snap.uptime_s);
+    printf("heap: free = %u, min free = %u, largest block = %u\n", snap.heap_free, snap.heap_min_free, snap.heap_largest_block);
+    printf("linked lists: rx = %hhu, tx = %hhu, cr = %hhu\n", snap.ll_len[RX_LL], snap.ll_len[TX_LL], snap.ll_len[CR_LL]);
+
+    printf("\nqueues (messages waiting):\n");
+    for (i = 0; i < STATS_Q_MAX; i++) {
+        if (snap.queue_depth[i] == STATS_QUEUE_NOT_INIT) {
+            printf("  %-24s -\n", queue_names[i]);
+        } else {
+            printf("  %-24s %hhu\n", queue_names[i], snap.queue_depth[i]);
+        }
+    }
+
+    printf("\ntasks (stack high water mark, bytes):\n");
+    for (i = 0; i < STATS_TASK_MAX; i++) {
+        if (snap.task_stack_hwm[i] == STATS_TASK_NOT_RUNNING) {
+            printf("  %-24s -\n", task_names[i]);
+        } else {
+            printf("  %-24s %hu\n", task_names[i], snap.task_stack_hwm[i]);
+        }
+    }
+
+    printf("\ncounters:\n");
+    for (i = 0; i < STATS_MAX; i++) {
+        printf("  %-24s %u\n", counter_names[i], snap.counters[i]);
+    }
+    ESP_LOGI(TAG, "Done printing stats");
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
+#include "stdint.h"
+
+/**********************************************************
+*                      COUNTERS
+*   WARNING: order is part of the wire format (GET_STATS_CMD),
+*   must be kept in line with the backend (device_stats.go)
+*   only ever append to the end of these enums!
+**********************************************************/
+typedef enum {
+    STATS_TCP_CONNECTS,       // tcp core came up
+    STATS_TCP_SOCKET_ERRORS,  // recv/send failed, tcp core torn down
+    STATS_TCP_RX_BYTES,       // bytes read off the socket
+    STATS_TCP_TX_BYTES,       // bytes written to the socket
+    STATS_PKT_RX,             // full packets out of the chunker
+    STATS_PKT_TX,             // full packets written to the socket
+    STATS_PKT_RX_BAD_TYPE,    // chunker got a type it does not know
+    STATS_PKT_RETRANSMIT,     // TX_LL resent a packet
+    STATS_PKT_TIMED_OUT,      // TX_LL gave up on a packet
+    STATS_LL_NODES_ADDED,     // nodes malloced into any LL
+    STATS_LL_FULL_WAITS,      // ll_add_node had to spin because a LL was full
+    STATS_CMDS_PROCESSED,     // commands master core started processing
+    STATS_CMDS_REJECTED_BUSY, // commands bounced because one was outstanding
+    STATS_LOGINS,             // login/logout packets sent to the server
+    STATS_LOGINS_DROPPED,     // login/logout dropped (no connection, bricked..)
+    STATS_FILE_OPS,           // file core commands
+    STATS_FILE_ERRORS,        // file core commands that did not return FILE_RET_OK
+    STATS_PRINT_SCANS,        // 1:N compares started
+    STATS_PRINT_NO_MATCH,     // 1:N compares that did not match anyone
+    STATS_FOTA_STARTED,       // fota task spawned
+    STATS_PKT_RX_BAD_CRC,     // chunker dropped a packet that failed its CRC
+    STATS_MAX
+} stats_counter_e;
+
+typedef enum {
+    STATS_Q_TCP_CORE_SEND,
+    STATS_Q_TCP_CORE_SEND_ACK,
+    STATS_Q_TCP_CORE_PROCESSED,
+    STATS_Q_TCP_CORE_SOCKET_WRITE,
+    STATS_Q_PARALLAX_LOGIN,
+    STATS_Q_LCD_PRINT,
+    STATS_Q_MASTER_TO_FOTA,
+    STATS_Q_FILE_COMMAND,
+    STATS_Q_MAX
+} stats_queue_e;
+
+typedef enum {
+    STATS_TASK_MASTER_CORE,
+    STATS_TASK_REGISTRATION,
+    STATS_TASK_TCP_CORE,
+    STATS_TASK_TCP_READER,
+    STATS_TASK_TCP_WRITER,
+    STATS_TASK_TCP_WRITE_ADAPTOR,
+    STATS_TASK_TX_MANAGER,
+    STATS_TASK_TIMER,
+    STATS_TASK_LCD,
+    STATS_TASK_FILE,
+    STATS_TASK_PARALLAX,
+    STATS_TASK_MAX
+} stats_task_e;
+
+#define STATS_SNAPSHOT_VERSION (2)
+#define STATS_TASK_NOT_RUNNING (0xFFFF)
+#define STATS_QUEUE_NOT_INIT   (0xFF)
+
+typedef struct {
+    uint8_t  version;
+    uint32_t uptime_s;
+    uint32_t heap_free;
+    uint32_t heap_min_free;
+    uint32_t heap_largest_block; // free - largest == how fragmented we are
+    uint8_t  ll_len[3];          // RX, TX, CR
+    uint8_t  queue_depth[STATS_Q_MAX];
+    uint16_t task_stack_hwm[STATS_TASK_MAX]; // bytes never used, STATS_TASK_NOT_RUNNING if task is not up
+    uint32_t counters[STATS_MAX];
+} __attribute__((packed)) stats_snapshot_t;
+
+/**********************************************************
+*                      Functions
+*********************************************************/
+// counters are lock free, safe to call from any task
+void stats_inc(stats_counter_e id);
+void stats_add(stats_counter_e id, uint32_t n);
+
+// registration just stores the handle, call from the task itself / after creating the queue
+void stats_register_task(stats_task_e id);
+void stats_unregister_task(stats_task_e id);
+void stats_register_queue(stats_queue_e id, QueueHandle_t q);
+
+void stats_snapshot(stats_snapshot_t* snap);
+void stats_print();
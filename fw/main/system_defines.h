@@ -1,5 +1,8 @@
 #pragma once
 
+#include "esp_system.h" // esp_restart, for ASSERT
+#include "stdint.h"
+
 /**********************************************************
 *                    MISC GLOBAL DEFINES
 **********************************************************/
@@ -32,6 +35,7 @@
     do {                                                                \
         if (!(x)) {                                                     \
             ESP_LOGE(TAG, "ASSERT! error %s %u\n", __FILE__, __LINE__); \
+            trace_dump_last(ASSERT_TRACE_RECORDS);                      \
             for (;;) {                                                  \
                 esp_restart();                                          \
             }                                                           \
@@ -41,6 +45,13 @@
 #define TRUE  (1)
 #define FALSE (0)
 
+// the newest trace records ASSERT prints. It prints them from the failing task, at 115200
+// baud a record is ~5 ms, the whole ring would hold the restart up for seconds
+#define ASSERT_TRACE_RECORDS (16)
+
+// trace_core.c, declared here so ASSERT works without every file pulling in trace_core.h
+void trace_dump_last(uint32_t n);
+
 /**********************************************************
 *                    FEATURES
 **********************************************************/
@@ -48,3 +59,16 @@
 
 // If set to yes, test features are compiled in
 #define TEST_MODE
+
+// Per packet / per fota block logging, one of LOG_HOT_OFF, LOG_HOT_UART or LOG_HOT_RING (see trace_core.h).
+// LOG_HOT_UART is what we used to do, it caps TCP RX and FOTA at whatever 115200 baud keeps up with.
+// A build can override them (the host build's TS_HOST_HOT_LOG)
+#ifndef QCORE_HOT_LOG
+#define QCORE_HOT_LOG LOG_HOT_RING
+#endif
+#ifndef LL_HOT_LOG
+#define LL_HOT_LOG LOG_HOT_RING
+#endif
+#ifndef FOTA_HOT_LOG
+#define FOTA_HOT_LOG LOG_HOT_RING
+#endif
@@ -10,6 +10,9 @@
 
 #define TCP_CORE_STACK_SIZE (2048)
 
+// packets in the chunker benchmark stream
+#define TCP_CORE_BENCH_PACKETS (8)
+
 // TCP core provides a global variable to let the rest of the
 // sytem know if TCP core is up or not
 typedef enum {
@@ -23,6 +26,7 @@ void tcp_core_init_freertos_objects(void);
 
 // global functions
 tcp_core_status_e get_tcp_core_status();
+int               tcp_core_bench_chunker(int rx_len, int passes, uint32_t* us, uint32_t* bytes);
 
 extern QueueHandle_t      tcp_core_send;
 extern QueueHandle_t      tcp_core_send_ack;
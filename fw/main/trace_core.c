@@ -0,0 +1,86 @@
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+
+#include "trace_core.h"
+
+/**********************************************************
+*              TRACE CORE STATIC VARIABLES
+**********************************************************/
+static trace_record_t ring[TRACE_RING_LEN];
+static uint32_t       head; // total records ever written, ring index is head % TRACE_RING_LEN
+static portMUX_TYPE   ring_mux = portMUX_INITIALIZER_UNLOCKED;
+
+_Static_assert((TRACE_RING_LEN & (TRACE_RING_LEN - 1)) == 0, "TRACE_RING_LEN must be a power of 2");
+
+static const char* event_names[TRACE_MAX] = {
+    "chunker_called",
+    "chunker_new_msg",
+    "chunker_rx_ll_add",
+    "chunker_host_ack",
+    "device_ack_tx",
+    "sock_rx",
+    "sock_tx",
+    "tx_ll_no_consumer",
+    "tx_ll_wait_consumer",
+    "tx_ll_acked",
+    "ll_add",
+    "fota_ack",
+    "fota_fetch_block",
+    "fota_meta",
+    "fota_data",
+    "fota_crc16",
+    "fota_block_committed",
+};
+
+/**********************************************************
+*                  TRACE CORE FUCTIONS
+**********************************************************/
+
+void trace_put(trace_event_e event, uint16_t a0, uint32_t a1) {
+    trace_record_t* r;
+
+    // critical section is a handful of stores, cheaper than a mutex and safe from both cores
+    portENTER_CRITICAL(&ring_mux);
+    r        = &ring[head & (TRACE_RING_LEN - 1)];
+    r->ts_us = (uint32_t)esp_timer_get_time();
+    r->event = event;
+    r->a0    = a0;
+    r->a1    = a1;
+    head++;
+    portEXIT_CRITICAL(&ring_mux);
+}
+
+// the whole ring, see trace_dump_last
+void trace_dump() {
+    trace_dump_last(TRACE_RING_LEN);
+}
+
+// the newest n records, oldest first. Does not stop writers so the oldest few records
+// may be overwritten mid dump
+void trace_dump_last(uint32_t n) {
+    uint32_t end, i;
+
+    portENTER_CRITICAL(&ring_mux);
+    end = head;
+    portEXIT_CRITICAL(&ring_mux);
+
+    if (end == 0) {
+        printf("trace ring is empty\n");
+        return;
+    }
+
+    if (n > TRACE_RING_LEN) {
+        n = TRACE_RING_LEN;
+    }
+    i = (end > n) ? end - n : 0;
+    printf("trace ring, %u records (%u total):\n", end - i, end);
+    for (; i < end; i++) {
+        trace_record_t r = ring[i & (TRACE_RING_LEN - 1)];
+        if (r.event >= TRACE_MAX) {
+            continue;
+        }
+        printf("  [%10u us] %-22s %5hu %u\n", r.ts_us, event_names[r.event], r.a0, r.a1);
+    }
+}
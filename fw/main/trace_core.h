@@ -0,0 +1,83 @@
+#pragma once
+
+#include "esp_log.h"
+#include "stdint.h"
+
+/* Hot path logging. The per packet / per fota block logs used to go straight out the UART,
+ * at 115200 baud that is what capped TCP RX and FOTA. Each module picks a mode at compile
+ * time (see FEATURES in system_defines.h) and logs through HOT_LOG1/HOT_LOG2:
+ *
+ *   LOG_HOT_OFF  - compiled out
+ *   LOG_HOT_UART - plain ESP_LOGI, same as before
+ *   LOG_HOT_RING - a 12 byte binary record into a RAM ring, no formatting, no UART
+ *
+ * The ring is printed by the "trace" console command, ASSERT prints the newest
+ * ASSERT_TRACE_RECORDS of it */
+
+#define LOG_HOT_OFF  (0)
+#define LOG_HOT_UART (1)
+#define LOG_HOT_RING (2)
+
+#define TRACE_RING_LEN (512) // must be a power of 2
+
+/**********************************************************
+*                      EVENTS
+*   keep in line with event_names in trace_core.c
+**********************************************************/
+typedef enum {
+    TRACE_CHUNKER_CALLED,       // a0 = bytes
+    TRACE_CHUNKER_NEW_MSG,      // a0 = packet type
+    TRACE_CHUNKER_RX_LL_ADD,    // a0 = packet type, a1 = RX_LL len
+    TRACE_CHUNKER_HOST_ACK,     // a0 = transaction id, a1 = reason
+    TRACE_DEVICE_ACK_TX,        // a0 = transaction id
+    TRACE_SOCK_RX,              // a0 = bytes
+    TRACE_SOCK_TX,              // a0 = transaction id
+    TRACE_TX_LL_NO_CONSUMER,    // a0 = transaction id
+    TRACE_TX_LL_WAIT_CONSUMER,  // a0 = transaction id
+    TRACE_TX_LL_ACKED,          // a0 = transaction id
+    TRACE_LL_ADD,               // a0 = ll type, a1 = ll len
+    TRACE_FOTA_ACK,             // a0 = transaction id, a1 = (type << 8) | status
+    TRACE_FOTA_FETCH_BLOCK,     // a0 = block
+    TRACE_FOTA_META,            // a0 = crc16
+    TRACE_FOTA_DATA,            // a0 = segment
+    TRACE_FOTA_CRC16,           // a0 = local, a1 = expected
+    TRACE_FOTA_BLOCK_COMMITTED, // a0 = block
+    TRACE_MAX
+} trace_event_e;
+
+typedef struct {
+    uint32_t ts_us; // esp_timer_get_time(), wraps after ~71 minutes
+    uint16_t event;
+    uint16_t a0;
+    uint32_t a1;
+} trace_record_t;
+
+/**********************************************************
+*                      MACROS
+*   the .c file must #define HOT_LOG_MODE (and TAG) first
+**********************************************************/
+#define HOT_LOG1(event, fmt, a0)                   \
+    do {                                           \
+        if (HOT_LOG_MODE == LOG_HOT_RING) {        \
+            trace_put((event), (a0), 0);           \
+        } else if (HOT_LOG_MODE == LOG_HOT_UART) { \
+            ESP_LOGI(TAG, fmt, a0);                \
+        }                                          \
+    } while (0)
+
+#define HOT_LOG2(event, fmt, a0, a1)               \
+    do {                                           \
+        if (HOT_LOG_MODE == LOG_HOT_RING) {        \
+            trace_put((event), (a0), (a1));        \
+        } else if (HOT_LOG_MODE == LOG_HOT_UART) { \
+            ESP_LOGI(TAG, fmt, a0, a1);            \
+        }                                          \
+    } while (0)
+
+/**********************************************************
+*                      Functions
+*********************************************************/
+// safe to call from any task, never blocks
+void trace_put(trace_event_e event, uint16_t a0, uint32_t a1);
+void trace_dump();
+void trace_dump_last(uint32_t n);
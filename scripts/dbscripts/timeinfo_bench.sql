@@ -0,0 +1,98 @@
+-- Query plans, old timeinfo vs the partitioned one, on a synthetic year
+-- (1000 employees, a login and a logout every weekday). Everything lives in
+-- the timeinfo_bench schema, dropped at the end, the real tables are not touched
+--
+-- psql -d checkin_co -f timeinfo_bench.sql > timeinfo_bench.txt
+
+\timing on
+set client_min_messages = warning;
+
+drop schema if exists timeinfo_bench cascade;
+create schema timeinfo_bench;
+set search_path = timeinfo_bench;
+
+create table employeeinfo(id serial PRIMARY KEY, employee VARCHAR(50));
+insert into employeeinfo (employee) select 'employee ' || i from generate_series(1, 1000) i;
+
+-- as before be/golang_be/migrate
+create table timeinfo_legacy(id bigint NOT NULL,
+                             employee VARCHAR(50),
+                             datework date,
+                             type varchar(50),
+                             timestamp time without time zone
+                            );
+
+insert into timeinfo_legacy
+  select e.id, e.employee, d::date, p.type,
+         p.at + (random() * interval '20 minutes')
+  from employeeinfo e,
+       generate_series(date '2024-01-01', date '2024-12-31', interval '1 day') d,
+       (values ('login', time '08:50'), ('logout', time '17:00')) p(type, at)
+  where extract(isodow from d) < 6;
+
+-- as in setup.sql
+create table timeinfo(employee integer NOT NULL REFERENCES employeeinfo(id),
+                      punched_at timestamp with time zone NOT NULL,
+                      type varchar(8) NOT NULL CHECK (type in ('login', 'logout'))
+                     ) PARTITION BY RANGE (punched_at);
+create index timeinfo_employee_punched_at on timeinfo(employee, punched_at);
+
+do $$
+declare m date;
+begin
+  for m in select generate_series(date '2024-01-01', date '2024-12-01', interval '1 month') loop
+    execute format('create table timeinfo_y%sm%s partition of timeinfo for values from (%L) to (%L)',
+                   to_char(m, 'YYYY'), to_char(m, 'MM'), m::timestamptz, (m + interval '1 month')::timestamptz);
+  end loop;
+end $$;
+
+insert into timeinfo select id, (datework + timestamp)::timestamptz, type from timeinfo_legacy;
+
+vacuum analyze timeinfo_legacy;
+vacuum analyze timeinfo;
+
+select pg_size_pretty(pg_total_relation_size('timeinfo_legacy')) as legacy_size,
+       (select pg_size_pretty(sum(pg_total_relation_size(inhrelid))) from pg_inherits
+        where inhparent = 'timeinfo'::regclass) as partitioned_size;
+
+-- one employee's day, what db_get_time_worked_in_day used to ask
+explain (analyze, buffers)
+  select timestamp from timeinfo_legacy where id = 500 and datework = '2024-06-12' and type = 'login';
+explain (analyze, buffers)
+  select punched_at from timeinfo where employee = 500
+    and punched_at >= '2024-06-12' and punched_at < '2024-06-13' and type = 'login';
+
+-- one employee's pay period
+explain (analyze, buffers)
+  select datework, type, timestamp from timeinfo_legacy
+    where id = 500 and datework >= '2024-06-01' and datework <= '2024-06-15';
+explain (analyze, buffers)
+  select punched_at, type from timeinfo
+    where employee = 500 and punched_at >= '2024-06-01' and punched_at < '2024-06-16';
+
+-- everyone's pay period, the daily_hours backfill shape
+explain (analyze, buffers)
+  select datework, id, min(timestamp) filter (where type = 'login'), max(timestamp) filter (where type = 'logout')
+    from timeinfo_legacy where datework >= '2024-06-01' and datework <= '2024-06-15' group by 1, 2;
+explain (analyze, buffers)
+  select punched_at::date, employee, min(punched_at::time) filter (where type = 'login'), max(punched_at::time) filter (where type = 'logout')
+    from timeinfo where punched_at >= '2024-06-01' and punched_at < '2024-06-16' group by 1, 2;
+
+-- a month of the csv export
+explain (analyze, buffers)
+  select id, employee, datework, type, timestamp from timeinfo_legacy
+    where datework >= '2024-06-01' and datework < '2024-07-01';
+explain (analyze, buffers)
+  select t.employee, e.employee, t.punched_at::date, t.type, t.punched_at::time
+    from timeinfo t join employeeinfo e on e.id = t.employee
+    where t.punched_at >= '2024-06-01' and t.punched_at < '2024-07-01';
+
+-- dropping a month of history, a DELETE vs dropping its partition
+explain (analyze, buffers)
+  delete from timeinfo_legacy where datework < '2024-02-01';
+\echo 'partitioned: alter table timeinfo detach partition timeinfo_y2024m01; drop table timeinfo_y2024m01;'
+alter table timeinfo detach partition timeinfo_y2024m01;
+drop table timeinfo_y2024m01;
+
+reset search_path;
+drop schema timeinfo_bench cascade;
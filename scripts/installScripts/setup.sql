@@ -3,22 +3,28 @@ create database checkin_co;
 \connect checkin_co;
 
 drop table timeinfo;
+drop table daily_hours;
 drop table employeeinfo;
 drop table shiftinfo;
 drop table registeredDeviceId;
 drop table sitepasswords;
+drop table devicestats;
 
-create table timeinfo(id bigint NOT NULL, 
-	                    employee VARCHAR(50), 
-                      datework date,
-                      type varchar(50),
-                      timestamp time without time zone
-                 	    );
+-- timeinfo rolled up per employee per day, kept up to date by core (daily_hours.go).
+-- anomaly is one of the TIME_WORKED_* codes, NULL until core has judged the day
+create table daily_hours(datework date NOT NULL,
+                         id bigint NOT NULL,
+                         first_in time without time zone,
+                         last_out time without time zone,
+                         worked interval,
+                         anomaly integer,
+                         PRIMARY KEY (datework, id)
+                        );
 
 create table employeeinfo(id serial PRIMARY KEY,
-                        employee VARCHAR(50) UNIQUE,
+                        employee VARCHAR(50),
                         salary   integer,
-                        email    varchar UNIQUE,
+                        email    varchar,
                         shift_m_s time without time zone,
                         shift_m_e time without time zone,
                         shift_t_s time without time zone,
@@ -28,8 +34,42 @@ create table employeeinfo(id serial PRIMARY KEY,
                         shift_th_s time without time zone,
                         shift_th_e time without time zone,
                         shift_f_s time without time zone,
-                        shift_f_e time without time zone
+                        shift_f_e time without time zone,
+                        deleted_at timestamp with time zone
                        );
+
+-- a deleted employee keeps their row (and their punches), names and emails are only
+-- unique among the ones still here
+create unique index employeeinfo_employee_active on employeeinfo(employee) where deleted_at is null;
+create unique index employeeinfo_email_active on employeeinfo(email) where deleted_at is null;
+
+-- one row per punch, partitioned by month. core creates the current and next month's
+-- partition (timeinfo_partition.go), be/golang_be/migrate moves a pre-partition timeinfo in
+create table timeinfo(employee integer NOT NULL REFERENCES employeeinfo(id),
+                      punched_at timestamp with time zone NOT NULL,
+                      type varchar(8) NOT NULL CHECK (type in ('login', 'logout'))
+                     ) PARTITION BY RANGE (punched_at);
+
+create index timeinfo_employee_punched_at on timeinfo(employee, punched_at);
+
+-- core caches employeeinfo (employee_dir.go), tell it what changed. The payload is the id, empty for a truncate
+create or replace function employeeinfo_notify() returns trigger as $$
+begin
+  if TG_OP = 'TRUNCATE' then
+    perform pg_notify('employeeinfo_changed', '');
+  elsif TG_OP = 'DELETE' then
+    perform pg_notify('employeeinfo_changed', OLD.id::text);
+  else
+    perform pg_notify('employeeinfo_changed', NEW.id::text);
+  end if;
+  return null;
+end;
+$$ language plpgsql;
+
+create trigger employeeinfo_changed after insert or update or delete on employeeinfo
+  for each row execute procedure employeeinfo_notify();
+create trigger employeeinfo_truncated after truncate on employeeinfo
+  for each statement execute procedure employeeinfo_notify();
                         
 create table shiftinfo(userid int NOT NULL, 
 	           employee VARCHAR(50), 
@@ -46,4 +86,13 @@ create table sitepasswords(username VARCHAR(50),
                            password VARCHAR(50)
                           );
 
+create table devicestats(deviceid bigint NOT NULL,
+                         taken timestamp without time zone NOT NULL,
+                         uptime_s bigint,
+                         heap_free bigint,
+                         heap_min_free bigint,
+                         heap_largest_block bigint,
+                         snapshot jsonb
+                        );
 
+create index devicestats_deviceid_taken on devicestats(deviceid, taken);